@@ -3,269 +3,287 @@ package main
 import (
 	"context"
 	"log"
+	"sync"
 	"time"
 
 	"go.mongodb.org/mongo-driver/bson"
+	"go.mongodb.org/mongo-driver/mongo"
+	"go.mongodb.org/mongo-driver/mongo/options"
 )
 
-// startAggregationWorkers starts background goroutines for periodic aggregation
-func startAggregationWorkers() {
-	log.Println("Starting historical data aggregation workers...")
+// Metrics tiers, finest first. Each coarser tier is rebuilt from the
+// snapshots of the one before it.
+var rollupTiers = []struct {
+	name   string
+	window time.Duration
+}{
+	{"1m", time.Minute},
+	{"5m", 5 * time.Minute},
+	{"1h", time.Hour},
+}
 
-	// 1-minute aggregation worker
-	go func() {
-		ticker := time.NewTicker(1 * time.Minute)
-		defer ticker.Stop()
+const (
+	rollupFlushInterval = 10 * time.Second
+	// How long a 1m window stays in memory after it ends. An event for an
+	// evicted window reopens it from its stored snapshot.
+	rollupRetain = 3 * time.Minute
+	// Minimum time between refreshes of the device and AP totals
+	rollupTotalsInterval = time.Minute
+)
 
-		// Run immediately on startup
-		if err := aggregateMetrics("1m", time.Minute); err != nil {
-			log.Printf("1m aggregation error: %v", err)
-		}
+// rollupEngine keeps the open 1m windows. The ingest handlers add every
+// stored event to its window; the flush loop writes the windows that
+// changed and rolls them up into the coarser tiers.
+type rollupEngine struct {
+	mu      sync.Mutex
+	windows map[time.Time]*rollupWindow
+
+	// Owned by the flush loop
+	devicesTotal int
+	apsTotal     int
+	totalsAt     time.Time
+}
 
-		for range ticker.C {
-			if err := aggregateMetrics("1m", time.Minute); err != nil {
-				log.Printf("1m aggregation error: %v", err)
-			}
-		}
-	}()
+var rollups = &rollupEngine{windows: make(map[time.Time]*rollupWindow)}
 
-	// 5-minute aggregation worker
-	go func() {
-		ticker := time.NewTicker(5 * time.Minute)
-		defer ticker.Stop()
+// window returns the 1m window containing ts; callers hold mu
+func (e *rollupEngine) window(ts time.Time) *rollupWindow {
+	start := ts.Truncate(time.Minute)
+	w := e.windows[start]
+	if w == nil {
+		w = newRollupWindow(start)
+		e.windows[start] = w
+	}
+	return w
+}
 
-		// Run immediately on startup
-		if err := aggregateMetrics("5m", 5*time.Minute); err != nil {
-			log.Printf("5m aggregation error: %v", err)
+// add folds stored DeviceEvents and AccessPointEvents into their windows
+func (e *rollupEngine) add(events ...interface{}) {
+	e.mu.Lock()
+	defer e.mu.Unlock()
+
+	for _, ev := range events {
+		switch ev := ev.(type) {
+		case DeviceEvent:
+			e.window(ev.Timestamp).addDeviceEvent(&ev)
+		case AccessPointEvent:
+			e.window(ev.Timestamp).addAPEvent(&ev)
 		}
+	}
+}
 
-		for range ticker.C {
-			if err := aggregateMetrics("5m", 5*time.Minute); err != nil {
-				log.Printf("5m aggregation error: %v", err)
-			}
-		}
-	}()
+// touch marks the window containing ts as changed, for data that is read
+// at flush time (probe sketches)
+func (e *rollupEngine) touch(ts time.Time) {
+	e.mu.Lock()
+	e.window(ts).dirty = true
+	e.mu.Unlock()
+}
 
-	// 1-hour aggregation worker
-	go func() {
-		ticker := time.NewTicker(1 * time.Hour)
-		defer ticker.Stop()
+// startAggregationWorkers runs the rollup flush loop
+func startAggregationWorkers() {
+	log.Println("Starting incremental metrics rollups...")
 
-		// Run immediately on startup
-		if err := aggregateMetrics("1h", time.Hour); err != nil {
-			log.Printf("1h aggregation error: %v", err)
-		}
+	ticker := time.NewTicker(rollupFlushInterval)
+	defer ticker.Stop()
 
-		for range ticker.C {
-			if err := aggregateMetrics("1h", time.Hour); err != nil {
-				log.Printf("1h aggregation error: %v", err)
-			}
+	for range ticker.C {
+		if err := rollups.flush(); err != nil {
+			log.Printf("Metrics rollup error: %v", err)
 		}
-	}()
+	}
 }
 
-// aggregateMetrics creates a snapshot of current metrics
-func aggregateMetrics(tier string, windowDuration time.Duration) error {
+// flush writes every changed 1m window, then rebuilds the 5m and 1h
+// windows above them. Nothing here reads raw events, so its cost depends
+// on the number of windows, not the event volume.
+func (e *rollupEngine) flush() error {
 	ctx, cancel := context.WithTimeout(context.Background(), 30*time.Second)
 	defer cancel()
 
 	now := time.Now()
-	// Round timestamp to the start of the interval
-	var roundedTime time.Time
-	switch tier {
-	case "1m":
-		roundedTime = now.Truncate(time.Minute)
-	case "5m":
-		roundedTime = now.Truncate(5 * time.Minute)
-	case "1h":
-		roundedTime = now.Truncate(time.Hour)
-	}
-
-	snapshot := MetricsSnapshot{
-		Timestamp: roundedTime,
-		Tier:      tier,
+	tier := rollupTiers[0]
+
+	// Windows reopened after eviction (or an API restart) first fold in
+	// what was already stored for them
+	e.mu.Lock()
+	var reopened []*rollupWindow
+	for _, w := range e.windows {
+		if w.dirty && !w.loaded {
+			reopened = append(reopened, w)
+		}
 	}
+	e.mu.Unlock()
 
-	deviceEvents := db.Collection("device_events")
-	apEvents := db.Collection("access_point_events")
+	for _, w := range reopened {
+		var stored MetricsSnapshot
+		err := db.Collection("metrics_"+tier.name).FindOne(ctx, bson.M{"tier": tier.name, "timestamp": w.start}).Decode(&stored)
+		if err != nil && err != mongo.ErrNoDocuments {
+			return err
+		}
 
-	// Get aggregate device stats
-	if distinctDevices, err := deviceEvents.Distinct(ctx, "mac_address", bson.M{}); err == nil {
-		snapshot.Devices.Total = len(distinctDevices)
+		e.mu.Lock()
+		if err == nil {
+			w.addSnapshot(&stored)
+		}
+		w.loaded = true
+		e.mu.Unlock()
 	}
 
-	activeCutoff := now.Add(-windowDuration)
-	activeFilter := bson.M{"timestamp": bson.M{"$gte": activeCutoff}}
+	e.refreshTotals(ctx, now)
 
-	if activeDevices, err := deviceEvents.Distinct(ctx, "mac_address", activeFilter); err == nil {
-		snapshot.Devices.Active = len(activeDevices)
+	e.mu.Lock()
+	// The current minute gets a snapshot even when nothing arrives
+	if _, ok := e.windows[now.Truncate(tier.window)]; !ok {
+		e.window(now).dirty = true
 	}
-
-	if connectedDevices, err := deviceEvents.Distinct(ctx, "mac_address", bson.M{
-		"timestamp": bson.M{"$gte": activeCutoff},
-		"connected": true,
-	}); err == nil {
-		snapshot.Devices.Connected = len(connectedDevices)
+	var snapshots []MetricsSnapshot
+	for start, w := range e.windows {
+		if w.dirty && w.loaded {
+			w.dirty = false
+			w.devicesTotal, w.apsTotal = e.devicesTotal, e.apsTotal
+			snapshots = append(snapshots, w.snapshot(tier.name))
+		} else if !w.dirty && now.Sub(start) > tier.window+rollupRetain {
+			delete(e.windows, start)
+		}
 	}
-
-	// Get aggregate AP stats
-	if distinctAPs, err := apEvents.Distinct(ctx, "bssid", bson.M{}); err == nil {
-		snapshot.AccessPoints.Total = len(distinctAPs)
+	e.mu.Unlock()
+
+	// A window is clean only once it and its parents are written. The
+	// writes are upserts and rebuilds, so on failure every window of this
+	// flush is marked again and the next flush repeats them.
+	if err := writeSnapshots(ctx, snapshots); err != nil {
+		e.mu.Lock()
+		for i := range snapshots {
+			if w, ok := e.windows[snapshots[i].Timestamp]; ok {
+				w.dirty = true
+			}
+		}
+		e.mu.Unlock()
+		return err
 	}
 
-	if activeAPs, err := apEvents.Distinct(ctx, "bssid", activeFilter); err == nil {
-		snapshot.AccessPoints.Active = len(activeAPs)
+	if len(snapshots) > 0 {
+		log.Printf("Rolled up %d 1m window(s) into metrics tiers", len(snapshots))
 	}
+	return nil
+}
 
-	// Aggregate per-device metrics from recent events
-	deviceMetricsPipeline := []bson.M{
-		{"$match": bson.M{"timestamp": bson.M{"$gte": activeCutoff}}},
-		{"$group": bson.M{
-			"_id":          "$mac_address",
-			"vendor":       bson.M{"$last": "$vendor"},
-			"connected":    bson.M{"$last": "$connected"},
-			"packet_count": bson.M{"$sum": 1},
-			"data_bytes":   bson.M{"$sum": "$data_byte_count"},
-			"rssi_values":  bson.M{"$push": "$rssi"},
-		}},
-		{"$limit": 500},
+// writeSnapshots stores 1m window snapshots and rebuilds the windows of
+// the higher tiers that contain them
+func writeSnapshots(ctx context.Context, snapshots []MetricsSnapshot) error {
+	tier := rollupTiers[0]
+
+	// Parent windows to rebuild, per tier
+	changed := make(map[time.Time]bool)
+	for i := range snapshots {
+		s := &snapshots[i]
+		s.Probes = mergeProbeSketches(ctx, s.Timestamp, s.Timestamp.Add(tier.window))
+		if err := upsertSnapshot(ctx, s); err != nil {
+			return err
+		}
+		changed[s.Timestamp] = true
 	}
 
-	cursor, err := deviceEvents.Aggregate(ctx, deviceMetricsPipeline)
-	if err == nil {
-		defer cursor.Close(ctx)
-
-		for cursor.Next(ctx) {
-			var result bson.M
-			if err := cursor.Decode(&result); err != nil {
-				continue
-			}
-
-			rssiValues := extractIntSlice(result["rssi_values"])
-			metric := DeviceMetric{
-				MACAddress:  asString(result["_id"]),
-				PacketCount: asInt(result["packet_count"]),
-				DataBytes:   asInt64(result["data_bytes"]),
-				Connected:   asBool(result["connected"]),
-				Vendor:      asString(result["vendor"]),
-			}
+	for i := 1; i < len(rollupTiers); i++ {
+		child, parent := rollupTiers[i-1], rollupTiers[i]
+		parents := make(map[time.Time]bool)
+		for start := range changed {
+			parents[start.Truncate(parent.window)] = true
+		}
 
-			if len(rssiValues) > 0 {
-				metric.RSSIAvg, metric.RSSIMin, metric.RSSIMax = calculateRSSIStats(rssiValues)
+		for start := range parents {
+			if err := rebuildWindow(ctx, child.name, parent.name, start, parent.window); err != nil {
+				return err
 			}
-
-			snapshot.DeviceMetrics = append(snapshot.DeviceMetrics, metric)
 		}
+		changed = parents
 	}
 
-	// Aggregate per-AP metrics from recent events
-	apMetricsPipeline := []bson.M{
-		{"$match": bson.M{"timestamp": bson.M{"$gte": activeCutoff}}},
-		{"$group": bson.M{
-			"_id":          "$bssid",
-			"ssid":         bson.M{"$last": "$ssid"},
-			"channel":      bson.M{"$last": "$channel"},
-			"beacon_count": bson.M{"$sum": 1},
-			"rssi_values":  bson.M{"$push": "$rssi"},
-		}},
-		{"$limit": 500},
-	}
-
-	cursor, err = apEvents.Aggregate(ctx, apMetricsPipeline)
-	if err == nil {
-		defer cursor.Close(ctx)
-
-		for cursor.Next(ctx) {
-			var result bson.M
-			if err := cursor.Decode(&result); err != nil {
-				continue
-			}
-
-			rssiValues := extractIntSlice(result["rssi_values"])
-			metric := APMetric{
-				BSSID:       asString(result["_id"]),
-				SSID:        asString(result["ssid"]),
-				Channel:     asInt(result["channel"]),
-				BeaconCount: asInt(result["beacon_count"]),
-			}
+	return nil
+}
 
-			if len(rssiValues) > 0 {
-				metric.RSSIAvg, metric.RSSIMin, metric.RSSIMax = calculateRSSIStats(rssiValues)
-			}
+// refreshTotals counts the known devices (one summary each) and the
+// distinct APs, at most once per rollupTotalsInterval. The bssid index
+// makes the latter a distinct-key scan rather than an event scan.
+func (e *rollupEngine) refreshTotals(ctx context.Context, now time.Time) {
+	if now.Sub(e.totalsAt) < rollupTotalsInterval {
+		return
+	}
 
-			snapshot.APMetrics = append(snapshot.APMetrics, metric)
-		}
+	if n, err := db.Collection("devices").EstimatedDocumentCount(ctx); err == nil {
+		e.devicesTotal = int(n)
 	}
+	if bssids, err := db.Collection("access_point_events").Distinct(ctx, "bssid", bson.M{}); err == nil {
+		e.apsTotal = len(bssids)
+	}
+	e.totalsAt = now
+}
 
-	// Store the snapshot in the appropriate collection
-	collectionName := "metrics_" + tier
-	_, err = db.Collection(collectionName).InsertOne(ctx, snapshot)
+// rebuildWindow recomputes one window of a coarser tier from the stored
+// snapshots of the finer tier inside it. A child that has already expired
+// drops out of the rebuilt window, which only matters when backfilling
+// data older than the child tier's retention.
+func rebuildWindow(ctx context.Context, childTier, tier string, start time.Time, window time.Duration) error {
+	cursor, err := db.Collection("metrics_"+childTier).Find(ctx, bson.M{
+		"tier":      childTier,
+		"timestamp": bson.M{"$gte": start, "$lt": start.Add(window)},
+	}, options.Find().SetSort(bson.D{{Key: "timestamp", Value: 1}}))
 	if err != nil {
 		return err
 	}
+	defer cursor.Close(ctx)
 
-	log.Printf("Created %s metrics snapshot: %d devices, %d APs (active: %d/%d)",
-		tier, snapshot.Devices.Total, snapshot.AccessPoints.Total,
-		snapshot.Devices.Active, snapshot.AccessPoints.Active)
-
-	return nil
-}
-
-func asString(value interface{}) string {
-	if value == nil {
-		return ""
+	w := newRollupWindow(start)
+	for cursor.Next(ctx) {
+		var child MetricsSnapshot
+		if err := cursor.Decode(&child); err != nil {
+			continue
+		}
+		w.addSnapshot(&child)
 	}
-	if str, ok := value.(string); ok {
-		return str
+	if err := cursor.Err(); err != nil {
+		return err
 	}
-	return ""
-}
 
-func asInt(value interface{}) int {
-	switch v := value.(type) {
-	case int:
-		return v
-	case int32:
-		return int(v)
-	case int64:
-		return int(v)
-	case float64:
-		return int(v)
-	default:
-		return 0
-	}
+	snapshot := w.snapshot(tier)
+	return upsertSnapshot(ctx, &snapshot)
 }
 
-func asInt64(value interface{}) int64 {
-	switch v := value.(type) {
-	case int64:
-		return v
-	case int32:
-		return int64(v)
-	case int:
-		return int64(v)
-	case float64:
-		return int64(v)
-	default:
-		return 0
-	}
+// upsertSnapshot replaces the stored snapshot of a window, or creates it
+func upsertSnapshot(ctx context.Context, s *MetricsSnapshot) error {
+	_, err := db.Collection("metrics_"+s.Tier).ReplaceOne(ctx,
+		bson.M{"tier": s.Tier, "timestamp": s.Timestamp}, s, options.Replace().SetUpsert(true))
+	return err
 }
 
-func asBool(value interface{}) bool {
-	if b, ok := value.(bool); ok {
-		return b
+// mergeProbeSketches merges every sniffer's probe sketches with an interval
+// start in [from, to) into one summary
+func mergeProbeSketches(ctx context.Context, from, to time.Time) ProbeSummary {
+	cursor, err := db.Collection("probe_sketches").Find(ctx, bson.M{
+		"timestamp": bson.M{"$gte": from, "$lt": to},
+	})
+	if err != nil {
+		log.Printf("Probe sketch query error: %v", err)
+		return ProbeSummary{}
 	}
-	return false
-}
+	defer cursor.Close(ctx)
 
-func extractIntSlice(value interface{}) []int {
-	raw, ok := value.([]interface{})
-	if !ok {
-		return nil
+	var merged *ProbeSketch
+	for cursor.Next(ctx) {
+		var sketch ProbeSketch
+		if err := cursor.Decode(&sketch); err != nil {
+			continue
+		}
+		if merged == nil {
+			merged = &sketch
+		} else if err := merged.merge(&sketch); err != nil {
+			log.Printf("Skipping probe sketch from %s: %v", sketch.SnifferID, err)
+		}
 	}
-	result := make([]int, 0, len(raw))
-	for _, item := range raw {
-		result = append(result, asInt(item))
+
+	if merged == nil {
+		return ProbeSummary{}
 	}
-	return result
+	return merged.summary()
 }
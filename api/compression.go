@@ -0,0 +1,129 @@
+package main
+
+import (
+	"bufio"
+	"compress/gzip"
+	"compress/zlib"
+	"encoding/binary"
+	"fmt"
+	"hash/adler32"
+	"io"
+	"net/http"
+	"strings"
+
+	"github.com/gin-gonic/gin"
+)
+
+// maxDecodedBodyBytes bounds a decompressed request body, so a small
+// compressed body cannot expand without limit
+const maxDecodedBodyBytes = 8 << 20
+
+// ingestDictionaries are the preset deflate dictionaries compressed
+// batches may use, current first. Sniffers fetch the current one from
+// /ingest/dictionary; a zlib stream names its dictionary by Adler-32, so
+// when it changes the old one stays listed until every sniffer has
+// restarted or been refused with 415 and fetched the new one.
+var ingestDictionaries = [][]byte{ingestDictionaryV1}
+
+// ingestDictionaryV1 is built from the sniffer's batch records. deflate
+// finds matches at short distances more cheaply, so the most frequent
+// strings come last.
+var ingestDictionaryV1 = []byte(strings.Join([]string{
+	"FLX\x03",
+	`{"type":"disconnection","ts_us":17,"seq":,"mac_address":"","frame_count":1}`,
+	`{"type":"connection","ts_us":17,"seq":,"mac_address":"","bssid":"","rssi":-`,
+	`{"type":"data","ts_us":17,"seq":,"mac_address":"","frame_count":,"byte_count":,"rssi":-,"direction":"downlink"}`,
+	`"direction":"uplink"},"direction":"wds"},"direction":"adhoc"}`,
+	`"vendor":"VirtualBox","vendor":"QEMU/KVM","vendor":"Microsoft","vendor":"Cisco","vendor":"TP-Link"`,
+	`"vendor":"Google","vendor":"Samsung","vendor":"Apple"`,
+	`"encryption":"Open","encryption":"WEP","encryption":"OWE","encryption":"WPA-PSK","encryption":"WPA2-EAP"`,
+	`"encryption":"WPA2-PSK/WPA3-SAE","encryption":"WPA3-SAE","encryption":"WPA2-PSK"`,
+	`"max_rate":54,"country":"US","country":"GB","country":"DE"`,
+	`{"type":"access_point","ts_us":17,"seq":,"bssid":"","ssid":"","channel":1,"channel":6,"channel":11,"channel":36,"rssi":-,"beacon_count":1,`,
+	`"capabilities":["ht","vht","he","wmm","wps","p2p","rrm","btm"]`,
+	`"capabilities":["ht","vht","he","wmm"]},"capabilities":["ht","wmm","rrm","btm"]}`,
+	`"probe_ssid":"","vendor":"Unknown","fingerprint":"`,
+	`{"type":"device","ts_us":17,"seq":,"mac_address":"","rssi":-`,
+}, ""))
+
+var ingestDictionaryByID = func() map[uint32][]byte {
+	byID := make(map[uint32][]byte, len(ingestDictionaries))
+	for _, dict := range ingestDictionaries {
+		byID[adler32.Checksum(dict)] = dict
+	}
+	return byID
+}()
+
+// getIngestDictionary serves the dictionary sniffers compress batches with
+func getIngestDictionary(c *gin.Context) {
+	c.Data(http.StatusOK, "application/octet-stream", ingestDictionaries[0])
+}
+
+// dictionaryReader reads a zlib stream (HTTP "deflate"), looking up its
+// preset dictionary, if it names one, by the Adler-32 in its header
+func dictionaryReader(body io.Reader) (io.ReadCloser, error) {
+	r := bufio.NewReader(body)
+	header, err := r.Peek(2)
+	if err != nil {
+		return nil, err
+	}
+	// Only a valid header with FDICT set names a dictionary; zlib reports
+	// anything else
+	valid := header[0]&0x0f == 8 && (uint16(header[0])<<8|uint16(header[1]))%31 == 0
+	if !valid || header[1]&0x20 == 0 {
+		return zlib.NewReader(r)
+	}
+
+	header, err = r.Peek(6)
+	if err != nil {
+		return nil, err
+	}
+	id := binary.BigEndian.Uint32(header[2:])
+	dict, ok := ingestDictionaryByID[id]
+	if !ok {
+		return nil, errUnknownDictionary(id)
+	}
+	return zlib.NewReaderDict(r, dict)
+}
+
+type errUnknownDictionary uint32
+
+func (e errUnknownDictionary) Error() string {
+	return fmt.Sprintf("unknown dictionary %08x, fetch /ingest/dictionary", uint32(e))
+}
+
+// decodeContentEncoding replaces a gzip or deflate request body with its
+// decompressed form, so handlers behind it only ever see plain bodies.
+// Unsupported encodings and unknown dictionaries are refused with 415.
+func decodeContentEncoding(c *gin.Context) {
+	encoding := strings.ToLower(strings.TrimSpace(c.GetHeader("Content-Encoding")))
+	if encoding == "" || encoding == "identity" {
+		c.Next()
+		return
+	}
+
+	var body io.ReadCloser
+	var err error
+	switch encoding {
+	case "gzip":
+		body, err = gzip.NewReader(c.Request.Body)
+	case "deflate":
+		body, err = dictionaryReader(c.Request.Body)
+	default:
+		c.AbortWithStatusJSON(http.StatusUnsupportedMediaType, gin.H{"error": "unsupported Content-Encoding " + encoding})
+		return
+	}
+	if _, ok := err.(errUnknownDictionary); ok {
+		c.AbortWithStatusJSON(http.StatusUnsupportedMediaType, gin.H{"error": err.Error()})
+		return
+	}
+	if err != nil {
+		c.AbortWithStatusJSON(http.StatusBadRequest, gin.H{"error": "bad " + encoding + " body: " + err.Error()})
+		return
+	}
+
+	c.Request.Body = http.MaxBytesReader(c.Writer, body, maxDecodedBodyBytes)
+	c.Request.Header.Del("Content-Encoding")
+	c.Request.ContentLength = -1
+	c.Next()
+}
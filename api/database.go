@@ -81,6 +81,28 @@ func initEventCollections(ctx context.Context) error {
 		if err != nil {
 			log.Printf("Failed to create event type index for %s: %v", coll.name, err)
 		}
+
+		// An event the sniffer resends or replays from its spool repeats
+		// (sniffer_id, seq) and its capture time; seq alone restarts with
+		// the sniffer. Events without a sniffer ID or seq are not checked.
+		dedupIndex := mongo.IndexModel{
+			Keys: bson.D{
+				{Key: "sniffer_id", Value: 1},
+				{Key: "seq", Value: 1},
+				{Key: "timestamp", Value: 1},
+			},
+			Options: options.Index().
+				SetUnique(true).
+				SetPartialFilterExpression(bson.M{
+					"sniffer_id": bson.M{"$exists": true},
+					"seq":        bson.M{"$exists": true},
+				}).
+				SetName("sniffer_seq_unique_index"),
+		}
+		_, err = db.Collection(coll.name).Indexes().CreateOne(ctx, dedupIndex)
+		if err != nil {
+			log.Printf("Failed to create sniffer seq index for %s: %v", coll.name, err)
+		}
 	}
 
 	// Historical metrics collections with tier TTLs
@@ -121,5 +143,36 @@ func initEventCollections(ctx context.Context) error {
 		}
 	}
 
+	// Raw probe sketches are only read by the aggregation workers, so they
+	// need to outlive the longest (1h) tier window and no more: each one is
+	// ~25 KB per sniffer per minute
+	sketchTTL := mongo.IndexModel{
+		Keys: bson.D{
+			{Key: "timestamp", Value: 1},
+		},
+		Options: options.Index().
+			SetExpireAfterSeconds(2 * 60 * 60).
+			SetName("ttl_index"),
+	}
+	if _, err := db.Collection("probe_sketches").Indexes().CreateOne(ctx, sketchTTL); err != nil {
+		log.Printf("Failed to create TTL index for probe_sketches: %v", err)
+		return err
+	}
+
+	// Device summaries expire with the last of their events, and the same
+	// index serves the last_seen sorts and ranges of /devices
+	lastSeenTTL := mongo.IndexModel{
+		Keys: bson.D{
+			{Key: "last_seen", Value: 1},
+		},
+		Options: options.Index().
+			SetExpireAfterSeconds(30 * 24 * 60 * 60).
+			SetName("ttl_index"),
+	}
+	if _, err := db.Collection("devices").Indexes().CreateOne(ctx, lastSeenTTL); err != nil {
+		log.Printf("Failed to create TTL index for devices: %v", err)
+		return err
+	}
+
 	return nil
 }
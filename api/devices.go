@@ -0,0 +1,271 @@
+package main
+
+import (
+	"context"
+	"log"
+	"time"
+
+	"go.mongodb.org/mongo-driver/bson"
+	"go.mongodb.org/mongo-driver/mongo"
+	"go.mongodb.org/mongo-driver/mongo/options"
+)
+
+// deviceRecentRSSI bounds the recent RSSI readings kept per device
+const deviceRecentRSSI = 100
+
+// deviceSummary is one document of the devices collection: everything
+// /devices shows for a MAC, kept current by the ingest handlers so reads
+// are index range scans instead of a $group over device_events. Every
+// field is updated with an order-independent operator, so batches may
+// land in any order.
+type deviceSummary struct {
+	MACAddress       string    `bson:"_id"`
+	FirstSeen        time.Time `bson:"first_seen"`
+	LastSeen         time.Time `bson:"last_seen"`
+	PacketCount      int       `bson:"packet_count"`
+	DataFrames       int       `bson:"data_frames"`
+	DataBytes        int64     `bson:"data_bytes"`
+	RSSISum          int64     `bson:"rssi_sum"`
+	RSSISamples      int64     `bson:"rssi_samples"`
+	RSSIMin          int       `bson:"rssi_min"`
+	RSSIMax          int       `bson:"rssi_max"`
+	RSSIValues       []int     `bson:"rssi_values"` // Most recent deviceRecentRSSI readings
+	Vendor           string    `bson:"vendor"`
+	ProbeSSIDs       []string  `bson:"probe_ssids"`
+	Fingerprints     []string  `bson:"fingerprints"`
+	LastConnected    time.Time `bson:"last_connected"`
+	LastDisconnected time.Time `bson:"last_disconnected"`
+}
+
+func (s *deviceSummary) toDevice() Device {
+	d := Device{
+		MACAddress:       s.MACAddress,
+		FirstSeen:        s.FirstSeen,
+		LastSeen:         s.LastSeen,
+		RSSIValues:       s.RSSIValues,
+		RSSIMin:          s.RSSIMin,
+		RSSIMax:          s.RSSIMax,
+		ProbeSSIDs:       s.ProbeSSIDs,
+		Fingerprints:     s.Fingerprints,
+		PacketCount:      s.PacketCount,
+		Vendor:           s.Vendor,
+		Connected:        s.LastConnected.After(s.LastDisconnected),
+		LastConnected:    s.LastConnected,
+		LastDisconnected: s.LastDisconnected,
+		DataFrames:       s.DataFrames,
+		DataBytes:        s.DataBytes,
+	}
+	if s.RSSISamples > 0 {
+		d.RSSIAvg = float64(s.RSSISum) / float64(s.RSSISamples)
+	}
+	return d
+}
+
+// deviceUpdate collects one MAC's events from a request
+type deviceUpdate struct {
+	firstSeen, lastSeen           time.Time
+	packets, dataFrames           int
+	dataBytes, rssiSum            int64
+	rssiMin, rssiMax              int
+	rssi                          []int
+	vendor                        string
+	vendorTs                      time.Time
+	probeSSIDs, fingerprints      []string
+	lastConnected, lastDisconnect time.Time
+}
+
+func (u *deviceUpdate) add(ev *DeviceEvent) {
+	if u.packets == 0 || ev.Timestamp.Before(u.firstSeen) {
+		u.firstSeen = ev.Timestamp
+	}
+	if u.packets == 0 || ev.RSSI < u.rssiMin {
+		u.rssiMin = ev.RSSI
+	}
+	if u.packets == 0 || ev.RSSI > u.rssiMax {
+		u.rssiMax = ev.RSSI
+	}
+	if ev.Timestamp.After(u.lastSeen) {
+		u.lastSeen = ev.Timestamp
+	}
+	weight := ev.weight()
+	u.packets += weight
+	u.dataFrames += ev.DataFrameCount
+	u.dataBytes += ev.DataByteCount
+	u.rssiSum += int64(ev.RSSI) * int64(weight)
+	u.rssi = append(u.rssi, ev.RSSI)
+
+	if ev.Vendor != "" && !ev.Timestamp.Before(u.vendorTs) {
+		u.vendor, u.vendorTs = ev.Vendor, ev.Timestamp
+	}
+	if ev.ProbeSSID != "" {
+		u.probeSSIDs = append(u.probeSSIDs, ev.ProbeSSID)
+	}
+	if ev.Fingerprint != "" {
+		u.fingerprints = append(u.fingerprints, ev.Fingerprint)
+	}
+
+	switch ev.EventType {
+	case "connection":
+		if ev.Timestamp.After(u.lastConnected) {
+			u.lastConnected = ev.Timestamp
+		}
+	case "disconnection":
+		if ev.Timestamp.After(u.lastDisconnect) {
+			u.lastDisconnect = ev.Timestamp
+		}
+	}
+}
+
+func (u *deviceUpdate) model(mac string) mongo.WriteModel {
+	update := bson.M{
+		"$min": bson.M{"first_seen": u.firstSeen, "rssi_min": u.rssiMin},
+		"$max": bson.M{"last_seen": u.lastSeen, "rssi_max": u.rssiMax},
+		"$inc": bson.M{
+			"packet_count": u.packets,
+			"data_frames":  u.dataFrames,
+			"data_bytes":   u.dataBytes,
+			"rssi_sum":     u.rssiSum,
+			"rssi_samples": int64(u.packets),
+		},
+		"$push": bson.M{"rssi_values": bson.M{"$each": u.rssi, "$slice": -deviceRecentRSSI}},
+	}
+
+	latest := update["$max"].(bson.M)
+	if !u.lastConnected.IsZero() {
+		latest["last_connected"] = u.lastConnected
+	}
+	if !u.lastDisconnect.IsZero() {
+		latest["last_disconnected"] = u.lastDisconnect
+	}
+
+	addToSet := bson.M{}
+	if len(u.probeSSIDs) > 0 {
+		addToSet["probe_ssids"] = bson.M{"$each": u.probeSSIDs}
+	}
+	if len(u.fingerprints) > 0 {
+		addToSet["fingerprints"] = bson.M{"$each": u.fingerprints}
+	}
+	if len(addToSet) > 0 {
+		update["$addToSet"] = addToSet
+	}
+	if u.vendor != "" {
+		update["$set"] = bson.M{"vendor": u.vendor}
+	}
+
+	return mongo.NewUpdateOneModel().
+		SetFilter(bson.M{"_id": mac}).
+		SetUpdate(update).
+		SetUpsert(true)
+}
+
+// updateDeviceSummaries folds stored DeviceEvents into the devices
+// collection with one upsert per MAC. The events are already stored, so
+// a failure is logged rather than failing the request.
+func updateDeviceSummaries(ctx context.Context, events ...interface{}) {
+	updates := make(map[string]*deviceUpdate)
+	var order []string
+
+	for _, ev := range events {
+		event, ok := ev.(DeviceEvent)
+		if !ok {
+			continue
+		}
+		u := updates[event.MACAddress]
+		if u == nil {
+			u = &deviceUpdate{}
+			updates[event.MACAddress] = u
+			order = append(order, event.MACAddress)
+		}
+		u.add(&event)
+	}
+	if len(order) == 0 {
+		return
+	}
+
+	models := make([]mongo.WriteModel, 0, len(order))
+	for _, mac := range order {
+		models = append(models, updates[mac].model(mac))
+	}
+
+	opts := options.BulkWrite().SetOrdered(false)
+	if _, err := db.Collection("devices").BulkWrite(ctx, models, opts); err != nil {
+		log.Printf("Device summary update error: %v", err)
+	}
+}
+
+// findDevices reads device summaries, most recently seen first
+func findDevices(ctx context.Context, filter bson.M, limit int64) ([]Device, error) {
+	opts := options.Find().SetSort(bson.D{{Key: "last_seen", Value: -1}})
+	if limit > 0 {
+		opts.SetLimit(limit)
+	}
+
+	cursor, err := db.Collection("devices").Find(ctx, filter, opts)
+	if err != nil {
+		return nil, err
+	}
+	defer cursor.Close(ctx)
+
+	devices := make([]Device, 0)
+	for cursor.Next(ctx) {
+		var summary deviceSummary
+		if err := cursor.Decode(&summary); err != nil {
+			continue
+		}
+		devices = append(devices, summary.toDevice())
+	}
+	return devices, cursor.Err()
+}
+
+// backfillDeviceSummaries builds the devices collection from device_events
+// when it is empty, which is the case once after upgrading. It is the only
+// full scan of the events and runs before the API accepts ingest, so no
+// summary is counted twice. Recent RSSI readings refill as events arrive.
+func backfillDeviceSummaries(ctx context.Context) {
+	devices := db.Collection("devices")
+	if n, err := devices.EstimatedDocumentCount(ctx); err != nil || n > 0 {
+		return
+	}
+
+	eventTime := func(eventType string) bson.M {
+		return bson.M{"$cond": bson.A{bson.M{"$eq": bson.A{"$event_type", eventType}}, "$timestamp", nil}}
+	}
+	weight := bson.M{"$ifNull": bson.A{"$sample_weight", 1}}
+	pipeline := []bson.M{
+		{"$sort": bson.M{"timestamp": 1}},
+		{"$group": bson.M{
+			"_id":               "$mac_address",
+			"first_seen":        bson.M{"$min": "$timestamp"},
+			"last_seen":         bson.M{"$max": "$timestamp"},
+			"packet_count":      bson.M{"$sum": weight},
+			"data_frames":       bson.M{"$sum": "$data_frame_count"},
+			"data_bytes":        bson.M{"$sum": "$data_byte_count"},
+			"rssi_sum":          bson.M{"$sum": bson.M{"$multiply": bson.A{"$rssi", weight}}},
+			"rssi_samples":      bson.M{"$sum": weight},
+			"rssi_min":          bson.M{"$min": "$rssi"},
+			"rssi_max":          bson.M{"$max": "$rssi"},
+			"vendor":            bson.M{"$last": "$vendor"},
+			"probe_ssids":       bson.M{"$addToSet": "$probe_ssid"},
+			"fingerprints":      bson.M{"$addToSet": "$fingerprint"},
+			"last_connected":    bson.M{"$max": eventTime("connection")},
+			"last_disconnected": bson.M{"$max": eventTime("disconnection")},
+		}},
+		{"$set": bson.M{
+			"rssi_values":  bson.A{},
+			"probe_ssids":  bson.M{"$filter": bson.M{"input": "$probe_ssids", "cond": bson.M{"$gt": bson.A{"$$this", ""}}}},
+			"fingerprints": bson.M{"$filter": bson.M{"input": "$fingerprints", "cond": bson.M{"$gt": bson.A{"$$this", ""}}}},
+		}},
+		{"$merge": bson.M{"into": "devices"}},
+	}
+
+	start := time.Now()
+	cursor, err := db.Collection("device_events").Aggregate(ctx, pipeline, options.Aggregate().SetAllowDiskUse(true))
+	if err != nil {
+		log.Printf("Device summary backfill error: %v", err)
+		return
+	}
+	cursor.Close(ctx)
+
+	n, _ := devices.EstimatedDocumentCount(ctx)
+	log.Printf("Backfilled %d device summaries from device_events in %v", n, time.Since(start).Round(time.Millisecond))
+}
@@ -8,9 +8,15 @@ import (
 
 	"github.com/gin-gonic/gin"
 	"go.mongodb.org/mongo-driver/bson"
+	"go.mongodb.org/mongo-driver/mongo"
 	"go.mongodb.org/mongo-driver/mongo/options"
 )
 
+// beaconCountSum sums the beacons represented by each AP event. Events
+// stored before sniffer-side de-duplication carry no beacon_count and
+// stand for a single beacon.
+var beaconCountSum = bson.M{"$sum": bson.M{"$ifNull": bson.A{"$beacon_count", 1}}}
+
 // getAccessPoints aggregates AP data from events on demand
 func getAccessPoints(c *gin.Context) {
 	limit := parseLimit(c.Query("limit"), 100)
@@ -37,10 +43,13 @@ func getAccessPoints(c *gin.Context) {
 				"ssid":         bson.M{"$last": "$ssid"},
 				"channel":      bson.M{"$last": "$channel"},
 				"encryption":   bson.M{"$last": "$encryption"},
+				"capabilities": bson.M{"$last": "$capabilities"},
+				"max_rate":     bson.M{"$last": "$max_rate"},
+				"country":      bson.M{"$last": "$country"},
 				"avg_rssi":     bson.M{"$avg": "$rssi"},    // Average RSSI instead of all values
 				"min_rssi":     bson.M{"$min": "$rssi"},    // Min RSSI
 				"max_rssi":     bson.M{"$max": "$rssi"},    // Max RSSI
-				"beacon_count": bson.M{"$sum": 1},
+				"beacon_count": beaconCountSum,
 			},
 		},
 		// Sort groups by most recently seen
@@ -82,6 +91,13 @@ func getAccessPoints(c *gin.Context) {
 		if encryption, ok := result["encryption"].(string); ok {
 			ap.Encryption = encryption
 		}
+		ap.Capabilities = toStrings(result["capabilities"])
+		if rate, ok := result["max_rate"].(float64); ok {
+			ap.MaxRate = rate
+		}
+		if country, ok := result["country"].(string); ok {
+			ap.Country = country
+		}
 
 		// Create synthetic RSSI values from statistics for backward compatibility
 		// This uses far less memory than storing thousands of actual values
@@ -116,7 +132,7 @@ func getActiveAccessPoints(c *gin.Context) {
 				"ssid":         bson.M{"$last": "$ssid"},
 				"channel":      bson.M{"$last": "$channel"},
 				"rssi_values":  bson.M{"$push": "$rssi"},
-				"beacon_count": bson.M{"$sum": 1},
+				"beacon_count": beaconCountSum,
 			},
 		},
 		{"$sort": bson.M{"last_seen": -1}},
@@ -166,11 +182,18 @@ func getActiveAccessPoints(c *gin.Context) {
 // ingestAccessPoint handles incoming access point beacon data
 func ingestAccessPoint(c *gin.Context) {
 	var req struct {
-		BSSID      string `json:"bssid" binding:"required"`
-		SSID       string `json:"ssid"`
-		Channel    int    `json:"channel"`
-		RSSI       int    `json:"rssi"`
-		Encryption string `json:"encryption"`
+		BSSID       string `json:"bssid" binding:"required"`
+		SSID        string `json:"ssid"`
+		Channel     int    `json:"channel"`
+		RSSI        int    `json:"rssi"`
+		Encryption  string `json:"encryption"`
+		BeaconCount int    `json:"beacon_count"`
+		TsUs        int64  `json:"ts_us"`
+		Seq         uint32 `json:"seq"`
+
+		Capabilities []string `json:"capabilities"`
+		MaxRate      float64  `json:"max_rate"`
+		Country      string   `json:"country"`
 	}
 
 	if err := c.ShouldBindJSON(&req); err != nil {
@@ -183,22 +206,34 @@ func ingestAccessPoint(c *gin.Context) {
 
 	// Create raw event
 	event := AccessPointEvent{
-		Timestamp:  time.Now(),
-		BSSID:      req.BSSID,
-		EventType:  "beacon",
-		SSID:       req.SSID,
-		Channel:    req.Channel,
-		RSSI:       req.RSSI,
-		Encryption: req.Encryption,
+		Timestamp:   captureTime(req.TsUs, time.Now()),
+		BSSID:       req.BSSID,
+		EventType:   "beacon",
+		SSID:        req.SSID,
+		Channel:     req.Channel,
+		RSSI:        req.RSSI,
+		Encryption:  req.Encryption,
+		BeaconCount: req.BeaconCount,
+		SnifferID:   c.GetHeader(snifferIDHeader),
+		Seq:         req.Seq,
+
+		Capabilities: req.Capabilities,
+		MaxRate:      req.MaxRate,
+		Country:      req.Country,
 	}
 
 	// Store raw event
 	_, err := db.Collection("access_point_events").InsertOne(ctx, event)
 	if err != nil {
+		if mongo.IsDuplicateKeyError(err) {
+			c.JSON(http.StatusOK, gin.H{"status": "duplicate"})
+			return
+		}
 		log.Printf("AP event insertion error: %v", err)
 		c.JSON(http.StatusInternalServerError, gin.H{"error": err.Error()})
 		return
 	}
+	rollups.add(event)
 
 	c.JSON(http.StatusOK, gin.H{"status": "ok"})
 }
@@ -3,6 +3,8 @@ package main
 import (
 	"context"
 	"net/http"
+	"strconv"
+	"strings"
 	"sync"
 	"time"
 
@@ -14,14 +16,46 @@ import (
 var (
 	channelHoppingConfig = ChannelHoppingConfig{
 		Enabled:     true,
+		Mode:        hopModeRoundRobin,
 		TimeoutMs:   300,
 		Channels:    []int{1, 6, 11, 2, 7, 3, 8, 4, 9, 5, 10}, // Default 2.4GHz channels
+		FrameTypes:  defaultFrameTypes(),
 		LastUpdated: time.Now(),
 	}
 	configMutex sync.RWMutex
 	configKey   = "channel_hopping"
+
+	// configChanged is closed and replaced on every save, waking all
+	// long-polling readers at once (guarded by configMutex)
+	configChanged = make(chan struct{})
+)
+
+// maxConfigWait caps how long a GET with ?wait= is held open
+const maxConfigWait = 60 * time.Second
+
+// Channel hopping modes understood by the sniffer
+const (
+	hopModeRoundRobin = "round_robin"
+	hopModeAdaptive   = "adaptive"
 )
 
+// validFrameTypes lists the frame types the sniffer can build a capture
+// filter for; anything not listed is dropped in the kernel
+var validFrameTypes = []string{"beacon", "probe_req", "assoc_req", "reassoc_req", "disassoc", "deauth", "data"}
+
+func defaultFrameTypes() []string {
+	return append([]string(nil), validFrameTypes...)
+}
+
+func isValidFrameType(name string) bool {
+	for _, t := range validFrameTypes {
+		if t == name {
+			return true
+		}
+	}
+	return false
+}
+
 // loadChannelConfig loads the channel hopping configuration from MongoDB
 func loadChannelConfig() error {
 	configMutex.Lock()
@@ -36,8 +70,11 @@ func loadChannelConfig() error {
 	var result struct {
 		ID          string    `bson:"_id"`
 		Enabled     bool      `bson:"enabled"`
+		Mode        string    `bson:"mode"`
 		TimeoutMs   int       `bson:"timeout_ms"`
 		Channels    []int     `bson:"channels"`
+		FrameTypes  []string  `bson:"frame_types"`
+		Policies    bson.M    `bson:"frame_policies"`
 		LastUpdated time.Time `bson:"last_updated"`
 	}
 
@@ -48,17 +85,62 @@ func loadChannelConfig() error {
 	}
 
 	channelHoppingConfig.Enabled = result.Enabled
+	channelHoppingConfig.Mode = result.Mode
+	if channelHoppingConfig.Mode == "" {
+		channelHoppingConfig.Mode = hopModeRoundRobin
+	}
 	channelHoppingConfig.TimeoutMs = result.TimeoutMs
 	channelHoppingConfig.Channels = result.Channels
 	if len(channelHoppingConfig.Channels) == 0 {
 		// Fallback to default channels if empty
 		channelHoppingConfig.Channels = []int{1, 6, 11, 2, 7, 3, 8, 4, 9, 5, 10}
 	}
+	channelHoppingConfig.FrameTypes = result.FrameTypes
+	if len(channelHoppingConfig.FrameTypes) == 0 {
+		// Configs saved before frame filtering existed capture everything
+		channelHoppingConfig.FrameTypes = defaultFrameTypes()
+	}
+	channelHoppingConfig.FramePolicies = nil
+	for t, p := range result.Policies {
+		if s, ok := p.(string); ok && isValidFrameType(t) && isValidFramePolicy(s) {
+			if channelHoppingConfig.FramePolicies == nil {
+				channelHoppingConfig.FramePolicies = make(map[string]string)
+			}
+			channelHoppingConfig.FramePolicies[t] = s
+		}
+	}
 	channelHoppingConfig.LastUpdated = result.LastUpdated
+	close(configChanged)
+	configChanged = make(chan struct{})
 
 	return nil
 }
 
+// isValidFramePolicy reports whether the sniffer can apply a capture
+// policy: "keep", "summary", "sample:N" or "rate:R" / "rate:R/B" with
+// counts of at least 1
+func isValidFramePolicy(policy string) bool {
+	count := func(s string) bool {
+		n, err := strconv.ParseUint(s, 10, 32)
+		return err == nil && n >= 1 && s[0] != '+'
+	}
+	switch {
+	case policy == "keep", policy == "summary":
+		return true
+	case strings.HasPrefix(policy, "sample:"):
+		return count(strings.TrimPrefix(policy, "sample:"))
+	case strings.HasPrefix(policy, "rate:"):
+		rate, burst, hasBurst := strings.Cut(strings.TrimPrefix(policy, "rate:"), "/")
+		return count(rate) && (!hasBurst || count(burst))
+	}
+	return false
+}
+
+// configETagUnsafe identifies the current config version (caller must hold lock)
+func configETagUnsafe() string {
+	return `"` + strconv.FormatInt(channelHoppingConfig.LastUpdated.UnixNano(), 10) + `"`
+}
+
 // saveChannelConfig saves the channel hopping configuration to MongoDB
 func saveChannelConfig() error {
 	configMutex.Lock()
@@ -72,16 +154,21 @@ func saveChannelConfigUnsafe() error {
 	defer cancel()
 
 	channelHoppingConfig.LastUpdated = time.Now()
+	close(configChanged)
+	configChanged = make(chan struct{})
 
 	collection := db.Collection("config")
 	filter := bson.M{"_id": configKey}
 	update := bson.M{
 		"$set": bson.M{
-			"_id":          configKey,
-			"enabled":      channelHoppingConfig.Enabled,
-			"timeout_ms":   channelHoppingConfig.TimeoutMs,
-			"channels":     channelHoppingConfig.Channels,
-			"last_updated": channelHoppingConfig.LastUpdated,
+			"_id":            configKey,
+			"enabled":        channelHoppingConfig.Enabled,
+			"mode":           channelHoppingConfig.Mode,
+			"timeout_ms":     channelHoppingConfig.TimeoutMs,
+			"channels":       channelHoppingConfig.Channels,
+			"frame_types":    channelHoppingConfig.FrameTypes,
+			"frame_policies": channelHoppingConfig.FramePolicies,
+			"last_updated":   channelHoppingConfig.LastUpdated,
 		},
 	}
 
@@ -90,11 +177,44 @@ func saveChannelConfigUnsafe() error {
 	return err
 }
 
-// getChannelConfig returns the current channel hopping configuration
+// getChannelConfig returns the current channel hopping configuration.
+// A request whose If-None-Match matches the current ETag gets 304, after
+// waiting up to ?wait= seconds for the config to change.
 func getChannelConfig(c *gin.Context) {
+	configMutex.RLock()
+	etag := configETagUnsafe()
+	changed := configChanged
+	configMutex.RUnlock()
+
+	if c.GetHeader("If-None-Match") == etag {
+		wait, _ := strconv.Atoi(c.Query("wait"))
+		timeout := time.Duration(wait) * time.Second
+		if timeout > maxConfigWait {
+			timeout = maxConfigWait
+		}
+		if timeout <= 0 {
+			c.Header("ETag", etag)
+			c.Status(http.StatusNotModified)
+			return
+		}
+
+		timer := time.NewTimer(timeout)
+		defer timer.Stop()
+		select {
+		case <-changed:
+		case <-timer.C:
+			c.Header("ETag", etag)
+			c.Status(http.StatusNotModified)
+			return
+		case <-c.Request.Context().Done():
+			return
+		}
+	}
+
 	configMutex.RLock()
 	defer configMutex.RUnlock()
 
+	c.Header("ETag", configETagUnsafe())
 	c.JSON(http.StatusOK, channelHoppingConfig)
 }
 
@@ -123,12 +243,48 @@ func updateChannelConfig(c *gin.Context) {
 		}
 	}
 
+	// Validate mode
+	if req.Mode != "" && req.Mode != hopModeRoundRobin && req.Mode != hopModeAdaptive {
+		c.JSON(http.StatusBadRequest, gin.H{"error": "mode must be round_robin or adaptive"})
+		return
+	}
+
+	// Validate frame types
+	for _, t := range req.FrameTypes {
+		if !isValidFrameType(t) {
+			c.JSON(http.StatusBadRequest, gin.H{"error": "unknown frame type: " + t})
+			return
+		}
+	}
+
+	// Validate frame policies
+	for t, p := range req.FramePolicies {
+		if !isValidFrameType(t) {
+			c.JSON(http.StatusBadRequest, gin.H{"error": "unknown frame type in frame_policies: " + t})
+			return
+		}
+		if !isValidFramePolicy(p) {
+			c.JSON(http.StatusBadRequest, gin.H{"error": "invalid frame policy for " + t + ": " + p})
+			return
+		}
+	}
+
 	configMutex.Lock()
 	channelHoppingConfig.Enabled = req.Enabled
 	channelHoppingConfig.TimeoutMs = req.TimeoutMs
+	if req.Mode != "" {
+		channelHoppingConfig.Mode = req.Mode
+	}
 	if len(req.Channels) > 0 {
 		channelHoppingConfig.Channels = req.Channels
 	}
+	if len(req.FrameTypes) > 0 {
+		channelHoppingConfig.FrameTypes = req.FrameTypes
+	}
+	// Omitted keeps the current policies; {} clears them
+	if req.FramePolicies != nil {
+		channelHoppingConfig.FramePolicies = req.FramePolicies
+	}
 	configMutex.Unlock()
 
 	if err := saveChannelConfig(); err != nil {
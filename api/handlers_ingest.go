@@ -0,0 +1,288 @@
+package main
+
+import (
+	"context"
+	"errors"
+	"fmt"
+	"io"
+	"log"
+	"net/http"
+	"time"
+
+	"github.com/gin-gonic/gin"
+	"go.mongodb.org/mongo-driver/mongo"
+	"go.mongodb.org/mongo-driver/mongo/options"
+)
+
+// maxBatchRecords bounds the size of a single /ingest/batch request
+const maxBatchRecords = 5000
+
+// snifferIDHeader names the sniffer that sent a request; with seq it lets
+// the API tell loss and duplicates apart per sniffer (see the sniffer seq
+// index in database.go)
+const snifferIDHeader = "X-Sniffer-ID"
+
+// batchRecord is one element of an /ingest/batch array. The type field
+// selects which of the single-event ingest routes the record mirrors.
+type batchRecord struct {
+	Type       string `json:"type"` // "device", "access_point", "connection", "disconnection", "data"
+	MACAddress string `json:"mac_address"`
+	BSSID      string `json:"bssid"`
+	SSID       string `json:"ssid"`
+	ProbeSSID  string `json:"probe_ssid"`
+	Vendor     string `json:"vendor"`
+	Channel    int    `json:"channel"`
+	RSSI       int    `json:"rssi"`
+	FrameCount int    `json:"frame_count"` // Data frames, deauth/disassoc frames of a disconnection, or probes a sampled device record stands for
+	ByteCount  int64  `json:"byte_count"`
+	Direction  string `json:"direction"`
+	Encryption string `json:"encryption"`
+	Beacons    int    `json:"beacon_count"`
+	TsUs       int64  `json:"ts_us"` // Capture time, Unix microseconds
+	Seq        uint32 `json:"seq"`
+
+	// Information element fields of device and access point records
+	Fingerprint  string   `json:"fingerprint"`
+	Capabilities []string `json:"capabilities"`
+	MaxRate      float64  `json:"max_rate"`
+	Country      string   `json:"country"`
+}
+
+// toDeviceEvent converts a device-side record into a DeviceEvent
+func (r *batchRecord) toDeviceEvent(ts time.Time) (DeviceEvent, bool) {
+	if r.MACAddress == "" {
+		return DeviceEvent{}, false
+	}
+
+	event := DeviceEvent{
+		Timestamp:  ts,
+		MACAddress: r.MACAddress,
+		RSSI:       r.RSSI,
+		Vendor:     r.Vendor,
+		Seq:        r.Seq,
+	}
+
+	switch r.Type {
+	case "device":
+		event.EventType = "probe"
+		event.ProbeSSID = r.ProbeSSID
+		event.Fingerprint = r.Fingerprint
+		event.Capabilities = r.Capabilities
+		if r.FrameCount > 1 {
+			event.SampleWeight = r.FrameCount
+		}
+	case "connection":
+		event.EventType = "connection"
+		event.Connected = true
+		event.BSSID = r.BSSID
+	case "disconnection":
+		event.EventType = "disconnection"
+		event.DeauthCount = r.FrameCount
+	case "data":
+		event.EventType = "data"
+		event.DataFrameCount = r.FrameCount
+		event.DataByteCount = r.ByteCount
+		event.Direction = r.Direction
+	default:
+		return DeviceEvent{}, false
+	}
+
+	return event, true
+}
+
+// toAccessPointEvent converts a beacon record into an AccessPointEvent
+func (r *batchRecord) toAccessPointEvent(ts time.Time) (AccessPointEvent, bool) {
+	if r.Type != "access_point" || r.BSSID == "" {
+		return AccessPointEvent{}, false
+	}
+
+	return AccessPointEvent{
+		Timestamp:    ts,
+		BSSID:        r.BSSID,
+		EventType:    "beacon",
+		SSID:         r.SSID,
+		Channel:      r.Channel,
+		RSSI:         r.RSSI,
+		Encryption:   r.Encryption,
+		Capabilities: r.Capabilities,
+		MaxRate:      r.MaxRate,
+		Country:      r.Country,
+		BeaconCount:  r.Beacons,
+		Seq:          r.Seq,
+	}, true
+}
+
+// ingestBatch stores a batch of mixed sniffer events, sent as a JSON array
+// or in the binary format (Content-Type application/octet-stream), with
+// one InsertMany per event collection instead of one InsertOne per event
+func ingestBatch(c *gin.Context) {
+	var records []batchRecord
+
+	if c.ContentType() == wireContentType {
+		body, err := io.ReadAll(io.LimitReader(c.Request.Body, maxWireBatchBytes+1))
+		if err != nil {
+			c.JSON(http.StatusBadRequest, gin.H{"error": err.Error()})
+			return
+		}
+		if len(body) > maxWireBatchBytes {
+			c.JSON(http.StatusRequestEntityTooLarge, gin.H{"error": fmt.Sprintf("batch exceeds %d bytes", maxWireBatchBytes)})
+			return
+		}
+		if records, err = decodeWireBatch(body); err != nil {
+			c.JSON(http.StatusBadRequest, gin.H{"error": err.Error()})
+			return
+		}
+	} else if err := c.ShouldBindJSON(&records); err != nil {
+		c.JSON(http.StatusBadRequest, gin.H{"error": err.Error()})
+		return
+	}
+
+	if len(records) > maxBatchRecords {
+		c.JSON(http.StatusRequestEntityTooLarge, gin.H{"error": fmt.Sprintf("batch exceeds %d records", maxBatchRecords)})
+		return
+	}
+
+	now := time.Now()
+	sniffer := c.GetHeader(snifferIDHeader)
+	deviceDocs := make([]interface{}, 0, len(records))
+	apDocs := make([]interface{}, 0)
+	rejected := 0
+
+	for i := range records {
+		if records[i].Type == "access_point" {
+			if event, ok := records[i].toAccessPointEvent(captureTime(records[i].TsUs, now)); ok {
+				event.SnifferID = sniffer
+				apDocs = append(apDocs, event)
+				continue
+			}
+		} else if event, ok := records[i].toDeviceEvent(captureTime(records[i].TsUs, now)); ok {
+			event.SnifferID = sniffer
+			deviceDocs = append(deviceDocs, event)
+			continue
+		}
+		rejected++
+	}
+
+	ctx, cancel := context.WithTimeout(context.Background(), 10*time.Second)
+	defer cancel()
+
+	// Both collections are attempted, and whatever landed is summarized,
+	// even if the batch then fails: the sniffer resends it, and the copies
+	// already stored come back as duplicates that are not counted again
+	devices, deviceDups, deviceErr := insertEvents(ctx, "device_events", deviceDocs)
+	if deviceErr != nil {
+		log.Printf("Batch device event insertion error: %v", deviceErr)
+	}
+	aps, apDups, apErr := insertEvents(ctx, "access_point_events", apDocs)
+	if apErr != nil {
+		log.Printf("Batch AP event insertion error: %v", apErr)
+	}
+
+	updateDeviceSummaries(ctx, devices...)
+	rollups.add(devices...)
+	rollups.add(aps...)
+
+	if deviceErr != nil || apErr != nil {
+		err := deviceErr
+		if err == nil {
+			err = apErr
+		}
+		c.JSON(http.StatusInternalServerError, gin.H{"error": err.Error()})
+		return
+	}
+
+	c.JSON(http.StatusOK, gin.H{
+		"status":        "ok",
+		"devices":       len(devices),
+		"access_points": len(aps),
+		"duplicates":    deviceDups + apDups,
+		"rejected":      rejected,
+	})
+}
+
+// duplicateKeyCode is the server error code of a unique index violation
+const duplicateKeyCode = 11000
+
+// insertEvents inserts docs unordered, so Mongo can parallelize and keep
+// going past a bad document, and returns the ones that landed. Documents
+// refused by the sniffer seq index were stored by an earlier attempt at
+// the batch; they are counted in duplicates and are not an error.
+func insertEvents(ctx context.Context, collection string, docs []interface{}) ([]interface{}, int, error) {
+	if len(docs) == 0 {
+		return nil, 0, nil
+	}
+
+	_, err := db.Collection(collection).InsertMany(ctx, docs, options.InsertMany().SetOrdered(false))
+	if err == nil {
+		return docs, 0, nil
+	}
+
+	var bwe mongo.BulkWriteException
+	if !errors.As(err, &bwe) {
+		return nil, 0, err
+	}
+	landed, duplicates, failed := splitInserted(docs, bwe.WriteErrors)
+	if failed > 0 || bwe.WriteConcernError != nil {
+		return landed, duplicates, err
+	}
+	return landed, duplicates, nil
+}
+
+// splitInserted drops the documents named by the write errors of an
+// unordered insert, counting duplicate key errors apart from other failures
+func splitInserted(docs []interface{}, writeErrors []mongo.BulkWriteError) (landed []interface{}, duplicates, failed int) {
+	refused := make(map[int]bool, len(writeErrors))
+	for _, we := range writeErrors {
+		refused[we.Index] = true
+		if we.Code == duplicateKeyCode {
+			duplicates++
+		} else {
+			failed++
+		}
+	}
+
+	landed = make([]interface{}, 0, len(docs)-len(refused))
+	for i, doc := range docs {
+		if !refused[i] {
+			landed = append(landed, doc)
+		}
+	}
+	return landed, duplicates, failed
+}
+
+// ingestSketch stores one interval of a sniffer's probe sketch. The
+// rollup flush merges them into the 1m window the interval starts in.
+func ingestSketch(c *gin.Context) {
+	body, err := io.ReadAll(io.LimitReader(c.Request.Body, maxSketchBytes+1))
+	if err != nil {
+		c.JSON(http.StatusBadRequest, gin.H{"error": err.Error()})
+		return
+	}
+	if len(body) > maxSketchBytes {
+		c.JSON(http.StatusRequestEntityTooLarge, gin.H{"error": fmt.Sprintf("sketch exceeds %d bytes", maxSketchBytes)})
+		return
+	}
+
+	sketch, err := decodeSketch(body)
+	if err != nil {
+		c.JSON(http.StatusBadRequest, gin.H{"error": err.Error()})
+		return
+	}
+
+	now := time.Now()
+	sketch.Timestamp = captureTime(sketch.Timestamp.UnixMicro(), now)
+	sketch.End = captureTime(sketch.End.UnixMicro(), now)
+	sketch.SnifferID = c.GetHeader(snifferIDHeader)
+
+	ctx, cancel := context.WithTimeout(context.Background(), 5*time.Second)
+	defer cancel()
+
+	if _, err := db.Collection("probe_sketches").InsertOne(ctx, sketch); err != nil {
+		log.Printf("Probe sketch insertion error: %v", err)
+		c.JSON(http.StatusInternalServerError, gin.H{"error": err.Error()})
+		return
+	}
+	rollups.touch(sketch.Timestamp)
+
+	c.JSON(http.StatusOK, gin.H{"status": "ok", "probes": sketch.Probes})
+}
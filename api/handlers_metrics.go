@@ -274,6 +274,15 @@ func getMetricsSummary(c *gin.Context) {
 			MaxTotal  int     `json:"max_total"`
 			MaxActive int     `json:"max_active"`
 		} `json:"access_points"`
+
+		// Unique counts over the whole range, from the snapshots' merged
+		// HyperLogLogs
+		Probes struct {
+			Total         int64       `json:"total"`
+			UniqueDevices int         `json:"unique_devices"`
+			UniqueGlobal  int         `json:"unique_global"`
+			TopSSIDs      []SSIDCount `json:"top_ssids"`
+		} `json:"probes"`
 	}{
 		Tier:       tier,
 		Start:      start,
@@ -286,8 +295,17 @@ func getMetricsSummary(c *gin.Context) {
 	connectedDeviceSum := 0
 	totalAPSum := 0
 	activeAPSum := 0
+	var hllAll, hllGlobal []byte
+	ssidCounts := make(map[string]int64)
 
 	for _, snap := range snapshots {
+		summary.Probes.Total += snap.Probes.Probes
+		hllAll = hllMerge(hllAll, snap.Probes.HLLAll)
+		hllGlobal = hllMerge(hllGlobal, snap.Probes.HLLGlobal)
+		for _, s := range snap.Probes.TopSSIDs {
+			ssidCounts[s.SSID] += s.Count
+		}
+
 		totalDeviceSum += snap.Devices.Total
 		activeDeviceSum += snap.Devices.Active
 		connectedDeviceSum += snap.Devices.Connected
@@ -315,5 +333,13 @@ func getMetricsSummary(c *gin.Context) {
 	summary.AccessPoints.AvgTotal = float64(totalAPSum) / n
 	summary.AccessPoints.AvgActive = float64(activeAPSum) / n
 
+	summary.Probes.UniqueDevices = hllEstimate(hllAll)
+	summary.Probes.UniqueGlobal = hllEstimate(hllGlobal)
+	summary.Probes.TopSSIDs = make([]SSIDCount, 0, len(ssidCounts))
+	for ssid, count := range ssidCounts {
+		summary.Probes.TopSSIDs = append(summary.Probes.TopSSIDs, SSIDCount{SSID: ssid, Count: count})
+	}
+	summary.Probes.TopSSIDs = topSSIDs(summary.Probes.TopSSIDs, 10)
+
 	c.JSON(http.StatusOK, summary)
 }
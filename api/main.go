@@ -62,6 +62,9 @@ func main() {
 		log.Printf("Warning: Failed to initialize event collections: %v", err)
 	}
 
+	// Build device summaries from existing events once, before ingest starts
+	backfillDeviceSummaries(context.Background())
+
 	// Load channel hopping configuration
 	if err := loadChannelConfig(); err != nil {
 		log.Printf("Warning: Failed to load channel config: %v", err)
@@ -88,6 +91,9 @@ func main() {
 		c.Next()
 	})
 
+	// Compressed request bodies (sniffer batches) are decoded up front
+	r.Use(decodeContentEncoding)
+
 	// Static files (operations dashboard, swagger docs)
 	r.Static("/static", "./static")
 
@@ -133,6 +139,18 @@ func main() {
 	api.GET("/access-points/active", getActiveAccessPoints)
 	api.POST("/ingest/access-point", ingestAccessPoint)
 
+	// Batched ingest (mixed device and access point events)
+	r.POST("/ingest/batch", ingestBatch)
+	api.POST("/ingest/batch", ingestBatch)
+
+	// Probe request sketches (HyperLogLog / Count-Min), one per sniffer interval
+	r.POST("/ingest/sketch", ingestSketch)
+	api.POST("/ingest/sketch", ingestSketch)
+
+	// Preset dictionary for Content-Encoding: deflate batches
+	r.GET("/ingest/dictionary", getIngestDictionary)
+	api.GET("/ingest/dictionary", getIngestDictionary)
+
 	// Stats endpoint
 	r.GET("/stats", getStats)
 	api.GET("/stats", getStats)
@@ -15,6 +15,21 @@ type DeviceEvent struct {
 	BSSID            string    `bson:"bssid,omitempty" json:"bssid,omitempty"`
 	DataFrameCount   int       `bson:"data_frame_count,omitempty" json:"data_frame_count,omitempty"`
 	DataByteCount    int64     `bson:"data_byte_count,omitempty" json:"data_byte_count,omitempty"`
+	Direction        string    `bson:"direction,omitempty" json:"direction,omitempty"` // data events: "uplink", "downlink", "adhoc", "wds"
+	DeauthCount      int       `bson:"deauth_count,omitempty" json:"deauth_count,omitempty"` // disconnection events: deauth/disassoc frames in the burst
+	Fingerprint      string    `bson:"fingerprint,omitempty" json:"fingerprint,omitempty"`   // probe events: capability fingerprint of the probe's elements
+	Capabilities     []string  `bson:"capabilities,omitempty" json:"capabilities,omitempty"` // probe events: "ht", "vht", "he", "wmm", ...
+	SampleWeight     int       `bson:"sample_weight,omitempty" json:"sample_weight,omitempty"` // probe events: probes a sampled sighting stands for, if more than 1
+	SnifferID        string    `bson:"sniffer_id,omitempty" json:"sniffer_id,omitempty"` // X-Sniffer-ID of the reporting sniffer
+	Seq              uint32    `bson:"seq,omitempty" json:"seq,omitempty"`               // Per-sniffer event sequence number
+}
+
+// weight is the number of frames the event counts for
+func (ev *DeviceEvent) weight() int {
+	if ev.SampleWeight > 1 {
+		return ev.SampleWeight
+	}
+	return 1
 }
 
 // AccessPointEvent represents a single WiFi access point detection event
@@ -27,15 +42,32 @@ type AccessPointEvent struct {
 	Channel    int       `bson:"channel" json:"channel"`
 	RSSI       int       `bson:"rssi" json:"rssi"`
 	Encryption string    `bson:"encryption,omitempty" json:"encryption,omitempty"`
+
+	// Decoded from the beacon's information elements
+	Capabilities []string `bson:"capabilities,omitempty" json:"capabilities,omitempty"` // "ht", "vht", "he", "wmm", ...
+	MaxRate      float64  `bson:"max_rate,omitempty" json:"max_rate,omitempty"`         // Highest legacy rate, Mbps
+	Country      string   `bson:"country,omitempty" json:"country,omitempty"`
+
+	// Beacons this event stands for. The sniffer suppresses unchanged
+	// beacons and folds them into its next report; absent means 1.
+	BeaconCount int `bson:"beacon_count,omitempty" json:"beacon_count,omitempty"`
+
+	SnifferID string `bson:"sniffer_id,omitempty" json:"sniffer_id,omitempty"` // X-Sniffer-ID of the reporting sniffer
+	Seq       uint32 `bson:"seq,omitempty" json:"seq,omitempty"`               // Per-sniffer event sequence number
 }
 
-// Device represents aggregated device data (computed from events)
+// Device represents aggregated device data, read from the devices summary
+// collection (see devices.go)
 type Device struct {
 	MACAddress       string    `bson:"mac_address" json:"mac_address"`
 	FirstSeen        time.Time `bson:"first_seen" json:"first_seen"`
 	LastSeen         time.Time `bson:"last_seen" json:"last_seen"`
-	RSSIValues       []int     `bson:"rssi_values" json:"rssi_values"`
+	RSSIValues       []int     `bson:"rssi_values" json:"rssi_values"` // Most recent readings, up to 100
+	RSSIAvg          float64   `bson:"rssi_avg" json:"rssi_avg"`       // Over every event
+	RSSIMin          int       `bson:"rssi_min" json:"rssi_min"`
+	RSSIMax          int       `bson:"rssi_max" json:"rssi_max"`
 	ProbeSSIDs       []string  `bson:"probe_ssids" json:"probe_ssids"`
+	Fingerprints     []string  `bson:"fingerprints" json:"fingerprints,omitempty"` // Probe capability fingerprints; shared ones suggest one device behind randomized MACs
 	PacketCount      int       `bson:"packet_count" json:"packet_count"`
 	Vendor           string    `bson:"vendor" json:"vendor,omitempty"`
 	Connected        bool      `bson:"connected" json:"connected"`
@@ -55,6 +87,10 @@ type AccessPoint struct {
 	RSSIValues  []int     `bson:"rssi_values" json:"rssi_values"`
 	BeaconCount int       `bson:"beacon_count" json:"beacon_count"`
 	Encryption  string    `bson:"encryption" json:"encryption,omitempty"`
+
+	Capabilities []string `bson:"capabilities" json:"capabilities,omitempty"`
+	MaxRate      float64  `bson:"max_rate" json:"max_rate,omitempty"`
+	Country      string   `bson:"country" json:"country,omitempty"`
 }
 
 // Stats represents aggregate statistics about devices and access points
@@ -88,6 +124,39 @@ type APMetric struct {
 	Channel     int     `bson:"channel" json:"channel"`
 }
 
+// SSIDCount is a probed SSID with its estimated number of probe requests
+type SSIDCount struct {
+	SSID  string `bson:"ssid" json:"ssid"`
+	Count int64  `bson:"count" json:"count"`
+}
+
+// ProbeSketch is one sniffer interval of /ingest/sketch data, or a merge of
+// several. Registers and counters are stored as the raw little-endian bytes
+// the sniffer sent.
+type ProbeSketch struct {
+	Timestamp time.Time   `bson:"timestamp" json:"timestamp"` // Interval start
+	End       time.Time   `bson:"end" json:"end"`
+	SnifferID string      `bson:"sniffer_id,omitempty" json:"sniffer_id,omitempty"`
+	Probes    int64       `bson:"probes" json:"probes"`
+	HLLAll    []byte      `bson:"hll_all" json:"-"`    // HyperLogLog of all probing MACs
+	HLLGlobal []byte      `bson:"hll_global" json:"-"` // Same, globally administered MACs only
+	CMSDepth  int         `bson:"cms_depth" json:"-"`
+	CMSWidth  int         `bson:"cms_width" json:"-"`
+	CMS       []byte      `bson:"cms" json:"-"` // Count-Min counters of probed SSIDs, u32 LE
+	TopSSIDs  []SSIDCount `bson:"top_ssids" json:"top_ssids"`
+}
+
+// ProbeSummary is the probe-request part of a metrics snapshot. The HLL
+// registers are kept so snapshots can be merged into longer ranges.
+type ProbeSummary struct {
+	Probes        int64       `bson:"probes" json:"probes"`
+	UniqueDevices int         `bson:"unique_devices" json:"unique_devices"`
+	UniqueGlobal  int         `bson:"unique_global" json:"unique_global"` // Excluding randomized MACs
+	TopSSIDs      []SSIDCount `bson:"top_ssids,omitempty" json:"top_ssids,omitempty"`
+	HLLAll        []byte      `bson:"hll_all,omitempty" json:"-"`
+	HLLGlobal     []byte      `bson:"hll_global,omitempty" json:"-"`
+}
+
 // MetricsSnapshot represents a time-series snapshot of system metrics
 // Used for multi-granularity historical data storage
 type MetricsSnapshot struct {
@@ -109,12 +178,24 @@ type MetricsSnapshot struct {
 	// Per-device/AP metrics (only store active entities to save space)
 	DeviceMetrics []DeviceMetric `bson:"device_metrics" json:"device_metrics"`
 	APMetrics     []APMetric     `bson:"ap_metrics" json:"ap_metrics"`
+
+	// Merged from the sniffers' probe sketches rather than from raw events
+	Probes ProbeSummary `bson:"probes" json:"probes"`
+
+	// HyperLogLogs of the MACs behind the active counts, so a coarser
+	// tier can count unique devices across its windows
+	DeviceHLL    []byte `bson:"device_hll,omitempty" json:"-"`
+	ConnectedHLL []byte `bson:"connected_hll,omitempty" json:"-"`
+	APHLL        []byte `bson:"ap_hll,omitempty" json:"-"`
 }
 
 // ChannelHoppingConfig represents the channel hopping configuration
 type ChannelHoppingConfig struct {
-	Enabled     bool      `json:"enabled"`
-	TimeoutMs   int       `json:"timeout_ms"` // Timeout in milliseconds
-	Channels    []int     `json:"channels"`   // List of channels to hop (e.g. [1, 6, 11])
-	LastUpdated time.Time `json:"last_updated"`
+	Enabled       bool              `json:"enabled"`
+	Mode          string            `json:"mode"`                     // "round_robin" (fixed dwell) or "adaptive" (dwell follows activity)
+	TimeoutMs     int               `json:"timeout_ms"`               // Timeout in milliseconds
+	Channels      []int             `json:"channels"`                 // List of channels to hop (e.g. [1, 6, 11])
+	FrameTypes    []string          `json:"frame_types"`              // Frame types the sniffer captures (e.g. ["beacon", "data"])
+	FramePolicies map[string]string `json:"frame_policies,omitempty"` // Per frame type: "keep", "sample:N", "rate:R/B" or "summary" (e.g. {"deauth": "rate:10/20"})
+	LastUpdated   time.Time         `json:"last_updated"`
 }
@@ -0,0 +1,268 @@
+package main
+
+import (
+	"sort"
+	"time"
+)
+
+// rollupMaxEntities bounds the device and AP metrics stored per snapshot;
+// the busiest ones are kept
+const rollupMaxEntities = 500
+
+// rollupHLLRegisters sizes the unique-MAC HyperLogLogs kept in each
+// snapshot, the same precision as the sniffer's probe sketch: 4 KB each,
+// ~1.6% standard error and close to exact for small counts
+const rollupHLLRegisters = 1 << 12
+
+// rssiRollup is a weighted RSSI sum with its extremes. Device metrics are
+// weighted by events and AP metrics by beacons, which keeps the averages
+// of merged windows exact.
+type rssiRollup struct {
+	sum    float64
+	weight int64
+	min    int
+	max    int
+}
+
+func (r *rssiRollup) add(avg float64, min, max int, weight int64) {
+	if weight <= 0 {
+		return
+	}
+	if r.weight == 0 || min < r.min {
+		r.min = min
+	}
+	if r.weight == 0 || max > r.max {
+		r.max = max
+	}
+	r.sum += avg * float64(weight)
+	r.weight += weight
+}
+
+func (r *rssiRollup) avg() float64 {
+	if r.weight == 0 {
+		return 0
+	}
+	return r.sum / float64(r.weight)
+}
+
+type deviceRollup struct {
+	metric   DeviceMetric
+	rssi     rssiRollup
+	lastSeen time.Time
+}
+
+type apRollup struct {
+	metric   APMetric
+	rssi     rssiRollup
+	lastSeen time.Time
+}
+
+// rollupWindow accumulates one window of one tier. A 1m window is fed
+// events by the ingest handlers; a coarser window is fed the snapshots of
+// the tier below. Either way it can fold in a stored snapshot of itself,
+// which is how a window evicted from memory picks up late events.
+type rollupWindow struct {
+	start   time.Time
+	devices map[string]*deviceRollup
+	aps     map[string]*apRollup
+
+	deviceHLL    []byte
+	connectedHLL []byte
+	apHLL        []byte
+
+	devicesTotal int
+	apsTotal     int
+
+	probes     ProbeSummary
+	probeSSIDs map[string]int64
+
+	dirty  bool // Changed since the last flush
+	loaded bool // The stored snapshot, if any, has been folded in
+}
+
+func newRollupWindow(start time.Time) *rollupWindow {
+	return &rollupWindow{
+		start:        start,
+		devices:      make(map[string]*deviceRollup),
+		aps:          make(map[string]*apRollup),
+		deviceHLL:    make([]byte, rollupHLLRegisters),
+		connectedHLL: make([]byte, rollupHLLRegisters),
+		apHLL:        make([]byte, rollupHLLRegisters),
+		probeSSIDs:   make(map[string]int64),
+	}
+}
+
+func (w *rollupWindow) device(mac string) *deviceRollup {
+	d := w.devices[mac]
+	if d == nil {
+		d = &deviceRollup{metric: DeviceMetric{MACAddress: mac}}
+		w.devices[mac] = d
+	}
+	return d
+}
+
+func (w *rollupWindow) ap(bssid string) *apRollup {
+	a := w.aps[bssid]
+	if a == nil {
+		a = &apRollup{metric: APMetric{BSSID: bssid}}
+		w.aps[bssid] = a
+	}
+	return a
+}
+
+func (w *rollupWindow) addDeviceEvent(ev *DeviceEvent) {
+	d := w.device(ev.MACAddress)
+	weight := ev.weight()
+	d.metric.PacketCount += weight
+	d.metric.DataBytes += ev.DataByteCount
+	d.rssi.add(float64(ev.RSSI), ev.RSSI, ev.RSSI, int64(weight))
+
+	// The latest event in capture time decides the current state
+	if !ev.Timestamp.Before(d.lastSeen) {
+		d.lastSeen = ev.Timestamp
+		d.metric.Connected = ev.Connected
+		if ev.Vendor != "" {
+			d.metric.Vendor = ev.Vendor
+		}
+	}
+
+	h := sketchHash([]byte(ev.MACAddress))
+	hllAdd(w.deviceHLL, h)
+	if ev.Connected {
+		hllAdd(w.connectedHLL, h)
+	}
+	w.dirty = true
+}
+
+func (w *rollupWindow) addAPEvent(ev *AccessPointEvent) {
+	beacons := ev.BeaconCount
+	if beacons <= 0 {
+		beacons = 1
+	}
+
+	a := w.ap(ev.BSSID)
+	a.metric.BeaconCount += beacons
+	a.rssi.add(float64(ev.RSSI), ev.RSSI, ev.RSSI, int64(beacons))
+	if !ev.Timestamp.Before(a.lastSeen) {
+		a.lastSeen = ev.Timestamp
+		a.metric.SSID = ev.SSID
+		a.metric.Channel = ev.Channel
+	}
+
+	hllAdd(w.apHLL, sketchHash([]byte(ev.BSSID)))
+	w.dirty = true
+}
+
+// addSnapshot folds a stored snapshot into the window. Snapshots are
+// folded in time order, so later ones decide vendor, SSID and state.
+func (w *rollupWindow) addSnapshot(s *MetricsSnapshot) {
+	for i := range s.DeviceMetrics {
+		m := &s.DeviceMetrics[i]
+		d := w.device(m.MACAddress)
+		d.metric.PacketCount += m.PacketCount
+		d.metric.DataBytes += m.DataBytes
+		d.metric.Connected = m.Connected
+		if m.Vendor != "" {
+			d.metric.Vendor = m.Vendor
+		}
+		d.rssi.add(m.RSSIAvg, m.RSSIMin, m.RSSIMax, int64(m.PacketCount))
+	}
+
+	for i := range s.APMetrics {
+		m := &s.APMetrics[i]
+		a := w.ap(m.BSSID)
+		a.metric.BeaconCount += m.BeaconCount
+		a.metric.SSID = m.SSID
+		a.metric.Channel = m.Channel
+		a.rssi.add(m.RSSIAvg, m.RSSIMin, m.RSSIMax, int64(m.BeaconCount))
+	}
+
+	w.deviceHLL = hllMerge(w.deviceHLL, s.DeviceHLL)
+	w.connectedHLL = hllMerge(w.connectedHLL, s.ConnectedHLL)
+	w.apHLL = hllMerge(w.apHLL, s.APHLL)
+
+	if s.Devices.Total > w.devicesTotal {
+		w.devicesTotal = s.Devices.Total
+	}
+	if s.AccessPoints.Total > w.apsTotal {
+		w.apsTotal = s.AccessPoints.Total
+	}
+
+	w.addProbes(&s.Probes)
+	w.dirty = true
+}
+
+// addProbes merges a probe summary. Top SSID counts of the parts are
+// summed, which undercounts an SSID outside some part's top list.
+func (w *rollupWindow) addProbes(p *ProbeSummary) {
+	w.probes.Probes += p.Probes
+	w.probes.HLLAll = hllMerge(w.probes.HLLAll, p.HLLAll)
+	w.probes.HLLGlobal = hllMerge(w.probes.HLLGlobal, p.HLLGlobal)
+	for _, s := range p.TopSSIDs {
+		w.probeSSIDs[s.SSID] += s.Count
+	}
+}
+
+// snapshot renders the window as a metrics document that shares no
+// memory with it
+func (w *rollupWindow) snapshot(tier string) MetricsSnapshot {
+	s := MetricsSnapshot{
+		Timestamp:    w.start,
+		Tier:         tier,
+		DeviceHLL:    append([]byte(nil), w.deviceHLL...),
+		ConnectedHLL: append([]byte(nil), w.connectedHLL...),
+		APHLL:        append([]byte(nil), w.apHLL...),
+	}
+
+	s.Devices.Total = w.devicesTotal
+	s.Devices.Active = hllEstimate(w.deviceHLL)
+	s.Devices.Connected = hllEstimate(w.connectedHLL)
+	s.AccessPoints.Total = w.apsTotal
+	s.AccessPoints.Active = hllEstimate(w.apHLL)
+
+	s.DeviceMetrics = make([]DeviceMetric, 0, len(w.devices))
+	for _, d := range w.devices {
+		m := d.metric
+		m.RSSIAvg, m.RSSIMin, m.RSSIMax = d.rssi.avg(), d.rssi.min, d.rssi.max
+		s.DeviceMetrics = append(s.DeviceMetrics, m)
+	}
+	sort.Slice(s.DeviceMetrics, func(i, j int) bool {
+		a, b := &s.DeviceMetrics[i], &s.DeviceMetrics[j]
+		if a.PacketCount != b.PacketCount {
+			return a.PacketCount > b.PacketCount
+		}
+		return a.MACAddress < b.MACAddress
+	})
+	if len(s.DeviceMetrics) > rollupMaxEntities {
+		s.DeviceMetrics = s.DeviceMetrics[:rollupMaxEntities]
+	}
+
+	s.APMetrics = make([]APMetric, 0, len(w.aps))
+	for _, a := range w.aps {
+		m := a.metric
+		m.RSSIAvg, m.RSSIMin, m.RSSIMax = a.rssi.avg(), a.rssi.min, a.rssi.max
+		s.APMetrics = append(s.APMetrics, m)
+	}
+	sort.Slice(s.APMetrics, func(i, j int) bool {
+		a, b := &s.APMetrics[i], &s.APMetrics[j]
+		if a.BeaconCount != b.BeaconCount {
+			return a.BeaconCount > b.BeaconCount
+		}
+		return a.BSSID < b.BSSID
+	})
+	if len(s.APMetrics) > rollupMaxEntities {
+		s.APMetrics = s.APMetrics[:rollupMaxEntities]
+	}
+
+	s.Probes = w.probes
+	s.Probes.HLLAll = append([]byte(nil), w.probes.HLLAll...)
+	s.Probes.HLLGlobal = append([]byte(nil), w.probes.HLLGlobal...)
+	s.Probes.UniqueDevices = hllEstimate(w.probes.HLLAll)
+	s.Probes.UniqueGlobal = hllEstimate(w.probes.HLLGlobal)
+	s.Probes.TopSSIDs = make([]SSIDCount, 0, len(w.probeSSIDs))
+	for ssid, count := range w.probeSSIDs {
+		s.Probes.TopSSIDs = append(s.Probes.TopSSIDs, SSIDCount{SSID: ssid, Count: count})
+	}
+	s.Probes.TopSSIDs = topSSIDs(s.Probes.TopSSIDs, sketchTopK)
+	return s
+}
@@ -0,0 +1,228 @@
+package main
+
+import (
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"math"
+	"math/bits"
+	"sort"
+	"time"
+)
+
+// Binary /ingest/sketch bodies. The layout is defined next to the encoder
+// in src/sketch.h: a 32-byte header, two HyperLogLogs of 2^p one-byte
+// registers, depth*width u32 Count-Min counters, and the top-K SSIDs.
+const (
+	sketchMagic     = "FLS"
+	sketchVersion   = 1
+	sketchHeaderLen = 32
+	sketchTopK      = 32
+	maxSketchBytes  = 1 << 20
+)
+
+var errSketchHeader = errors.New("not a flux probe sketch")
+
+// sketchHash must match sketch_hash in src/sketch.c: 64-bit FNV-1a with a
+// murmur3 finalizer
+func sketchHash(b []byte) uint64 {
+	h := uint64(0xCBF29CE484222325)
+	for _, c := range b {
+		h ^= uint64(c)
+		h *= 0x100000001B3
+	}
+	h ^= h >> 33
+	h *= 0xFF51AFD7ED558CCD
+	h ^= h >> 33
+	h *= 0xC4CEB9FE1A85EC53
+	h ^= h >> 33
+	return h
+}
+
+func decodeSketch(body []byte) (*ProbeSketch, error) {
+	if len(body) < sketchHeaderLen || string(body[:3]) != sketchMagic {
+		return nil, errSketchHeader
+	}
+	if body[3] != sketchVersion {
+		return nil, fmt.Errorf("unsupported sketch version %d", body[3])
+	}
+
+	p := int(body[4])
+	depth := int(body[5])
+	width := int(binary.LittleEndian.Uint16(body[6:8]))
+	if p < 4 || p > 16 || depth == 0 || width == 0 || width&(width-1) != 0 {
+		return nil, errors.New("invalid sketch dimensions")
+	}
+
+	registers := 1 << p
+	cmsLen := depth * width * 4
+	rest := body[sketchHeaderLen:]
+	if len(rest) < 2*registers+cmsLen {
+		return nil, errors.New("sketch truncated")
+	}
+
+	s := &ProbeSketch{
+		Timestamp: time.UnixMicro(int64(binary.LittleEndian.Uint64(body[8:16]))),
+		End:       time.UnixMicro(int64(binary.LittleEndian.Uint64(body[16:24]))),
+		Probes:    int64(binary.LittleEndian.Uint32(body[24:28])),
+		HLLAll:    append([]byte(nil), rest[:registers]...),
+		HLLGlobal: append([]byte(nil), rest[registers:2*registers]...),
+		CMSDepth:  depth,
+		CMSWidth:  width,
+		CMS:       append([]byte(nil), rest[2*registers:2*registers+cmsLen]...),
+	}
+
+	rest = rest[2*registers+cmsLen:]
+	count := int(binary.LittleEndian.Uint16(body[28:30]))
+	for i := 0; i < count; i++ {
+		if len(rest) < 1 || len(rest) < 1+int(rest[0])+4 {
+			return nil, errors.New("sketch top-K truncated")
+		}
+		n := int(rest[0])
+		s.TopSSIDs = append(s.TopSSIDs, SSIDCount{
+			SSID:  string(rest[1 : 1+n]),
+			Count: int64(binary.LittleEndian.Uint32(rest[1+n : 5+n])),
+		})
+		rest = rest[5+n:]
+	}
+	return s, nil
+}
+
+// hllAdd records hash h, as hll_add does in src/sketch.c. The register
+// count must be a power of two.
+func hllAdd(registers []byte, h uint64) {
+	p := bits.TrailingZeros(uint(len(registers)))
+	idx := h >> (64 - p)
+	rank := byte(bits.LeadingZeros64(h<<p) + 1)
+	if rank > 64-byte(p) {
+		rank = 64 - byte(p) + 1
+	}
+	if rank > registers[idx] {
+		registers[idx] = rank
+	}
+}
+
+// hllEstimate is the HyperLogLog cardinality estimate, with linear
+// counting for small cardinalities. A 64-bit hash needs no large-range
+// correction.
+func hllEstimate(registers []byte) int {
+	m := float64(len(registers))
+	if m == 0 {
+		return 0
+	}
+
+	sum := 0.0
+	zeros := 0
+	for _, r := range registers {
+		sum += math.Ldexp(1, -int(r))
+		if r == 0 {
+			zeros++
+		}
+	}
+
+	alpha := 0.7213 / (1 + 1.079/m)
+	estimate := alpha * m * m / sum
+	if estimate <= 2.5*m && zeros > 0 {
+		estimate = m * math.Log(m/float64(zeros))
+	}
+	return int(estimate + 0.5)
+}
+
+// hllMerge folds src into dst by register-wise max
+func hllMerge(dst, src []byte) []byte {
+	if dst == nil {
+		return append([]byte(nil), src...)
+	}
+	if len(dst) != len(src) {
+		return dst
+	}
+	for i, r := range src {
+		if r > dst[i] {
+			dst[i] = r
+		}
+	}
+	return dst
+}
+
+// estimate returns the Count-Min estimate for ssid
+func (s *ProbeSketch) estimate(ssid string) int64 {
+	h := sketchHash([]byte(ssid))
+	h1 := uint32(h)
+	h2 := uint32(h>>32) | 1
+	mask := uint32(s.CMSWidth - 1)
+
+	est := int64(math.MaxInt64)
+	for row := 0; row < s.CMSDepth; row++ {
+		col := int((h1 + uint32(row)*h2) & mask)
+		off := (row*s.CMSWidth + col) * 4
+		if v := int64(binary.LittleEndian.Uint32(s.CMS[off : off+4])); v < est {
+			est = v
+		}
+	}
+	return est
+}
+
+// merge folds o into s. Sketches of different dimensions cannot be merged.
+func (s *ProbeSketch) merge(o *ProbeSketch) error {
+	if s.CMSDepth != o.CMSDepth || s.CMSWidth != o.CMSWidth || len(s.HLLAll) != len(o.HLLAll) {
+		return errors.New("sketch dimensions differ")
+	}
+
+	hllMerge(s.HLLAll, o.HLLAll)
+	hllMerge(s.HLLGlobal, o.HLLGlobal)
+	for off := 0; off+4 <= len(s.CMS); off += 4 {
+		sum := uint64(binary.LittleEndian.Uint32(s.CMS[off:])) + uint64(binary.LittleEndian.Uint32(o.CMS[off:]))
+		if sum > math.MaxUint32 {
+			sum = math.MaxUint32
+		}
+		binary.LittleEndian.PutUint32(s.CMS[off:], uint32(sum))
+	}
+
+	s.Probes += o.Probes
+	if o.Timestamp.Before(s.Timestamp) {
+		s.Timestamp = o.Timestamp
+	}
+	if o.End.After(s.End) {
+		s.End = o.End
+	}
+
+	// The heavy hitters of the union are among the heavy hitters of the
+	// parts; re-estimate them all against the merged counters
+	seen := make(map[string]bool, len(s.TopSSIDs)+len(o.TopSSIDs))
+	candidates := make([]SSIDCount, 0, len(s.TopSSIDs)+len(o.TopSSIDs))
+	for _, list := range [][]SSIDCount{s.TopSSIDs, o.TopSSIDs} {
+		for _, c := range list {
+			if !seen[c.SSID] {
+				seen[c.SSID] = true
+				candidates = append(candidates, SSIDCount{SSID: c.SSID, Count: s.estimate(c.SSID)})
+			}
+		}
+	}
+	s.TopSSIDs = topSSIDs(candidates, sketchTopK)
+	return nil
+}
+
+func topSSIDs(counts []SSIDCount, k int) []SSIDCount {
+	sort.Slice(counts, func(i, j int) bool {
+		if counts[i].Count != counts[j].Count {
+			return counts[i].Count > counts[j].Count
+		}
+		return counts[i].SSID < counts[j].SSID
+	})
+	if len(counts) > k {
+		counts = counts[:k]
+	}
+	return counts
+}
+
+// summary reduces a (merged) sketch to the numbers stored in a snapshot
+func (s *ProbeSketch) summary() ProbeSummary {
+	return ProbeSummary{
+		Probes:        s.Probes,
+		UniqueDevices: hllEstimate(s.HLLAll),
+		UniqueGlobal:  hllEstimate(s.HLLGlobal),
+		TopSSIDs:      s.TopSSIDs,
+		HLLAll:        s.HLLAll,
+		HLLGlobal:     s.HLLGlobal,
+	}
+}
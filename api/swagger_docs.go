@@ -95,6 +95,72 @@ package main
 //   400: errorResponse
 //   500: errorResponse
 
+// swagger:route POST /ingest/batch ingest ingestBatch
+//
+// Ingest a batch of sniffer events
+//
+// Records an array of device, access point, connection, disconnection and
+// data events in one request. Each element carries a type field and the
+// same fields as the matching single-event ingest route.
+//
+// Consumes:
+// - application/json
+//
+// Produces:
+// - application/json
+//
+// Parameters:
+//   + name: body
+//     in: body
+//     description: Array of events (at most 5000)
+//     required: true
+//     schema:
+//       type: array
+//       items:
+//         type: object
+//         required:
+//           - type
+//         properties:
+//           type:
+//             type: string
+//             enum: [device, access_point, connection, disconnection, data]
+//           mac_address:
+//             type: string
+//             example: "aa:bb:cc:dd:ee:ff"
+//           bssid:
+//             type: string
+//             example: "11:22:33:44:55:66"
+//           rssi:
+//             type: integer
+//             example: -65
+//
+// Responses:
+//   200: batchIngestResponse
+//   400: errorResponse
+//   413: errorResponse
+//   500: errorResponse
+
+// swagger:route POST /ingest/sketch ingest ingestSketch
+//
+// Ingest a probe request sketch
+//
+// Records one interval of a sniffer's probe requests as HyperLogLogs of
+// the probing MACs and a Count-Min sketch / top-K of probed SSIDs, in the
+// binary layout of src/sketch.h. The aggregation workers merge them into
+// the probes section of each metrics tier.
+//
+// Consumes:
+// - application/octet-stream
+//
+// Produces:
+// - application/json
+//
+// Responses:
+//   200: okResponse
+//   400: errorResponse
+//   413: errorResponse
+//   500: errorResponse
+
 // swagger:route GET /access-points accessPoints listAccessPoints
 //
 // List access points
@@ -120,11 +186,26 @@ package main
 //
 // Get channel hopping configuration
 //
-// Returns the current channel hopping settings
+// Returns the current channel hopping settings with an ETag. A request
+// whose If-None-Match matches gets 304, after waiting up to `wait` seconds
+// for the settings to change (long-poll).
 //
 // Produces:
 // - application/json
 //
+// Parameters:
+//   + name: If-None-Match
+//     in: header
+//     description: ETag from a previous response
+//     required: false
+//     type: string
+//   + name: wait
+//     in: query
+//     description: Seconds to hold an unchanged request open (max 60)
+//     required: false
+//     type: integer
+//     default: 0
+//
 // Responses:
 //   200: channelConfigResponse
 //   500: errorResponse
@@ -298,6 +379,18 @@ type metricsSummaryResponseWrapper struct {
 	}
 }
 
+// swagger:response batchIngestResponse
+type batchIngestResponseWrapper struct {
+	// in: body
+	Body struct {
+		Status       string `json:"status"`
+		Devices      int    `json:"devices"`
+		AccessPoints int    `json:"access_points"`
+		Duplicates   int    `json:"duplicates"`
+		Rejected     int    `json:"rejected"`
+	}
+}
+
 // swagger:response okResponse
 type okResponseWrapper struct {
 	// in: body
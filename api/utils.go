@@ -24,6 +24,28 @@ func parseLimit(s string, defaultVal int) int {
 	return val
 }
 
+// Capture timestamps further than this from the API clock are not trusted:
+// a sniffer without NTP reports 1970, and a week-old event is more likely
+// a bad clock than a delayed upload
+const (
+	maxCaptureSkewAhead = time.Minute
+	maxCaptureAge       = 7 * 24 * time.Hour
+)
+
+// captureTime converts a sniffer capture timestamp (Unix microseconds) to
+// the event time, falling back to the arrival time when it is missing or
+// implausible
+func captureTime(tsUs int64, now time.Time) time.Time {
+	if tsUs <= 0 {
+		return now
+	}
+	ts := time.UnixMicro(tsUs)
+	if ts.After(now.Add(maxCaptureSkewAhead)) || ts.Before(now.Add(-maxCaptureAge)) {
+		return now
+	}
+	return ts
+}
+
 // getEnv retrieves an environment variable with a fallback value
 func getEnv(key, fallback string) string {
 	if value := os.Getenv(key); value != "" {
@@ -86,6 +108,25 @@ func toInt(value interface{}) int {
 	}
 }
 
+// toStrings collects the non-empty strings of a BSON array
+func toStrings(value interface{}) []string {
+	var values []interface{}
+	switch v := value.(type) {
+	case primitive.A:
+		values = v
+	case []interface{}:
+		values = v
+	}
+
+	var out []string
+	for _, item := range values {
+		if s, ok := item.(string); ok && s != "" {
+			out = append(out, s)
+		}
+	}
+	return out
+}
+
 // toInt64 safely converts numeric BSON types to int64
 func toInt64(value interface{}) int64 {
 	switch v := value.(type) {
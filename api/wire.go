@@ -0,0 +1,191 @@
+package main
+
+import (
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"net"
+	"strings"
+)
+
+// Binary /ingest/batch bodies sent by the sniffer with --wire binary. The
+// layout is defined next to the encoder in src/http_client.h: an 8-byte
+// header ("FLX", version, little-endian u16 count, 2 reserved bytes)
+// followed by fixed 40-byte records, each trailed by its SSID and vendor.
+// Version 2 records carry no information element fields, and version 1
+// records also lack the trailing seq and are 36 bytes.
+const (
+	wireContentType = "application/octet-stream"
+	wireMagic       = "FLX"
+	wireVersion     = 3
+	wireHeaderLen   = 8
+	wireRecordLen   = 40
+	wireRecordLenV1 = 36
+
+	// Largest body a maxBatchRecords batch can produce
+	maxWireBatchBytes = wireHeaderLen + maxBatchRecords*(wireRecordLen+32+255)
+)
+
+// Record types and data directions, as numbered by the sniffer
+var wireEventTypes = []string{"device", "access_point", "connection", "disconnection", "data"}
+var wireDirections = []string{"adhoc", "uplink", "downlink", "wds"}
+
+// Capability bits (IE_CAP_* in src/ie.h), lowest first
+var wireCapabilities = []string{"ht", "vht", "he", "wmm", "wps", "p2p", "rrm", "btm"}
+
+// Security bits (IE_SEC_* in src/ie.h)
+const (
+	wireSecWEP = 1 << iota
+	wireSecWPA
+	wireSecRSN
+	wireSecPSK
+	wireSecEAP
+	wireSecSAE
+	wireSecOWE
+)
+
+var errWireHeader = errors.New("not a flux binary batch")
+
+func wireCaps(bits byte) []string {
+	var caps []string
+	for i, name := range wireCapabilities {
+		if bits&(1<<i) != 0 {
+			caps = append(caps, name)
+		}
+	}
+	return caps
+}
+
+// wireEncryption names the security bits the same way the sniffer's JSON
+// encoder does (ie_security_name)
+func wireEncryption(bits byte) string {
+	if bits&wireSecOWE != 0 {
+		return "OWE"
+	}
+	if bits&(wireSecRSN|wireSecWPA) == 0 {
+		if bits&wireSecWEP != 0 {
+			return "WEP"
+		}
+		return "Open"
+	}
+
+	proto := "WPA"
+	if bits&wireSecRSN != 0 {
+		proto = "WPA2"
+	}
+	var names []string
+	if bits&wireSecPSK != 0 {
+		names = append(names, proto+"-PSK")
+	}
+	if bits&wireSecEAP != 0 {
+		names = append(names, proto+"-EAP")
+	}
+	if bits&wireSecSAE != 0 {
+		names = append(names, "WPA3-SAE")
+	}
+	if len(names) == 0 {
+		return proto
+	}
+	return strings.Join(names, "/")
+}
+
+func wireMAC(b []byte) string {
+	return net.HardwareAddr(b).String()
+}
+
+// decodeWireBatch turns a binary batch into the same records a JSON batch
+// binds to
+func decodeWireBatch(body []byte) ([]batchRecord, error) {
+	if len(body) < wireHeaderLen || string(body[:3]) != wireMagic {
+		return nil, errWireHeader
+	}
+	recordLen := wireRecordLen
+	switch body[3] {
+	case wireVersion, 2:
+	case 1:
+		recordLen = wireRecordLenV1
+	default:
+		return nil, fmt.Errorf("unsupported binary batch version %d", body[3])
+	}
+
+	count := int(binary.LittleEndian.Uint16(body[4:6]))
+	if count > maxBatchRecords {
+		return nil, fmt.Errorf("batch exceeds %d records", maxBatchRecords)
+	}
+	if count*recordLen > len(body)-wireHeaderLen {
+		return nil, errors.New("binary batch truncated")
+	}
+
+	hasIEs := body[3] >= 3
+	records := make([]batchRecord, 0, count)
+	buf := body[wireHeaderLen:]
+	for i := 0; i < count; i++ {
+		if len(buf) < recordLen {
+			return nil, fmt.Errorf("record %d truncated", i)
+		}
+		ssidLen, vendorLen := int(buf[3]), int(buf[4])
+		size := recordLen + ssidLen + vendorLen
+		if len(buf) < size {
+			return nil, fmt.Errorf("record %d truncated", i)
+		}
+
+		var r batchRecord
+		if int(buf[0]) < len(wireEventTypes) {
+			r.Type = wireEventTypes[buf[0]]
+		}
+		r.RSSI = int(int8(buf[2]))
+		r.Channel = int(binary.LittleEndian.Uint16(buf[6:8]))
+		r.TsUs = int64(binary.LittleEndian.Uint64(buf[8:16]))
+		if recordLen >= wireRecordLen {
+			r.Seq = binary.LittleEndian.Uint32(buf[36:40])
+		}
+
+		mac := wireMAC(buf[16:22])
+		ssid := string(buf[recordLen : recordLen+ssidLen])
+		switch r.Type {
+		case "access_point":
+			r.BSSID = mac
+			r.SSID = ssid
+			r.Beacons = int(binary.LittleEndian.Uint32(buf[28:32]))
+			if hasIEs {
+				r.Encryption = wireEncryption(buf[32])
+				r.MaxRate = float64(buf[33]) / 2
+				if buf[34] != 0 {
+					r.Country = string(buf[34:36])
+				}
+				r.Capabilities = wireCaps(buf[5])
+			}
+		case "device":
+			r.MACAddress = mac
+			r.ProbeSSID = ssid
+			r.Vendor = string(buf[recordLen+ssidLen : size])
+			r.FrameCount = int(binary.LittleEndian.Uint32(buf[28:32]))
+			if hasIEs {
+				if fp := binary.LittleEndian.Uint32(buf[32:36]); fp != 0 {
+					r.Fingerprint = fmt.Sprintf("%08x", fp)
+				}
+				r.Capabilities = wireCaps(buf[5])
+			}
+		case "connection":
+			r.MACAddress = mac
+			r.BSSID = wireMAC(buf[22:28])
+		case "data":
+			r.MACAddress = mac
+			r.FrameCount = int(binary.LittleEndian.Uint32(buf[28:32]))
+			r.ByteCount = int64(binary.LittleEndian.Uint32(buf[32:36]))
+			if int(buf[1]) < len(wireDirections) {
+				r.Direction = wireDirections[buf[1]]
+			}
+		case "disconnection":
+			r.MACAddress = mac
+			r.FrameCount = int(binary.LittleEndian.Uint32(buf[28:32]))
+		default:
+			r.MACAddress = mac
+		}
+
+		records = append(records, r)
+		buf = buf[size:]
+	}
+
+	return records, nil
+}
@@ -0,0 +1,392 @@
+// Replays a radiotap pcap/pcapng through packet_handler and reports
+// throughput, per-frame-type cost, allocations on the capture thread and
+// enqueue->POST latency. Built by `make bench` with the HTTP layer
+// replaced by bench/http_sink.c.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <time.h>
+#include <pcap.h>
+#include "sniffer.h"
+#include "packet_handler.h"
+#include "radiotap.h"
+#include "ie.h"
+#include "http_sink.h"
+
+typedef enum {
+    CLASS_BEACON,
+    CLASS_PROBE_REQ,
+    CLASS_ASSOC_REQ,
+    CLASS_REASSOC_REQ,
+    CLASS_DISASSOC,
+    CLASS_DEAUTH,
+    CLASS_DATA,
+    CLASS_OTHER,
+    CLASS_INVALID,
+    CLASS_COUNT,
+} frame_class_t;
+
+static const char *class_names[CLASS_COUNT] = {
+    "beacon", "probe_req", "assoc_req", "reassoc_req", "disassoc", "deauth", "data", "other", "invalid",
+};
+
+typedef struct {
+    struct pcap_pkthdr hdr;
+    const uint8_t *data;
+    frame_class_t cls;
+} frame_t;
+
+typedef struct {
+    frame_t *frames;
+    size_t count;
+    uint8_t *arena;
+    uint64_t duration_us;   // Capture time spanned by the file
+} trace_t;
+
+// Allocation counting through -Wl,--wrap; only the capture thread counts
+static __thread int counting;
+static uint64_t alloc_count;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    if (counting) alloc_count++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    if (counting) alloc_count++;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    if (counting) alloc_count++;
+    return __real_realloc(ptr, size);
+}
+
+static uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static frame_class_t classify(const uint8_t *data, uint32_t caplen) {
+    radiotap_info_t rt;
+    if (radiotap_parse(data, caplen, &rt) != 0 || caplen < rt.len + 2u) return CLASS_INVALID;
+
+    uint8_t fc = data[rt.len];
+    uint8_t type = (fc >> 2) & 0x03;
+    uint8_t subtype = (fc >> 4) & 0x0F;
+
+    if (type == 2) return CLASS_DATA;
+    if (type != 0) return CLASS_OTHER;
+    switch (subtype) {
+        case 0x08: return CLASS_BEACON;
+        case 0x04: return CLASS_PROBE_REQ;
+        case 0x00: return CLASS_ASSOC_REQ;
+        case 0x02: return CLASS_REASSOC_REQ;
+        case 0x0A: return CLASS_DISASSOC;
+        case 0x0C: return CLASS_DEAUTH;
+    }
+    return CLASS_OTHER;
+}
+
+// Read the whole file up front so disk and pcap parsing stay out of the timings
+static int load_trace(const char *path, trace_t *trace) {
+    char errbuf[PCAP_ERRBUF_SIZE];
+    pcap_t *handle = pcap_open_offline(path, errbuf);
+    if (!handle) {
+        fprintf(stderr, "Error opening %s: %s\n", path, errbuf);
+        return -1;
+    }
+    if (pcap_datalink(handle) != DLT_IEEE802_11_RADIO) {
+        fprintf(stderr, "%s is not a radiotap capture\n", path);
+        pcap_close(handle);
+        return -1;
+    }
+
+    size_t cap = 1024, arena_cap = 1 << 20, arena_len = 0;
+    memset(trace, 0, sizeof(*trace));
+    trace->frames = malloc(cap * sizeof(frame_t));
+    trace->arena = malloc(arena_cap);
+    size_t *offsets = malloc(cap * sizeof(size_t));
+    if (!trace->frames || !trace->arena || !offsets) {
+        fprintf(stderr, "Out of memory loading %s\n", path);
+        pcap_close(handle);
+        free(offsets);
+        return -1;
+    }
+
+    struct pcap_pkthdr *hdr;
+    const u_char *data;
+    int rc;
+    while ((rc = pcap_next_ex(handle, &hdr, &data)) == 1) {
+        if (trace->count == cap) {
+            cap *= 2;
+            trace->frames = realloc(trace->frames, cap * sizeof(frame_t));
+            offsets = realloc(offsets, cap * sizeof(size_t));
+        }
+        while (arena_len + hdr->caplen > arena_cap) {
+            arena_cap *= 2;
+            trace->arena = realloc(trace->arena, arena_cap);
+        }
+        if (!trace->frames || !offsets || !trace->arena) {
+            fprintf(stderr, "Out of memory loading %s\n", path);
+            pcap_close(handle);
+            return -1;
+        }
+
+        memcpy(trace->arena + arena_len, data, hdr->caplen);
+        trace->frames[trace->count].hdr = *hdr;
+        trace->frames[trace->count].cls = classify(data, hdr->caplen);
+        offsets[trace->count] = arena_len;
+        arena_len += hdr->caplen;
+        trace->count++;
+    }
+    if (rc == -1) {
+        fprintf(stderr, "Error reading %s: %s\n", path, pcap_geterr(handle));
+    }
+    pcap_close(handle);
+
+    // The arena may have moved while growing, so pointers are fixed up last
+    for (size_t i = 0; i < trace->count; i++) {
+        trace->frames[i].data = trace->arena + offsets[i];
+    }
+    free(offsets);
+
+    if (trace->count > 0) {
+        const struct timeval *first = &trace->frames[0].hdr.ts;
+        const struct timeval *last = &trace->frames[trace->count - 1].hdr.ts;
+        int64_t us = (int64_t)(last->tv_sec - first->tv_sec) * 1000000 + (last->tv_usec - first->tv_usec);
+        trace->duration_us = us > 0 ? (uint64_t)us : 0;
+    }
+    return 0;
+}
+
+// Shift capture timestamps forward on every loop so the AP cache and data
+// aggregation windows see time advancing instead of repeating
+static void replay_frame(sniffer_t *sniffer, const frame_t *f, uint64_t shift_us) {
+    struct pcap_pkthdr hdr = f->hdr;
+    uint64_t us = (uint64_t)hdr.ts.tv_usec + shift_us;
+    hdr.ts.tv_sec += us / 1000000;
+    hdr.ts.tv_usec = us % 1000000;
+    packet_handler((u_char *)&sniffer->radios[0], &hdr, f->data);
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+typedef struct {
+    uint64_t frames;
+    uint64_t ns;
+    size_t fingerprints;    // Distinct probe request fingerprints
+} ie_bench_t;
+
+// Element decoding on its own: ie_parse plus everything the handlers
+// derive from it, over the beacons and probe requests of the trace
+static void bench_ie(const trace_t *trace, uint64_t overhead, ie_bench_t *out) {
+    memset(out, 0, sizeof(*out));
+    uint32_t *prints = malloc(trace->count * sizeof(uint32_t));
+    size_t num_prints = 0;
+    volatile uint32_t sink = 0;
+
+    for (size_t i = 0; i < trace->count; i++) {
+        const frame_t *f = &trace->frames[i];
+        if (f->cls != CLASS_BEACON && f->cls != CLASS_PROBE_REQ) continue;
+
+        radiotap_info_t rt;
+        radiotap_parse(f->data, f->hdr.caplen, &rt);
+        uint32_t start = rt.len + 24 + (f->cls == CLASS_BEACON ? 12 : 0);
+        if (f->hdr.caplen < start) continue;
+        const uint8_t *elems = f->data + start;
+        uint32_t len = f->hdr.caplen - start - radiotap_fcs_len(&rt);
+
+        uint64_t t0 = mono_ns();
+        ie_info_t ies;
+        char ssid[33], country[2];
+        ie_parse(elems, len, &ies);
+        ie_ssid(&ies, elems, ssid);
+        if (f->cls == CLASS_BEACON) {
+            sink += ie_security(&ies, elems, false) + ie_max_rate(&ies, elems) + ie_channel(&ies, elems) +
+                    ie_country(&ies, elems, country);
+        }
+        uint64_t ns = mono_ns() - t0;
+        out->ns += ns > overhead ? ns - overhead : 0;
+        out->frames++;
+        sink += (uint32_t)ssid[0];
+
+        if (f->cls == CLASS_PROBE_REQ && prints) prints[num_prints++] = ies.fingerprint;
+    }
+    (void)sink;
+
+    if (prints) {
+        qsort(prints, num_prints, sizeof(uint32_t), compare_u32);
+        for (size_t i = 0; i < num_prints; i++) {
+            if (i == 0 || prints[i] != prints[i - 1]) out->fingerprints++;
+        }
+        free(prints);
+    }
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options] capture.pcap\n"
+            "  -l, --loops N         Times to replay the file (default 10)\n"
+            "  -u, --uploaders N     Uploader threads (default %d)\n"
+            "  -b, --batch-size N    Events per batch, 1 disables batching (default %d)\n"
+            "  -w, --workers N       Parse worker threads, 0 parses on the replay thread (default 0)\n"
+            "  -h, --help            Show this help\n",
+            prog, SNIFFER_DEFAULT_UPLOADERS, HTTP_BATCH_DEFAULT_MAX_EVENTS);
+}
+
+int main(int argc, char *argv[]) {
+    sniffer_opts_t opts;
+    sniffer_opts_init(&opts);
+    int loops = 10;
+
+    static const struct option long_opts[] = {
+        {"loops", required_argument, NULL, 'l'},
+        {"uploaders", required_argument, NULL, 'u'},
+        {"batch-size", required_argument, NULL, 'b'},
+        {"workers", required_argument, NULL, 'w'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "l:u:b:w:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+            case 'l':
+                loops = atoi(optarg);
+                break;
+            case 'u':
+                opts.num_uploaders = atoi(optarg);
+                break;
+            case 'b':
+                opts.batch_size = atoi(optarg);
+                break;
+            case 'w':
+                opts.num_workers = atoi(optarg);
+                break;
+            case 'h':
+                usage(argv[0]);
+                return 0;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (loops < 1) loops = 1;
+
+    trace_t trace;
+    if (load_trace(argv[optind], &trace) != 0 || trace.count == 0) {
+        fprintf(stderr, "No frames to replay\n");
+        return 1;
+    }
+
+    // Replay outruns any worker; wait on full rings rather than measure drops
+    opts.backpressure = true;
+
+    static sniffer_t sniffer;
+    if (http_sink_init() != 0 || sniffer_init_offline(&sniffer, &opts) != 0) {
+        fprintf(stderr, "Failed to set up the pipeline\n");
+        return 1;
+    }
+
+    // Keep the uploader and spool status lines out of the report while replaying
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, STDOUT_FILENO);
+    close(devnull);
+
+    // Throughput: back-to-back replay with no per-frame timing
+    uint64_t shift_us = 0;
+    counting = 1;
+    uint64_t start = mono_ns();
+    for (int l = 0; l < loops; l++) {
+        for (size_t i = 0; i < trace.count; i++) {
+            replay_frame(&sniffer, &trace.frames[i], shift_us);
+        }
+        shift_us += trace.duration_us + 1000000;
+    }
+    sniffer_wait_workers(&sniffer);
+    uint64_t elapsed = mono_ns() - start;
+    counting = 0;
+    uint64_t allocs = alloc_count;
+
+    // Per-type cost: one more pass timing each call, less the cost of the
+    // clock reads themselves
+    uint64_t overhead = mono_ns();
+    for (int i = 0; i < 1000; i++) {
+        (void)mono_ns();
+    }
+    overhead = (mono_ns() - overhead) / 1001;
+
+    uint64_t class_ns[CLASS_COUNT] = {0};
+    uint64_t class_frames[CLASS_COUNT] = {0};
+    for (size_t i = 0; i < trace.count; i++) {
+        const frame_t *f = &trace.frames[i];
+        uint64_t t0 = mono_ns();
+        replay_frame(&sniffer, f, shift_us);
+        uint64_t ns = mono_ns() - t0;
+        class_ns[f->cls] += ns > overhead ? ns - overhead : 0;
+        class_frames[f->cls]++;
+    }
+
+    ie_bench_t ie;
+    bench_ie(&trace, overhead, &ie);
+
+    // Queue counters go away with the uploaders, so read them first
+    uint64_t enqueued, dropped;
+    sniffer_queue_stats(&sniffer, &enqueued, &dropped);
+    sniffer_stop(&sniffer);
+
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+
+    uint64_t frames = (uint64_t)loops * trace.count;
+    http_sink_stats_t sink;
+    http_sink_report(&sink);
+
+    printf("Replayed %zu frames x %d loops from %s\n", trace.count, loops, argv[optind]);
+    printf("Throughput:     %.0f frames/s (%.1f ns/frame)\n",
+           frames * 1e9 / (double)elapsed, (double)elapsed / frames);
+    printf("Allocations:    %.4f per frame on the capture thread (%llu total)\n",
+           (double)allocs / frames, (unsigned long long)allocs);
+    printf("Events:         %llu queued, %llu dropped, %llu posted in %llu requests\n",
+           (unsigned long long)enqueued, (unsigned long long)dropped,
+           (unsigned long long)sink.events, (unsigned long long)sink.posts);
+    printf("Enqueue->POST:  p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n",
+           sink.p50_ns / 1e3, sink.p90_ns / 1e3, sink.p99_ns / 1e3, sink.max_ns / 1e3);
+
+    if (ie.frames) {
+        printf("IE decode:      %.1f ns/frame over %llu beacons and probes, %zu distinct probe fingerprints\n",
+               (double)ie.ns / ie.frames, (unsigned long long)ie.frames, ie.fingerprints);
+    }
+
+    printf("\n%-12s %10s %12s\n", "type", "frames", "ns/frame");
+    for (int c = 0; c < CLASS_COUNT; c++) {
+        if (class_frames[c] == 0) continue;
+        printf("%-12s %10llu %12.1f\n", class_names[c], (unsigned long long)class_frames[c],
+               (double)class_ns[c] / class_frames[c]);
+    }
+
+    sniffer_cleanup(&sniffer);
+    http_sink_free();
+    free(trace.frames);
+    free(trace.arena);
+    return 0;
+}
@@ -0,0 +1,130 @@
+// Stand-in for src/http_client.c in the bench build: nothing is encoded or
+// sent, each "POST" only records how long its events sat in the pipeline
+// since sniffer_emit stamped them.
+#include "http_client.h"
+#include "http_sink.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SINK_MAX_SAMPLES (1u << 22)
+
+static uint64_t *samples;
+static _Atomic uint32_t num_samples;
+static _Atomic uint64_t num_posts;
+static _Atomic uint64_t num_events;
+
+static uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void record(uint64_t enqueue_ns, uint64_t now) {
+    atomic_fetch_add_explicit(&num_events, 1, memory_order_relaxed);
+    uint32_t i = atomic_fetch_add_explicit(&num_samples, 1, memory_order_relaxed);
+    if (i < SINK_MAX_SAMPLES) {
+        samples[i] = now - enqueue_ns;
+    }
+}
+
+int http_sink_init(void) {
+    samples = malloc(SINK_MAX_SAMPLES * sizeof(uint64_t));
+    return samples ? 0 : -1;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+void http_sink_report(http_sink_stats_t *stats) {
+    uint32_t n = atomic_load(&num_samples);
+    if (n > SINK_MAX_SAMPLES) n = SINK_MAX_SAMPLES;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->posts = atomic_load(&num_posts);
+    stats->events = atomic_load(&num_events);
+    stats->samples = n;
+    if (n == 0) return;
+
+    qsort(samples, n, sizeof(uint64_t), cmp_u64);
+    stats->p50_ns = samples[n / 2];
+    stats->p90_ns = samples[(uint64_t)n * 90 / 100];
+    stats->p99_ns = samples[(uint64_t)n * 99 / 100];
+    stats->max_ns = samples[n - 1];
+}
+
+void http_sink_free(void) {
+    free(samples);
+    samples = NULL;
+}
+
+int http_client_init(http_client_t *client, const char *api_url, const char *sniffer_id,
+                     http_compression_t compression) {
+    (void)api_url;
+    (void)sniffer_id;
+    (void)compression;
+    memset(client, 0, sizeof(*client));
+    return 0;
+}
+
+void http_client_cleanup(http_client_t *client) {
+    (void)client;
+}
+
+int http_post_event(http_client_t *client, const flux_event_t *ev) {
+    (void)client;
+    atomic_fetch_add_explicit(&num_posts, 1, memory_order_relaxed);
+    record(ev->enqueue_ns, mono_ns());
+    return 0;
+}
+
+int http_post_sketch(http_client_t *client, const uint8_t *body, size_t len) {
+    (void)client;
+    (void)body;
+    (void)len;
+    return 0;
+}
+
+// The batch buffer holds the enqueue stamps of the pending events
+int http_batch_init(http_batch_t *batch, int max_events, http_wire_format_t format) {
+    memset(batch, 0, sizeof(*batch));
+    batch->format = format;
+    batch->max_events = max_events > 0 ? max_events : HTTP_BATCH_DEFAULT_MAX_EVENTS;
+    batch->cap = (size_t)batch->max_events * sizeof(uint64_t);
+    batch->buf = malloc(batch->cap);
+    return batch->buf ? 0 : -1;
+}
+
+void http_batch_free(http_batch_t *batch) {
+    free(batch->buf);
+    batch->buf = NULL;
+}
+
+bool http_batch_add(http_batch_t *batch, const flux_event_t *ev) {
+    if (batch->count >= batch->max_events) {
+        return false;
+    }
+    memcpy(batch->buf + batch->len, &ev->enqueue_ns, sizeof(uint64_t));
+    batch->len += sizeof(uint64_t);
+    batch->count++;
+    return true;
+}
+
+int http_batch_flush(http_batch_t *batch, http_client_t *client) {
+    (void)client;
+    if (batch->count == 0) return 0;
+
+    atomic_fetch_add_explicit(&num_posts, 1, memory_order_relaxed);
+    uint64_t now = mono_ns();
+    for (int i = 0; i < batch->count; i++) {
+        uint64_t stamp;
+        memcpy(&stamp, batch->buf + i * sizeof(uint64_t), sizeof(uint64_t));
+        record(stamp, now);
+    }
+
+    batch->len = 0;
+    batch->count = 0;
+    return 0;
+}
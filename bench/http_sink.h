@@ -0,0 +1,21 @@
+#ifndef HTTP_SINK_H
+#define HTTP_SINK_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint64_t posts;
+    uint64_t events;
+    uint32_t samples;
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t max_ns;
+} http_sink_stats_t;
+
+int http_sink_init(void);
+// Sorts the recorded enqueue->POST latencies; call once the uploaders have stopped
+void http_sink_report(http_sink_stats_t *stats);
+void http_sink_free(void);
+
+#endif
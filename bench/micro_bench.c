@@ -0,0 +1,593 @@
+// Microbenchmarks for the per-frame parsing and per-event encoding
+// kernels: radiotap RSSI extraction, the element decoder, OUI lookup, MAC
+// formatting and the batch record encoders. Every kernel runs over a
+// fixed synthetic corpus built from a constant seed, so numbers compare
+// across builds and machines. Reports the best of several runs in ns/op
+// and, where perf_event_open is allowed, CPU cycles/op. Built by
+// `make microbench`.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "radiotap.h"
+#include "ie.h"
+#include "oui.h"
+#include "http_client.h"
+#include "cpu_affinity.h"
+
+#define CORPUS_SIZE 256     // Entries per corpus; a power of two
+#define FRAME_MAX 512
+#define BEACON_FIXED_LEN 12
+
+typedef struct {
+    uint8_t data[FRAME_MAX];
+    uint32_t len;
+} frame_t;
+
+static frame_t radiotap_basic[CORPUS_SIZE];
+static frame_t radiotap_chains[CORPUS_SIZE];
+static frame_t beacons[CORPUS_SIZE];      // Elements after the fixed fields
+static frame_t probes[CORPUS_SIZE];
+static uint8_t macs[CORPUS_SIZE][6];
+static flux_event_t events[EVENT_DATA + 1][CORPUS_SIZE];
+
+// Keeps results live so the compiler cannot drop a kernel's work
+static volatile uint64_t sink;
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint32_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 16);
+}
+
+static uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Corpora
+
+static void put(frame_t *f, const void *p, size_t n) {
+    memcpy(f->data + f->len, p, n);
+    f->len += (uint32_t)n;
+}
+
+static void put_elem(frame_t *f, uint8_t id, const void *body, uint8_t len) {
+    f->data[f->len++] = id;
+    f->data[f->len++] = len;
+    put(f, body, len);
+}
+
+static void put_random_elem(frame_t *f, uint8_t id, uint8_t len) {
+    uint8_t body[255];
+    for (int i = 0; i < len; i++) body[i] = (uint8_t)rng();
+    put_elem(f, id, body, len);
+}
+
+static void put_ssid(frame_t *f, int max_len) {
+    static const char chars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_ ";
+    char ssid[32];
+    int len = max_len ? 4 + (int)(rng() % (max_len - 3)) : 0;
+    for (int i = 0; i < len; i++) ssid[i] = chars[rng() % (sizeof(chars) - 1)];
+    put_elem(f, IE_SSID, ssid, (uint8_t)len);
+}
+
+static const uint16_t channels_mhz[] = {2412, 2437, 2462, 5180, 5220, 5745};
+
+// Flags, rate, channel and one combined signal: the common single-chain layout
+static void build_radiotap_basic(frame_t *f) {
+    uint16_t freq = channels_mhz[rng() % 6];
+    uint8_t hdr[15] = {0, 0, 15, 0, 0x2e, 0, 0, 0};
+    hdr[8] = RADIOTAP_F_FCS;
+    hdr[9] = 12;
+    hdr[10] = (uint8_t)freq;
+    hdr[11] = (uint8_t)(freq >> 8);
+    hdr[12] = 0xa0;
+    hdr[14] = (uint8_t)(-30 - (int)(rng() % 60));
+    f->len = 0;
+    put(f, hdr, sizeof(hdr));
+}
+
+// TSFT, flags, rate, channel, combined signal and RX flags, then two
+// chains in extended present words, as multi-antenna drivers report them
+static void build_radiotap_chains(frame_t *f) {
+    uint16_t freq = channels_mhz[rng() % 6];
+    uint8_t hdr[38] = {0, 0, 38, 0};
+    uint32_t words[3] = {
+        (1u << RADIOTAP_TSFT) | (1u << RADIOTAP_FLAGS) | (1u << RADIOTAP_RATE) | (1u << RADIOTAP_CHANNEL) |
+            (1u << RADIOTAP_DBM_ANTSIGNAL) | (1u << 14) | (1u << RADIOTAP_RADIOTAP_NAMESPACE) | (1u << RADIOTAP_EXT),
+        (1u << RADIOTAP_DBM_ANTSIGNAL) | (1u << RADIOTAP_ANTENNA) | (1u << RADIOTAP_RADIOTAP_NAMESPACE) |
+            (1u << RADIOTAP_EXT),
+        (1u << RADIOTAP_DBM_ANTSIGNAL) | (1u << RADIOTAP_ANTENNA),
+    };
+    for (int w = 0; w < 3; w++) {
+        for (int b = 0; b < 4; b++) hdr[4 + 4 * w + b] = (uint8_t)(words[w] >> (8 * b));
+    }
+    for (int i = 16; i < 24; i++) hdr[i] = (uint8_t)rng();
+    hdr[24] = RADIOTAP_F_FCS;
+    hdr[25] = 108;
+    hdr[26] = (uint8_t)freq;
+    hdr[27] = (uint8_t)(freq >> 8);
+    hdr[28] = 0x40;
+    int8_t signal = (int8_t)(-30 - (int)(rng() % 60));
+    hdr[30] = (uint8_t)signal;
+    hdr[34] = (uint8_t)(signal - 2);
+    hdr[35] = 0;
+    hdr[36] = (uint8_t)(signal - (int)(rng() % 6));
+    hdr[37] = 1;
+    f->len = 0;
+    put(f, hdr, sizeof(hdr));
+}
+
+static const uint8_t rsn_psk[] = {1, 0, 0x00, 0x0f, 0xac, 4, 1, 0, 0x00, 0x0f, 0xac, 4, 1, 0, 0x00, 0x0f, 0xac, 2, 0x0c, 0};
+static const uint8_t rsn_psk_sae[] = {1, 0, 0x00, 0x0f, 0xac, 4, 1, 0, 0x00, 0x0f, 0xac, 4, 2, 0,
+                                      0x00, 0x0f, 0xac, 2, 0x00, 0x0f, 0xac, 8, 0x8c, 0};
+static const uint8_t wmm_param[] = {0x00, 0x50, 0xf2, 2, 1, 1, 0x80, 0, 3, 0xa4, 0, 0, 0x27, 0xa4, 0, 0,
+                                    0x42, 0x43, 0x5e, 0, 0x62, 0x32, 0x2f, 0};
+static const uint8_t wps[] = {0x00, 0x50, 0xf2, 4, 0x10, 0x4a, 0, 1, 0x10, 0x10, 0x44, 0, 1, 2};
+static const uint8_t p2p[] = {0x50, 0x6f, 0x9a, 9, 2, 2, 0, 0x25, 0};
+static const uint8_t legacy_rates[] = {0x82, 0x84, 0x8b, 0x96, 0x0c, 0x12, 0x18, 0x24};
+static const uint8_t ext_rates[] = {0x30, 0x48, 0x60, 0x6c};
+
+// A beacon's elements in the order access points send them; the mix of
+// open, WPA2 and WPA3 networks and of HT/VHT/HE varies per entry
+static void build_beacon(frame_t *f) {
+    uint32_t r = rng();
+    f->len = 0;
+    put_ssid(f, 20);
+    put_elem(f, IE_SUPP_RATES, legacy_rates, sizeof(legacy_rates));
+    uint8_t channel = (uint8_t)(1 + rng() % 11);
+    put_elem(f, IE_DS_PARAMS, &channel, 1);
+    put_random_elem(f, 5, 4);   // TIM
+    put_elem(f, IE_COUNTRY, "US \x01\x0b\x1e", 6);
+    put_random_elem(f, 42, 1);  // ERP
+    if (r & 1) {
+        put_elem(f, IE_RSN, rsn_psk, sizeof(rsn_psk));
+    } else if (r & 2) {
+        put_elem(f, IE_RSN, rsn_psk_sae, sizeof(rsn_psk_sae));
+    }
+    put_elem(f, IE_EXT_RATES, ext_rates, sizeof(ext_rates));
+    put_random_elem(f, IE_HT_CAP, 26);
+    put_random_elem(f, 61, 22); // HT operation
+    put_random_elem(f, IE_EXT_CAPS, 8);
+    if (r & 4) {
+        put_random_elem(f, IE_VHT_CAP, 12);
+        put_random_elem(f, 192, 5);   // VHT operation
+    }
+    if (r & 8) {
+        uint8_t he[22];
+        he[0] = IE_EXT_HE_CAP;
+        for (int i = 1; i < 22; i++) he[i] = (uint8_t)rng();
+        put_elem(f, IE_EXTENSION, he, sizeof(he));
+    }
+    put_elem(f, IE_VENDOR, wmm_param, sizeof(wmm_param));
+    if (r & 16) put_elem(f, IE_VENDOR, wps, sizeof(wps));
+}
+
+// A probe request's elements: wildcard or directed SSID, rates and
+// capabilities, sometimes P2P
+static void build_probe(frame_t *f) {
+    uint32_t r = rng();
+    f->len = 0;
+    put_ssid(f, r & 1 ? 16 : 0);
+    put_elem(f, IE_SUPP_RATES, legacy_rates, sizeof(legacy_rates));
+    put_elem(f, IE_EXT_RATES, ext_rates, sizeof(ext_rates));
+    put_random_elem(f, IE_HT_CAP, 26);
+    put_random_elem(f, IE_EXT_CAPS, 10);
+    if (r & 2) put_random_elem(f, IE_VHT_CAP, 12);
+    if (r & 4) {
+        uint8_t he[26];
+        he[0] = IE_EXT_HE_CAP;
+        for (int i = 1; i < 26; i++) he[i] = (uint8_t)rng();
+        put_elem(f, IE_EXTENSION, he, sizeof(he));
+    }
+    if (r & 8) put_elem(f, IE_VENDOR, p2p, sizeof(p2p));
+    if (r & 16) put_elem(f, IE_VENDOR, wps, sizeof(wps));
+}
+
+// A quarter each of listed vendors, unlisted OUIs, randomized (locally
+// administered) addresses and addresses differing only in the low bytes
+static void build_mac(uint8_t *mac, int i) {
+    static const uint32_t known[] = {0x0023d6, 0x001d70, 0x080027, 0x84f3eb, 0x50c7bf, 0xe848b8, 0x1c61b4, 0x000e38};
+    uint32_t oui;
+    switch (i % 4) {
+        case 0: oui = known[rng() % 8]; break;
+        case 1: oui = rng() & 0xfcffff; break;
+        case 2: oui = (rng() & 0xffffff) | 0x020000; break;
+        default: oui = 0x0023d6; break;
+    }
+    mac[0] = (uint8_t)(oui >> 16);
+    mac[1] = (uint8_t)(oui >> 8);
+    mac[2] = (uint8_t)oui;
+    for (int b = 3; b < 6; b++) mac[b] = (uint8_t)rng();
+}
+
+static void build_event(flux_event_t *ev, event_type_t type, int i) {
+    memset(ev, 0, sizeof(*ev));
+    ev->type = (uint8_t)type;
+    ev->ts_us = 1700000000000000ull + (uint64_t)i * 1234567;
+    ev->seq = (uint32_t)i * 7919;
+    ev->rssi = (int8_t)(-30 - (int)(rng() % 60));
+    memcpy(ev->mac, macs[i], 6);
+
+    switch (type) {
+        case EVENT_DEVICE:
+            // One SSID in eight needs escaping
+            if (i % 2) snprintf(ev->ssid, sizeof(ev->ssid), i % 8 == 1 ? "Cafe \"Free\" %d" : "HomeNet-%d", i);
+            ev->fingerprint = rng();
+            ev->caps = (uint8_t)(IE_CAP_HT | (rng() & (IE_CAP_VHT | IE_CAP_HE | IE_CAP_WMM)));
+            ev->frame_count = i % 4 == 0 ? 4 : 1;
+            break;
+        case EVENT_AP:
+            snprintf(ev->ssid, sizeof(ev->ssid), "Office-%04x", rng() & 0xffff);
+            ev->channel = (uint16_t)(1 + rng() % 11);
+            ev->frame_count = 1 + (int32_t)(rng() % 100);
+            ev->security = i % 3 ? IE_SEC_RSN | IE_SEC_PSK : IE_SEC_RSN | IE_SEC_PSK | IE_SEC_SAE;
+            ev->max_rate = 108;
+            memcpy(ev->country, "US", 2);
+            ev->caps = IE_CAP_HT | IE_CAP_VHT | IE_CAP_WMM;
+            break;
+        case EVENT_CONNECTION:
+            memcpy(ev->bssid, macs[(i + 1) % CORPUS_SIZE], 6);
+            break;
+        case EVENT_DISCONNECTION:
+            ev->frame_count = 1 + (int32_t)(rng() % 3);
+            break;
+        case EVENT_DATA:
+            ev->frame_count = (int32_t)(rng() % 5000);
+            ev->byte_count = rng() % 5000000;
+            ev->direction = (uint8_t)(rng() % 4);
+            break;
+    }
+}
+
+static int build_corpora(void) {
+    for (int i = 0; i < CORPUS_SIZE; i++) {
+        build_radiotap_basic(&radiotap_basic[i]);
+        build_radiotap_chains(&radiotap_chains[i]);
+        build_beacon(&beacons[i]);
+        build_probe(&probes[i]);
+        build_mac(macs[i], i);
+    }
+    for (int t = EVENT_DEVICE; t <= EVENT_DATA; t++) {
+        for (int i = 0; i < CORPUS_SIZE; i++) build_event(&events[t][i], (event_type_t)t, i);
+    }
+
+    // A corpus the parsers reject would time only the error paths
+    for (int i = 0; i < CORPUS_SIZE; i++) {
+        radiotap_info_t rt;
+        ie_info_t ies;
+        if (radiotap_parse(radiotap_basic[i].data, radiotap_basic[i].len, &rt) != 0 ||
+            !(rt.has & RADIOTAP_HAS_SIGNAL) ||
+            radiotap_parse(radiotap_chains[i].data, radiotap_chains[i].len, &rt) != 0 || rt.num_antennas != 2) {
+            fprintf(stderr, "Radiotap corpus entry %d does not parse\n", i);
+            return -1;
+        }
+        ie_parse(beacons[i].data, beacons[i].len, &ies);
+        if (ies.truncated || !ies.ds.present) {
+            fprintf(stderr, "Beacon corpus entry %d does not parse\n", i);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Kernels: each runs `iters` operations over its corpus and returns a
+// value derived from every result
+
+static uint64_t k_radiotap(const frame_t *corpus, size_t iters) {
+    uint64_t acc = 0;
+    radiotap_info_t rt;
+    for (size_t i = 0; i < iters; i++) {
+        const frame_t *f = &corpus[i & (CORPUS_SIZE - 1)];
+        radiotap_parse(f->data, f->len, &rt);
+        acc += (uint8_t)rt.signal_dbm + rt.freq_mhz;
+    }
+    return acc;
+}
+
+static uint64_t k_radiotap_basic(size_t iters) {
+    return k_radiotap(radiotap_basic, iters);
+}
+
+static uint64_t k_radiotap_chains(size_t iters) {
+    return k_radiotap(radiotap_chains, iters);
+}
+
+static uint64_t k_ie_parse(const frame_t *corpus, size_t iters) {
+    uint64_t acc = 0;
+    ie_info_t ies;
+    for (size_t i = 0; i < iters; i++) {
+        const frame_t *f = &corpus[i & (CORPUS_SIZE - 1)];
+        ie_parse(f->data, f->len, &ies);
+        acc += ies.fingerprint + ies.caps;
+    }
+    return acc;
+}
+
+static uint64_t k_ie_parse_beacon(size_t iters) {
+    return k_ie_parse(beacons, iters);
+}
+
+static uint64_t k_ie_parse_probe(size_t iters) {
+    return k_ie_parse(probes, iters);
+}
+
+// Everything handle_beacon asks of the decoder
+static uint64_t k_beacon_decode(size_t iters) {
+    uint64_t acc = 0;
+    ie_info_t ies;
+    char ssid[33], country[2];
+    for (size_t i = 0; i < iters; i++) {
+        const frame_t *f = &beacons[i & (CORPUS_SIZE - 1)];
+        ie_parse(f->data, f->len, &ies);
+        ie_ssid(&ies, f->data, ssid);
+        acc += (uint64_t)ie_channel(&ies, f->data) + ie_security(&ies, f->data, true) +
+               ie_max_rate(&ies, f->data) + ie_country(&ies, f->data, country) + (uint8_t)ssid[0];
+    }
+    return acc;
+}
+
+static uint64_t k_oui_lookup(size_t iters) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < iters; i++) {
+        acc += (uintptr_t)oui_lookup(macs[i & (CORPUS_SIZE - 1)]);
+    }
+    return acc;
+}
+
+// As http_client.c formats addresses into records
+static uint64_t k_mac_snprintf(size_t iters) {
+    uint64_t acc = 0;
+    char out[18];
+    for (size_t i = 0; i < iters; i++) {
+        const uint8_t *m = macs[i & (CORPUS_SIZE - 1)];
+        snprintf(out, sizeof(out), "%02x:%02x:%02x:%02x:%02x:%02x", m[0], m[1], m[2], m[3], m[4], m[5]);
+        acc += (uint8_t)out[16];
+    }
+    return acc;
+}
+
+// Candidate: one table lookup per byte instead of a format string
+static uint64_t k_mac_table(size_t iters) {
+    static const char hex[] = "0123456789abcdef";
+    uint64_t acc = 0;
+    char out[18];
+    for (size_t i = 0; i < iters; i++) {
+        const uint8_t *m = macs[i & (CORPUS_SIZE - 1)];
+        for (int b = 0; b < 6; b++) {
+            out[3 * b] = hex[m[b] >> 4];
+            out[3 * b + 1] = hex[m[b] & 0x0f];
+            out[3 * b + 2] = ':';
+        }
+        out[17] = '\0';
+        acc += (uint8_t)out[16];
+    }
+    return acc;
+}
+
+// One record through http_batch_add, resetting the batch in place when
+// it fills so the buffer stays hot, as an uploader's does
+static http_batch_t json_batch, binary_batch;
+
+static uint64_t k_encode(http_batch_t *batch, event_type_t type, size_t iters) {
+    size_t header = batch->format == HTTP_WIRE_BINARY ? HTTP_WIRE_HEADER_LEN : 1;
+    uint64_t acc = 0;
+    for (size_t i = 0; i < iters; i++) {
+        if (!http_batch_add(batch, &events[type][i & (CORPUS_SIZE - 1)])) {
+            acc += batch->len;
+            batch->len = header;
+            batch->count = 0;
+            http_batch_add(batch, &events[type][i & (CORPUS_SIZE - 1)]);
+        }
+    }
+    return acc + batch->len;
+}
+
+static uint64_t k_json_device(size_t iters) { return k_encode(&json_batch, EVENT_DEVICE, iters); }
+static uint64_t k_json_ap(size_t iters) { return k_encode(&json_batch, EVENT_AP, iters); }
+static uint64_t k_json_connection(size_t iters) { return k_encode(&json_batch, EVENT_CONNECTION, iters); }
+static uint64_t k_json_disconnection(size_t iters) { return k_encode(&json_batch, EVENT_DISCONNECTION, iters); }
+static uint64_t k_json_data(size_t iters) { return k_encode(&json_batch, EVENT_DATA, iters); }
+static uint64_t k_binary_device(size_t iters) { return k_encode(&binary_batch, EVENT_DEVICE, iters); }
+static uint64_t k_binary_ap(size_t iters) { return k_encode(&binary_batch, EVENT_AP, iters); }
+
+typedef struct {
+    const char *name;
+    uint64_t (*run)(size_t iters);
+    const char *what;
+} kernel_t;
+
+static const kernel_t kernels[] = {
+    {"radiotap_basic", k_radiotap_basic, "radiotap_parse, flags/rate/channel/signal"},
+    {"radiotap_chains", k_radiotap_chains, "radiotap_parse, TSFT and two chains in ext words"},
+    {"ie_parse_beacon", k_ie_parse_beacon, "ie_parse over beacon elements"},
+    {"ie_parse_probe", k_ie_parse_probe, "ie_parse over probe request elements"},
+    {"beacon_decode", k_beacon_decode, "ie_parse plus the SSID/channel/security/rate/country getters"},
+    {"oui_lookup", k_oui_lookup, "oui_lookup, listed, unlisted and randomized MACs"},
+    {"mac_hex_snprintf", k_mac_snprintf, "MAC to text with snprintf, as the JSON encoder does"},
+    {"mac_hex_table", k_mac_table, "MAC to text with a hex table (candidate)"},
+    {"json_device", k_json_device, "http_batch_add, JSON device records"},
+    {"json_ap", k_json_ap, "http_batch_add, JSON access point records"},
+    {"json_connection", k_json_connection, "http_batch_add, JSON connection records"},
+    {"json_disconnection", k_json_disconnection, "http_batch_add, JSON disconnection records"},
+    {"json_data", k_json_data, "http_batch_add, JSON data records"},
+    {"binary_device", k_binary_device, "http_batch_add, binary device records"},
+    {"binary_ap", k_binary_ap, "http_batch_add, binary access point records"},
+};
+
+#define KERNEL_COUNT (sizeof(kernels) / sizeof(kernels[0]))
+
+// User-space CPU cycles of this thread; -1 where perf events are not
+// available (no PMU access in containers, perf_event_paranoid > 2)
+static int open_cycle_counter(void) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+typedef struct {
+    double ns_per_op;
+    double cycles_per_op;   // < 0 without a cycle counter
+} sample_t;
+
+static sample_t run_once(const kernel_t *k, size_t iters, int cycles_fd) {
+    sample_t s = {0, -1};
+    if (cycles_fd >= 0) {
+        ioctl(cycles_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(cycles_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    uint64_t start = mono_ns();
+    sink += k->run(iters);
+    uint64_t elapsed = mono_ns() - start;
+    if (cycles_fd >= 0) {
+        uint64_t cycles;
+        ioctl(cycles_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(cycles_fd, &cycles, sizeof(cycles)) == sizeof(cycles)) s.cycles_per_op = (double)cycles / iters;
+    }
+    s.ns_per_op = (double)elapsed / iters;
+    return s;
+}
+
+// Size runs to about run_ms each, then keep the fastest: the least
+// disturbed by interrupts and frequency changes. The spread between the
+// fastest and slowest run says how far to trust a difference.
+static void bench_kernel(const kernel_t *k, int runs, int run_ms, int cycles_fd) {
+    size_t iters = 1024;
+    uint64_t target_ns = (uint64_t)run_ms * 1000000;
+    for (;;) {
+        uint64_t start = mono_ns();
+        sink += k->run(iters);
+        uint64_t elapsed = mono_ns() - start;
+        if (elapsed >= target_ns / 8 || iters >= ((size_t)1 << 34)) {
+            iters = (size_t)((double)iters * target_ns / (elapsed ? elapsed : 1));
+            break;
+        }
+        iters *= 2;
+    }
+    if (iters < 1) iters = 1;
+
+    sample_t best = {0, -1};
+    double worst = 0;
+    for (int r = 0; r < runs; r++) {
+        sample_t s = run_once(k, iters, cycles_fd);
+        if (r == 0 || s.ns_per_op < best.ns_per_op) best = s;
+        if (s.ns_per_op > worst) worst = s.ns_per_op;
+    }
+
+    char cycles[16];
+    if (best.cycles_per_op >= 0) {
+        snprintf(cycles, sizeof(cycles), "%.1f", best.cycles_per_op);
+    } else {
+        snprintf(cycles, sizeof(cycles), "-");
+    }
+    printf("%-20s %10.1f %11s %7.1f%%  %s\n", k->name, best.ns_per_op, cycles,
+           best.ns_per_op > 0 ? 100.0 * (worst - best.ns_per_op) / best.ns_per_op : 0.0, k->what);
+    fflush(stdout);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options] [kernel...]\n"
+            "  Runs every kernel, or those whose names contain one of the arguments\n"
+            "  -r, --runs N          Timed runs per kernel, best reported (default 5)\n"
+            "  -t, --time-ms MS      Length of each run (default 100)\n"
+            "  -c, --cpu N           Pin to CPU N, ideally an isolated one\n"
+            "  -l, --list            List the kernels\n"
+            "  -h, --help            Show this help\n",
+            prog);
+}
+
+static bool selected(const char *name, int argc, char *argv[]) {
+    if (optind >= argc) return true;
+    for (int i = optind; i < argc; i++) {
+        if (strstr(name, argv[i])) return true;
+    }
+    return false;
+}
+
+int main(int argc, char *argv[]) {
+    int runs = 5, run_ms = 100, cpu = -1;
+
+    static const struct option long_opts[] = {
+        {"runs", required_argument, NULL, 'r'},
+        {"time-ms", required_argument, NULL, 't'},
+        {"cpu", required_argument, NULL, 'c'},
+        {"list", no_argument, NULL, 'l'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "r:t:c:lh", long_opts, NULL)) != -1) {
+        switch (opt) {
+            case 'r':
+                runs = atoi(optarg);
+                break;
+            case 't':
+                run_ms = atoi(optarg);
+                break;
+            case 'c':
+                cpu = atoi(optarg);
+                break;
+            case 'l':
+                for (size_t i = 0; i < KERNEL_COUNT; i++) printf("%-20s %s\n", kernels[i].name, kernels[i].what);
+                return 0;
+            case 'h':
+                usage(argv[0]);
+                return 0;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (runs < 1) runs = 1;
+    if (run_ms < 1) run_ms = 1;
+
+    if (cpu >= 0) {
+        cpu_mask_t mask = {0};
+        cpu_mask_set(&mask, cpu);
+        if (cpu_pin_thread(pthread_self(), &mask) != 0) {
+            fprintf(stderr, "Could not pin to CPU %d\n", cpu);
+            return 1;
+        }
+    }
+
+    if (build_corpora() != 0) return 1;
+    if (http_batch_init(&json_batch, HTTP_BATCH_DEFAULT_MAX_EVENTS, HTTP_WIRE_JSON) != 0 ||
+        http_batch_init(&binary_batch, HTTP_BATCH_DEFAULT_MAX_EVENTS, HTTP_WIRE_BINARY) != 0) {
+        fprintf(stderr, "Failed to allocate batch buffers\n");
+        return 1;
+    }
+
+    int cycles_fd = open_cycle_counter();
+    printf("%d runs of %d ms per kernel over %d-entry corpora, best run", runs, run_ms, CORPUS_SIZE);
+    if (cpu >= 0) printf(", on CPU %d", cpu);
+    if (cycles_fd < 0) printf("; no cycle counter (%s)", strerror(errno));
+    printf("\n\n%-20s %10s %11s %8s\n", "kernel", "ns/op", "cycles/op", "spread");
+
+    for (size_t i = 0; i < KERNEL_COUNT; i++) {
+        if (selected(kernels[i].name, argc, argv)) bench_kernel(&kernels[i], runs, run_ms, cycles_fd);
+    }
+
+    if (cycles_fd >= 0) close(cycles_fd);
+    http_batch_free(&json_batch);
+    http_batch_free(&binary_batch);
+    return 0;
+}
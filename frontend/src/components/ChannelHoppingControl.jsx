@@ -5,6 +5,7 @@ import { apiService } from '../services/api';
 export default function ChannelHoppingControl() {
   const [config, setConfig] = useState({
     enabled: false,
+    mode: 'round_robin',
     timeout_ms: 300,
     channels: [],
   });
@@ -50,8 +51,10 @@ export default function ChannelHoppingControl() {
 
       const updateData = {
         enabled: config.enabled,
+        mode: config.mode,
         timeout_ms: config.timeout_ms,
         channels: channels,
+        frame_types: config.frame_types,
       };
 
       await apiService.updateChannelConfig(updateData);
@@ -102,6 +105,19 @@ export default function ChannelHoppingControl() {
           </button>
         </div>
 
+        {/* Mode */}
+        <div className="form-group">
+          <label className="form-label">Hopping Mode</label>
+          <select
+            value={config.mode || 'round_robin'}
+            onChange={(e) => setConfig({ ...config, mode: e.target.value })}
+            className="input w-full"
+          >
+            <option value="round_robin">Round robin (fixed dwell)</option>
+            <option value="adaptive">Adaptive (dwell follows activity)</option>
+          </select>
+        </div>
+
         {/* Timeout */}
         <div className="form-group">
           <label className="form-label">
@@ -179,6 +195,7 @@ export default function ChannelHoppingControl() {
               </p>
               <p>
                 <span className="text-highlight">Hopping Interval:</span> {config.timeout_ms}ms
+                {config.mode === 'adaptive' ? ' (average, adaptive)' : ''}
               </p>
               <p>
                 <span className="text-highlight">Active Channels:</span>{' '}
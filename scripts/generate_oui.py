@@ -2,7 +2,9 @@
 import re
 import sys
 
-def parse_oui_file(input_file, output_file):
+
+def parse_oui_file(input_file):
+    """Return (oui, vendor) pairs in file order, oui as a 24-bit int."""
     oui_data = []
 
     with open(input_file, 'r', encoding='utf-8', errors='ignore') as f:
@@ -11,41 +13,109 @@ def parse_oui_file(input_file, output_file):
 
             match = re.match(r'^([0-9A-F]{2}-[0-9A-F]{2}-[0-9A-F]{2})\s+\(hex\)\s+(.+)$', line)
             if match:
-                oui_hex = match.group(1).replace('-', ':')
+                oui = int(match.group(1).replace('-', ''), 16)
                 vendor = match.group(2).strip()
-                vendor = vendor.replace('"', '\\"')
-                oui_data.append((oui_hex, vendor))
+                oui_data.append((oui, vendor))
+
+    return oui_data
+
+
+def c_string(s):
+    return '"' + s.replace('\\', '\\\\').replace('"', '\\"') + '"'
+
+
+def eytzinger(sorted_items):
+    """Lay out a sorted list in BFS (Eytzinger) order, 1-indexed.
+
+    A search walks the array top-down, so the first levels of the implicit
+    tree share a handful of cache lines instead of being spread across the
+    whole table as in a plain binary search.
+    """
+    n = len(sorted_items)
+    out = [None] * (n + 1)
+    it = iter(sorted_items)
+
+    # Iterative in-order traversal of the implicit tree rooted at 1
+    stack = []
+    k = 1
+    while stack or k <= n:
+        while k <= n:
+            stack.append(k)
+            k = 2 * k
+        k = stack.pop()
+        out[k] = next(it)
+        k = 2 * k + 1
+
+    return out
+
 
-    with open(output_file, 'w') as f:
+def write_oui_source(oui_data, output_file):
+    # Keep the first vendor listed for an OUI, matching what the old
+    # linear scan returned for duplicate entries
+    first = {}
+    for oui, vendor in oui_data:
+        first.setdefault(oui, vendor)
+    entries = sorted(first.items())
+
+    # Intern vendor names into one NUL-separated pool
+    pool = []
+    offsets = {}
+    size = 0
+    for _, vendor in entries:
+        if vendor not in offsets:
+            offsets[vendor] = size
+            pool.append(vendor)
+            size += len(vendor.encode('utf-8')) + 1
+
+    layout = eytzinger(entries)
+
+    with open(output_file, 'w', encoding='utf-8') as f:
+        f.write('// Generated by scripts/generate_oui.py - do not edit by hand\n')
         f.write('#include "oui.h"\n')
-        f.write('#include <string.h>\n')
-        f.write('#include <stdio.h>\n\n')
-
-        f.write('typedef struct {\n')
-        f.write('    uint8_t prefix[3];\n')
-        f.write('    const char *vendor;\n')
-        f.write('} oui_entry_t;\n\n')
-
-        f.write(f'static const oui_entry_t oui_db[{len(oui_data)}] = {{\n')
-        for oui_hex, vendor in oui_data:
-            parts = oui_hex.split(':')
-            f.write(f'    {{{{0x{parts[0]}, 0x{parts[1]}, 0x{parts[2]}}}, "{vendor}"}},\n')
+        f.write('#include <stddef.h>\n\n')
+
+        f.write(f'#define OUI_COUNT {len(entries)}\n\n')
+
+        f.write('// Vendor names, each stored once, NUL-separated\n')
+        f.write('static const char oui_strings[] =\n')
+        for vendor in pool:
+            f.write(f'    {c_string(vendor)} "\\0"\n')
+        f.write('    ;\n\n')
+
+        f.write('// 24-bit OUIs in Eytzinger order (index 0 unused) and the offset\n')
+        f.write('// of each one\'s vendor in oui_strings\n')
+        f.write('static const uint32_t oui_keys[OUI_COUNT + 1] = {\n    0,\n')
+        for oui, _ in layout[1:]:
+            f.write(f'    0x{oui:06x},\n')
+        f.write('};\n\n')
+
+        f.write('static const uint32_t oui_vendor[OUI_COUNT + 1] = {\n    0,\n')
+        for _, vendor in layout[1:]:
+            f.write(f'    {offsets[vendor]},\n')
         f.write('};\n\n')
 
         f.write('const char* oui_lookup(const uint8_t *mac) {\n')
-        f.write(f'    for (size_t i = 0; i < {len(oui_data)}; i++) {{\n')
-        f.write('        if (memcmp(mac, oui_db[i].prefix, 3) == 0) {\n')
-        f.write('            return oui_db[i].vendor;\n')
-        f.write('        }\n')
+        f.write('    uint32_t key = ((uint32_t)mac[0] << 16) | ((uint32_t)mac[1] << 8) | mac[2];\n')
+        f.write('    size_t k = 1;\n\n')
+        f.write('    // Branch-free descent; k ends up encoding the path taken\n')
+        f.write('    while (k <= OUI_COUNT) {\n')
+        f.write('        k = 2 * k + (oui_keys[k] < key);\n')
+        f.write('    }\n')
+        f.write('    // Undo the trailing right turns to land on the lower bound\n')
+        f.write('    k >>= __builtin_ffsll(~(long long)k);\n\n')
+        f.write('    if (k != 0 && oui_keys[k] == key) {\n')
+        f.write('        return oui_strings + oui_vendor[k];\n')
         f.write('    }\n')
         f.write('    return "Unknown";\n')
         f.write('}\n')
 
-    print(f"Generated {len(oui_data)} OUI entries")
+    print(f"Generated {len(entries)} OUI entries "
+          f"({len(oui_data) - len(entries)} duplicates dropped, {len(pool)} vendor strings)")
+
 
 if __name__ == '__main__':
     if len(sys.argv) != 3:
         print("Usage: generate_oui.py <input_oui.txt> <output_oui.c>")
         sys.exit(1)
 
-    parse_oui_file(sys.argv[1], sys.argv[2])
+    write_oui_source(parse_oui_file(sys.argv[1]), sys.argv[2])
@@ -0,0 +1,77 @@
+#include "alloc_stats.h"
+#include <stddef.h>
+#include <stdio.h>
+
+static alloc_thread_stats_t threads[ALLOC_STATS_MAX_THREADS];
+static atomic_int num_threads;
+static _Thread_local alloc_thread_stats_t *self;
+
+void alloc_stats_register(const char *name) {
+    // Slots are never reused, so a restarted thread takes a new one
+    int i = atomic_fetch_add(&num_threads, 1);
+    if (i >= ALLOC_STATS_MAX_THREADS) {
+        atomic_store(&num_threads, ALLOC_STATS_MAX_THREADS);
+        return;
+    }
+    snprintf(threads[i].name, sizeof(threads[i].name), "%s", name);
+    self = &threads[i];
+}
+
+uint64_t alloc_stats_self(void) {
+    return self ? atomic_load_explicit(&self->allocs, memory_order_relaxed) : 0;
+}
+
+int alloc_stats_count(void) {
+    int n = atomic_load(&num_threads);
+    return n < ALLOC_STATS_MAX_THREADS ? n : ALLOC_STATS_MAX_THREADS;
+}
+
+const alloc_thread_stats_t *alloc_stats_get(int i) {
+    return &threads[i];
+}
+
+#ifdef FLUX_ALLOC_STATS
+
+bool alloc_stats_enabled(void) {
+    return true;
+}
+
+// glibc's own entry points, so the interposers below need no dlsym (which
+// allocates itself)
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+// Only the owning thread writes its counters; relaxed atomics let other
+// threads read them without tearing
+static inline void charge(size_t size) {
+    alloc_thread_stats_t *t = self;
+    if (!t) return;
+    atomic_store_explicit(&t->allocs, atomic_load_explicit(&t->allocs, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+    atomic_store_explicit(&t->bytes, atomic_load_explicit(&t->bytes, memory_order_relaxed) + size,
+                          memory_order_relaxed);
+}
+
+void *malloc(size_t size) {
+    charge(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+    charge(n * size);
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    charge(size);
+    return __libc_realloc(ptr, size);
+}
+
+#else
+
+bool alloc_stats_enabled(void) {
+    return false;
+}
+
+#endif
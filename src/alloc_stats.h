@@ -0,0 +1,32 @@
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#define ALLOC_STATS_MAX_THREADS 32
+
+typedef struct {
+    char name[24];
+    _Atomic uint64_t allocs;     // malloc/calloc/realloc calls
+    _Atomic uint64_t bytes;
+} alloc_thread_stats_t;
+
+// Heap allocation counters per named thread. Built with FLUX_ALLOC_STATS,
+// the sniffer interposes malloc, calloc and realloc and charges every call
+// to the calling thread, which proves the capture path stays allocation
+// free once running. Without it the counters stay at zero.
+
+// Registers the calling thread; later allocations on it are counted
+void alloc_stats_register(const char *name);
+bool alloc_stats_enabled(void);
+
+// Allocations charged to the calling thread so far
+uint64_t alloc_stats_self(void);
+
+// Number of registered threads; their counters stay valid for the process
+int alloc_stats_count(void);
+const alloc_thread_stats_t *alloc_stats_get(int i);
+
+#endif
@@ -0,0 +1,132 @@
+#include "ap_cache.h"
+#include "mac.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define AP_CACHE_USED (1ULL << 63)
+
+static inline size_t slot_for(uint64_t key, size_t mask) {
+    // Fibonacci hashing spreads the mostly-sequential vendor BSSIDs
+    return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+static int alloc_entries(ap_cache_t *cache, size_t capacity) {
+    cache->entries = calloc(capacity, sizeof(ap_cache_entry_t));
+    if (!cache->entries) return -1;
+    cache->mask = capacity - 1;
+    cache->count = 0;
+    return 0;
+}
+
+int ap_cache_init(ap_cache_t *cache, int rssi_hysteresis, int heartbeat_s) {
+    memset(cache, 0, sizeof(*cache));
+    cache->rssi_hysteresis = rssi_hysteresis > 0 ? rssi_hysteresis : AP_CACHE_DEFAULT_HYSTERESIS_DB;
+    cache->heartbeat_ms = (uint64_t)(heartbeat_s > 0 ? heartbeat_s : AP_CACHE_DEFAULT_HEARTBEAT_S) * 1000;
+    return alloc_entries(cache, AP_CACHE_INITIAL_CAPACITY);
+}
+
+void ap_cache_destroy(ap_cache_t *cache) {
+    free(cache->entries);
+    cache->entries = NULL;
+}
+
+// Rebuild the table once it passes 75% load: entries not seen for two
+// heartbeats are dropped, and the table doubles if it is still crowded.
+static void rehash(ap_cache_t *cache, uint64_t now_ms) {
+    ap_cache_entry_t *old = cache->entries;
+    size_t old_cap = cache->mask + 1;
+    size_t old_count = cache->count;
+    size_t live = 0;
+
+    for (size_t i = 0; i < old_cap; i++) {
+        if (old[i].key && now_ms - old[i].last_seen_ms < 2 * cache->heartbeat_ms) live++;
+    }
+
+    size_t new_cap = old_cap;
+    while (live * 2 > new_cap && new_cap < AP_CACHE_MAX_CAPACITY) new_cap <<= 1;
+
+    if (alloc_entries(cache, new_cap) != 0) {
+        // Keep going with the old table rather than lose state; its stale
+        // entries still hold their slots
+        cache->entries = old;
+        cache->mask = old_cap - 1;
+        cache->count = old_count;
+        return;
+    }
+
+    for (size_t i = 0; i < old_cap; i++) {
+        if (!old[i].key || now_ms - old[i].last_seen_ms >= 2 * cache->heartbeat_ms) continue;
+        // Only reachable at AP_CACHE_MAX_CAPACITY: shed the rest so the
+        // table is not rebuilt again on the very next beacon
+        if (cache->count * 2 >= cache->mask + 1) break;
+
+        size_t slot = slot_for(old[i].key, cache->mask);
+        while (cache->entries[slot].key) slot = (slot + 1) & cache->mask;
+        cache->entries[slot] = old[i];
+        cache->count++;
+    }
+
+    free(old);
+}
+
+bool ap_cache_update(ap_cache_t *cache, const uint8_t *bssid, const char *ssid, int channel,
+                     int8_t rssi, uint64_t now_ms, uint32_t weight, uint32_t *beacons) {
+    uint64_t key = mac_to_u64(bssid) | AP_CACHE_USED;
+
+    if (cache->count * 4 >= (cache->mask + 1) * 3) {
+        rehash(cache, now_ms);
+    }
+
+    size_t slot = slot_for(key, cache->mask);
+    ap_cache_entry_t *e;
+    for (;;) {
+        e = &cache->entries[slot];
+        if (e->key == key || e->key == 0) break;
+        slot = (slot + 1) & cache->mask;
+    }
+
+    if (e->key == 0) {
+        // Only after rehash failed to allocate: probes end at a free slot,
+        // so the last one stays free and the AP is reported uncached
+        if (cache->count >= cache->mask) {
+            cache->reported++;
+            *beacons = weight;
+            return true;
+        }
+        e->key = key;
+        e->channel = (uint16_t)channel;
+        e->rssi = rssi;
+        strncpy(e->ssid, ssid, sizeof(e->ssid) - 1);
+        e->last_report_ms = now_ms;
+        e->last_seen_ms = now_ms;
+        e->beacons = 0;
+        cache->count++;
+        cache->reported++;
+        *beacons = weight;
+        return true;
+    }
+
+    e->last_seen_ms = now_ms;
+    e->beacons += weight;
+
+    int delta = rssi - e->rssi;
+    bool changed = e->channel != (uint16_t)channel ||
+                   strncmp(e->ssid, ssid, sizeof(e->ssid) - 1) != 0 ||
+                   delta >= cache->rssi_hysteresis || -delta >= cache->rssi_hysteresis ||
+                   now_ms - e->last_report_ms >= cache->heartbeat_ms;
+
+    if (!changed) {
+        cache->suppressed++;
+        return false;
+    }
+
+    e->channel = (uint16_t)channel;
+    e->rssi = rssi;
+    strncpy(e->ssid, ssid, sizeof(e->ssid) - 1);
+    e->last_report_ms = now_ms;
+    *beacons = e->beacons;
+    e->beacons = 0;
+    cache->reported++;
+    return true;
+}
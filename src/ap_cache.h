@@ -0,0 +1,46 @@
+#ifndef AP_CACHE_H
+#define AP_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define AP_CACHE_INITIAL_CAPACITY 1024
+#define AP_CACHE_MAX_CAPACITY 65536
+#define AP_CACHE_DEFAULT_HYSTERESIS_DB 6
+#define AP_CACHE_DEFAULT_HEARTBEAT_S 60
+
+typedef struct {
+    uint64_t key;              // Packed BSSID | AP_CACHE_USED, 0 = empty slot
+    uint64_t last_report_ms;
+    uint64_t last_seen_ms;
+    uint32_t beacons;          // Beacons seen since the last report
+    uint16_t channel;
+    int8_t rssi;               // RSSI at the last report
+    char ssid[33];
+} ap_cache_entry_t;
+
+// Open-addressing (linear probing) table of the last state reported for
+// each BSSID. Owned by the capture thread; not thread-safe.
+typedef struct {
+    ap_cache_entry_t *entries;
+    size_t mask;
+    size_t count;
+    int rssi_hysteresis;
+    uint64_t heartbeat_ms;
+    uint64_t reported;
+    uint64_t suppressed;
+} ap_cache_t;
+
+int ap_cache_init(ap_cache_t *cache, int rssi_hysteresis, int heartbeat_s);
+void ap_cache_destroy(ap_cache_t *cache);
+
+// Records a beacon and decides whether it must be reported: true when the
+// BSSID is new, its SSID or channel changed, its RSSI moved by at least the
+// hysteresis, or the heartbeat interval expired. weight is the number of
+// beacons this one stands for (see frame_policy.h); on true, *beacons is
+// set to the number of beacons the report stands for.
+bool ap_cache_update(ap_cache_t *cache, const uint8_t *bssid, const char *ssid, int channel,
+                     int8_t rssi, uint64_t now_ms, uint32_t weight, uint32_t *beacons);
+
+#endif
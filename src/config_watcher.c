@@ -0,0 +1,382 @@
+#include "config_watcher.h"
+#include "frame_filter.h"
+#include "alloc_stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+typedef enum {
+    FETCH_CHANGED,
+    FETCH_UNCHANGED,
+    FETCH_FAILED,
+} fetch_result_t;
+
+// API response, written into the watcher's fixed buffer
+struct curl_response {
+    char *data;
+    size_t size;
+    size_t cap;
+    char etag[CONFIG_ETAG_MAX];
+};
+
+static size_t config_write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t realsize = size * nmemb;
+    struct curl_response *mem = (struct curl_response *)userp;
+
+    if (mem->size + realsize + 1 > mem->cap) {
+        fprintf(stderr, "Config response larger than %zu bytes\n", mem->cap - 1);
+        return 0;
+    }
+
+    memcpy(&(mem->data[mem->size]), contents, realsize);
+    mem->size += realsize;
+    mem->data[mem->size] = 0;
+
+    return realsize;
+}
+
+static size_t config_header_callback(char *buffer, size_t size, size_t nitems, void *userp) {
+    size_t len = size * nitems;
+    struct curl_response *mem = (struct curl_response *)userp;
+
+    if (len > 5 && strncasecmp(buffer, "ETag:", 5) == 0) {
+        const char *value = buffer + 5;
+        size_t value_len = len - 5;
+        while (value_len > 0 && *value == ' ') {
+            value++;
+            value_len--;
+        }
+        while (value_len > 0 && (value[value_len - 1] == '\r' || value[value_len - 1] == '\n')) {
+            value_len--;
+        }
+        if (value_len < sizeof(mem->etag)) {
+            memcpy(mem->etag, value, value_len);
+            mem->etag[value_len] = '\0';
+        }
+    }
+    return len;
+}
+
+// Lets config_watcher_stop abort a long-poll that is still waiting
+static int config_progress_callback(void *userp, curl_off_t dltotal, curl_off_t dlnow,
+                                    curl_off_t ultotal, curl_off_t ulnow) {
+    (void)dltotal; (void)dlnow; (void)ultotal; (void)ulnow;
+    config_watcher_t *w = (config_watcher_t *)userp;
+    return atomic_load(&w->running) ? 0 : 1;
+}
+
+// "frame_policies": {"deauth": "rate:10/20", "data": "summary", ...}.
+// Types the object leaves out, and every type for null, get keep.
+static void parse_policies(const char *p, frame_policy_set_t *set) {
+    memset(set, 0, sizeof(*set));
+    while (*p == ' ') p++;
+    if (*p != '{') return;
+    p++;
+
+    while (*p && *p != '}') {
+        while (*p == ' ' || *p == ',') p++;
+        if (*p != '"') break;
+        const char *name = ++p;
+        while (*p && *p != '"') p++;
+        if (!*p) break;
+        int name_len = (int)(p - name);
+        uint32_t bit = frame_filter_bit(name, (size_t)name_len);
+        p++;
+
+        while (*p == ' ' || *p == ':') p++;
+        if (*p != '"') break;
+        const char *value = ++p;
+        while (*p && *p != '"') p++;
+        if (!*p) break;
+
+        frame_policy_t policy;
+        if (bit && frame_policy_parse(value, p - value, &policy) == 0) {
+            set->classes[__builtin_ctz(bit)] = policy;
+        } else {
+            fprintf(stderr, "Ignoring frame policy %.*s: %.*s\n", name_len, name, (int)(p - value), value);
+        }
+        p++;
+    }
+}
+
+// Simple JSON parsing - look for "enabled", "timeout_ms", "channels",
+// "frame_types", "frame_policies" and "mode"; missing fields keep their
+// previous value
+static void parse_config(const char *json, hop_config_t *cfg) {
+    const char *enabled_ptr = strstr(json, "\"enabled\":");
+    if (enabled_ptr) {
+        enabled_ptr += 10; // Skip past "enabled":
+        while (*enabled_ptr == ' ') enabled_ptr++;
+        cfg->enabled = (strncmp(enabled_ptr, "true", 4) == 0);
+    }
+
+    const char *timeout_ptr = strstr(json, "\"timeout_ms\":");
+    if (timeout_ptr) {
+        timeout_ptr += 13; // Skip past "timeout_ms":
+        cfg->timeout_ms = atoi(timeout_ptr);
+        if (cfg->timeout_ms < 50) cfg->timeout_ms = 50;
+        if (cfg->timeout_ms > 10000) cfg->timeout_ms = 10000;
+    }
+
+    // Parse channels array
+    const char *channels_ptr = strstr(json, "\"channels\":");
+    if (channels_ptr) {
+        channels_ptr += 11; // Skip past "channels":
+        while (*channels_ptr == ' ') channels_ptr++;
+        if (*channels_ptr == '[') {
+            channels_ptr++; // Skip '['
+            cfg->num_channels = 0;
+
+            while (*channels_ptr && *channels_ptr != ']' && cfg->num_channels < CONFIG_MAX_CHANNELS) {
+                while (*channels_ptr == ' ' || *channels_ptr == ',') channels_ptr++;
+                if (*channels_ptr >= '0' && *channels_ptr <= '9') {
+                    int ch = atoi(channels_ptr);
+                    if (ch >= 1 && ch <= 165) {
+                        cfg->channels[cfg->num_channels++] = ch;
+                    }
+                    while (*channels_ptr >= '0' && *channels_ptr <= '9') channels_ptr++;
+                } else {
+                    break;
+                }
+            }
+        }
+    }
+
+    // Parse frame_types array, e.g. ["beacon", "probe_req", "data"]
+    const char *types_ptr = strstr(json, "\"frame_types\":");
+    if (types_ptr) {
+        types_ptr += 14; // Skip past "frame_types":
+        while (*types_ptr == ' ') types_ptr++;
+        if (*types_ptr == '[') {
+            uint32_t mask = 0;
+            types_ptr++; // Skip '['
+
+            while (*types_ptr && *types_ptr != ']') {
+                while (*types_ptr == ' ' || *types_ptr == ',') types_ptr++;
+                if (*types_ptr != '"') break;
+                const char *name = ++types_ptr;
+                while (*types_ptr && *types_ptr != '"') types_ptr++;
+                if (!*types_ptr) break;
+                mask |= frame_filter_bit(name, types_ptr - name);
+                types_ptr++; // Skip closing quote
+            }
+
+            // An empty or unrecognized list falls back to every handled type
+            cfg->frame_types = mask ? mask : FRAME_TYPES_ALL;
+        }
+    }
+
+    const char *policies_ptr = strstr(json, "\"frame_policies\":");
+    if (policies_ptr) {
+        parse_policies(policies_ptr + 17, &cfg->policies);
+    }
+
+    const char *mode_ptr = strstr(json, "\"mode\":");
+    if (mode_ptr) {
+        mode_ptr += 7; // Skip past "mode":
+        while (*mode_ptr == ' ') mode_ptr++;
+        cfg->mode = strncmp(mode_ptr, "\"adaptive\"", 10) == 0 ? HOP_MODE_ADAPTIVE : HOP_MODE_ROUND_ROBIN;
+    }
+
+    // If no channels parsed, use defaults
+    if (cfg->num_channels == 0) {
+        int default_channels[] = {1, 6, 11, 2, 7, 3, 8, 4, 9, 5, 10};
+        cfg->num_channels = 11;
+        memcpy(cfg->channels, default_channels, sizeof(default_channels));
+    }
+}
+
+static bool config_equal(const hop_config_t *a, const hop_config_t *b) {
+    for (int i = 0; i < FRAME_CLASS_COUNT; i++) {
+        if (!frame_policy_equal(&a->policies.classes[i], &b->policies.classes[i])) return false;
+    }
+    return a->enabled == b->enabled && a->timeout_ms == b->timeout_ms && a->mode == b->mode &&
+           a->frame_types == b->frame_types && a->num_channels == b->num_channels &&
+           memcmp(a->channels, b->channels, sizeof(int) * a->num_channels) == 0;
+}
+
+static void publish(config_watcher_t *w, const hop_config_t *cfg) {
+    pthread_mutex_lock(&w->lock);
+    w->current = *cfg;
+    atomic_store(&w->frame_types, cfg->frame_types);
+    atomic_fetch_add_explicit(&w->generation, 1, memory_order_release);
+    pthread_mutex_unlock(&w->lock);
+}
+
+// The If-None-Match list is rebuilt only when the ETag changes, not per poll
+static void set_etag(config_watcher_t *w, const char *etag) {
+    if (strcmp(w->etag, etag) == 0 && (w->headers || !etag[0])) return;
+
+    strncpy(w->etag, etag, sizeof(w->etag) - 1);
+    w->etag[sizeof(w->etag) - 1] = '\0';
+
+    curl_slist_free_all(w->headers);
+    w->headers = NULL;
+    if (w->etag[0]) {
+        char if_none_match[CONFIG_ETAG_MAX + 16];
+        snprintf(if_none_match, sizeof(if_none_match), "If-None-Match: %s", w->etag);
+        w->headers = curl_slist_append(NULL, if_none_match);
+    }
+}
+
+static fetch_result_t fetch(config_watcher_t *w, int wait_s) {
+    char url[sizeof(w->url) + 32];
+    if (wait_s > 0) {
+        snprintf(url, sizeof(url), "%s?wait=%d", w->url, wait_s);
+    } else {
+        snprintf(url, sizeof(url), "%s", w->url);
+    }
+
+    struct curl_response response = {.data = w->response, .cap = sizeof(w->response)};
+
+    // The handle is reused so its connection stays open between polls
+    curl_easy_setopt(w->curl, CURLOPT_URL, url);
+    curl_easy_setopt(w->curl, CURLOPT_HTTPHEADER, w->headers);
+    curl_easy_setopt(w->curl, CURLOPT_WRITEFUNCTION, config_write_callback);
+    curl_easy_setopt(w->curl, CURLOPT_WRITEDATA, (void *)&response);
+    curl_easy_setopt(w->curl, CURLOPT_HEADERFUNCTION, config_header_callback);
+    curl_easy_setopt(w->curl, CURLOPT_HEADERDATA, (void *)&response);
+    curl_easy_setopt(w->curl, CURLOPT_XFERINFOFUNCTION, config_progress_callback);
+    curl_easy_setopt(w->curl, CURLOPT_XFERINFODATA, (void *)w);
+    curl_easy_setopt(w->curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(w->curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(w->curl, CURLOPT_TIMEOUT, (long)(wait_s + 5));
+
+    CURLcode res = curl_easy_perform(w->curl);
+
+    long status = 0;
+    if (res == CURLE_OK) {
+        curl_easy_getinfo(w->curl, CURLINFO_RESPONSE_CODE, &status);
+    }
+
+    fetch_result_t result = FETCH_FAILED;
+    if (status == 304) {
+        result = FETCH_UNCHANGED;
+    } else if (status == 200 && response.size > 0) {
+        // Parse on top of a copy so fields the API omits keep their value
+        hop_config_t cfg;
+        config_watcher_get(w, &cfg);
+        hop_config_t old = cfg;
+        parse_config(response.data, &cfg);
+
+        set_etag(w, response.etag);
+        if (config_equal(&old, &cfg)) {
+            result = FETCH_UNCHANGED;
+        } else {
+            publish(w, &cfg);
+            result = FETCH_CHANGED;
+        }
+    }
+
+    return result;
+}
+
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void backoff(config_watcher_t *w) {
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += CONFIG_RETRY_S;
+
+    pthread_mutex_lock(&w->lock);
+    while (atomic_load(&w->running)) {
+        if (pthread_cond_timedwait(&w->wake, &w->lock, &until) != 0) break;
+    }
+    pthread_mutex_unlock(&w->lock);
+}
+
+static void *config_thread(void *arg) {
+    config_watcher_t *w = (config_watcher_t *)arg;
+    alloc_stats_register("config");
+
+    while (atomic_load(&w->running)) {
+        uint64_t started = monotonic_ms();
+        fetch_result_t result = fetch(w, CONFIG_WAIT_S);
+        if (!atomic_load(&w->running)) break;
+
+        if (result == FETCH_CHANGED) {
+            printf("Channel hopping config updated\n");
+            continue;
+        }
+
+        // Failures, and APIs that answer immediately instead of holding the
+        // request, fall back to polling every CONFIG_RETRY_S seconds
+        if (result == FETCH_FAILED || monotonic_ms() - started < 1000) {
+            backoff(w);
+        }
+    }
+
+    return NULL;
+}
+
+void config_watcher_init(config_watcher_t *w) {
+    memset(w, 0, sizeof(*w));
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->wake, NULL);
+    w->current.enabled = true;
+    w->current.timeout_ms = 300;
+    w->current.mode = HOP_MODE_ROUND_ROBIN;
+    w->current.frame_types = FRAME_TYPES_ALL;
+    atomic_init(&w->frame_types, FRAME_TYPES_ALL);
+    atomic_init(&w->generation, 1);
+}
+
+int config_watcher_start(config_watcher_t *w, const char *api_url) {
+    snprintf(w->url, sizeof(w->url), "%s/config/channel-hopping", api_url);
+
+    w->curl = curl_easy_init();
+    if (!w->curl) {
+        fprintf(stderr, "Failed to init curl for config fetch\n");
+        return -1;
+    }
+
+    atomic_store(&w->running, true);
+    if (fetch(w, 0) == FETCH_FAILED) {
+        fprintf(stderr, "Could not fetch channel hopping config from %s, using defaults\n", w->url);
+    }
+
+    if (pthread_create(&w->thread, NULL, config_thread, w) != 0) {
+        fprintf(stderr, "Failed to create config thread\n");
+        atomic_store(&w->running, false);
+        curl_easy_cleanup(w->curl);
+        w->curl = NULL;
+        return -1;
+    }
+    w->started = true;
+    return 0;
+}
+
+void config_watcher_stop(config_watcher_t *w) {
+    if (!w->started) return;
+
+    pthread_mutex_lock(&w->lock);
+    atomic_store(&w->running, false);
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+
+    pthread_join(w->thread, NULL);
+    w->started = false;
+    curl_easy_cleanup(w->curl);
+    w->curl = NULL;
+    curl_slist_free_all(w->headers);
+    w->headers = NULL;
+}
+
+void config_watcher_destroy(config_watcher_t *w) {
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->wake);
+}
+
+unsigned config_watcher_get(config_watcher_t *w, hop_config_t *out) {
+    pthread_mutex_lock(&w->lock);
+    *out = w->current;
+    unsigned generation = atomic_load(&w->generation);
+    pthread_mutex_unlock(&w->lock);
+    return generation;
+}
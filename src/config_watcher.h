@@ -0,0 +1,64 @@
+#ifndef CONFIG_WATCHER_H
+#define CONFIG_WATCHER_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <curl/curl.h>
+#include "hop_sched.h"
+#include "frame_policy.h"
+
+#define CONFIG_MAX_CHANNELS HOP_LIST_MAX
+#define CONFIG_WAIT_S 30           // Long-poll: how long the API may hold a request
+#define CONFIG_RETRY_S 5           // Back-off after a failed fetch
+#define CONFIG_ETAG_MAX 128
+#define CONFIG_RESPONSE_MAX 8192   // Largest config body accepted
+
+// Channel hopping config as served by GET /config/channel-hopping
+typedef struct {
+    bool enabled;
+    int timeout_ms;
+    hop_mode_t mode;
+    int channels[CONFIG_MAX_CHANNELS];
+    int num_channels;
+    uint32_t frame_types;          // FRAME_* mask
+    frame_policy_set_t policies;   // Per FRAME_* type, all keep by default
+} hop_config_t;
+
+// Keeps the latest config on its own thread. Requests carry the last ETag
+// and ask the API to hold them until the config changes, so an unchanged
+// config costs one idle connection and is never re-parsed. Readers copy a
+// consistent snapshot under the lock when the generation moves.
+typedef struct {
+    char url[512];
+    pthread_t thread;
+    bool started;
+    atomic_bool running;
+    CURL *curl;
+    char etag[CONFIG_ETAG_MAX];
+    struct curl_slist *headers;    // If-None-Match for etag, kept across polls
+    char response[CONFIG_RESPONSE_MAX];
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;           // Cuts the retry back-off short on stop
+    hop_config_t current;
+    atomic_uint generation;        // Bumped after every published change
+    atomic_uint frame_types;       // current.frame_types, readable without the lock
+} config_watcher_t;
+
+// Defaults (hopping on, 300 ms, no channels, every frame type) as generation 1
+void config_watcher_init(config_watcher_t *w);
+// Fetches once synchronously, then keeps watching on a background thread
+int config_watcher_start(config_watcher_t *w, const char *api_url);
+void config_watcher_stop(config_watcher_t *w);
+void config_watcher_destroy(config_watcher_t *w);
+
+static inline unsigned config_watcher_generation(config_watcher_t *w) {
+    return atomic_load_explicit(&w->generation, memory_order_acquire);
+}
+
+// Copy the current config; returns the generation it belongs to
+unsigned config_watcher_get(config_watcher_t *w, hop_config_t *out);
+
+#endif
@@ -0,0 +1,231 @@
+#define _GNU_SOURCE
+#include "cpu_affinity.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <dirent.h>
+#include <sched.h>
+
+int cpu_mask_count(const cpu_mask_t *m) {
+    int n = 0;
+    for (size_t i = 0; i < sizeof(m->bits) / sizeof(m->bits[0]); i++) {
+        n += __builtin_popcountll(m->bits[i]);
+    }
+    return n;
+}
+
+int cpu_mask_nth(const cpu_mask_t *m, int i) {
+    int count = cpu_mask_count(m);
+    if (count == 0 || i < 0) return -1;
+    i %= count;
+    for (int cpu = 0; cpu < CPU_MASK_MAX; cpu++) {
+        if (cpu_mask_test(m, cpu) && i-- == 0) return cpu;
+    }
+    return -1;
+}
+
+int cpu_mask_parse(const char *s, cpu_mask_t *out) {
+    cpu_mask_t m = {0};
+    const char *p = s;
+
+    while (*p && *p != '\n') {
+        char *end;
+        if (!isdigit((unsigned char)*p)) return -1;
+        long lo = strtol(p, &end, 10), hi = lo;
+        p = end;
+        if (*p == '-') {
+            if (!isdigit((unsigned char)p[1])) return -1;
+            hi = strtol(p + 1, &end, 10);
+            p = end;
+        }
+        if (hi < lo) return -1;
+        if (hi >= CPU_MASK_MAX) hi = CPU_MASK_MAX - 1;   // Left out of the mask
+        for (long cpu = lo; cpu <= hi; cpu++) cpu_mask_set(&m, (int)cpu);
+
+        if (*p == ',') {
+            if (!isdigit((unsigned char)*++p)) return -1;
+        } else if (*p && *p != '\n') {
+            return -1;
+        }
+    }
+
+    if (cpu_mask_count(&m) == 0) return -1;
+    *out = m;
+    return 0;
+}
+
+void cpu_mask_format(const cpu_mask_t *m, char *out, size_t len) {
+    size_t n = 0;
+    out[0] = '\0';
+    for (int cpu = 0; cpu < CPU_MASK_MAX && n < len; cpu++) {
+        if (!cpu_mask_test(m, cpu)) continue;
+        int last = cpu;
+        while (cpu_mask_test(m, last + 1)) last++;
+        int w = last > cpu ? snprintf(out + n, len - n, "%s%d-%d", n ? "," : "", cpu, last)
+                           : snprintf(out + n, len - n, "%s%d", n ? "," : "", cpu);
+        if (w < 0) break;
+        n += (size_t)w;
+        cpu = last;
+    }
+}
+
+static void from_cpu_set(const cpu_set_t *set, cpu_mask_t *out) {
+    memset(out, 0, sizeof(*out));
+    for (int cpu = 0; cpu < CPU_MASK_MAX && cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, set)) cpu_mask_set(out, cpu);
+    }
+}
+
+static void to_cpu_set(const cpu_mask_t *m, cpu_set_t *out) {
+    CPU_ZERO(out);
+    for (int cpu = 0; cpu < CPU_MASK_MAX && cpu < CPU_SETSIZE; cpu++) {
+        if (cpu_mask_test(m, cpu)) CPU_SET(cpu, out);
+    }
+}
+
+int cpu_mask_allowed(cpu_mask_t *out) {
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return -1;
+    from_cpu_set(&set, out);
+    return 0;
+}
+
+// First line of a sysfs or procfs file
+static int read_line(const char *path, char *buf, size_t len) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    char *line = fgets(buf, (int)len, f);
+    fclose(f);
+    return line ? 0 : -1;
+}
+
+static int read_int(const char *path, int *out) {
+    char buf[32];
+    if (read_line(path, buf, sizeof(buf)) != 0) return -1;
+    char *end;
+    long v = strtol(buf, &end, 10);
+    if (end == buf) return -1;
+    *out = (int)v;
+    return 0;
+}
+
+// First MSI vector of a PCI device, from the names in its msi_irqs directory
+static int first_msi_irq(const char *dev) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/msi_irqs", dev);
+    DIR *dir = opendir(path);
+    if (!dir) return -1;
+
+    int irq = -1;
+    struct dirent *e;
+    while ((e = readdir(dir)) != NULL) {
+        if (!isdigit((unsigned char)e->d_name[0])) continue;
+        int n = atoi(e->d_name);
+        if (irq < 0 || n < irq) irq = n;
+    }
+    closedir(dir);
+    return irq;
+}
+
+// Whether the action list of a /proc/interrupts line names `name`
+static bool names_action(const char *line, const char *name) {
+    size_t n = strlen(name);
+    for (const char *p = strstr(line, name); p; p = strstr(p + 1, name)) {
+        char before = p > line ? p[-1] : ' ';
+        char after = p[n];
+        if ((before == ' ' || before == ',' || before == ':') &&
+            (after == '\0' || after == '\n' || after == ',' || after == ' ')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Platform USB controllers (dwc_otg on older Pis) have no irq file; their
+// handlers are named after the root hub, e.g. "dwc_otg_hcd:usb1"
+static int irq_by_action(const char *name) {
+    FILE *f = fopen("/proc/interrupts", "r");
+    if (!f) return -1;
+
+    char line[1024];
+    int irq = -1;
+    while (irq < 0 && fgets(line, sizeof(line), f)) {
+        char *end;
+        long n = strtol(line, &end, 10);
+        if (end != line && *end == ':' && names_action(end + 1, name)) {
+            irq = (int)n;
+        }
+    }
+    fclose(f);
+    return irq;
+}
+
+// CPUs an IRQ is delivered to; the effective list is the one actually in
+// use when the requested affinity spans several CPUs
+static int irq_cpus(int irq, cpu_mask_t *out) {
+    char path[64], buf[256];
+    snprintf(path, sizeof(path), "/proc/irq/%d/effective_affinity_list", irq);
+    if (read_line(path, buf, sizeof(buf)) == 0 && cpu_mask_parse(buf, out) == 0) return 0;
+    snprintf(path, sizeof(path), "/proc/irq/%d/smp_affinity_list", irq);
+    if (read_line(path, buf, sizeof(buf)) == 0 && cpu_mask_parse(buf, out) == 0) return 0;
+    return -1;
+}
+
+int cpu_mask_for_interface(const char *interface, cpu_mask_t *out, char *source, size_t source_len) {
+    char link[PATH_MAX], dev[PATH_MAX];
+    snprintf(link, sizeof(link), "/sys/class/net/%s/device", interface);
+
+    int irq = -1, numa = -1;
+    char usb_bus[32] = "";
+
+    // Walk from the interface's device up towards the root: a USB adapter's
+    // IRQ belongs to the host controller a few levels up
+    if (realpath(link, dev) != NULL) {
+        while (irq < 0 && strlen(dev) > strlen("/sys/devices")) {
+            char path[PATH_MAX];
+            const char *base = strrchr(dev, '/') + 1;
+            if (!usb_bus[0] && strncmp(base, "usb", 3) == 0 && isdigit((unsigned char)base[3])) {
+                snprintf(usb_bus, sizeof(usb_bus), "%s", base);
+            }
+
+            irq = first_msi_irq(dev);
+            int n;
+            snprintf(path, sizeof(path), "%s/irq", dev);
+            if (irq < 0 && read_int(path, &n) == 0 && n > 0) irq = n;
+            snprintf(path, sizeof(path), "%s/numa_node", dev);
+            if (numa < 0 && read_int(path, &n) == 0 && n >= 0) numa = n;
+
+            *strrchr(dev, '/') = '\0';
+        }
+    }
+    if (irq < 0 && usb_bus[0]) irq = irq_by_action(usb_bus);
+    if (irq < 0) irq = irq_by_action(interface);
+
+    if (irq >= 0 && irq_cpus(irq, out) == 0) {
+        snprintf(source, source_len, "IRQ %d", irq);
+        return 0;
+    }
+
+    if (numa >= 0) {
+        char path[64], buf[256];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", numa);
+        if (read_line(path, buf, sizeof(buf)) == 0 && cpu_mask_parse(buf, out) == 0) {
+            snprintf(source, source_len, "NUMA node %d", numa);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int cpu_pin_thread(pthread_t thread, const cpu_mask_t *m) {
+    cpu_set_t set;
+    to_cpu_set(m, &set);
+    return pthread_setaffinity_np(thread, sizeof(set), &set);
+}
+
+int cpu_set_fifo(pthread_t thread, int priority) {
+    struct sched_param param = {.sched_priority = priority};
+    return pthread_setschedparam(thread, SCHED_FIFO | SCHED_RESET_ON_FORK, &param);
+}
@@ -0,0 +1,52 @@
+#ifndef CPU_AFFINITY_H
+#define CPU_AFFINITY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#define CPU_MASK_MAX 256   // CPUs a mask can name; higher ones are ignored
+
+// A CPU set that needs no _GNU_SOURCE, converted to cpu_set_t in cpu_affinity.c
+typedef struct {
+    uint64_t bits[CPU_MASK_MAX / 64];
+} cpu_mask_t;
+
+static inline void cpu_mask_set(cpu_mask_t *m, int cpu) {
+    if (cpu >= 0 && cpu < CPU_MASK_MAX) m->bits[cpu / 64] |= 1ull << (cpu % 64);
+}
+
+static inline void cpu_mask_clear(cpu_mask_t *m, int cpu) {
+    if (cpu >= 0 && cpu < CPU_MASK_MAX) m->bits[cpu / 64] &= ~(1ull << (cpu % 64));
+}
+
+static inline bool cpu_mask_test(const cpu_mask_t *m, int cpu) {
+    return cpu >= 0 && cpu < CPU_MASK_MAX && (m->bits[cpu / 64] >> (cpu % 64)) & 1;
+}
+
+int cpu_mask_count(const cpu_mask_t *m);
+// The i-th CPU of the mask, wrapping around; -1 if the mask is empty
+int cpu_mask_nth(const cpu_mask_t *m, int i);
+// Parse a kernel-style CPU list, e.g. "0-2,5"; CPUs from CPU_MASK_MAX up
+// are dropped. Returns -1 if invalid or if no CPU is left.
+int cpu_mask_parse(const char *s, cpu_mask_t *out);
+// Format as a CPU list, e.g. "0-2,5"
+void cpu_mask_format(const cpu_mask_t *m, char *out, size_t len);
+
+// CPUs this process may run on (taskset, cgroups and hotplug included)
+int cpu_mask_allowed(cpu_mask_t *out);
+
+// CPUs closest to a network interface: those its IRQ is delivered to
+// (the USB host controller for a USB adapter), else those of its NUMA
+// node. Describes which in `source`, e.g. "IRQ 56". Returns -1 if
+// neither is known, as for virtual interfaces.
+int cpu_mask_for_interface(const char *interface, cpu_mask_t *out, char *source, size_t source_len);
+
+// Restrict a thread to the CPUs of the mask
+int cpu_pin_thread(pthread_t thread, const cpu_mask_t *m);
+// Run a thread under SCHED_FIFO at `priority` (1-99). Children it forks
+// (iw, through system()) start with normal scheduling again.
+int cpu_set_fifo(pthread_t thread, int priority);
+
+#endif
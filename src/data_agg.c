@@ -0,0 +1,93 @@
+#include "data_agg.h"
+#include "mac.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DATA_AGG_MASK (DATA_AGG_CAPACITY - 1)
+#define DATA_AGG_USED (1ULL << 63)
+
+static inline size_t slot_for(uint64_t key) {
+    return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & DATA_AGG_MASK;
+}
+
+int data_agg_init(data_agg_t *agg, int interval_s) {
+    memset(agg, 0, sizeof(*agg));
+    agg->entries = calloc(DATA_AGG_CAPACITY, sizeof(data_agg_entry_t));
+    if (!agg->entries) return -1;
+    agg->interval_ms = (uint64_t)(interval_s > 0 ? interval_s : DATA_AGG_DEFAULT_INTERVAL_S) * 1000;
+    return 0;
+}
+
+void data_agg_destroy(data_agg_t *agg) {
+    free(agg->entries);
+    agg->entries = NULL;
+}
+
+void data_agg_add(data_agg_t *agg, const uint8_t *mac, data_dir_t dir, uint32_t bytes, int8_t rssi,
+                  uint32_t weight) {
+    uint64_t key = (mac_to_u64(mac) << 2) | (uint64_t)dir | DATA_AGG_USED;
+    size_t slot = slot_for(key);
+
+    // The table is flushed before it gets crowded, so probing always ends
+    for (;;) {
+        data_agg_entry_t *e = &agg->entries[slot];
+        if (e->key == key) {
+            e->frames += weight;
+            e->bytes += (int64_t)bytes * weight;
+            e->rssi_sum += rssi * (int32_t)weight;
+            return;
+        }
+        if (e->key == 0) {
+            e->key = key;
+            e->frames = weight;
+            e->bytes = (int64_t)bytes * weight;
+            e->rssi_sum = rssi * (int32_t)weight;
+            agg->count++;
+            return;
+        }
+        slot = (slot + 1) & DATA_AGG_MASK;
+    }
+}
+
+void data_agg_flush(data_agg_t *agg, uint64_t now_ms, data_agg_emit_fn emit, void *ctx) {
+    for (size_t i = 0; i < DATA_AGG_CAPACITY && agg->count > 0; i++) {
+        data_agg_entry_t *e = &agg->entries[i];
+        if (!e->key) continue;
+
+        flux_event_t ev = {0};
+        ev.ts_us = now_ms * 1000;
+        ev.type = EVENT_DATA;
+        ev.direction = (uint8_t)(e->key & 0x03);
+        ev.frame_count = (int32_t)e->frames;
+        ev.byte_count = e->bytes > UINT32_MAX ? UINT32_MAX : (uint32_t)e->bytes;
+        ev.rssi = (int8_t)(e->rssi_sum / (int32_t)e->frames);
+        u64_to_mac((e->key & ~DATA_AGG_USED) >> 2, ev.mac);
+        emit(ctx, &ev);
+
+        memset(e, 0, sizeof(*e));
+        agg->count--;
+    }
+    agg->window_start_ms = now_ms;
+}
+
+bool data_agg_maybe_flush(data_agg_t *agg, uint64_t now_ms, data_agg_emit_fn emit, void *ctx) {
+    if (agg->window_start_ms == 0) {
+        agg->window_start_ms = now_ms;
+        return false;
+    }
+
+    bool crowded = agg->count * 4 >= DATA_AGG_CAPACITY * 3;
+    if (!crowded && now_ms - agg->window_start_ms < agg->interval_ms) return false;
+
+    data_agg_flush(agg, now_ms, emit, ctx);
+    return true;
+}
+
+const char *data_dir_name(uint8_t dir) {
+    switch (dir) {
+        case DATA_DIR_UPLINK: return "uplink";
+        case DATA_DIR_DOWNLINK: return "downlink";
+        case DATA_DIR_WDS: return "wds";
+        default: return "adhoc";
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef DATA_AGG_H
+#define DATA_AGG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "event_queue.h"
+
+#define DATA_AGG_CAPACITY 4096
+#define DATA_AGG_DEFAULT_INTERVAL_S 10
+
+// Direction of a data frame from the ToDS/FromDS bits
+typedef enum {
+    DATA_DIR_ADHOC = 0,   // ToDS=0 FromDS=0 (IBSS / direct link)
+    DATA_DIR_UPLINK,      // ToDS=1: station to AP
+    DATA_DIR_DOWNLINK,    // FromDS=1: AP to station
+    DATA_DIR_WDS,         // ToDS=1 FromDS=1: mesh / bridge
+} data_dir_t;
+
+typedef struct {
+    uint64_t key;          // Packed addr2 + direction + used bit, 0 = empty
+    uint32_t frames;
+    int32_t rssi_sum;
+    int64_t bytes;
+} data_agg_entry_t;
+
+// Per-station accumulator of data frames and bytes, flushed as one
+// EVENT_DATA record per (addr2, direction) per interval.
+// Owned by the capture thread; not thread-safe.
+typedef struct {
+    data_agg_entry_t *entries;
+    size_t count;
+    uint64_t interval_ms;
+    uint64_t window_start_ms;
+} data_agg_t;
+
+typedef void (*data_agg_emit_fn)(void *ctx, const flux_event_t *ev);
+
+int data_agg_init(data_agg_t *agg, int interval_s);
+void data_agg_destroy(data_agg_t *agg);
+
+void data_agg_add(data_agg_t *agg, const uint8_t *mac, data_dir_t dir, uint32_t bytes, int8_t rssi,
+                  uint32_t weight);
+// Flush if the interval elapsed (or the table is crowded); returns true if it flushed
+bool data_agg_maybe_flush(data_agg_t *agg, uint64_t now_ms, data_agg_emit_fn emit, void *ctx);
+void data_agg_flush(data_agg_t *agg, uint64_t now_ms, data_agg_emit_fn emit, void *ctx);
+
+const char *data_dir_name(uint8_t dir);
+
+#endif
@@ -0,0 +1,67 @@
+#include "event_queue.h"
+#include <stdlib.h>
+#include <string.h>
+
+int event_queue_init(event_queue_t *q, size_t capacity) {
+    size_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+
+    memset(q, 0, sizeof(*q));
+    q->slots = calloc(cap, sizeof(flux_event_t));
+    if (!q->slots) return -1;
+    q->mask = cap - 1;
+
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->enqueued, 0);
+    atomic_init(&q->dropped, 0);
+    return 0;
+}
+
+void event_queue_destroy(event_queue_t *q) {
+    free(q->slots);
+    q->slots = NULL;
+}
+
+// Counters are only written by the producer, so a relaxed load+store is
+// enough and avoids a locked read-modify-write on every frame.
+static inline void counter_inc(_Atomic uint64_t *counter) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+}
+
+bool event_queue_push(event_queue_t *q, const flux_event_t *ev) {
+    size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+
+    if (head - q->tail_cache > q->mask) {
+        q->tail_cache = atomic_load_explicit(&q->tail, memory_order_acquire);
+        if (head - q->tail_cache > q->mask) {
+            counter_inc(&q->dropped);
+            return false;
+        }
+    }
+
+    q->slots[head & q->mask] = *ev;
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    counter_inc(&q->enqueued);
+    return true;
+}
+
+bool event_queue_pop(event_queue_t *q, flux_event_t *ev) {
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+    if (tail == q->head_cache) {
+        q->head_cache = atomic_load_explicit(&q->head, memory_order_acquire);
+        if (tail == q->head_cache) return false;
+    }
+
+    *ev = q->slots[tail & q->mask];
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+size_t event_queue_depth(event_queue_t *q) {
+    size_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    return head - tail;
+}
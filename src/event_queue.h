@@ -0,0 +1,89 @@
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define EVENT_QUEUE_DEFAULT_CAPACITY 4096
+#define EVENT_SSID_MAX 33
+#define CACHE_LINE_SIZE 64
+
+typedef enum {
+    EVENT_DEVICE = 0,
+    EVENT_AP,
+    EVENT_CONNECTION,
+    EVENT_DISCONNECTION,
+    EVENT_DATA,
+} event_type_t;
+
+// Fixed-size record handed from the capture thread to an uploader.
+// Field order keeps the record at exactly one cache line. Fields only one
+// event type uses share bytes: a connection never carries an SSID, so the
+// BSSID overlays it, and the data totals overlay what the element decoder
+// (ie.h) found in beacons and probe requests.
+typedef struct {
+    uint64_t ts_us;               // Capture time, Unix microseconds (window end for EVENT_DATA)
+    uint32_t seq;                 // Per-sniffer sequence number, assigned by sniffer_emit
+    union {
+        uint32_t byte_count;      // EVENT_DATA: per-interval total, saturated
+        uint32_t fingerprint;     // EVENT_DEVICE: probe capability fingerprint, 0 if none
+        struct {
+            uint8_t security;     // EVENT_AP: IE_SEC_* bits
+            uint8_t max_rate;     // EVENT_AP: highest legacy rate, 500 kbps units
+            char country[2];      // EVENT_AP: Country element code, zeros if none
+        };
+    };
+    int32_t frame_count;          // Data frames, beacons folded into an EVENT_AP, or the probes
+                                  // an EVENT_DEVICE stands for under sampling
+    uint16_t channel;
+    uint8_t type;                 // event_type_t
+    int8_t rssi;                  // Average RSSI for EVENT_DATA
+    union {
+        uint8_t direction;        // EVENT_DATA: data_dir_t
+        uint8_t caps;             // EVENT_DEVICE and EVENT_AP: IE_CAP_* bits
+    };
+    uint8_t mac[6];               // Station MAC, or BSSID for EVENT_AP
+    union {
+        char ssid[EVENT_SSID_MAX];    // Probe SSID or beacon SSID
+        uint8_t bssid[6];             // Associated BSSID for EVENT_CONNECTION
+    };
+#ifdef FLUX_EVENT_TRACE
+    uint64_t enqueue_ns;          // Bench builds only: CLOCK_MONOTONIC at sniffer_emit
+#endif
+} flux_event_t;
+
+#ifndef FLUX_EVENT_TRACE
+_Static_assert(sizeof(flux_event_t) == CACHE_LINE_SIZE, "flux_event_t must stay one cache line");
+#endif
+
+// Single-producer/single-consumer lock-free ring of flux_event_t.
+// The producer and consumer indices live on separate cache lines and each
+// side keeps a cached copy of the other's index, so a push or pop only
+// touches the shared line when the cached view says the ring is full/empty.
+typedef struct {
+    // Producer-owned
+    _Alignas(CACHE_LINE_SIZE) _Atomic size_t head;
+    size_t tail_cache;
+    _Atomic uint64_t enqueued;
+    _Atomic uint64_t dropped;
+
+    // Consumer-owned
+    _Alignas(CACHE_LINE_SIZE) _Atomic size_t tail;
+    size_t head_cache;
+
+    // Read-only after init
+    _Alignas(CACHE_LINE_SIZE) size_t mask;
+    flux_event_t *slots;
+} event_queue_t;
+
+int event_queue_init(event_queue_t *q, size_t capacity);
+void event_queue_destroy(event_queue_t *q);
+
+// Never blocks. Returns false (and counts a drop) when the ring is full.
+bool event_queue_push(event_queue_t *q, const flux_event_t *ev);
+bool event_queue_pop(event_queue_t *q, flux_event_t *ev);
+size_t event_queue_depth(event_queue_t *q);
+
+#endif
@@ -0,0 +1,73 @@
+#include "frame_filter.h"
+#include <stdio.h>
+#include <string.h>
+
+static const struct {
+    uint32_t bit;
+    const char *name;     // Name used in the API config
+    const char *expr;     // libpcap 802.11 filter primitive
+} frame_types[] = {
+    {FRAME_BEACON, "beacon", "type mgt subtype beacon"},
+    {FRAME_PROBE_REQ, "probe_req", "type mgt subtype probe-req"},
+    {FRAME_ASSOC_REQ, "assoc_req", "type mgt subtype assoc-req"},
+    {FRAME_REASSOC_REQ, "reassoc_req", "type mgt subtype reassoc-req"},
+    {FRAME_DISASSOC, "disassoc", "type mgt subtype disassoc"},
+    {FRAME_DEAUTH, "deauth", "type mgt subtype deauth"},
+    {FRAME_DATA, "data", "type data"},
+};
+
+#define FRAME_TYPE_COUNT (sizeof(frame_types) / sizeof(frame_types[0]))
+
+uint32_t frame_filter_bit(const char *name, size_t len) {
+    for (size_t i = 0; i < FRAME_TYPE_COUNT; i++) {
+        if (strlen(frame_types[i].name) == len && strncmp(frame_types[i].name, name, len) == 0) {
+            return frame_types[i].bit;
+        }
+    }
+    return 0;
+}
+
+const char *frame_filter_name(int i) {
+    return i >= 0 && (size_t)i < FRAME_TYPE_COUNT ? frame_types[i].name : "";
+}
+
+int frame_filter_build(uint32_t mask, char *out, size_t len) {
+    size_t pos = 0;
+    out[0] = '\0';
+
+    for (size_t i = 0; i < FRAME_TYPE_COUNT; i++) {
+        if (!(mask & frame_types[i].bit)) continue;
+
+        int n = snprintf(out + pos, len - pos, "%s(%s)", pos ? " or " : "", frame_types[i].expr);
+        if (n < 0 || (size_t)n >= len - pos) {
+            return -1;
+        }
+        pos += n;
+    }
+    return 0;
+}
+
+int frame_filter_apply(pcap_t *handle, uint32_t mask) {
+    char expr[512];
+    struct bpf_program prog;
+
+    if (frame_filter_build(mask, expr, sizeof(expr)) != 0) {
+        fprintf(stderr, "Capture filter expression too long\n");
+        return -1;
+    }
+
+    if (pcap_compile(handle, &prog, expr, 1, PCAP_NETMASK_UNKNOWN) == -1) {
+        fprintf(stderr, "Failed to compile capture filter '%s': %s\n", expr, pcap_geterr(handle));
+        return -1;
+    }
+
+    int ret = pcap_setfilter(handle, &prog);
+    if (ret == -1) {
+        fprintf(stderr, "Failed to install capture filter: %s\n", pcap_geterr(handle));
+    } else {
+        printf("Capture filter: %s\n", expr);
+    }
+    pcap_freecode(&prog);
+
+    return ret == -1 ? -1 : 0;
+}
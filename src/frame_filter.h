@@ -0,0 +1,47 @@
+#ifndef FRAME_FILTER_H
+#define FRAME_FILTER_H
+
+#include <pcap.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Frame types packet_handler consumes. Everything else (control frames,
+// ACKs, RTS/CTS, unused management subtypes) is dropped in the kernel.
+#define FRAME_BEACON        (1u << 0)
+#define FRAME_PROBE_REQ     (1u << 1)
+#define FRAME_ASSOC_REQ     (1u << 2)
+#define FRAME_REASSOC_REQ   (1u << 3)
+#define FRAME_DISASSOC      (1u << 4)
+#define FRAME_DEAUTH        (1u << 5)
+#define FRAME_DATA          (1u << 6)
+
+#define FRAME_TYPES_ALL     0x7Fu
+
+// Map a config name ("beacon", "probe_req", ...) to its bit, 0 if unknown
+uint32_t frame_filter_bit(const char *name, size_t len);
+// Config name of the FRAME_* bit with index i
+const char *frame_filter_name(int i);
+
+// Index of the FRAME_* bit an 802.11 type and subtype falls under, -1 for
+// frames packet_handler ignores
+static inline int frame_filter_index(uint8_t type, uint8_t subtype) {
+    if (type == 2) return 6;
+    if (type != 0) return -1;
+    switch (subtype) {
+        case 0x08: return 0;    // Beacon
+        case 0x04: return 1;    // Probe request
+        case 0x00: return 2;    // Association request
+        case 0x02: return 3;    // Reassociation request
+        case 0x0A: return 4;    // Disassociation
+        case 0x0C: return 5;    // Deauthentication
+    }
+    return -1;
+}
+
+// Write the libpcap filter expression for a frame type mask
+int frame_filter_build(uint32_t mask, char *out, size_t len);
+
+// Compile and install the filter for mask; returns 0 on success
+int frame_filter_apply(pcap_t *handle, uint32_t mask);
+
+#endif
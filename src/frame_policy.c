@@ -0,0 +1,148 @@
+#include "frame_policy.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Parse the decimal number at s[*i..len), >= 1; advances *i past it
+static int parse_count(const char *s, size_t len, size_t *i, uint32_t *out) {
+    uint64_t value = 0;
+    size_t start = *i;
+    while (*i < len && s[*i] >= '0' && s[*i] <= '9' && value <= UINT32_MAX) {
+        value = value * 10 + (uint64_t)(s[*i] - '0');
+        (*i)++;
+    }
+    if (*i == start || value < 1 || value > UINT32_MAX) return -1;
+    *out = (uint32_t)value;
+    return 0;
+}
+
+static bool has_prefix(const char *s, size_t len, const char *prefix) {
+    size_t n = strlen(prefix);
+    return len >= n && strncmp(s, prefix, n) == 0;
+}
+
+int frame_policy_parse(const char *s, size_t len, frame_policy_t *out) {
+    frame_policy_t p = {0};
+    size_t i;
+
+    if (len == 4 && strncmp(s, "keep", 4) == 0) {
+        p.kind = FRAME_POLICY_KEEP;
+    } else if (len == 7 && strncmp(s, "summary", 7) == 0) {
+        p.kind = FRAME_POLICY_SUMMARY;
+    } else if (has_prefix(s, len, "sample:")) {
+        i = 7;
+        if (parse_count(s, len, &i, &p.n) != 0 || i != len) return -1;
+        p.kind = p.n == 1 ? FRAME_POLICY_KEEP : FRAME_POLICY_SAMPLE;
+        if (p.n == 1) p.n = 0;
+    } else if (has_prefix(s, len, "rate:")) {
+        i = 5;
+        if (parse_count(s, len, &i, &p.rate) != 0) return -1;
+        p.burst = p.rate;
+        if (i < len && s[i] == '/') {
+            i++;
+            if (parse_count(s, len, &i, &p.burst) != 0) return -1;
+        }
+        if (i != len) return -1;
+        p.kind = FRAME_POLICY_RATE;
+    } else {
+        return -1;
+    }
+
+    *out = p;
+    return 0;
+}
+
+void frame_policy_format(const frame_policy_t *p, char *out, size_t len) {
+    switch (p->kind) {
+        case FRAME_POLICY_SAMPLE:
+            snprintf(out, len, "sample:%u", p->n);
+            break;
+        case FRAME_POLICY_RATE:
+            snprintf(out, len, "rate:%u/%u", p->rate, p->burst);
+            break;
+        case FRAME_POLICY_SUMMARY:
+            snprintf(out, len, "summary");
+            break;
+        default:
+            snprintf(out, len, "keep");
+    }
+}
+
+bool frame_policy_equal(const frame_policy_t *a, const frame_policy_t *b) {
+    return a->kind == b->kind && a->n == b->n && a->rate == b->rate && a->burst == b->burst;
+}
+
+void frame_policer_init(frame_policer_t *p) {
+    memset(p, 0, sizeof(*p));
+}
+
+void frame_policer_destroy(frame_policer_t *p) {
+    free(p->buckets);
+    p->buckets = NULL;
+}
+
+int frame_policer_set(frame_policer_t *p, const frame_policy_set_t *set) {
+    bool active = false, rate = false;
+    for (int i = 0; i < FRAME_CLASS_COUNT; i++) {
+        active |= set->classes[i].kind != FRAME_POLICY_KEEP;
+        rate |= set->classes[i].kind == FRAME_POLICY_RATE;
+    }
+
+    int ret = 0;
+    if (rate && !p->buckets && !(p->buckets = calloc(FRAME_POLICY_BUCKETS, sizeof(frame_bucket_t)))) {
+        ret = -1;
+    }
+
+    p->set = *set;
+    p->active = active;
+    memset(p->sampled, 0, sizeof(p->sampled));
+    return ret;
+}
+
+// Fibonacci hash of MAC and class, so each class has its own buckets
+static inline uint32_t bucket_for(const uint8_t *mac, int cls) {
+    uint64_t key = (uint64_t)cls << 48;
+    memcpy(&key, mac, 6);
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 52) & (FRAME_POLICY_BUCKETS - 1);
+}
+
+_Static_assert((FRAME_POLICY_BUCKETS & (FRAME_POLICY_BUCKETS - 1)) == 0, "bucket count must be a power of two");
+
+uint32_t frame_policer_admit_slow(frame_policer_t *p, int cls, const uint8_t *mac, uint64_t ts_us) {
+    const frame_policy_t *policy = &p->set.classes[cls];
+
+    switch (policy->kind) {
+        case FRAME_POLICY_SAMPLE:
+            if (++p->sampled[cls] < policy->n) return 0;
+            p->sampled[cls] = 0;
+            return policy->n;
+
+        case FRAME_POLICY_RATE: {
+            if (!mac || !p->buckets) return 1;
+
+            // Generic cell rate algorithm: one timestamp per bucket instead
+            // of a token count and a refill time
+            uint64_t interval = 1000000 / policy->rate;
+            if (interval == 0) interval = 1;
+            uint64_t tolerance = interval * (policy->burst - 1);
+
+            frame_bucket_t *b = &p->buckets[bucket_for(mac, cls)];
+            // Capture time went backwards (a new replay, a clock step)
+            if (b->tat > ts_us + tolerance + interval) b->tat = ts_us;
+
+            uint64_t tat = b->tat > ts_us ? b->tat : ts_us;
+            if (tat - ts_us > tolerance) {
+                b->shed++;
+                return 0;
+            }
+            b->tat = tat + interval;
+            uint32_t weight = b->shed + 1;
+            b->shed = 0;
+            return weight;
+        }
+
+        case FRAME_POLICY_SUMMARY:
+            return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,75 @@
+#ifndef FRAME_POLICY_H
+#define FRAME_POLICY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define FRAME_CLASS_COUNT 7          // One per FRAME_* type of frame_filter.h
+#define FRAME_POLICY_BUCKETS 4096    // Token buckets per radio; MACs that hash together share one
+#define FRAME_POLICY_STR_MAX 32
+
+// What packet_handler does with the frames of one type, before parsing
+// anything past the 802.11 header:
+//   keep      handle every frame
+//   sample:N  handle 1 in N, standing for N frames
+//   rate:R/B  handle up to R frames/s per transmitter MAC with bursts of
+//             B (default R); a handled frame stands for itself and the
+//             frames its bucket shed since the last one
+//   summary   handle none; the frames only show up in the per-type counts
+// Counts derived from handled frames (beacons, data frames and bytes,
+// deauth bursts, probe sightings) are scaled by what each frame stands
+// for, so totals stay unbiased while the work drops.
+typedef enum {
+    FRAME_POLICY_KEEP = 0,
+    FRAME_POLICY_SAMPLE,
+    FRAME_POLICY_RATE,
+    FRAME_POLICY_SUMMARY,
+} frame_policy_kind_t;
+
+typedef struct {
+    uint8_t kind;       // frame_policy_kind_t
+    uint32_t n;         // FRAME_POLICY_SAMPLE
+    uint32_t rate;      // FRAME_POLICY_RATE, frames per second
+    uint32_t burst;
+} frame_policy_t;
+
+// Indexed like the FRAME_* bits
+typedef struct {
+    frame_policy_t classes[FRAME_CLASS_COUNT];
+} frame_policy_set_t;
+
+// Parse "keep", "sample:N", "rate:R" or "rate:R/B"; returns -1 if invalid
+int frame_policy_parse(const char *s, size_t len, frame_policy_t *out);
+void frame_policy_format(const frame_policy_t *p, char *out, size_t len);
+bool frame_policy_equal(const frame_policy_t *a, const frame_policy_t *b);
+
+// One radio's policy state, owned by its capture thread
+typedef struct {
+    uint64_t tat;       // GCRA theoretical arrival time, capture microseconds
+    uint32_t shed;      // Frames refused since the last one let through
+} frame_bucket_t;
+
+typedef struct {
+    frame_policy_set_t set;
+    bool active;                            // Some class is not FRAME_POLICY_KEEP
+    uint32_t sampled[FRAME_CLASS_COUNT];    // Frames since the last sampled one
+    frame_bucket_t *buckets;                // Allocated with the first rate policy
+} frame_policer_t;
+
+void frame_policer_init(frame_policer_t *p);
+void frame_policer_destroy(frame_policer_t *p);
+// Install a new policy set; returns -1 if the buckets cannot be allocated,
+// in which case rate policies keep every frame
+int frame_policer_set(frame_policer_t *p, const frame_policy_set_t *set);
+
+uint32_t frame_policer_admit_slow(frame_policer_t *p, int cls, const uint8_t *mac, uint64_t ts_us);
+
+// Frames this one stands for if it should be handled, 0 to shed it. cls
+// is the FRAME_* bit index, mac the transmitter the frame is keyed by.
+static inline uint32_t frame_policer_admit(frame_policer_t *p, int cls, const uint8_t *mac, uint64_t ts_us) {
+    if (!p->active || p->set.classes[cls].kind == FRAME_POLICY_KEEP) return 1;
+    return frame_policer_admit_slow(p, cls, mac, ts_us);
+}
+
+#endif
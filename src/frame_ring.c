@@ -0,0 +1,104 @@
+#include "frame_ring.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAME_RING_MIN_BYTES (8 * (sizeof(frame_rec_t) + FRAME_RING_MAX_FRAME))
+
+static inline size_t record_len(size_t captured) {
+    return (sizeof(frame_rec_t) + captured + 7) & ~(size_t)7;
+}
+
+int frame_ring_init(frame_ring_t *r, size_t bytes) {
+    size_t cap = 1;
+    while (cap < bytes || cap < FRAME_RING_MIN_BYTES) cap <<= 1;
+
+    memset(r, 0, sizeof(*r));
+    r->buf = calloc(1, cap);
+    if (!r->buf) return -1;
+    r->mask = cap - 1;
+
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    atomic_init(&r->pushed, 0);
+    atomic_init(&r->dropped, 0);
+    return 0;
+}
+
+void frame_ring_destroy(frame_ring_t *r) {
+    free(r->buf);
+    r->buf = NULL;
+}
+
+// Producer-only counters, as in event_queue.c
+static inline void counter_inc(_Atomic uint64_t *counter) {
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+}
+
+frame_rec_t *frame_ring_reserve(frame_ring_t *r, size_t captured, bool count_drop) {
+    size_t cap = r->mask + 1;
+    size_t need = record_len(captured);
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t pos = head & r->mask;
+    size_t to_end = cap - pos;
+
+    // A record that does not fit before the end also uses up the tail gap
+    size_t total = need <= to_end ? need : to_end + need;
+    if (cap - (head - r->tail_cache) < total) {
+        r->tail_cache = atomic_load_explicit(&r->tail, memory_order_acquire);
+        if (cap - (head - r->tail_cache) < total) {
+            if (count_drop) counter_inc(&r->dropped);
+            return NULL;
+        }
+    }
+
+    if (need > to_end) {
+        if (to_end >= sizeof(frame_rec_t)) {
+            ((frame_rec_t *)(r->buf + pos))->captured = FRAME_RING_WRAP;
+        }
+        head += to_end;
+        pos = 0;
+    }
+    r->reserved_head = head + need;
+    return (frame_rec_t *)(r->buf + pos);
+}
+
+void frame_ring_commit(frame_ring_t *r) {
+    atomic_store_explicit(&r->head, r->reserved_head, memory_order_release);
+    counter_inc(&r->pushed);
+}
+
+const frame_rec_t *frame_ring_peek(frame_ring_t *r) {
+    size_t cap = r->mask + 1;
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+
+    for (;;) {
+        if (tail == r->head_cache) {
+            r->head_cache = atomic_load_explicit(&r->head, memory_order_acquire);
+            if (tail == r->head_cache) return NULL;
+        }
+
+        size_t pos = tail & r->mask;
+        size_t to_end = cap - pos;
+        const frame_rec_t *f = (const frame_rec_t *)(r->buf + pos);
+        if (to_end < sizeof(frame_rec_t) || f->captured == FRAME_RING_WRAP) {
+            tail += to_end;
+            atomic_store_explicit(&r->tail, tail, memory_order_release);
+            continue;
+        }
+
+        r->peeked_len = record_len(f->captured);
+        return f;
+    }
+}
+
+void frame_ring_release(frame_ring_t *r) {
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    atomic_store_explicit(&r->tail, tail + r->peeked_len, memory_order_release);
+}
+
+bool frame_ring_empty(frame_ring_t *r) {
+    size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    return head == tail;
+}
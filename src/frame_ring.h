@@ -0,0 +1,68 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "event_queue.h"
+
+#define FRAME_RING_DEFAULT_BYTES (1u << 20)   // Per radio per worker
+#define FRAME_RING_MAX_FRAME 2048              // Longer frames are truncated
+#define FRAME_RING_WRAP 0xFFFF                 // captured value of a wrap marker
+
+// A frame as classified by the capture thread: the radiotap fields the
+// handlers use, followed by the first `captured` bytes of the 802.11 frame
+typedef struct {
+    uint64_t ts_us;
+    uint32_t frame_len;     // On-air length without FCS
+    uint16_t captured;
+    int16_t rx_channel;     // From radiotap, 0 if unknown
+    int8_t rssi;
+    uint8_t reserved[3];
+    uint32_t weight;        // Frames this one stands for under a capture policy (frame_policy.h)
+} frame_rec_t;
+
+// Single-producer/single-consumer ring of variable-length frame records,
+// laid out like event_queue: byte offsets on separate cache lines with a
+// cached copy of the other side's offset. Records are 8-byte aligned and
+// never split; a record that would cross the end leaves a wrap marker (or
+// a gap too short to hold one) and starts over at offset 0. The consumer
+// reads records in place.
+typedef struct {
+    // Producer-owned
+    _Alignas(CACHE_LINE_SIZE) _Atomic size_t head;
+    size_t tail_cache;
+    size_t reserved_head;   // head after the pending reservation
+    _Atomic uint64_t pushed;
+    _Atomic uint64_t dropped;
+
+    // Consumer-owned
+    _Alignas(CACHE_LINE_SIZE) _Atomic size_t tail;
+    size_t head_cache;
+    size_t peeked_len;
+
+    // Read-only after init
+    _Alignas(CACHE_LINE_SIZE) size_t mask;
+    uint8_t *buf;
+} frame_ring_t;
+
+int frame_ring_init(frame_ring_t *r, size_t bytes);
+void frame_ring_destroy(frame_ring_t *r);
+
+// Room for a record with captured (<= FRAME_RING_MAX_FRAME) bytes after
+// it, or NULL when the ring is full; with count_drop the miss is counted
+// as a dropped frame. Nothing is visible to the consumer until commit.
+frame_rec_t *frame_ring_reserve(frame_ring_t *r, size_t captured, bool count_drop);
+void frame_ring_commit(frame_ring_t *r);
+
+// Oldest record, or NULL when empty; stays valid until frame_ring_release
+const frame_rec_t *frame_ring_peek(frame_ring_t *r);
+void frame_ring_release(frame_ring_t *r);
+bool frame_ring_empty(frame_ring_t *r);
+
+static inline const uint8_t *frame_rec_data(const frame_rec_t *f) {
+    return (const uint8_t *)(f + 1);
+}
+
+#endif
@@ -0,0 +1,89 @@
+#include "hop_sched.h"
+#include "mac.h"
+#include <string.h>
+
+#define HOP_MIN_SCORE 1.0   // Keeps an idle channel from dropping out of the weights
+
+static inline hop_activity_t *activity_for(hop_sched_t *sched, int channel) {
+    if (channel <= 0 || channel >= HOP_CHANNEL_MAX) return NULL;
+    return &sched->activity[channel];
+}
+
+// Single writer, so relaxed load+store instead of a locked read-modify-write
+void hop_sched_record(hop_sched_t *sched, int channel, const uint8_t *mac) {
+    hop_activity_t *a = activity_for(sched, channel);
+    if (!a) return;
+
+    atomic_store_explicit(&a->frames, atomic_load_explicit(&a->frames, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+
+    uint32_t epoch = atomic_load_explicit(&a->epoch, memory_order_relaxed);
+    if (epoch != atomic_load_explicit(&a->seen_epoch, memory_order_relaxed)) {
+        for (int i = 0; i < HOP_STATION_BITS / 64; i++) {
+            atomic_store_explicit(&a->stations[i], 0, memory_order_relaxed);
+        }
+        atomic_store_explicit(&a->seen_epoch, epoch, memory_order_relaxed);
+    }
+
+    uint32_t bit = (uint32_t)((mac_to_u64(mac) * 0x9E3779B97F4A7C15ull) >> 54);   // Top 10 bits
+    _Atomic uint64_t *word = &a->stations[bit / 64];
+    uint64_t v = atomic_load_explicit(word, memory_order_relaxed);
+    uint64_t mask = 1ull << (bit % 64);
+    if (!(v & mask)) {
+        atomic_store_explicit(word, v | mask, memory_order_relaxed);
+    }
+}
+
+void hop_sched_reset(hop_sched_t *sched) {
+    for (int i = 0; i < HOP_LIST_MAX; i++) {
+        sched->score[i] = HOP_MIN_SCORE;
+    }
+}
+
+int hop_sched_dwell_ms(const hop_sched_t *sched, int idx, int num_channels, int timeout_ms) {
+    if (num_channels <= 1) return timeout_ms;
+
+    double total = 0;
+    for (int i = 0; i < num_channels; i++) {
+        total += sched->score[i];
+    }
+
+    // Same cycle length as round robin; a quarter of each slot is reserved
+    // so every channel is revisited at least once per cycle
+    int min_dwell = timeout_ms / 4;
+    if (min_dwell < 50) min_dwell = 50;
+    int spare = num_channels * (timeout_ms - min_dwell);
+    if (spare < 0) spare = 0;
+
+    return min_dwell + (int)(spare * (sched->score[idx] / total));
+}
+
+void hop_sched_begin(hop_sched_t *sched, int channel) {
+    hop_activity_t *a = activity_for(sched, channel);
+    if (!a) return;
+
+    atomic_fetch_add_explicit(&a->epoch, 1, memory_order_relaxed);
+    sched->frames_start = atomic_load_explicit(&a->frames, memory_order_relaxed);
+}
+
+void hop_sched_end(hop_sched_t *sched, int idx, int channel, int dwell_ms) {
+    hop_activity_t *a = activity_for(sched, channel);
+    if (!a || idx < 0 || idx >= HOP_LIST_MAX || dwell_ms <= 0) return;
+
+    uint32_t frames = atomic_load_explicit(&a->frames, memory_order_relaxed) - sched->frames_start;
+
+    // Reading the bitmap before the capture thread noticed the new epoch
+    // would count the previous dwell's stations
+    uint32_t stations = 0;
+    if (atomic_load_explicit(&a->seen_epoch, memory_order_relaxed) ==
+        atomic_load_explicit(&a->epoch, memory_order_relaxed) && frames > 0) {
+        for (int i = 0; i < HOP_STATION_BITS / 64; i++) {
+            stations += __builtin_popcountll(atomic_load_explicit(&a->stations[i], memory_order_relaxed));
+        }
+    }
+
+    // With far fewer stations than bits, set bits are a near-exact count
+    double activity = frames * 1000.0 / dwell_ms + HOP_STATION_WEIGHT * stations;
+    double score = HOP_SCORE_ALPHA * activity + (1.0 - HOP_SCORE_ALPHA) * sched->score[idx];
+    sched->score[idx] = score > HOP_MIN_SCORE ? score : HOP_MIN_SCORE;
+}
@@ -0,0 +1,50 @@
+#ifndef HOP_SCHED_H
+#define HOP_SCHED_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define HOP_CHANNEL_MAX 200          // Indexed by channel number (2.4 and 5 GHz)
+#define HOP_LIST_MAX 64              // Matches radio_t.channels
+#define HOP_STATION_BITS 1024        // Per-channel bitmap of transmitter MAC hashes
+#define HOP_STATION_WEIGHT 20.0      // One unique station scores like 20 frames/s
+#define HOP_SCORE_ALPHA 0.3          // EWMA weight of the latest dwell
+
+typedef enum {
+    HOP_MODE_ROUND_ROBIN = 0,        // Fixed timeout_ms on every channel
+    HOP_MODE_ADAPTIVE,               // Dwell shared in proportion to activity
+} hop_mode_t;
+
+// Activity seen on one channel. Written only by the capture thread; the
+// hopper reads the counters and asks for a bitmap reset by bumping epoch.
+typedef struct {
+    _Atomic uint32_t frames;               // Cumulative, never reset
+    _Atomic uint32_t epoch;                // Bumped by the hopper to restart the bitmap
+    _Atomic uint32_t seen_epoch;           // Last epoch the capture thread acted on
+    _Atomic uint64_t stations[HOP_STATION_BITS / 64];
+} hop_activity_t;
+
+typedef struct {
+    hop_activity_t activity[HOP_CHANNEL_MAX];
+
+    // Hopper thread only, indexed like radio_t.channels
+    double score[HOP_LIST_MAX];
+    uint32_t frames_start;                 // frames counter when the dwell began
+} hop_sched_t;
+
+// Capture thread: count a frame received on channel from transmitter mac
+void hop_sched_record(hop_sched_t *sched, int channel, const uint8_t *mac);
+
+// Hopper thread: forget learned scores, e.g. when the channel list changes
+void hop_sched_reset(hop_sched_t *sched);
+
+// Dwell for the idx-th configured channel. Every channel is visited once
+// per cycle of num_channels * timeout_ms, and gets at least a quarter of
+// timeout_ms, so quiet channels keep being sampled.
+int hop_sched_dwell_ms(const hop_sched_t *sched, int idx, int num_channels, int timeout_ms);
+
+// Hopper thread: bracket a dwell on channel (the idx-th configured one)
+void hop_sched_begin(hop_sched_t *sched, int channel);
+void hop_sched_end(hop_sched_t *sched, int idx, int channel, int dwell_ms);
+
+#endif
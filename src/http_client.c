@@ -1,180 +1,563 @@
 #include "http_client.h"
 #include "oui.h"
-#include <curl/curl.h>
+#include "data_agg.h"
+#include "ie.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+static const char *endpoint_paths[HTTP_ENDPOINT_COUNT] = {
+    [HTTP_ENDPOINT_DEVICE] = "/ingest/device",
+    [HTTP_ENDPOINT_AP] = "/ingest/access-point",
+    [HTTP_ENDPOINT_CONNECTION] = "/ingest/connection",
+    [HTTP_ENDPOINT_DISCONNECTION] = "/ingest/disconnection",
+    [HTTP_ENDPOINT_DATA] = "/ingest/data",
+    [HTTP_ENDPOINT_BATCH] = "/ingest/batch",
+    [HTTP_ENDPOINT_SKETCH] = "/ingest/sketch",
+    [HTTP_ENDPOINT_DICTIONARY] = "/ingest/dictionary",
+};
 
 static size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    (void)contents;
+    (void)userp;
     return size * nmemb;
 }
 
-void http_post_device(const char *api_url, const uint8_t *mac, int rssi, const char *probe_ssid) {
-    CURL *curl = curl_easy_init();
-    if (!curl) {
-        fprintf(stderr, "Failed to init curl\n");
-        return;
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    bool overflow;
+} fetch_buf_t;
+
+static size_t fetch_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    fetch_buf_t *out = userp;
+    size_t n = size * nmemb;
+    if (out->len + n > HTTP_DICTIONARY_MAX) {
+        out->overflow = true;
+        return 0;
     }
+    memcpy(out->buf + out->len, contents, n);
+    out->len += n;
+    return n;
+}
 
-    char url[256];
-    snprintf(url, sizeof(url), "%s/ingest/device", api_url);
+static uint64_t monotonic_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint64_t)ts.tv_sec;
+}
 
-    const char *vendor = oui_lookup(mac);
+int http_client_init(http_client_t *client, const char *api_url, const char *sniffer_id,
+                     http_compression_t compression) {
+    memset(client, 0, sizeof(*client));
 
-    char json[512];
-    if (probe_ssid && probe_ssid[0]) {
-        snprintf(json, sizeof(json),
-                 "{\"mac_address\":\"%02x:%02x:%02x:%02x:%02x:%02x\",\"rssi\":%d,\"probe_ssid\":\"%s\",\"vendor\":\"%s\"}",
-                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], rssi, probe_ssid, vendor);
-    } else {
-        snprintf(json, sizeof(json),
-                 "{\"mac_address\":\"%02x:%02x:%02x:%02x:%02x:%02x\",\"rssi\":%d,\"vendor\":\"%s\"}",
-                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], rssi, vendor);
+    for (int i = 0; i < HTTP_ENDPOINT_COUNT; i++) {
+        snprintf(client->urls[i], sizeof(client->urls[i]), "%s%s", api_url, endpoint_paths[i]);
     }
 
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
+    client->curl = curl_easy_init();
+    if (!client->curl) {
+        fprintf(stderr, "Failed to init curl\n");
+        return -1;
+    }
 
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    char id_header[128];
+    snprintf(id_header, sizeof(id_header), HTTP_SNIFFER_ID_HEADER ": %s", sniffer_id);
+
+    client->headers = curl_slist_append(NULL, "Content-Type: application/json");
+    client->headers = curl_slist_append(client->headers, id_header);
+    client->binary_headers = curl_slist_append(NULL, "Content-Type: application/octet-stream");
+    client->binary_headers = curl_slist_append(client->binary_headers, id_header);
+    client->deflate_headers = curl_slist_append(NULL, "Content-Type: application/json");
+    client->deflate_headers = curl_slist_append(client->deflate_headers, "Content-Encoding: deflate");
+    client->deflate_headers = curl_slist_append(client->deflate_headers, id_header);
+    client->binary_deflate_headers = curl_slist_append(NULL, "Content-Type: application/octet-stream");
+    client->binary_deflate_headers = curl_slist_append(client->binary_deflate_headers, "Content-Encoding: deflate");
+    client->binary_deflate_headers = curl_slist_append(client->binary_deflate_headers, id_header);
+    if (!client->headers || !client->binary_headers || !client->deflate_headers || !client->binary_deflate_headers) {
+        http_client_cleanup(client);
+        return -1;
+    }
+
+    // One deflate stream per client, reset for every batch
+    client->compression = compression;
+    if (compression == HTTP_COMPRESS_DEFLATE) {
+        if (deflateInit2(&client->zs, HTTP_DEFLATE_LEVEL, Z_DEFLATED, 15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            fprintf(stderr, "Failed to init deflate\n");
+            http_client_cleanup(client);
+            return -1;
+        }
+        client->zs_ready = true;
+    }
+
+    // Options that never change are set once; curl keeps the connection
+    // to the API open between requests on the same easy handle
+    CURL *curl = client->curl;
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, 2L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 2L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, 30L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 15L);
+    curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+
+    return 0;
+}
+
+void http_client_cleanup(http_client_t *client) {
+    if (client->curl) {
+        curl_easy_cleanup(client->curl);
+        client->curl = NULL;
+    }
+    if (client->headers) {
+        curl_slist_free_all(client->headers);
+        client->headers = NULL;
+    }
+    if (client->binary_headers) {
+        curl_slist_free_all(client->binary_headers);
+        client->binary_headers = NULL;
+    }
+    if (client->deflate_headers) {
+        curl_slist_free_all(client->deflate_headers);
+        client->deflate_headers = NULL;
+    }
+    if (client->binary_deflate_headers) {
+        curl_slist_free_all(client->binary_deflate_headers);
+        client->binary_deflate_headers = NULL;
+    }
+    if (client->zs_ready) {
+        deflateEnd(&client->zs);
+        client->zs_ready = false;
+    }
+    free(client->dict);
+    client->dict = NULL;
+    free(client->zbuf);
+    client->zbuf = NULL;
+}
+
+static int post_body(http_client_t *client, http_endpoint_t endpoint, struct curl_slist *headers,
+                     const char *body, size_t len, long timeout_s) {
+    if (!client->curl) return -1;
+
+    CURL *curl = client->curl;
+    curl_easy_setopt(curl, CURLOPT_URL, client->urls[endpoint]);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)len);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout_s);
 
     CURLcode res = curl_easy_perform(curl);
     if (res != CURLE_OK) {
-        static int error_count = 0;
-        if (error_count < 5) {
-            fprintf(stderr, "Device POST failed: %s\n", curl_easy_strerror(res));
-            error_count++;
+        if (client->error_count < 5) {
+            fprintf(stderr, "POST %s failed: %s\n", endpoint_paths[endpoint], curl_easy_strerror(res));
+            client->error_count++;
         }
+        return -1;
     }
 
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    if (status >= 400) {
+        if (client->error_count < 5) {
+            fprintf(stderr, "POST %s returned HTTP %ld\n", endpoint_paths[endpoint], status);
+            client->error_count++;
+        }
+        return -1;
+    }
+
+    return 0;
 }
 
-void http_post_ap(const char *api_url, const uint8_t *bssid, const char *ssid, int channel, int rssi) {
-    CURL *curl = curl_easy_init();
-    if (!curl) {
-        fprintf(stderr, "Failed to init curl\n");
-        return;
+// Fetch the API's preset dictionary. An API without one (404) predates
+// compressed ingest; it is asked again every HTTP_DICTIONARY_RETRY_S in
+// case it has been upgraded since.
+static void fetch_dictionary(http_client_t *client) {
+    uint64_t now = monotonic_s();
+    if (now < client->next_dict_s) return;
+    client->next_dict_s = now + HTTP_DICTIONARY_RETRY_S;
+
+    fetch_buf_t out = {.buf = malloc(HTTP_DICTIONARY_MAX)};
+    if (!out.buf) return;
+
+    CURL *curl = client->curl;
+    curl_easy_setopt(curl, CURLOPT_URL, client->urls[HTTP_ENDPOINT_DICTIONARY]);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, client->headers);
+    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, fetch_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &out);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 2L);
+
+    CURLcode res = curl_easy_perform(curl);
+    long status = 0;
+    char *type = NULL;
+    if (res == CURLE_OK) {
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+        curl_easy_getinfo(curl, CURLINFO_CONTENT_TYPE, &type);
     }
 
-    char url[256];
-    snprintf(url, sizeof(url), "%s/ingest/access-point", api_url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, NULL);
+
+    // Older APIs answer unknown paths with the dashboard's index.html
+    bool binary = type && strncmp(type, "application/octet-stream", 24) == 0;
+    if (status == 200 && !binary) status = 404;
+
+    if (res == CURLE_OK && status == 200 && out.len > 0) {
+        client->dict = out.buf;
+        client->dict_len = out.len;
+        printf("Compressing batches with the API's %zu-byte dictionary\n", out.len);
+        return;
+    }
+    if (status == 404 && client->error_count < 5) {
+        fprintf(stderr, "API has no %s, sending batches uncompressed\n", endpoint_paths[HTTP_ENDPOINT_DICTIONARY]);
+        client->error_count++;
+    } else if (out.overflow && client->error_count < 5) {
+        fprintf(stderr, "API dictionary exceeds %d bytes, sending batches uncompressed\n", HTTP_DICTIONARY_MAX);
+        client->error_count++;
+    }
+    free(out.buf);
+}
 
-    char json[512];
-    snprintf(json, sizeof(json),
-             "{\"bssid\":\"%02x:%02x:%02x:%02x:%02x:%02x\",\"ssid\":\"%s\",\"channel\":%d,\"rssi\":%d}",
-             bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5],
-             ssid ? ssid : "", channel, rssi);
+// Compress body into client->zbuf; 0 if it failed
+static size_t deflate_body(http_client_t *client, const char *body, size_t len) {
+    // deflateBound leaves out the dictionary ID in the stream header
+    size_t bound = deflateBound(&client->zs, len) + 4;
+    if (bound > client->zbuf_cap) {
+        uint8_t *buf = realloc(client->zbuf, bound);
+        if (!buf) return 0;
+        client->zbuf = buf;
+        client->zbuf_cap = bound;
+    }
 
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
+    z_stream *zs = &client->zs;
+    if (deflateReset(zs) != Z_OK || deflateSetDictionary(zs, client->dict, (uInt)client->dict_len) != Z_OK) {
+        return 0;
+    }
+    zs->next_in = (Bytef *)body;
+    zs->avail_in = (uInt)len;
+    zs->next_out = client->zbuf;
+    zs->avail_out = (uInt)client->zbuf_cap;
+    if (deflate(zs, Z_FINISH) != Z_STREAM_END) return 0;
+    return client->zbuf_cap - zs->avail_out;
+}
 
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 2L);
+// Post a batch body, compressed when a dictionary has been negotiated and
+// compressing actually saves bytes
+static int post_batch(http_client_t *client, bool binary, const char *body, size_t len) {
+    if (client->compression == HTTP_COMPRESS_DEFLATE && !client->dict && client->curl) {
+        fetch_dictionary(client);
+    }
 
-    CURLcode res = curl_easy_perform(curl);
-    if (res != CURLE_OK) {
-        static int error_count = 0;
-        if (error_count < 5) {
-            fprintf(stderr, "AP POST failed: %s\n", curl_easy_strerror(res));
-            error_count++;
+    client->batch_bytes += len;
+    if (client->dict) {
+        size_t n = deflate_body(client, body, len);
+        if (n > 0 && n < len) {
+            client->batch_wire_bytes += n;
+            int ret = post_body(client, HTTP_ENDPOINT_BATCH, binary ? client->binary_deflate_headers : client->deflate_headers,
+                                (const char *)client->zbuf, n, 5L);
+
+            // 415: the API no longer knows this dictionary, so fetch its
+            // current one for the next batch
+            long status = 0;
+            curl_easy_getinfo(client->curl, CURLINFO_RESPONSE_CODE, &status);
+            if (ret != 0 && status == 415) {
+                free(client->dict);
+                client->dict = NULL;
+                client->next_dict_s = 0;
+            }
+            return ret;
         }
     }
+    client->batch_wire_bytes += len;
+    return post_body(client, HTTP_ENDPOINT_BATCH, binary ? client->binary_headers : client->headers, body, len, 5L);
+}
 
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+// Escape a string for inclusion in a JSON document. SSIDs are arbitrary
+// bytes, and one unescaped quote would otherwise poison a whole batch.
+// Bytes from 0x80 up pass through, so UTF-8 SSIDs arrive as they do in
+// binary batches.
+static size_t json_escape(char *out, size_t out_len, const char *in) {
+    static const char hex[] = "0123456789abcdef";
+    size_t o = 0;
+
+    for (const unsigned char *p = (const unsigned char *)in; *p && o + 7 < out_len; p++) {
+        if (*p == '"' || *p == '\\') {
+            out[o++] = '\\';
+            out[o++] = *p;
+        } else if (*p < 0x20 || *p == 0x7f) {
+            out[o++] = '\\';
+            out[o++] = 'u';
+            out[o++] = '0';
+            out[o++] = '0';
+            out[o++] = hex[*p >> 4];
+            out[o++] = hex[*p & 0x0f];
+        } else {
+            out[o++] = *p;
+        }
+    }
+    out[o] = '\0';
+    return o;
 }
 
-void http_post_connection(const char *api_url, const uint8_t *mac, const uint8_t *bssid) {
-    CURL *curl = curl_easy_init();
-    if (!curl) return;
+#define MAC_FMT "%02x:%02x:%02x:%02x:%02x:%02x"
+#define MAC_ARGS(m) (m)[0], (m)[1], (m)[2], (m)[3], (m)[4], (m)[5]
 
-    char url[256];
-    snprintf(url, sizeof(url), "%s/ingest/connection", api_url);
+#define EVENT_FMT "\"ts_us\":%llu,\"seq\":%u,"
+#define EVENT_ARGS(ev) (unsigned long long)(ev)->ts_us, (ev)->seq
 
-    char json[256];
-    if (bssid) {
-        snprintf(json, sizeof(json),
-                 "{\"mac_address\":\"%02x:%02x:%02x:%02x:%02x:%02x\",\"bssid\":\"%02x:%02x:%02x:%02x:%02x:%02x\"}",
-                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5],
-                 bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
-    } else {
-        snprintf(json, sizeof(json),
-                 "{\"mac_address\":\"%02x:%02x:%02x:%02x:%02x:%02x\"}",
-                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+// The element decoder's findings, as a suffix of device and AP records
+static void format_ie_fields(char *out, size_t out_len, const flux_event_t *ev) {
+    size_t n = 0;
+    out[0] = '\0';
+
+    if (ev->type == EVENT_DEVICE && ev->fingerprint) {
+        n += snprintf(out + n, out_len - n, ",\"fingerprint\":\"%08x\"", ev->fingerprint);
+    }
+    // Probes a sampled sighting stands for; 1 is left out
+    if (ev->type == EVENT_DEVICE && ev->frame_count > 1) {
+        n += snprintf(out + n, out_len - n, ",\"frame_count\":%d", ev->frame_count);
+    }
+    if (ev->type == EVENT_AP) {
+        char security[32];
+        ie_security_name(ev->security, security, sizeof(security));
+        n += snprintf(out + n, out_len - n, ",\"encryption\":\"%s\"", security);
+        if (ev->max_rate) {
+            n += snprintf(out + n, out_len - n, ",\"max_rate\":%u%s", ev->max_rate / 2, ev->max_rate & 1 ? ".5" : "");
+        }
+        if (ev->country[0]) {
+            n += snprintf(out + n, out_len - n, ",\"country\":\"%c%c\"", ev->country[0], ev->country[1]);
+        }
+    }
+    if (ev->caps) {
+        n += snprintf(out + n, out_len - n, ",\"capabilities\":[");
+        const char *sep = "";
+        for (int i = 0; i < IE_CAP_COUNT; i++) {
+            if (ev->caps & (1u << i)) {
+                n += snprintf(out + n, out_len - n, "%s\"%s\"", sep, ie_cap_name(i));
+                sep = ",";
+            }
+        }
+        snprintf(out + n, out_len - n, "]");
+    }
+}
+
+static int format_event(char *out, size_t out_len, const flux_event_t *ev) {
+    char ssid[EVENT_SSID_MAX * 6 + 1];
+    char ie_fields[160];
+
+    switch (ev->type) {
+        case EVENT_DEVICE:
+            json_escape(ssid, sizeof(ssid), ev->ssid);
+            format_ie_fields(ie_fields, sizeof(ie_fields), ev);
+            if (ssid[0]) {
+                return snprintf(out, out_len,
+                                "{\"type\":\"device\"," EVENT_FMT "\"mac_address\":\"" MAC_FMT "\",\"rssi\":%d,"
+                                "\"probe_ssid\":\"%s\",\"vendor\":\"%s\"%s}",
+                                EVENT_ARGS(ev), MAC_ARGS(ev->mac), ev->rssi, ssid, oui_lookup(ev->mac), ie_fields);
+            }
+            return snprintf(out, out_len,
+                            "{\"type\":\"device\"," EVENT_FMT "\"mac_address\":\"" MAC_FMT "\",\"rssi\":%d,\"vendor\":\"%s\"%s}",
+                            EVENT_ARGS(ev), MAC_ARGS(ev->mac), ev->rssi, oui_lookup(ev->mac), ie_fields);
+        case EVENT_AP:
+            json_escape(ssid, sizeof(ssid), ev->ssid);
+            format_ie_fields(ie_fields, sizeof(ie_fields), ev);
+            return snprintf(out, out_len,
+                            "{\"type\":\"access_point\"," EVENT_FMT "\"bssid\":\"" MAC_FMT "\",\"ssid\":\"%s\","
+                            "\"channel\":%d,\"rssi\":%d,\"beacon_count\":%d%s}",
+                            EVENT_ARGS(ev), MAC_ARGS(ev->mac), ssid, ev->channel, ev->rssi, ev->frame_count, ie_fields);
+        case EVENT_CONNECTION:
+            return snprintf(out, out_len,
+                            "{\"type\":\"connection\"," EVENT_FMT "\"mac_address\":\"" MAC_FMT "\",\"bssid\":\"" MAC_FMT "\","
+                            "\"rssi\":%d}",
+                            EVENT_ARGS(ev), MAC_ARGS(ev->mac), MAC_ARGS(ev->bssid), ev->rssi);
+        case EVENT_DISCONNECTION:
+            return snprintf(out, out_len,
+                            "{\"type\":\"disconnection\"," EVENT_FMT "\"mac_address\":\"" MAC_FMT "\",\"frame_count\":%d}",
+                            EVENT_ARGS(ev), MAC_ARGS(ev->mac), ev->frame_count);
+        case EVENT_DATA:
+            return snprintf(out, out_len,
+                            "{\"type\":\"data\"," EVENT_FMT "\"mac_address\":\"" MAC_FMT "\",\"frame_count\":%d,\"byte_count\":%u,"
+                            "\"rssi\":%d,\"direction\":\"%s\"}",
+                            EVENT_ARGS(ev), MAC_ARGS(ev->mac), ev->frame_count, ev->byte_count, ev->rssi,
+                            data_dir_name(ev->direction));
     }
+    return -1;
+}
 
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
+int http_post_event(http_client_t *client, const flux_event_t *ev) {
+    static const http_endpoint_t endpoint_for_type[] = {
+        [EVENT_DEVICE] = HTTP_ENDPOINT_DEVICE,
+        [EVENT_AP] = HTTP_ENDPOINT_AP,
+        [EVENT_CONNECTION] = HTTP_ENDPOINT_CONNECTION,
+        [EVENT_DISCONNECTION] = HTTP_ENDPOINT_DISCONNECTION,
+        [EVENT_DATA] = HTTP_ENDPOINT_DATA,
+    };
 
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 2L);
+    if (ev->type > EVENT_DATA) return -1;
 
-    curl_easy_perform(curl);
+    // The single-event routes ignore the extra "type" key, so they share
+    // the batch record encoding
+    char json[HTTP_BATCH_RECORD_MAX];
+    int n = format_event(json, sizeof(json), ev);
+    if (n < 0 || (size_t)n >= sizeof(json)) return -1;
 
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+    return post_body(client, endpoint_for_type[ev->type], client->headers, json, (size_t)n, 2L);
 }
 
-void http_post_disconnection(const char *api_url, const uint8_t *mac) {
-    CURL *curl = curl_easy_init();
-    if (!curl) return;
+static inline void put_u16le(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
 
-    char url[256];
-    snprintf(url, sizeof(url), "%s/ingest/disconnection", api_url);
+static inline void put_u32le(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
 
-    char json[256];
-    snprintf(json, sizeof(json),
-             "{\"mac_address\":\"%02x:%02x:%02x:%02x:%02x:%02x\"}",
-             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+static inline void put_u64le(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
 
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
+int http_post_sketch(http_client_t *client, const uint8_t *body, size_t len) {
+    return post_body(client, HTTP_ENDPOINT_SKETCH, client->binary_headers, (const char *)body, len, 5L);
+}
 
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 2L);
+// Encode one record of the binary batch format described in http_client.h
+static int encode_event(uint8_t *out, size_t out_len, const flux_event_t *ev) {
+    const char *ssid = "";
+    const char *vendor = "";
+
+    switch (ev->type) {
+        case EVENT_DEVICE:
+            ssid = ev->ssid;
+            vendor = oui_lookup(ev->mac);
+            break;
+        case EVENT_AP:
+            ssid = ev->ssid;
+            break;
+        case EVENT_CONNECTION:
+        case EVENT_DISCONNECTION:
+        case EVENT_DATA:
+            break;
+        default:
+            return -1;
+    }
 
-    curl_easy_perform(curl);
+    size_t ssid_len = strnlen(ssid, EVENT_SSID_MAX - 1);
+    size_t vendor_len = strnlen(vendor, 255);
+    size_t len = HTTP_WIRE_RECORD_LEN + ssid_len + vendor_len;
+    if (len > out_len) return -1;
+
+    bool has_ies = ev->type == EVENT_DEVICE || ev->type == EVENT_AP;
+    out[0] = ev->type;
+    out[1] = ev->type == EVENT_DATA ? ev->direction : 0;
+    out[2] = (uint8_t)ev->rssi;
+    out[3] = (uint8_t)ssid_len;
+    out[4] = (uint8_t)vendor_len;
+    out[5] = has_ies ? ev->caps : 0;
+    put_u16le(out + 6, ev->channel);
+    put_u64le(out + 8, ev->ts_us);
+    memcpy(out + 16, ev->mac, 6);
+    if (ev->type == EVENT_CONNECTION) {
+        memcpy(out + 22, ev->bssid, 6);
+    } else {
+        memset(out + 22, 0, 6);
+    }
+    put_u32le(out + 28, ev->frame_count > 0 ? (uint32_t)ev->frame_count : 0);
+    if (ev->type == EVENT_AP) {
+        out[32] = ev->security;
+        out[33] = ev->max_rate;
+        memcpy(out + 34, ev->country, 2);
+    } else if (ev->type == EVENT_DEVICE) {
+        put_u32le(out + 32, ev->fingerprint);
+    } else {
+        put_u32le(out + 32, ev->byte_count);
+    }
+    put_u32le(out + 36, ev->seq);
+    memcpy(out + HTTP_WIRE_RECORD_LEN, ssid, ssid_len);
+    memcpy(out + HTTP_WIRE_RECORD_LEN + ssid_len, vendor, vendor_len);
+    return (int)len;
+}
 
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+static size_t batch_header_len(const http_batch_t *batch) {
+    return batch->format == HTTP_WIRE_BINARY ? HTTP_WIRE_HEADER_LEN : 1;
 }
 
-void http_post_data(const char *api_url, const uint8_t *mac, int frame_count, int64_t byte_count) {
-    CURL *curl = curl_easy_init();
-    if (!curl) return;
+static void batch_reset(http_batch_t *batch) {
+    if (batch->format == HTTP_WIRE_BINARY) {
+        uint8_t *hdr = (uint8_t *)batch->buf;
+        memcpy(hdr, HTTP_WIRE_MAGIC, 3);
+        hdr[3] = HTTP_WIRE_VERSION;
+        memset(hdr + 4, 0, 4);
+    } else {
+        batch->buf[0] = '[';
+    }
+    batch->len = batch_header_len(batch);
+    batch->count = 0;
+}
 
-    char url[256];
-    snprintf(url, sizeof(url), "%s/ingest/data", api_url);
+int http_batch_init(http_batch_t *batch, int max_events, http_wire_format_t format) {
+    memset(batch, 0, sizeof(*batch));
+    if (max_events < 1) max_events = 1;
+    if (format == HTTP_WIRE_BINARY && max_events > UINT16_MAX) max_events = UINT16_MAX;
 
-    char json[256];
-    snprintf(json, sizeof(json),
-             "{\"mac_address\":\"%02x:%02x:%02x:%02x:%02x:%02x\",\"frame_count\":%d,\"byte_count\":%ld}",
-             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], frame_count, byte_count);
+    // Header + records + ',' separators + ']' + NUL
+    batch->cap = (size_t)max_events * (HTTP_BATCH_RECORD_MAX + 1) + HTTP_WIRE_HEADER_LEN + 2;
+    batch->buf = malloc(batch->cap);
+    if (!batch->buf) return -1;
 
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
+    batch->max_events = max_events;
+    batch->format = format;
+    batch_reset(batch);
+    return 0;
+}
 
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 2L);
+void http_batch_free(http_batch_t *batch) {
+    free(batch->buf);
+    batch->buf = NULL;
+}
+
+bool http_batch_add(http_batch_t *batch, const flux_event_t *ev) {
+    if (batch->count >= batch->max_events) return false;
+
+    // The buffer is sized so that a record of up to HTTP_BATCH_RECORD_MAX
+    // always fits while count < max_events
+    if (batch->format == HTTP_WIRE_BINARY) {
+        int n = encode_event((uint8_t *)batch->buf + batch->len, HTTP_BATCH_RECORD_MAX, ev);
+        if (n < 0) return true;   // Unknown type: drop it
+        batch->len += (size_t)n;
+        batch->count++;
+        return true;
+    }
+
+    size_t sep = batch->count > 0 ? 1 : 0;
+    char *out = batch->buf + batch->len + sep;
 
-    curl_easy_perform(curl);
+    int n = format_event(out, HTTP_BATCH_RECORD_MAX, ev);
+    if (n < 0 || n >= HTTP_BATCH_RECORD_MAX) {
+        // Unencodable record: drop it rather than corrupt the batch
+        return true;
+    }
+
+    if (sep) batch->buf[batch->len] = ',';
+    batch->len += sep + (size_t)n;
+    batch->count++;
+    return true;
+}
 
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+int http_batch_flush(http_batch_t *batch, http_client_t *client) {
+    if (batch->count == 0) return 0;
+
+    int ret;
+    if (batch->format == HTTP_WIRE_BINARY) {
+        put_u16le((uint8_t *)batch->buf + 4, (uint16_t)batch->count);
+        ret = post_batch(client, true, batch->buf, batch->len);
+    } else {
+        batch->buf[batch->len] = ']';
+        batch->buf[batch->len + 1] = '\0';
+        ret = post_batch(client, false, batch->buf, batch->len + 1);
+    }
+    batch_reset(batch);
+    return ret;
 }
@@ -2,11 +2,120 @@
 #define HTTP_CLIENT_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <curl/curl.h>
+#include <zlib.h>
+#include "event_queue.h"
 
-void http_post_device(const char *api_url, const uint8_t *mac, int rssi, const char *probe_ssid);
-void http_post_ap(const char *api_url, const uint8_t *bssid, const char *ssid, int channel, int rssi);
-void http_post_connection(const char *api_url, const uint8_t *mac, const uint8_t *bssid);
-void http_post_disconnection(const char *api_url, const uint8_t *mac);
-void http_post_data(const char *api_url, const uint8_t *mac, int frame_count, int64_t byte_count);
+#define HTTP_BATCH_DEFAULT_MAX_EVENTS 200
+#define HTTP_BATCH_DEFAULT_FLUSH_MS 500
+#define HTTP_BATCH_RECORD_MAX 640   // Worst-case encoded size of one record
+
+// Binary /ingest/batch body (Content-Type: application/octet-stream).
+// Integers are little-endian. The header is "FLX", a version byte, a u16
+// record count and two reserved bytes. Each record is:
+//   u8 type, u8 direction, i8 rssi, u8 ssid_len, u8 vendor_len, u8 caps,
+//   u16 channel, u64 ts_us, u8 mac[6], u8 bssid[6], u32 frame_count,
+//   u32 byte_count, u32 seq, then ssid_len SSID bytes and vendor_len
+//   vendor bytes.
+// type and direction use the event_type_t and data_dir_t values, and caps
+// the IE_CAP_* bits of ie.h. For a device, byte_count holds the probe
+// fingerprint and frame_count the probes it stands for when sampled (see
+// frame_policy.h); for an access point its bytes are the IE_SEC_* bits, the
+// max rate in 500 kbps units and the two country characters. Version 2
+// records had no caps or element fields, version 1 no seq either (a
+// 36-byte fixed part).
+#define HTTP_WIRE_MAGIC "FLX"
+#define HTTP_WIRE_VERSION 3
+#define HTTP_WIRE_HEADER_LEN 8
+#define HTTP_WIRE_RECORD_LEN 40     // Fixed part of a record
+
+#define HTTP_SNIFFER_ID_HEADER "X-Sniffer-ID"
+
+// Batch bodies can be sent zlib-compressed (Content-Encoding: deflate)
+// with a preset dictionary served by the API at /ingest/dictionary. The
+// stream header carries the dictionary's Adler-32, so the API can tell
+// which of its dictionaries a batch was compressed with. Until the
+// dictionary has been fetched, batches go out uncompressed.
+#define HTTP_DEFLATE_LEVEL 6
+#define HTTP_DICTIONARY_MAX 32768       // The deflate window; longer dictionaries are refused
+#define HTTP_DICTIONARY_RETRY_S 60      // Between fetch attempts while there is none
+
+typedef enum {
+    HTTP_COMPRESS_NONE = 0,
+    HTTP_COMPRESS_DEFLATE,
+} http_compression_t;
+
+typedef enum {
+    HTTP_WIRE_JSON = 0,
+    HTTP_WIRE_BINARY,
+} http_wire_format_t;
+
+typedef enum {
+    HTTP_ENDPOINT_DEVICE = 0,
+    HTTP_ENDPOINT_AP,
+    HTTP_ENDPOINT_CONNECTION,
+    HTTP_ENDPOINT_DISCONNECTION,
+    HTTP_ENDPOINT_DATA,
+    HTTP_ENDPOINT_BATCH,
+    HTTP_ENDPOINT_SKETCH,
+    HTTP_ENDPOINT_DICTIONARY,
+    HTTP_ENDPOINT_COUNT,
+} http_endpoint_t;
+
+// Connection-owning client: one easy handle and one header list, reused for
+// every request so the TCP connection to the API stays alive.
+// Not thread-safe; each uploader thread owns its own client.
+typedef struct {
+    CURL *curl;
+    struct curl_slist *headers;          // application/json
+    struct curl_slist *binary_headers;   // application/octet-stream
+    struct curl_slist *deflate_headers;  // The same two with Content-Encoding: deflate
+    struct curl_slist *binary_deflate_headers;
+    char urls[HTTP_ENDPOINT_COUNT][288];
+    int error_count;
+
+    http_compression_t compression;
+    z_stream zs;
+    bool zs_ready;
+    uint8_t *dict;               // Preset dictionary from the API, NULL until fetched
+    size_t dict_len;
+    uint64_t next_dict_s;        // Earliest next fetch attempt (monotonic seconds)
+    uint8_t *zbuf;               // Compressed batch body
+    size_t zbuf_cap;
+    uint64_t batch_bytes;        // Batch bodies before compression
+    uint64_t batch_wire_bytes;   // and as sent
+} http_client_t;
+
+// Events accumulated by an uploader and posted to /ingest/batch, either as
+// a JSON array or as one binary body
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+    int count;
+    int max_events;
+    http_wire_format_t format;
+} http_batch_t;
+
+// Every request carries sniffer_id in X-Sniffer-ID, so the API can keep
+// separate sequence spaces per sniffer. compression applies to batches.
+int http_client_init(http_client_t *client, const char *api_url, const char *sniffer_id,
+                     http_compression_t compression);
+void http_client_cleanup(http_client_t *client);
+
+// Post one event to its single-event ingest route
+int http_post_event(http_client_t *client, const flux_event_t *ev);
+// Posts an encoded probe sketch (see sketch.h) to /ingest/sketch
+int http_post_sketch(http_client_t *client, const uint8_t *body, size_t len);
+
+int http_batch_init(http_batch_t *batch, int max_events, http_wire_format_t format);
+void http_batch_free(http_batch_t *batch);
+// Returns false when the batch is full and must be flushed first. A record
+// that cannot be encoded is dropped, returning true without growing count.
+bool http_batch_add(http_batch_t *batch, const flux_event_t *ev);
+// Posts the accumulated events (if any) and resets the batch
+int http_batch_flush(http_batch_t *batch, http_client_t *client);
 
 #endif
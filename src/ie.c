@@ -0,0 +1,239 @@
+#include "ie.h"
+#include <stdio.h>
+#include <string.h>
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+static const uint8_t oui_ieee[3] = {0x00, 0x0f, 0xac};      // RSN suites
+static const uint8_t oui_microsoft[3] = {0x00, 0x50, 0xf2}; // WPA, WMM, WPS
+static const uint8_t oui_wfa[3] = {0x50, 0x6f, 0x9a};       // P2P
+
+#define SUITE_TKIP 2
+
+static inline uint32_t fnv1a(uint32_t h, const uint8_t *p, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * FNV_PRIME;
+    }
+    return h;
+}
+
+static inline void set_ref(ie_ref_t *ref, const uint8_t *buf, const ie_elem_t *e) {
+    if (ref->present) return;
+    ref->off = (uint16_t)(e->data - buf);
+    ref->len = e->len;
+    ref->present = true;
+}
+
+static void parse_vendor(const uint8_t *buf, const ie_elem_t *e, ie_info_t *info) {
+    if (info->num_vendor < IE_MAX_VENDOR) {
+        set_ref(&info->vendor[info->num_vendor++], buf, e);
+    }
+    if (e->len < 4) return;
+
+    uint8_t type = e->data[3];
+    if (memcmp(e->data, oui_microsoft, 3) == 0) {
+        if (type == 1) set_ref(&info->wpa, buf, e);
+        if (type == 2) info->caps |= IE_CAP_WMM;
+        if (type == 4) info->caps |= IE_CAP_WPS;
+    } else if (memcmp(e->data, oui_wfa, 3) == 0 && type == 9) {
+        info->caps |= IE_CAP_P2P;
+    }
+}
+
+void ie_parse(const uint8_t *buf, uint32_t len, ie_info_t *info) {
+    memset(info, 0, sizeof(*info));
+    uint32_t h = FNV_OFFSET;
+
+    ie_iter_t it;
+    ie_elem_t e;
+    ie_iter_init(&it, buf, len);
+    while (ie_iter_next(&it, &e)) {
+        h = fnv1a(h, &e.id, 1);
+
+        switch (e.id) {
+            case IE_SSID:
+                set_ref(&info->ssid, buf, &e);
+                break;
+            case IE_SUPP_RATES:
+                set_ref(&info->rates, buf, &e);
+                h = fnv1a(h, e.data, e.len);
+                break;
+            case IE_EXT_RATES:
+                set_ref(&info->ext_rates, buf, &e);
+                h = fnv1a(h, e.data, e.len);
+                break;
+            case IE_DS_PARAMS:
+                set_ref(&info->ds, buf, &e);
+                break;
+            case IE_COUNTRY:
+                set_ref(&info->country, buf, &e);
+                break;
+            case IE_RSN:
+                set_ref(&info->rsn, buf, &e);
+                break;
+            case IE_HT_CAP:
+                set_ref(&info->ht_cap, buf, &e);
+                info->caps |= IE_CAP_HT;
+                h = fnv1a(h, e.data, e.len);
+                break;
+            case IE_VHT_CAP:
+                set_ref(&info->vht_cap, buf, &e);
+                info->caps |= IE_CAP_VHT;
+                h = fnv1a(h, e.data, e.len);
+                break;
+            case IE_RM_CAPS:
+                info->caps |= IE_CAP_RRM;
+                h = fnv1a(h, e.data, e.len);
+                break;
+            case IE_EXT_CAPS:
+                set_ref(&info->ext_caps, buf, &e);
+                if (e.len > 2 && (e.data[2] & 0x08)) info->caps |= IE_CAP_BTM;
+                h = fnv1a(h, e.data, e.len);
+                break;
+            case IE_VENDOR:
+                parse_vendor(buf, &e, info);
+                // OUI and type only: WPS and P2P bodies carry device names and UUIDs
+                h = fnv1a(h, e.data, e.len < 4 ? e.len : 4);
+                break;
+            case IE_EXTENSION:
+                if (e.len < 1) break;
+                h = fnv1a(h, e.data, 1);
+                if (e.data[0] == IE_EXT_HE_CAP) {
+                    ie_elem_t he = {e.id, (uint8_t)(e.len - 1), e.data + 1};
+                    set_ref(&info->he_cap, buf, &he);
+                    info->caps |= IE_CAP_HE;
+                    h = fnv1a(h, he.data, he.len);
+                }
+                break;
+        }
+    }
+
+    info->truncated = it.pos != it.end;
+    // 0 stands for "no fingerprint" downstream
+    info->fingerprint = h ? h : 1;
+}
+
+void ie_ssid(const ie_info_t *info, const uint8_t *buf, char out[33]) {
+    out[0] = '\0';
+    if (!info->ssid.present || info->ssid.len == 0 || info->ssid.len > 32) return;
+    memcpy(out, ie_data(buf, info->ssid), info->ssid.len);
+    out[info->ssid.len] = '\0';
+}
+
+int ie_channel(const ie_info_t *info, const uint8_t *buf) {
+    if (!info->ds.present || info->ds.len != 1) return 0;
+    return *ie_data(buf, info->ds);
+}
+
+// The group cipher, pairwise cipher list and AKM list shared by the RSN
+// element and the WPA vendor element (after its version field). Fields
+// the element stops short of keep their defaults, which for the AKM is
+// 802.1X.
+static uint8_t parse_suites(const uint8_t *p, uint32_t len, const uint8_t oui[3]) {
+    uint8_t flags = 0;
+
+    if (len < 4) return IE_SEC_EAP;
+    if (memcmp(p, oui, 3) == 0 && p[3] == SUITE_TKIP) flags |= IE_SEC_TKIP;
+    p += 4;
+    len -= 4;
+
+    if (len < 2) return flags | IE_SEC_EAP;
+    uint32_t count = p[0] | (uint32_t)p[1] << 8;
+    p += 2;
+    len -= 2;
+    for (; count > 0 && len >= 4; count--, p += 4, len -= 4) {
+        if (memcmp(p, oui, 3) == 0 && p[3] == SUITE_TKIP) flags |= IE_SEC_TKIP;
+    }
+    if (count > 0) return flags;   // Truncated list
+
+    if (len < 2) return flags | IE_SEC_EAP;
+    count = p[0] | (uint32_t)p[1] << 8;
+    p += 2;
+    len -= 2;
+    for (; count > 0 && len >= 4; count--, p += 4, len -= 4) {
+        if (memcmp(p, oui, 3) != 0) continue;
+        switch (p[3]) {
+            case 1: case 3: case 5: case 11: case 12: case 13:
+                flags |= IE_SEC_EAP;
+                break;
+            case 2: case 4: case 6:
+                flags |= IE_SEC_PSK;
+                break;
+            case 8: case 9: case 24: case 25:
+                flags |= IE_SEC_SAE;
+                break;
+            case 18:
+                flags |= IE_SEC_OWE;
+                break;
+        }
+    }
+    return flags;
+}
+
+uint8_t ie_security(const ie_info_t *info, const uint8_t *buf, bool privacy) {
+    uint8_t flags = 0;
+
+    if (info->rsn.present && info->rsn.len >= 2) {
+        flags |= IE_SEC_RSN | parse_suites(ie_data(buf, info->rsn) + 2, info->rsn.len - 2u, oui_ieee);
+    }
+    // OUI, type and version precede the suites
+    if (info->wpa.present && info->wpa.len >= 6) {
+        flags |= IE_SEC_WPA | parse_suites(ie_data(buf, info->wpa) + 6, info->wpa.len - 6u, oui_microsoft);
+    }
+    if (privacy && !(flags & (IE_SEC_RSN | IE_SEC_WPA))) {
+        flags |= IE_SEC_WEP;
+    }
+    return flags;
+}
+
+// Rates above 54 Mbps are BSS membership selectors, not rates
+static uint8_t max_rate_in(const uint8_t *p, uint8_t len, uint8_t best) {
+    for (uint8_t i = 0; i < len; i++) {
+        uint8_t rate = p[i] & 0x7f;
+        if (rate <= 108 && rate > best) best = rate;
+    }
+    return best;
+}
+
+uint8_t ie_max_rate(const ie_info_t *info, const uint8_t *buf) {
+    uint8_t best = 0;
+    if (info->rates.present) best = max_rate_in(ie_data(buf, info->rates), info->rates.len, best);
+    if (info->ext_rates.present) best = max_rate_in(ie_data(buf, info->ext_rates), info->ext_rates.len, best);
+    return best;
+}
+
+bool ie_country(const ie_info_t *info, const uint8_t *buf, char out[2]) {
+    if (!info->country.present || info->country.len < 2) return false;
+    const uint8_t *p = ie_data(buf, info->country);
+    if (p[0] < 'A' || p[0] > 'Z' || p[1] < 'A' || p[1] > 'Z') return false;
+    out[0] = (char)p[0];
+    out[1] = (char)p[1];
+    return true;
+}
+
+void ie_security_name(uint8_t security, char *out, size_t out_len) {
+    if (security & IE_SEC_OWE) {
+        snprintf(out, out_len, "OWE");
+        return;
+    }
+    if (!(security & (IE_SEC_RSN | IE_SEC_WPA))) {
+        snprintf(out, out_len, "%s", security & IE_SEC_WEP ? "WEP" : "Open");
+        return;
+    }
+
+    // Protocol first, then one entry per AKM family, e.g. a WPA3
+    // transition network is "WPA2-PSK/WPA3-SAE"
+    const char *proto = security & IE_SEC_RSN ? "WPA2" : "WPA";
+    size_t n = 0;
+    out[0] = '\0';
+    if (security & IE_SEC_PSK) n += snprintf(out + n, out_len - n, "%s%s-PSK", n ? "/" : "", proto);
+    if (n < out_len && (security & IE_SEC_EAP)) n += snprintf(out + n, out_len - n, "%s%s-EAP", n ? "/" : "", proto);
+    if (n < out_len && (security & IE_SEC_SAE)) n += snprintf(out + n, out_len - n, "%sWPA3-SAE", n ? "/" : "");
+    if (n == 0) snprintf(out, out_len, "%s", proto);
+}
+
+const char *ie_cap_name(int bit) {
+    static const char *names[IE_CAP_COUNT] = {"ht", "vht", "he", "wmm", "wps", "p2p", "rrm", "btm"};
+    return bit >= 0 && bit < IE_CAP_COUNT ? names[bit] : "";
+}
@@ -0,0 +1,135 @@
+#ifndef IE_H
+#define IE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Element IDs the decoder looks at
+enum {
+    IE_SSID = 0,
+    IE_SUPP_RATES = 1,
+    IE_DS_PARAMS = 3,
+    IE_COUNTRY = 7,
+    IE_HT_CAP = 45,
+    IE_RSN = 48,
+    IE_EXT_RATES = 50,
+    IE_RM_CAPS = 70,
+    IE_EXT_CAPS = 127,
+    IE_VHT_CAP = 191,
+    IE_VENDOR = 221,
+    IE_EXTENSION = 255,     // First body byte is the element ID extension
+};
+
+#define IE_EXT_HE_CAP 35
+#define IE_MAX_VENDOR 8     // Vendor elements recorded per frame; later ones only feed the fingerprint
+
+// Security flags, from the capability field, RSN and WPA elements
+#define IE_SEC_WEP   0x01   // Privacy bit without RSN or WPA
+#define IE_SEC_WPA   0x02   // WPA vendor element
+#define IE_SEC_RSN   0x04
+#define IE_SEC_PSK   0x08   // AKMs, from either element
+#define IE_SEC_EAP   0x10
+#define IE_SEC_SAE   0x20
+#define IE_SEC_OWE   0x40
+#define IE_SEC_TKIP  0x80   // TKIP offered as group or pairwise cipher
+
+// Capability flags
+#define IE_CAP_HT    0x01
+#define IE_CAP_VHT   0x02
+#define IE_CAP_HE    0x04
+#define IE_CAP_WMM   0x08
+#define IE_CAP_WPS   0x10
+#define IE_CAP_P2P   0x20
+#define IE_CAP_RRM   0x40   // 802.11k radio measurement
+#define IE_CAP_BTM   0x80   // 802.11v BSS transition management
+
+#define IE_CAP_COUNT 8
+
+// One element as it sits in the frame
+typedef struct {
+    uint8_t id;
+    uint8_t len;
+    const uint8_t *data;
+} ie_elem_t;
+
+typedef struct {
+    const uint8_t *pos;
+    const uint8_t *end;
+} ie_iter_t;
+
+static inline void ie_iter_init(ie_iter_t *it, const uint8_t *buf, uint32_t len) {
+    it->pos = buf;
+    it->end = buf + len;
+}
+
+// Next complete element; false at the end of the buffer or at an element
+// that runs past it
+static inline bool ie_iter_next(ie_iter_t *it, ie_elem_t *e) {
+    if (it->end - it->pos < 2) return false;
+    uint8_t len = it->pos[1];
+    if (it->end - it->pos - 2 < len) return false;
+
+    e->id = it->pos[0];
+    e->len = len;
+    e->data = it->pos + 2;
+    it->pos += 2 + len;
+    return true;
+}
+
+// Where an element's body sits, as an offset into the buffer given to
+// ie_parse; nothing is copied out of the frame
+typedef struct {
+    uint16_t off;
+    uint8_t len;
+    bool present;
+} ie_ref_t;
+
+typedef struct {
+    ie_ref_t ssid;
+    ie_ref_t rates;
+    ie_ref_t ext_rates;
+    ie_ref_t ds;
+    ie_ref_t country;
+    ie_ref_t rsn;
+    ie_ref_t wpa;           // Vendor element 00:50:f2 type 1
+    ie_ref_t ht_cap;
+    ie_ref_t vht_cap;
+    ie_ref_t he_cap;        // Past the extension ID byte
+    ie_ref_t ext_caps;
+    ie_ref_t vendor[IE_MAX_VENDOR];
+    uint8_t num_vendor;
+    uint8_t caps;           // IE_CAP_* bits
+    bool truncated;         // The last element ran past the captured bytes
+    uint32_t fingerprint;   // See ie_parse
+} ie_info_t;
+
+// Walks the elements in buf once, recording the first instance of each
+// element above, capability flags and a fingerprint of the station's
+// capabilities: element order, rates, HT/VHT/HE/RM/extended capability
+// fields and vendor OUIs. SSIDs, channels and other per-network or
+// per-frame values are left out, so a device keeps the same fingerprint
+// across randomized MACs. buf must outlive info.
+void ie_parse(const uint8_t *buf, uint32_t len, ie_info_t *info);
+
+static inline const uint8_t *ie_data(const uint8_t *buf, ie_ref_t ref) {
+    return buf + ref.off;
+}
+
+// SSID as a C string, empty when absent, hidden or longer than 32 bytes
+void ie_ssid(const ie_info_t *info, const uint8_t *buf, char out[33]);
+// DS Parameter Set channel, 0 if absent
+int ie_channel(const ie_info_t *info, const uint8_t *buf);
+// IE_SEC_* bits; privacy is the capability field's Privacy bit
+uint8_t ie_security(const ie_info_t *info, const uint8_t *buf, bool privacy);
+// Highest supported legacy rate in 500 kbps units, 0 if none
+uint8_t ie_max_rate(const ie_info_t *info, const uint8_t *buf);
+// Two-letter country code, or false if there is none
+bool ie_country(const ie_info_t *info, const uint8_t *buf, char out[2]);
+
+// "WPA2-PSK/WPA3-SAE", "WEP", "Open", ... for IE_SEC_* bits
+void ie_security_name(uint8_t security, char *out, size_t out_len);
+// Short name of capability bit i (0 <= i < IE_CAP_COUNT)
+const char *ie_cap_name(int bit);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef MAC_H
+#define MAC_H
+
+#include <stdint.h>
+
+// Pack a 6-byte MAC into the low 48 bits of a uint64 (big-endian order)
+static inline uint64_t mac_to_u64(const uint8_t *mac) {
+    return ((uint64_t)mac[0] << 40) | ((uint64_t)mac[1] << 32) | ((uint64_t)mac[2] << 24) |
+           ((uint64_t)mac[3] << 16) | ((uint64_t)mac[4] << 8) | (uint64_t)mac[5];
+}
+
+static inline void u64_to_mac(uint64_t v, uint8_t *mac) {
+    for (int i = 0; i < 6; i++) {
+        mac[i] = (uint8_t)(v >> (40 - 8 * i));
+    }
+}
+
+#endif
@@ -1,25 +1,300 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <signal.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <curl/curl.h>
 #include "sniffer.h"
+#include "frame_filter.h"
 
 static sniffer_t sniffer;
 
+// Long-only options
+enum {
+    OPT_AP_HYSTERESIS = 256,
+    OPT_AP_HEARTBEAT,
+    OPT_DATA_INTERVAL,
+    OPT_CAPTURE,
+    OPT_BUFFER_MB,
+    OPT_WIRE,
+    OPT_COMPRESS,
+    OPT_SNIFFER_ID,
+    OPT_SPOOL_DIR,
+    OPT_SPOOL_MB,
+    OPT_SKETCH_INTERVAL,
+    OPT_METRICS,
+    OPT_WORKERS,
+    OPT_REPLAY,
+    OPT_RATE,
+    OPT_FRAME_POLICY,
+    OPT_CAPTURE_CPUS,
+    OPT_UPLOADER_CPUS,
+    OPT_RT_PRIORITY,
+};
+
 void signal_handler(int sig) {
     (void)sig;
-    printf("\nShutting down...\n");
-    sniffer_stop(&sniffer);
-    exit(0);
+    // Shutdown work (joins, final flush) happens in main once the capture threads return
+    sniffer_request_stop(&sniffer);
+}
+
+// Parse "iface" or "iface:1,6,11"; the channel list is split off in place
+static int parse_radio(char *spec, radio_opts_t *radio) {
+    char *plan = strchr(spec, ':');
+    radio->interface = spec;
+    radio->num_channels = 0;
+    if (!plan) {
+        return 0;
+    }
+
+    *plan++ = '\0';
+    char *save = NULL;
+    for (char *tok = strtok_r(plan, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        int channel = atoi(tok);
+        if (channel <= 0 || radio->num_channels >= SNIFFER_MAX_CHANNELS) {
+            fprintf(stderr, "Invalid channel plan for %s: %s\n", spec, tok);
+            return -1;
+        }
+        radio->channels[radio->num_channels++] = channel;
+    }
+    return 0;
+}
+
+// "max" (or 0) for as fast as possible, otherwise a speed-up factor
+// such as 1, 10 or 10x
+static int parse_rate(const char *arg, double *rate) {
+    if (strcmp(arg, "max") == 0) {
+        *rate = 0;
+        return 0;
+    }
+
+    char *end;
+    double value = strtod(arg, &end);
+    if (end == arg || (*end && strcmp(end, "x") != 0) || value < 0) {
+        fprintf(stderr, "Invalid replay rate: %s\n", arg);
+        return -1;
+    }
+    *rate = value;
+    return 0;
+}
+
+// TYPE=POLICY, e.g. deauth=rate:10/20; see frame_policy.h
+static int parse_frame_policy(const char *arg, sniffer_opts_t *opts) {
+    const char *eq = strchr(arg, '=');
+    uint32_t bit = eq ? frame_filter_bit(arg, (size_t)(eq - arg)) : 0;
+    frame_policy_t policy;
+    if (!bit || frame_policy_parse(eq + 1, strlen(eq + 1), &policy) != 0) {
+        fprintf(stderr, "Invalid frame policy: %s\n", arg);
+        return -1;
+    }
+    opts->frame_policies.classes[__builtin_ctz(bit)] = policy;
+    opts->pinned_policies |= bit;
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options] [interface[:channels]]...\n"
+            "  Each interface gets its own capture thread; channels (e.g. wlan1:1,6,11)\n"
+            "  pins it to a fixed plan instead of the API channel list (max %d interfaces)\n"
+            "  -a, --api-url URL     API base URL (default http://127.0.0.1:8080)\n"
+            "  -u, --uploaders N     Number of uploader threads (default %d, max %d)\n"
+            "  -q, --queue-size N    Events buffered per uploader (default %d)\n"
+            "  -b, --batch-size N    Events per /ingest/batch POST, 1 disables batching (default %d)\n"
+            "  -t, --batch-ms MS     Max time an event waits in a batch (default %d)\n"
+            "      --ap-hysteresis DB  RSSI change that re-reports an AP (default %d)\n"
+            "      --ap-heartbeat S    Re-report unchanged APs every S seconds (default %d)\n"
+            "      --data-interval S   Data frame aggregation window in seconds (default %d)\n"
+            "      --capture MODE      Capture backend: live or mmap (default live)\n"
+            "      --buffer-mb N       Ring buffer size for --capture mmap (default %d)\n"
+            "      --wire FORMAT       Batch encoding: json or binary (default json)\n"
+            "      --compress MODE     Batch compression: deflate or none (default deflate)\n"
+            "      --sniffer-id ID     Identity sent with every event (default hostname)\n"
+            "      --spool-dir DIR     Spool events to DIR while the API is unreachable\n"
+            "      --spool-mb N        Disk budget for the spool (default %d)\n"
+            "      --sketch-interval S Probe sketch interval in seconds, 0 disables (default %d)\n"
+            "      --metrics [ADDR:]PORT  Serve Prometheus metrics (default address %s)\n"
+            "      --workers N         Parse worker threads sharded by MAC, 0 parses on capture (max %d)\n"
+            "      --replay FILE       Feed a radiotap .pcap through the pipeline instead of interfaces\n"
+            "      --rate R            Replay speed: 1 = recorded timing, 10 or 10x, max (default 1)\n"
+            "      --frame-policy TYPE=POLICY  Capture policy that overrides the API's, e.g.\n"
+            "                          deauth=rate:10/20, probe_req=sample:4, data=summary, beacon=keep\n"
+            "      --capture-cpus CPUS Capture thread placement: auto (one CPU per interface),\n"
+            "                          irq (the CPU of the NIC's interrupts), none or a list like 2,3\n"
+            "      --uploader-cpus CPUS  CPUs for uploaders and hoppers, e.g. 0-1 or none\n"
+            "                          (default: those without a capture thread)\n"
+            "      --rt-priority N     Run capture and hopper threads under SCHED_FIFO at N (1-99)\n"
+            "  -h, --help            Show this help\n",
+            prog, SNIFFER_MAX_RADIOS, SNIFFER_DEFAULT_UPLOADERS, UPLOADER_MAX, EVENT_QUEUE_DEFAULT_CAPACITY,
+            HTTP_BATCH_DEFAULT_MAX_EVENTS, HTTP_BATCH_DEFAULT_FLUSH_MS,
+            AP_CACHE_DEFAULT_HYSTERESIS_DB, AP_CACHE_DEFAULT_HEARTBEAT_S, DATA_AGG_DEFAULT_INTERVAL_S,
+            SNIFFER_DEFAULT_BUFFER_MB, SPOOL_DEFAULT_MB, SKETCH_DEFAULT_INTERVAL_S, METRICS_DEFAULT_ADDR,
+            SNIFFER_MAX_WORKERS);
 }
 
 int main(int argc, char *argv[]) {
-    const char *interface = "wlan0";
-    const char *api_url = "http://127.0.0.1:8080";
+    sniffer_opts_t opts;
+    sniffer_opts_init(&opts);
 
-    if (argc > 1) {
-        interface = argv[1];
+    static const struct option long_opts[] = {
+        {"api-url", required_argument, NULL, 'a'},
+        {"uploaders", required_argument, NULL, 'u'},
+        {"queue-size", required_argument, NULL, 'q'},
+        {"batch-size", required_argument, NULL, 'b'},
+        {"batch-ms", required_argument, NULL, 't'},
+        {"ap-hysteresis", required_argument, NULL, OPT_AP_HYSTERESIS},
+        {"ap-heartbeat", required_argument, NULL, OPT_AP_HEARTBEAT},
+        {"data-interval", required_argument, NULL, OPT_DATA_INTERVAL},
+        {"capture", required_argument, NULL, OPT_CAPTURE},
+        {"buffer-mb", required_argument, NULL, OPT_BUFFER_MB},
+        {"wire", required_argument, NULL, OPT_WIRE},
+        {"compress", required_argument, NULL, OPT_COMPRESS},
+        {"sniffer-id", required_argument, NULL, OPT_SNIFFER_ID},
+        {"spool-dir", required_argument, NULL, OPT_SPOOL_DIR},
+        {"spool-mb", required_argument, NULL, OPT_SPOOL_MB},
+        {"sketch-interval", required_argument, NULL, OPT_SKETCH_INTERVAL},
+        {"metrics", required_argument, NULL, OPT_METRICS},
+        {"workers", required_argument, NULL, OPT_WORKERS},
+        {"replay", required_argument, NULL, OPT_REPLAY},
+        {"rate", required_argument, NULL, OPT_RATE},
+        {"frame-policy", required_argument, NULL, OPT_FRAME_POLICY},
+        {"capture-cpus", required_argument, NULL, OPT_CAPTURE_CPUS},
+        {"uploader-cpus", required_argument, NULL, OPT_UPLOADER_CPUS},
+        {"rt-priority", required_argument, NULL, OPT_RT_PRIORITY},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "a:u:q:b:t:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+            case 'a':
+                opts.api_url = optarg;
+                break;
+            case 'u':
+                opts.num_uploaders = atoi(optarg);
+                break;
+            case 'q':
+                opts.queue_capacity = (size_t)atol(optarg);
+                break;
+            case 'b':
+                opts.batch_size = atoi(optarg);
+                break;
+            case 't':
+                opts.batch_flush_ms = atoi(optarg);
+                break;
+            case OPT_AP_HYSTERESIS:
+                opts.ap_rssi_hysteresis = atoi(optarg);
+                break;
+            case OPT_AP_HEARTBEAT:
+                opts.ap_heartbeat_s = atoi(optarg);
+                break;
+            case OPT_DATA_INTERVAL:
+                opts.data_interval_s = atoi(optarg);
+                break;
+            case OPT_CAPTURE:
+                if (strcmp(optarg, "live") == 0) {
+                    opts.capture_backend = CAPTURE_LIVE;
+                } else if (strcmp(optarg, "mmap") == 0) {
+                    opts.capture_backend = CAPTURE_MMAP;
+                } else {
+                    fprintf(stderr, "Unknown capture backend: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPT_BUFFER_MB:
+                opts.buffer_mb = atoi(optarg);
+                break;
+            case OPT_WIRE:
+                if (strcmp(optarg, "json") == 0) {
+                    opts.wire_format = HTTP_WIRE_JSON;
+                } else if (strcmp(optarg, "binary") == 0) {
+                    opts.wire_format = HTTP_WIRE_BINARY;
+                } else {
+                    fprintf(stderr, "Unknown wire format: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPT_COMPRESS:
+                if (strcmp(optarg, "deflate") == 0) {
+                    opts.compression = HTTP_COMPRESS_DEFLATE;
+                } else if (strcmp(optarg, "none") == 0) {
+                    opts.compression = HTTP_COMPRESS_NONE;
+                } else {
+                    fprintf(stderr, "Unknown compression: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPT_SNIFFER_ID:
+                opts.sniffer_id = optarg;
+                break;
+            case OPT_SPOOL_DIR:
+                opts.spool_dir = optarg;
+                break;
+            case OPT_SPOOL_MB:
+                opts.spool_mb = atoi(optarg);
+                break;
+            case OPT_SKETCH_INTERVAL:
+                opts.sketch_interval_s = atoi(optarg);
+                break;
+            case OPT_METRICS:
+                opts.metrics_listen = optarg;
+                break;
+            case OPT_WORKERS:
+                opts.num_workers = atoi(optarg);
+                break;
+            case OPT_REPLAY:
+                opts.replay_path = optarg;
+                break;
+            case OPT_RATE:
+                if (parse_rate(optarg, &opts.replay_rate) != 0) {
+                    return 1;
+                }
+                break;
+            case OPT_FRAME_POLICY:
+                if (parse_frame_policy(optarg, &opts) != 0) {
+                    return 1;
+                }
+                break;
+            case OPT_CAPTURE_CPUS:
+                opts.capture_cpus = optarg;
+                break;
+            case OPT_UPLOADER_CPUS:
+                opts.uploader_cpus = optarg;
+                break;
+            case OPT_RT_PRIORITY:
+                opts.rt_priority = atoi(optarg);
+                if (opts.rt_priority < 0 || opts.rt_priority > 99) {
+                    fprintf(stderr, "Invalid real-time priority: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'h':
+                usage(argv[0]);
+                return 0;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (opts.replay_path && optind < argc) {
+        fprintf(stderr, "--replay reads the file instead of interfaces\n");
+        return 1;
+    }
+    if (argc - optind > SNIFFER_MAX_RADIOS) {
+        fprintf(stderr, "At most %d interfaces are supported\n", SNIFFER_MAX_RADIOS);
+        return 1;
+    }
+    if (optind < argc) {
+        opts.num_radios = 0;
+        for (int i = optind; i < argc; i++) {
+            if (parse_radio(argv[i], &opts.radios[opts.num_radios]) != 0) {
+                return 1;
+            }
+            opts.num_radios++;
+        }
     }
 
     signal(SIGINT, signal_handler);
@@ -27,22 +302,33 @@ int main(int argc, char *argv[]) {
 
     curl_global_init(CURL_GLOBAL_DEFAULT);
 
-    if (sniffer_init(&sniffer, interface, api_url) != 0) {
+    if (sniffer_init(&sniffer, &opts) != 0) {
         fprintf(stderr, "Failed to initialize sniffer\n");
         return 1;
     }
 
-    printf("Starting Flux WiFi Sniffer on %s\n", interface);
-    printf("Posting data to %s\n", api_url);
+    if (opts.replay_path) {
+        printf("Starting Flux WiFi Sniffer on %s\n", opts.replay_path);
+    } else {
+        printf("Starting Flux WiFi Sniffer on");
+        for (int i = 0; i < sniffer.num_radios; i++) {
+            printf("%s %s", i > 0 ? "," : "", sniffer.radios[i].interface);
+        }
+        printf("\n");
+    }
+    printf("Posting data to %s as %s (%d uploader thread%s)\n", opts.api_url, sniffer.sniffer_id,
+           sniffer.num_uploaders, sniffer.num_uploaders == 1 ? "" : "s");
 
-    if (sniffer_start(&sniffer) != 0) {
+    int ret = sniffer_start(&sniffer);
+    if (ret != 0) {
         fprintf(stderr, "Failed to start sniffer\n");
-        sniffer_cleanup(&sniffer);
-        return 1;
+    } else {
+        printf("\nShutting down...\n");
     }
 
+    sniffer_stop(&sniffer);
     sniffer_cleanup(&sniffer);
     curl_global_cleanup();
 
-    return 0;
+    return ret != 0;
 }
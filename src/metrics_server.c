@@ -0,0 +1,367 @@
+#include "metrics_server.h"
+#include "sniffer.h"
+#include "alloc_stats.h"
+#include "frame_filter.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define METRICS_POLL_MS 500
+#define METRICS_REQUEST_MAX 1024
+
+static const char *frame_types[4] = {"mgmt", "ctrl", "data", "ext"};
+
+static const char *subtype_names[4][16] = {
+    {"assoc_req", "assoc_resp", "reassoc_req", "reassoc_resp", "probe_req", "probe_resp", "timing_adv", NULL,
+     "beacon", "atim", "disassoc", "auth", "deauth", "action", "action_noack", NULL},
+    {NULL, NULL, NULL, NULL, "beamforming", "vht_ndp", "ctrl_ext", "ctrl_wrapper",
+     "block_ack_req", "block_ack", "ps_poll", "rts", "cts", "ack", "cf_end", "cf_end_ack"},
+    {"data", NULL, NULL, NULL, "null", NULL, NULL, NULL,
+     "qos_data", NULL, NULL, NULL, "qos_null", NULL, NULL, NULL},
+    {NULL},
+};
+
+// The text format wants every sample of a family in one group, so each
+// family is written across all radios or uploaders before the next one
+static void family(telemetry_writer_t *w, const char *name, const char *type, const char *help) {
+    if (help) telemetry_printf(w, "# HELP %s %s\n", name, help);
+    telemetry_printf(w, "# TYPE %s %s\n", name, type);
+}
+
+static void radio_metric(telemetry_writer_t *w, sniffer_t *sniffer, const char *name, const char *extra,
+                         size_t offset) {
+    for (int i = 0; i < sniffer->num_radios; i++) {
+        radio_t *radio = &sniffer->radios[i];
+        const telemetry_counter_t *c = (const telemetry_counter_t *)((const char *)&radio->telemetry + offset);
+        telemetry_printf(w, "%s{interface=\"%s\"%s} %llu\n", name, radio->interface, extra,
+                         (unsigned long long)telemetry_get(c));
+    }
+}
+
+static void radio_hist(telemetry_writer_t *w, sniffer_t *sniffer, const char *name, size_t offset, double scale) {
+    for (int i = 0; i < sniffer->num_radios; i++) {
+        radio_t *radio = &sniffer->radios[i];
+        char labels[48];
+        snprintf(labels, sizeof(labels), "interface=\"%s\"", radio->interface);
+        telemetry_write_hist(w, name, labels, (const telemetry_hist_t *)((const char *)&radio->telemetry + offset),
+                             scale);
+    }
+}
+
+static void uploader_metric(telemetry_writer_t *w, sniffer_t *sniffer, const char *name, const char *extra,
+                            size_t offset) {
+    for (int i = 0; i < sniffer->num_uploaders; i++) {
+        uploader_t *up = &sniffer->uploaders[i];
+        const telemetry_counter_t *c = (const telemetry_counter_t *)((const char *)&up->telemetry + offset);
+        telemetry_printf(w, "%s{uploader=\"%d\"%s} %llu\n", name, up->id, extra,
+                         (unsigned long long)telemetry_get(c));
+    }
+}
+
+static void uploader_hist(telemetry_writer_t *w, sniffer_t *sniffer, const char *name, size_t offset,
+                          double scale) {
+    for (int i = 0; i < sniffer->num_uploaders; i++) {
+        uploader_t *up = &sniffer->uploaders[i];
+        char labels[32];
+        snprintf(labels, sizeof(labels), "uploader=\"%d\"", up->id);
+        telemetry_write_hist(w, name, labels, (const telemetry_hist_t *)((const char *)&up->telemetry + offset),
+                             scale);
+    }
+}
+
+typedef enum { QUEUE_DEPTH, QUEUE_CAPACITY, QUEUE_ENQUEUED, QUEUE_DROPPED } queue_stat_t;
+
+// Summed over the uploader's SPSC queues, one per radio
+static void queue_metric(telemetry_writer_t *w, sniffer_t *sniffer, const char *name, queue_stat_t stat) {
+    for (int i = 0; i < sniffer->num_uploaders; i++) {
+        uploader_t *up = &sniffer->uploaders[i];
+        uint64_t v = 0;
+        for (int q = 0; q < up->num_queues; q++) {
+            event_queue_t *queue = &up->queues[q];
+            switch (stat) {
+                case QUEUE_DEPTH: v += event_queue_depth(queue); break;
+                case QUEUE_CAPACITY: v += up->config.queue_capacity; break;
+                case QUEUE_ENQUEUED: v += atomic_load_explicit(&queue->enqueued, memory_order_relaxed); break;
+                case QUEUE_DROPPED: v += atomic_load_explicit(&queue->dropped, memory_order_relaxed); break;
+            }
+        }
+        telemetry_printf(w, "%s{uploader=\"%d\"} %llu\n", name, up->id, (unsigned long long)v);
+    }
+}
+
+#define RADIO(field) offsetof(radio_telemetry_t, field)
+#define UPLOADER(field) offsetof(uploader_telemetry_t, field)
+
+static void write_radios(telemetry_writer_t *w, sniffer_t *sniffer) {
+    // Only subtypes that have been seen, so idle radios stay short
+    family(w, "flux_frames_total", "counter", "Captured frames by 802.11 type and subtype");
+    for (int i = 0; i < sniffer->num_radios; i++) {
+        radio_t *radio = &sniffer->radios[i];
+        for (int type = 0; type < 4; type++) {
+            for (int sub = 0; sub < 16; sub++) {
+                uint64_t n = telemetry_get(&radio->telemetry.frames[type][sub]);
+                if (n == 0) continue;
+
+                char subtype[16];
+                if (subtype_names[type][sub]) {
+                    snprintf(subtype, sizeof(subtype), "%s", subtype_names[type][sub]);
+                } else {
+                    snprintf(subtype, sizeof(subtype), "%d", sub);
+                }
+                telemetry_printf(w, "flux_frames_total{interface=\"%s\",type=\"%s\",subtype=\"%s\"} %llu\n",
+                                 radio->interface, frame_types[type], subtype, (unsigned long long)n);
+            }
+        }
+    }
+
+    family(w, "flux_frame_bytes_total", "counter", NULL);
+    radio_metric(w, sniffer, "flux_frame_bytes_total", "", RADIO(bytes));
+    family(w, "flux_frames_malformed_total", "counter", "Bad radiotap or truncated 802.11 header");
+    radio_metric(w, sniffer, "flux_frames_malformed_total", "", RADIO(malformed));
+    family(w, "flux_frames_bad_fcs_total", "counter", NULL);
+    radio_metric(w, sniffer, "flux_frames_bad_fcs_total", "", RADIO(bad_fcs));
+    family(w, "flux_frames_shed_total", "counter", "Frames a capture policy left unhandled");
+    for (int i = 0; i < FRAME_CLASS_COUNT; i++) {
+        char type[48];
+        snprintf(type, sizeof(type), ",type=\"%s\"", frame_filter_name(i));
+        radio_metric(w, sniffer, "flux_frames_shed_total", type, RADIO(shed) + i * sizeof(telemetry_counter_t));
+    }
+    family(w, "flux_kernel_received_total", "counter", "pcap_stats received");
+    radio_metric(w, sniffer, "flux_kernel_received_total", "", RADIO(kernel_received));
+    family(w, "flux_kernel_dropped_total", "counter", "pcap_stats drops: buffer full or by the interface");
+    radio_metric(w, sniffer, "flux_kernel_dropped_total", ",reason=\"buffer\"", RADIO(kernel_dropped));
+    radio_metric(w, sniffer, "flux_kernel_dropped_total", ",reason=\"interface\"", RADIO(kernel_ifdropped));
+    family(w, "flux_channel", "gauge", NULL);
+    radio_metric(w, sniffer, "flux_channel", "", RADIO(channel));
+    family(w, "flux_channel_switches_total", "counter", NULL);
+    radio_metric(w, sniffer, "flux_channel_switches_total", "", RADIO(channel_switches));
+    family(w, "flux_channel_switch_failures_total", "counter", "nl80211 switches that fell back to iw");
+    radio_metric(w, sniffer, "flux_channel_switch_failures_total", "", RADIO(channel_switch_failures));
+
+    family(w, "flux_frame_processing_seconds", "histogram", "packet_handler time of sampled frames");
+    radio_hist(w, sniffer, "flux_frame_processing_seconds", RADIO(frame_ns), 1e-9);
+    family(w, "flux_channel_switch_seconds", "histogram", NULL);
+    radio_hist(w, sniffer, "flux_channel_switch_seconds", RADIO(channel_switch_us), 1e-6);
+    family(w, "flux_hop_lateness_seconds", "histogram", "How far past a dwell deadline the channel hopper woke");
+    radio_hist(w, sniffer, "flux_hop_lateness_seconds", RADIO(hop_late_us), 1e-6);
+}
+
+static void write_uploaders(telemetry_writer_t *w, sniffer_t *sniffer) {
+    family(w, "flux_queue_depth", "gauge", "Events waiting in the uploader's queues");
+    queue_metric(w, sniffer, "flux_queue_depth", QUEUE_DEPTH);
+    family(w, "flux_queue_capacity", "gauge", NULL);
+    queue_metric(w, sniffer, "flux_queue_capacity", QUEUE_CAPACITY);
+    family(w, "flux_events_enqueued_total", "counter", NULL);
+    queue_metric(w, sniffer, "flux_events_enqueued_total", QUEUE_ENQUEUED);
+    family(w, "flux_events_queue_dropped_total", "counter", "Events dropped at a full queue");
+    queue_metric(w, sniffer, "flux_events_queue_dropped_total", QUEUE_DROPPED);
+
+    family(w, "flux_posts_total", "counter", NULL);
+    uploader_metric(w, sniffer, "flux_posts_total", "", UPLOADER(posts));
+    family(w, "flux_post_failures_total", "counter", NULL);
+    uploader_metric(w, sniffer, "flux_post_failures_total", "", UPLOADER(post_failures));
+    family(w, "flux_post_retries_total", "counter", "Replay POSTs of spooled events");
+    uploader_metric(w, sniffer, "flux_post_retries_total", "", UPLOADER(retries));
+    family(w, "flux_events_posted_total", "counter", NULL);
+    uploader_metric(w, sniffer, "flux_events_posted_total", "", UPLOADER(events_posted));
+    family(w, "flux_events_spooled_total", "counter", NULL);
+    uploader_metric(w, sniffer, "flux_events_spooled_total", "", UPLOADER(events_spooled));
+    family(w, "flux_events_replayed_total", "counter", NULL);
+    uploader_metric(w, sniffer, "flux_events_replayed_total", "", UPLOADER(events_replayed));
+    family(w, "flux_events_upload_dropped_total", "counter", NULL);
+    uploader_metric(w, sniffer, "flux_events_upload_dropped_total", ",reason=\"no_spool\"", UPLOADER(events_dropped));
+    uploader_metric(w, sniffer, "flux_events_upload_dropped_total", ",reason=\"spool_full\"", UPLOADER(spool_dropped));
+    family(w, "flux_batch_bytes_total", "counter", "Batch body bytes before compression");
+    uploader_metric(w, sniffer, "flux_batch_bytes_total", "", UPLOADER(batch_bytes));
+    family(w, "flux_batch_wire_bytes_total", "counter", "Batch body bytes as sent");
+    uploader_metric(w, sniffer, "flux_batch_wire_bytes_total", "", UPLOADER(batch_wire_bytes));
+
+    family(w, "flux_post_duration_seconds", "histogram", NULL);
+    uploader_hist(w, sniffer, "flux_post_duration_seconds", UPLOADER(post_us), 1e-6);
+    family(w, "flux_event_delivery_seconds", "histogram", "Capture timestamp to accepted POST");
+    uploader_hist(w, sniffer, "flux_event_delivery_seconds", UPLOADER(delivery_us), 1e-6);
+}
+
+static void write_workers(telemetry_writer_t *w, sniffer_t *sniffer) {
+    if (sniffer->num_workers == 0) return;
+
+    family(w, "flux_worker_frames_total", "counter", "Frames handled by each parse worker");
+    for (int i = 0; i < sniffer->num_workers; i++) {
+        telemetry_printf(w, "flux_worker_frames_total{worker=\"%d\"} %llu\n", i,
+                         (unsigned long long)telemetry_get(&sniffer->workers[i].frames));
+    }
+    family(w, "flux_worker_ring_dropped_total", "counter", "Frames dropped at a full worker ring");
+    for (int i = 0; i < sniffer->num_workers; i++) {
+        const worker_t *worker = &sniffer->workers[i];
+        uint64_t dropped = 0;
+        for (int j = 0; j < worker->num_rings; j++) {
+            dropped += atomic_load_explicit(&worker->rings[j].dropped, memory_order_relaxed);
+        }
+        telemetry_printf(w, "flux_worker_ring_dropped_total{worker=\"%d\"} %llu\n", i, (unsigned long long)dropped);
+    }
+}
+
+static void write_allocs(telemetry_writer_t *w) {
+    if (!alloc_stats_enabled()) return;
+
+    family(w, "flux_heap_allocations_total", "counter", NULL);
+    for (int i = 0; i < alloc_stats_count(); i++) {
+        const alloc_thread_stats_t *t = alloc_stats_get(i);
+        telemetry_printf(w, "flux_heap_allocations_total{thread=\"%s\"} %llu\n", t->name,
+                         (unsigned long long)atomic_load_explicit(&t->allocs, memory_order_relaxed));
+    }
+    family(w, "flux_heap_allocated_bytes_total", "counter", NULL);
+    for (int i = 0; i < alloc_stats_count(); i++) {
+        const alloc_thread_stats_t *t = alloc_stats_get(i);
+        telemetry_printf(w, "flux_heap_allocated_bytes_total{thread=\"%s\"} %llu\n", t->name,
+                         (unsigned long long)atomic_load_explicit(&t->bytes, memory_order_relaxed));
+    }
+}
+
+static size_t render(metrics_server_t *m) {
+    telemetry_writer_t w = {.buf = m->buf, .cap = METRICS_BUFFER_SIZE};
+    write_radios(&w, m->sniffer);
+    write_uploaders(&w, m->sniffer);
+    write_workers(&w, m->sniffer);
+    write_allocs(&w);
+
+    if (w.overflow) {
+        fprintf(stderr, "Metrics exposition truncated at %d bytes\n", METRICS_BUFFER_SIZE);
+    }
+    return w.len;
+}
+
+static void send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+static void serve(metrics_server_t *m, int fd) {
+    struct timeval timeout = {.tv_sec = 1};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // Only the request line matters; the rest of the headers are read so
+    // the client does not see a reset
+    char req[METRICS_REQUEST_MAX];
+    size_t len = 0;
+    while (len < sizeof(req) - 1) {
+        ssize_t n = recv(fd, req + len, sizeof(req) - 1 - len, 0);
+        if (n <= 0) break;
+        len += (size_t)n;
+        req[len] = '\0';
+        if (strstr(req, "\r\n\r\n")) break;
+    }
+    req[len] = '\0';
+
+    char header[160];
+    if (strncmp(req, "GET /metrics", 12) == 0 && (req[12] == ' ' || req[12] == '?')) {
+        size_t body = render(m);
+        int n = snprintf(header, sizeof(header),
+                         "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                         "Content-Length: %zu\r\nConnection: close\r\n\r\n", body);
+        send_all(fd, header, (size_t)n);
+        send_all(fd, m->buf, body);
+    } else {
+        static const char not_found[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        send_all(fd, not_found, sizeof(not_found) - 1);
+    }
+}
+
+static void *metrics_thread(void *arg) {
+    metrics_server_t *m = (metrics_server_t *)arg;
+    alloc_stats_register("metrics");
+
+    // Polled with a timeout so stop never has to interrupt accept
+    while (atomic_load(&m->running)) {
+        struct pollfd pfd = {.fd = m->fd, .events = POLLIN};
+        if (poll(&pfd, 1, METRICS_POLL_MS) <= 0) continue;
+
+        int client = accept(m->fd, NULL, NULL);
+        if (client < 0) continue;
+        serve(m, client);
+        close(client);
+    }
+    return NULL;
+}
+
+static int open_listener(const char *listen_spec) {
+    char addr[64] = METRICS_DEFAULT_ADDR;
+    const char *port_str = listen_spec;
+    const char *colon = strrchr(listen_spec, ':');
+    if (colon) {
+        size_t n = (size_t)(colon - listen_spec);
+        if (n >= sizeof(addr)) return -1;
+        memcpy(addr, listen_spec, n);
+        addr[n] = '\0';
+        port_str = colon + 1;
+    }
+
+    int port = atoi(port_str);
+    struct sockaddr_in sa = {.sin_family = AF_INET, .sin_port = htons((uint16_t)port)};
+    if (port <= 0 || port > 65535 || inet_pton(AF_INET, addr, &sa.sin_addr) != 1) {
+        fprintf(stderr, "Invalid metrics address: %s\n", listen_spec);
+        return -1;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0 || listen(fd, 8) != 0) {
+        fprintf(stderr, "Could not listen for metrics on %s:%d: %s\n", addr, port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    printf("Serving metrics on http://%s:%d/metrics\n", addr, port);
+    return fd;
+}
+
+int metrics_server_start(metrics_server_t *m, struct sniffer *sniffer, const char *listen_spec) {
+    memset(m, 0, sizeof(*m));
+    m->sniffer = sniffer;
+    m->fd = open_listener(listen_spec);
+    if (m->fd < 0) return -1;
+
+    m->buf = malloc(METRICS_BUFFER_SIZE);
+    if (!m->buf) {
+        close(m->fd);
+        return -1;
+    }
+
+    atomic_store(&m->running, true);
+    if (pthread_create(&m->thread, NULL, metrics_thread, m) != 0) {
+        fprintf(stderr, "Failed to create metrics thread\n");
+        close(m->fd);
+        free(m->buf);
+        m->buf = NULL;
+        return -1;
+    }
+    m->started = true;
+    return 0;
+}
+
+void metrics_server_stop(metrics_server_t *m) {
+    if (!m->started) return;
+
+    atomic_store(&m->running, false);
+    pthread_join(m->thread, NULL);
+    m->started = false;
+    close(m->fd);
+    free(m->buf);
+    m->buf = NULL;
+}
@@ -0,0 +1,31 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define METRICS_DEFAULT_ADDR "127.0.0.1"
+#define METRICS_BUFFER_SIZE (512 * 1024)   // Exposition text, rendered per scrape
+
+struct sniffer;
+
+// Serves GET /metrics in the Prometheus text format from its own thread.
+// Every scrape reads the capture and uploader threads' counters directly;
+// nothing is aggregated in between, so an unscraped sniffer pays only for
+// the counter updates.
+typedef struct {
+    struct sniffer *sniffer;
+    int fd;
+    pthread_t thread;
+    bool started;
+    atomic_bool running;
+    char *buf;
+} metrics_server_t;
+
+// listen is "port" (bound to METRICS_DEFAULT_ADDR) or "addr:port"
+int metrics_server_start(metrics_server_t *m, struct sniffer *sniffer, const char *listen);
+void metrics_server_stop(metrics_server_t *m);
+
+#endif
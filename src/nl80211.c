@@ -0,0 +1,162 @@
+#include "nl80211.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <linux/netlink.h>
+#include <linux/genetlink.h>
+#include <linux/nl80211.h>
+
+#define NL_BUF_SIZE 4096
+
+typedef struct {
+    struct nlmsghdr nlh;
+    struct genlmsghdr genl;
+    char attrs[256];
+} nl_request_t;
+
+static void put_attr(nl_request_t *req, uint16_t type, const void *data, uint16_t len) {
+    struct nlattr *attr = (struct nlattr *)((char *)req + NLMSG_ALIGN(req->nlh.nlmsg_len));
+    attr->nla_type = type;
+    attr->nla_len = NLA_HDRLEN + len;
+    memcpy((char *)attr + NLA_HDRLEN, data, len);
+    req->nlh.nlmsg_len = NLMSG_ALIGN(req->nlh.nlmsg_len) + NLA_ALIGN(attr->nla_len);
+}
+
+static void put_u32(nl_request_t *req, uint16_t type, uint32_t value) {
+    put_attr(req, type, &value, sizeof(value));
+}
+
+static void init_request(nl_request_t *req, uint16_t family, uint8_t cmd, uint32_t seq) {
+    memset(req, 0, sizeof(*req));
+    req->nlh.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN);
+    req->nlh.nlmsg_type = family;
+    req->nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+    req->nlh.nlmsg_seq = seq;
+    req->genl.cmd = cmd;
+    req->genl.version = 1;
+}
+
+static int send_request(nl80211_t *nl, nl_request_t *req) {
+    struct sockaddr_nl kernel = {.nl_family = AF_NETLINK};
+    if (sendto(nl->fd, req, req->nlh.nlmsg_len, 0, (struct sockaddr *)&kernel, sizeof(kernel)) < 0) {
+        return -errno;
+    }
+    return 0;
+}
+
+// Read replies to seq until the ACK or error arrives. If family_id is
+// non-NULL, CTRL_ATTR_FAMILY_ID from a GETFAMILY reply is stored there.
+static int recv_reply(nl80211_t *nl, uint32_t seq, uint16_t *family_id) {
+    char buf[NL_BUF_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+
+    for (;;) {
+        ssize_t n = recv(nl->fd, buf, sizeof(buf), 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -errno;
+        }
+
+        for (struct nlmsghdr *nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, (size_t)n); nlh = NLMSG_NEXT(nlh, n)) {
+            if (nlh->nlmsg_seq != seq) continue;
+
+            if (nlh->nlmsg_type == NLMSG_ERROR) {
+                const struct nlmsgerr *err = (const struct nlmsgerr *)NLMSG_DATA(nlh);
+                return err->error;   // 0 is the ACK
+            }
+            if (nlh->nlmsg_type == NLMSG_DONE) {
+                return 0;
+            }
+
+            if (family_id) {
+                const char *attrs = (const char *)NLMSG_DATA(nlh) + GENL_HDRLEN;
+                int len = (int)nlh->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN);
+                while (len >= NLA_HDRLEN) {
+                    const struct nlattr *attr = (const struct nlattr *)attrs;
+                    if (attr->nla_len < NLA_HDRLEN || attr->nla_len > len) break;
+                    if (attr->nla_type == CTRL_ATTR_FAMILY_ID) {
+                        memcpy(family_id, attrs + NLA_HDRLEN, sizeof(*family_id));
+                    }
+                    attrs += NLA_ALIGN(attr->nla_len);
+                    len -= NLA_ALIGN(attr->nla_len);
+                }
+            }
+        }
+    }
+}
+
+int nl80211_open(nl80211_t *nl, const char *ifname) {
+    memset(nl, 0, sizeof(*nl));
+    nl->fd = -1;
+
+    nl->ifindex = if_nametoindex(ifname);
+    if (nl->ifindex == 0) {
+        return -errno;
+    }
+
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    // A wedged driver must not stall the hopper thread forever
+    struct timeval timeout = {.tv_sec = 1};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    struct sockaddr_nl local = {.nl_family = AF_NETLINK};
+    if (bind(fd, (struct sockaddr *)&local, sizeof(local)) < 0) {
+        int err = -errno;
+        close(fd);
+        return err;
+    }
+    nl->fd = fd;
+
+    // Resolve the nl80211 family id through the generic netlink controller
+    nl_request_t req;
+    init_request(&req, GENL_ID_CTRL, CTRL_CMD_GETFAMILY, ++nl->seq);
+    put_attr(&req, CTRL_ATTR_FAMILY_NAME, NL80211_GENL_NAME, sizeof(NL80211_GENL_NAME));
+
+    int ret = send_request(nl, &req);
+    if (ret == 0) {
+        ret = recv_reply(nl, nl->seq, &nl->family_id);
+    }
+    if (ret == 0 && nl->family_id == 0) {
+        ret = -ENOENT;
+    }
+    if (ret != 0) {
+        nl80211_close(nl);
+    }
+    return ret;
+}
+
+void nl80211_close(nl80211_t *nl) {
+    if (nl->fd >= 0) {
+        close(nl->fd);
+    }
+    nl->fd = -1;
+}
+
+int nl80211_channel_to_freq(int channel) {
+    if (channel == 14) return 2484;
+    if (channel >= 1 && channel <= 13) return 2407 + channel * 5;
+    if (channel >= 32 && channel <= 177) return 5000 + channel * 5;
+    return 0;
+}
+
+int nl80211_set_channel(nl80211_t *nl, int channel) {
+    int freq = nl80211_channel_to_freq(channel);
+    if (nl->fd < 0) return -EBADF;
+    if (freq == 0) return -EINVAL;
+
+    nl_request_t req;
+    init_request(&req, nl->family_id, NL80211_CMD_SET_WIPHY, ++nl->seq);
+    put_u32(&req, NL80211_ATTR_IFINDEX, nl->ifindex);
+    put_u32(&req, NL80211_ATTR_WIPHY_FREQ, (uint32_t)freq);
+    put_u32(&req, NL80211_ATTR_WIPHY_CHANNEL_TYPE, NL80211_CHAN_NO_HT);
+
+    int ret = send_request(nl, &req);
+    if (ret != 0) return ret;
+    return recv_reply(nl, nl->seq, NULL);
+}
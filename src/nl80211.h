@@ -0,0 +1,26 @@
+#ifndef NL80211_H
+#define NL80211_H
+
+#include <stdint.h>
+
+// Persistent generic-netlink socket for nl80211, used to retune the
+// capture interface without forking iw. Raw netlink, no libnl.
+typedef struct {
+    int fd;
+    uint16_t family_id;    // Resolved "nl80211" generic netlink family
+    uint32_t seq;
+    uint32_t ifindex;
+} nl80211_t;
+
+// Returns 0 on success, -errno on failure (fd is left at -1)
+int nl80211_open(nl80211_t *nl, const char *ifname);
+void nl80211_close(nl80211_t *nl);
+
+// NL80211_CMD_SET_WIPHY with the channel's frequency, no HT.
+// Returns 0 on success or the kernel's -errno.
+int nl80211_set_channel(nl80211_t *nl, int channel);
+
+// Centre frequency of a 2.4/5 GHz channel number, 0 if unknown
+int nl80211_channel_to_freq(int channel);
+
+#endif
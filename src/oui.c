@@ -1,99 +1,202 @@
+// Generated by scripts/generate_oui.py - do not edit by hand
 #include "oui.h"
-#include <string.h>
-#include <stdio.h>
+#include <stddef.h>
 
-typedef struct {
-    uint8_t prefix[3];
-    const char *vendor;
-} oui_entry_t;
+#define OUI_COUNT 79
 
-static const oui_entry_t oui_db[] = {
-    {{0x00, 0x03, 0x93}, "Apple"},
-    {{0x00, 0x05, 0x02}, "Apple"},
-    {{0x00, 0x0a, 0x95}, "Apple"},
-    {{0x00, 0x0d, 0x93}, "Apple"},
-    {{0x00, 0x16, 0xcb}, "Apple"},
-    {{0x00, 0x17, 0xf2}, "Apple"},
-    {{0x00, 0x19, 0xe3}, "Apple"},
-    {{0x00, 0x1b, 0x63}, "Apple"},
-    {{0x00, 0x1c, 0xb3}, "Apple"},
-    {{0x00, 0x1d, 0x4f}, "Apple"},
-    {{0x00, 0x1e, 0x52}, "Apple"},
-    {{0x00, 0x1e, 0xc2}, "Apple"},
-    {{0x00, 0x1f, 0x5b}, "Apple"},
-    {{0x00, 0x21, 0xe9}, "Apple"},
-    {{0x00, 0x22, 0x41}, "Apple"},
-    {{0x00, 0x23, 0x12}, "Apple"},
-    {{0x00, 0x23, 0x32}, "Apple"},
-    {{0x00, 0x23, 0x6c}, "Apple"},
-    {{0x00, 0x23, 0xdf}, "Apple"},
-    {{0x00, 0x24, 0x36}, "Apple"},
-    {{0x00, 0x25, 0x00}, "Apple"},
-    {{0x00, 0x25, 0x4b}, "Apple"},
-    {{0x00, 0x25, 0xbc}, "Apple"},
-    {{0x00, 0x26, 0x08}, "Apple"},
-    {{0x00, 0x26, 0x4a}, "Apple"},
-    {{0x00, 0x26, 0xb0}, "Apple"},
-    {{0x00, 0x26, 0xbb}, "Apple"},
-    {{0x00, 0x50, 0xf2}, "Microsoft"},
-    {{0x00, 0x0f, 0xb5}, "Microsoft"},
-    {{0x00, 0x12, 0x5a}, "Microsoft"},
-    {{0x00, 0x15, 0x5d}, "Microsoft"},
-    {{0x00, 0x17, 0xfa}, "Microsoft"},
-    {{0x00, 0x1d, 0xd8}, "Microsoft"},
-    {{0x00, 0x22, 0x48}, "Microsoft"},
-    {{0x00, 0x25, 0xae}, "Microsoft"},
-    {{0x08, 0x00, 0x27}, "VirtualBox"},
-    {{0x52, 0x54, 0x00}, "QEMU/KVM"},
-    {{0x00, 0x1c, 0x14}, "Samsung"},
-    {{0x00, 0x1a, 0x8a}, "Samsung"},
-    {{0x00, 0x12, 0xfb}, "Samsung"},
-    {{0x00, 0x15, 0xb9}, "Samsung"},
-    {{0x00, 0x16, 0x32}, "Samsung"},
-    {{0x00, 0x17, 0xc9}, "Samsung"},
-    {{0x00, 0x18, 0xaf}, "Samsung"},
-    {{0x00, 0x1b, 0x98}, "Samsung"},
-    {{0x00, 0x1d, 0x25}, "Samsung"},
-    {{0x00, 0x1e, 0x7d}, "Samsung"},
-    {{0x00, 0x1f, 0xcd}, "Samsung"},
-    {{0x00, 0x21, 0x19}, "Samsung"},
-    {{0x00, 0x21, 0x4c}, "Samsung"},
-    {{0x00, 0x23, 0x39}, "Samsung"},
-    {{0x00, 0x23, 0xd6}, "Samsung"},
-    {{0x00, 0x24, 0x90}, "Samsung"},
-    {{0x00, 0x24, 0xe9}, "Samsung"},
-    {{0x00, 0x25, 0x66}, "Samsung"},
-    {{0x00, 0x26, 0x37}, "Samsung"},
-    {{0xd8, 0x5e, 0xd3}, "Google"},
-    {{0xf4, 0xf5, 0xd8}, "Google"},
-    {{0x68, 0xef, 0xbd}, "Google"},
-    {{0x3c, 0x5a, 0xb4}, "Google"},
-    {{0x54, 0x60, 0x09}, "Google"},
-    {{0xf8, 0x8f, 0xca}, "Google"},
-    {{0x18, 0xb4, 0x30}, "Google"},
-    {{0xac, 0x63, 0xbe}, "Google"},
-    {{0x84, 0xf3, 0xeb}, "TP-Link"},
-    {{0xf4, 0xec, 0x38}, "TP-Link"},
-    {{0xa4, 0x2b, 0xb0}, "TP-Link"},
-    {{0x50, 0xc7, 0xbf}, "TP-Link"},
-    {{0x1c, 0x61, 0xb4}, "TP-Link"},
-    {{0xe8, 0x48, 0xb8}, "Cisco"},
-    {{0x00, 0x0a, 0xb7}, "Cisco"},
-    {{0x00, 0x0b, 0xbe}, "Cisco"},
-    {{0x00, 0x0c, 0x30}, "Cisco"},
-    {{0x00, 0x0e, 0x38}, "Cisco"},
-    {{0x00, 0x0f, 0x23}, "Cisco"},
-    {{0x00, 0x1a, 0xa1}, "Cisco"},
-    {{0x00, 0x1b, 0x0c}, "Cisco"},
-    {{0x00, 0x1c, 0x0e}, "Cisco"},
-    {{0x00, 0x1d, 0x70}, "Cisco"},
+// Vendor names, each stored once, NUL-separated
+static const char oui_strings[] =
+    "Apple" "\0"
+    "Cisco" "\0"
+    "Microsoft" "\0"
+    "Samsung" "\0"
+    "VirtualBox" "\0"
+    "Google" "\0"
+    "TP-Link" "\0"
+    "QEMU/KVM" "\0"
+    ;
+
+// 24-bit OUIs in Eytzinger order (index 0 unused) and the offset
+// of each one's vendor in oui_strings
+static const uint32_t oui_keys[OUI_COUNT + 1] = {
+    0,
+    0x0023d6,
+    0x001d70,
+    0x080027,
+    0x0016cb,
+    0x00214c,
+    0x0025ae,
+    0x84f3eb,
+    0x000e38,
+    0x001b0c,
+    0x001ec2,
+    0x002312,
+    0x0024e9,
+    0x00264a,
+    0x50c7bf,
+    0xe848b8,
+    0x000ab7,
+    0x0012fb,
+    0x0018af,
+    0x001c14,
+    0x001e52,
+    0x001fcd,
+    0x002241,
+    0x002339,
+    0x002436,
+    0x00254b,
+    0x002608,
+    0x0026bb,
+    0x1c61b4,
+    0x546009,
+    0xac63be,
+    0xf4f5d8,
+    0x000502,
+    0x000c30,
+    0x000fb5,
+    0x0015b9,
+    0x0017f2,
+    0x001a8a,
+    0x001b98,
+    0x001d25,
+    0x001dd8,
+    0x001e7d,
+    0x001f5b,
+    0x002119,
+    0x0021e9,
+    0x002248,
+    0x002332,
+    0x00236c,
+    0x0023df,
+    0x002490,
+    0x002500,
+    0x002566,
+    0x0025bc,
+    0x002637,
+    0x0026b0,
+    0x0050f2,
+    0x18b430,
+    0x3c5ab4,
+    0x525400,
+    0x68efbd,
+    0xa42bb0,
+    0xd85ed3,
+    0xf4ec38,
+    0xf88fca,
+    0x000393,
+    0x000a95,
+    0x000bbe,
+    0x000d93,
+    0x000f23,
+    0x00125a,
+    0x00155d,
+    0x001632,
+    0x0017c9,
+    0x0017fa,
+    0x0019e3,
+    0x001aa1,
+    0x001b63,
+    0x001c0e,
+    0x001cb3,
+    0x001d4f,
+};
+
+static const uint32_t oui_vendor[OUI_COUNT + 1] = {
+    0,
+    22,
+    6,
+    30,
+    0,
+    22,
+    12,
+    48,
+    6,
+    6,
+    0,
+    0,
+    22,
+    0,
+    48,
+    6,
+    6,
+    22,
+    22,
+    22,
+    0,
+    22,
+    0,
+    22,
+    0,
+    0,
+    0,
+    0,
+    48,
+    41,
+    41,
+    41,
+    0,
+    6,
+    12,
+    22,
+    0,
+    22,
+    22,
+    22,
+    12,
+    22,
+    0,
+    22,
+    0,
+    12,
+    0,
+    0,
+    0,
+    22,
+    0,
+    22,
+    0,
+    22,
+    0,
+    12,
+    41,
+    41,
+    56,
+    41,
+    48,
+    41,
+    48,
+    41,
+    0,
+    0,
+    6,
+    0,
+    6,
+    12,
+    12,
+    22,
+    22,
+    12,
+    0,
+    6,
+    0,
+    6,
+    0,
+    0,
 };
 
 const char* oui_lookup(const uint8_t *mac) {
-    for (size_t i = 0; i < sizeof(oui_db) / sizeof(oui_db[0]); i++) {
-        if (memcmp(mac, oui_db[i].prefix, 3) == 0) {
-            return oui_db[i].vendor;
-        }
+    uint32_t key = ((uint32_t)mac[0] << 16) | ((uint32_t)mac[1] << 8) | mac[2];
+    size_t k = 1;
+
+    // Branch-free descent; k ends up encoding the path taken
+    while (k <= OUI_COUNT) {
+        k = 2 * k + (oui_keys[k] < key);
+    }
+    // Undo the trailing right turns to land on the lower bound
+    k >>= __builtin_ffsll(~(long long)k);
+
+    if (k != 0 && oui_keys[k] == key) {
+        return oui_strings + oui_vendor[k];
     }
     return "Unknown";
 }
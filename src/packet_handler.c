@@ -1,7 +1,9 @@
 #include "packet_handler.h"
-#include "http_client.h"
+#include "radiotap.h"
+#include "ie.h"
+#include "frame_filter.h"
 #include <string.h>
-#include <stdio.h>
+#include <sched.h>
 #include <time.h>
 
 #define IEEE80211_FTYPE_MGMT 0x00
@@ -23,6 +25,9 @@
 #define IEEE80211_STYPE_DATA 0x00
 #define IEEE80211_STYPE_QOS_DATA 0x08
 
+#define BEACON_FIXED_LEN 12         // Timestamp, interval and capability info
+#define BEACON_CAP_PRIVACY 0x10     // Capability info bit 4
+
 typedef struct {
     uint8_t fc[2];
     uint16_t duration;
@@ -32,211 +37,371 @@ typedef struct {
     uint16_t seq_ctrl;
 } __attribute__((packed)) ieee80211_hdr_t;
 
+// Where a frame's table updates and events go: one shard's tables, and
+// the uploader queues of the calling producer thread
 typedef struct {
-    uint8_t version;
-    uint8_t pad;
-    uint16_t len;
-    uint32_t present;
-} __attribute__((packed)) radiotap_hdr_t;
+    sniffer_t *sniffer;
+    shard_t *shard;
+    int producer;
+} frame_ctx_t;
+
+static void emit_device(frame_ctx_t *ctx, const uint8_t *mac, int8_t rssi, const char *probe_ssid,
+                        const ie_info_t *ies, const frame_rec_t *f) {
+    flux_event_t ev = {0};
+    ev.ts_us = f->ts_us;
+    ev.type = EVENT_DEVICE;
+    ev.rssi = rssi;
+    ev.frame_count = f->weight > INT32_MAX ? INT32_MAX : (int32_t)f->weight;
+    ev.fingerprint = ies->fingerprint;
+    ev.caps = ies->caps;
+    memcpy(ev.mac, mac, 6);
+    if (probe_ssid) {
+        memcpy(ev.ssid, probe_ssid, sizeof(ev.ssid));
+    }
+    sniffer_emit(ctx->sniffer, ctx->producer, &ev);
+}
+
+static void emit_connection(frame_ctx_t *ctx, const uint8_t *mac, const uint8_t *bssid, int8_t rssi, uint64_t ts_us) {
+    flux_event_t ev = {0};
+    ev.ts_us = ts_us;
+    ev.type = EVENT_CONNECTION;
+    ev.rssi = rssi;
+    memcpy(ev.mac, mac, 6);
+    memcpy(ev.bssid, bssid, 6);
+    sniffer_emit(ctx->sniffer, ctx->producer, &ev);
+}
 
-static int8_t extract_rssi(const uint8_t *packet, uint16_t rtap_len) {
-    if (rtap_len < sizeof(radiotap_hdr_t)) return -100;
+// Emit callback for the tables that hold events back (data_agg, stations)
+static void emit_aggregate(void *arg, const flux_event_t *ev) {
+    frame_ctx_t *ctx = (frame_ctx_t *)arg;
+    sniffer_emit(ctx->sniffer, ctx->producer, ev);
+}
 
-    const radiotap_hdr_t *rtap = (const radiotap_hdr_t *)packet;
-    uint32_t present = rtap->present;
-    const uint8_t *pos = packet + sizeof(radiotap_hdr_t);
+// Report an (re)association only when the station's state actually changes.
+// The connection event doubles as the device sighting.
+static void associate(frame_ctx_t *ctx, const ieee80211_hdr_t *hdr, int8_t rssi, uint64_t ts_us) {
+    sniffer_lock_tables(ctx->sniffer);
+    bool connected = station_table_associate(&ctx->shard->stations, hdr->addr2, hdr->addr1, ts_us / 1000,
+                                             emit_aggregate, ctx);
+    sniffer_unlock_tables(ctx->sniffer);
 
-    if (present & (1 << 5)) {
-        return (int8_t)*pos;
+    if (connected) {
+        emit_connection(ctx, hdr->addr2, hdr->addr1, rssi, ts_us);
     }
-
-    return -100;
 }
 
-static void handle_beacon(sniffer_t *sniffer, const ieee80211_hdr_t *hdr, const uint8_t *body, uint32_t body_len, int8_t rssi) {
-    static int beacon_count = 0;
-    char ssid[33] = {0};
-    int channel = 0;
-
-    if (body_len > 12) {
-        const uint8_t *ie = body + 12;
-        uint32_t ie_len = body_len - 12;
+// Deauth and disassoc frames go both ways; one sent by the AP names the
+// station in addr1
+static const uint8_t *disconnect_station(const ieee80211_hdr_t *hdr) {
+    bool from_ap = memcmp(hdr->addr2, hdr->addr3, 6) == 0;
+    bool unicast = !(hdr->addr1[0] & 0x01);
+    return from_ap && unicast ? hdr->addr1 : hdr->addr2;
+}
 
-        while (ie_len > 2) {
-            uint8_t id = ie[0];
-            uint8_t len = ie[1];
+static void disconnect(frame_ctx_t *ctx, const ieee80211_hdr_t *hdr, const frame_rec_t *f) {
+    const uint8_t *station = disconnect_station(hdr);
 
-            if (len + 2 > ie_len) break;
+    sniffer_lock_tables(ctx->sniffer);
+    station_table_disconnect(&ctx->shard->stations, station, f->ts_us, f->weight, emit_aggregate, ctx);
+    sniffer_unlock_tables(ctx->sniffer);
+}
 
-            if (id == 0 && len > 0 && len < 33) {
-                memcpy(ssid, ie + 2, len);
-                ssid[len] = '\0';
-            } else if (id == 3 && len == 1) {
-                channel = ie[2];
-            }
+static void handle_beacon(frame_ctx_t *ctx, const ieee80211_hdr_t *hdr, const uint8_t *body, uint32_t body_len,
+                          const frame_rec_t *f) {
+    int8_t rssi = f->rssi;
+    uint64_t ts_us = f->ts_us;
+    char ssid[33] = {0};
+    int channel = 0;
+    ie_info_t ies = {0};
+    bool privacy = false;
+
+    if (body_len > BEACON_FIXED_LEN) {
+        ie_parse(body + BEACON_FIXED_LEN, body_len - BEACON_FIXED_LEN, &ies);
+        ie_ssid(&ies, body + BEACON_FIXED_LEN, ssid);
+        channel = ie_channel(&ies, body + BEACON_FIXED_LEN);
+        privacy = body[10] & BEACON_CAP_PRIVACY;
+    }
 
-            ie += len + 2;
-            ie_len -= len + 2;
-        }
+    // 5 GHz and 6 GHz beacons usually omit the DS Parameter Set
+    if (channel == 0) {
+        channel = f->rx_channel;
     }
 
-    beacon_count++;
-    if (beacon_count <= 5) {
-        printf("Beacon from %02x:%02x:%02x:%02x:%02x:%02x SSID=%s CH=%d RSSI=%ddBm\n",
-               hdr->addr3[0], hdr->addr3[1], hdr->addr3[2],
-               hdr->addr3[3], hdr->addr3[4], hdr->addr3[5],
-               ssid[0] ? ssid : "(hidden)", channel, rssi);
+    // Only report new APs, real changes, large RSSI moves and heartbeats
+    uint32_t beacons;
+    sniffer_lock_tables(ctx->sniffer);
+    bool report = ap_cache_update(&ctx->shard->ap_cache, hdr->addr3, ssid, channel, rssi, ts_us / 1000, f->weight,
+                                  &beacons);
+    sniffer_unlock_tables(ctx->sniffer);
+    if (!report) {
+        return;
     }
 
-    http_post_ap(sniffer->api_url, hdr->addr3, ssid, channel, rssi);
+    flux_event_t ev = {0};
+    ev.ts_us = ts_us;
+    ev.type = EVENT_AP;
+    ev.rssi = rssi;
+    ev.channel = channel;
+    ev.frame_count = (int32_t)beacons;
+    if (body_len > BEACON_FIXED_LEN) {
+        const uint8_t *elems = body + BEACON_FIXED_LEN;
+        ev.security = ie_security(&ies, elems, privacy);
+        ev.max_rate = ie_max_rate(&ies, elems);
+        ie_country(&ies, elems, ev.country);
+        ev.caps = ies.caps;
+    }
+    memcpy(ev.mac, hdr->addr3, 6);
+    memcpy(ev.ssid, ssid, sizeof(ev.ssid));
+    sniffer_emit(ctx->sniffer, ctx->producer, &ev);
 }
 
-static void handle_probe_req(sniffer_t *sniffer, const ieee80211_hdr_t *hdr, const uint8_t *body, uint32_t body_len, int8_t rssi) {
-    static int probe_count = 0;
-    char ssid[33] = {0};
+static void handle_probe_req(frame_ctx_t *ctx, const ieee80211_hdr_t *hdr, const uint8_t *body, uint32_t body_len,
+                             const frame_rec_t *f) {
+    char ssid[33];
+    ie_info_t ies;
 
-    if (body_len > 0) {
-        const uint8_t *ie = body;
-        uint32_t ie_len = body_len;
+    ie_parse(body, body_len, &ies);
+    ie_ssid(&ies, body, ssid);
 
-        while (ie_len > 2) {
-            uint8_t id = ie[0];
-            uint8_t len = ie[1];
+    emit_device(ctx, hdr->addr2, f->rssi, ssid, &ies, f);
 
-            if (len + 2 > ie_len) break;
-
-            if (id == 0 && len > 0 && len < 33) {
-                memcpy(ssid, ie + 2, len);
-                ssid[len] = '\0';
-                break;
-            }
-
-            ie += len + 2;
-            ie_len -= len + 2;
-        }
+    if (ctx->sniffer->sketch_interval_us) {
+        sniffer_lock_tables(ctx->sniffer);
+        probe_sketch_add(&ctx->shard->sketch, hdr->addr2, ssid, f->weight);
+        sniffer_unlock_tables(ctx->sniffer);
     }
-
-    probe_count++;
-    if (probe_count <= 5) {
-        printf("Probe from %02x:%02x:%02x:%02x:%02x:%02x SSID=%s RSSI=%ddBm\n",
-               hdr->addr2[0], hdr->addr2[1], hdr->addr2[2],
-               hdr->addr2[3], hdr->addr2[4], hdr->addr2[5],
-               ssid[0] ? ssid : "(broadcast)", rssi);
-    }
-    http_post_device(sniffer->api_url, hdr->addr2, rssi, ssid);
 }
 
-static void handle_assoc_req(sniffer_t *sniffer, const ieee80211_hdr_t *hdr, int8_t rssi) {
-    static int assoc_count = 0;
-    assoc_count++;
-    if (assoc_count <= 5) {
-        printf("Association from %02x:%02x:%02x:%02x:%02x:%02x to %02x:%02x:%02x:%02x:%02x:%02x\n",
-               hdr->addr2[0], hdr->addr2[1], hdr->addr2[2],
-               hdr->addr2[3], hdr->addr2[4], hdr->addr2[5],
-               hdr->addr1[0], hdr->addr1[1], hdr->addr1[2],
-               hdr->addr1[3], hdr->addr1[4], hdr->addr1[5]);
-    }
-    http_post_device(sniffer->api_url, hdr->addr2, rssi, NULL);
-    http_post_connection(sniffer->api_url, hdr->addr2, hdr->addr1);
+static void handle_assoc_req(frame_ctx_t *ctx, const ieee80211_hdr_t *hdr, int8_t rssi, uint64_t ts_us) {
+    associate(ctx, hdr, rssi, ts_us);
 }
 
-static void handle_reassoc_req(sniffer_t *sniffer, const ieee80211_hdr_t *hdr, int8_t rssi) {
-    static int reassoc_count = 0;
-    reassoc_count++;
-    if (reassoc_count <= 5) {
-        printf("Reassociation from %02x:%02x:%02x:%02x:%02x:%02x\n",
-               hdr->addr2[0], hdr->addr2[1], hdr->addr2[2],
-               hdr->addr2[3], hdr->addr2[4], hdr->addr2[5]);
-    }
-    http_post_device(sniffer->api_url, hdr->addr2, rssi, NULL);
-    http_post_connection(sniffer->api_url, hdr->addr2, hdr->addr1);
+static void handle_reassoc_req(frame_ctx_t *ctx, const ieee80211_hdr_t *hdr, int8_t rssi, uint64_t ts_us) {
+    associate(ctx, hdr, rssi, ts_us);
 }
 
-static void handle_disassoc(sniffer_t *sniffer, const ieee80211_hdr_t *hdr) {
-    static int disassoc_count = 0;
-    disassoc_count++;
-    if (disassoc_count <= 5) {
-        printf("Disassociation: %02x:%02x:%02x:%02x:%02x:%02x\n",
-               hdr->addr2[0], hdr->addr2[1], hdr->addr2[2],
-               hdr->addr2[3], hdr->addr2[4], hdr->addr2[5]);
-    }
-    http_post_disconnection(sniffer->api_url, hdr->addr2);
+static void handle_disassoc(frame_ctx_t *ctx, const ieee80211_hdr_t *hdr, const frame_rec_t *f) {
+    disconnect(ctx, hdr, f);
 }
 
-static void handle_deauth(sniffer_t *sniffer, const ieee80211_hdr_t *hdr) {
-    static int deauth_count = 0;
-    deauth_count++;
-    if (deauth_count <= 5) {
-        printf("Deauth: %02x:%02x:%02x:%02x:%02x:%02x\n",
-               hdr->addr2[0], hdr->addr2[1], hdr->addr2[2],
-               hdr->addr2[3], hdr->addr2[4], hdr->addr2[5]);
-    }
-    http_post_disconnection(sniffer->api_url, hdr->addr2);
+static void handle_deauth(frame_ctx_t *ctx, const ieee80211_hdr_t *hdr, const frame_rec_t *f) {
+    disconnect(ctx, hdr, f);
 }
 
-static void handle_data_frame(sniffer_t *sniffer, const ieee80211_hdr_t *hdr, uint32_t frame_len) {
-    static int data_count = 0;
-    static uint64_t total_bytes = 0;
-
-    data_count++;
-    total_bytes += frame_len;
+static void handle_data_frame(frame_ctx_t *ctx, const ieee80211_hdr_t *hdr, const frame_rec_t *f) {
+    // ToDS/FromDS bits map directly onto data_dir_t
+    data_dir_t dir = (data_dir_t)(hdr->fc[1] & 0x03);
+    sniffer_lock_tables(ctx->sniffer);
+    data_agg_add(&ctx->shard->data_agg, hdr->addr2, dir, f->frame_len, f->rssi, f->weight);
+    sniffer_unlock_tables(ctx->sniffer);
+}
 
-    if (data_count % 1000 == 0) {
-        printf("Data frames: %d (%.2f MB)\n", data_count, total_bytes / 1024.0 / 1024.0);
+void packet_handler_flush(sniffer_t *sniffer, uint64_t now_ms) {
+    for (int i = 0; i < sniffer->num_shards; i++) {
+        // Without workers the capture threads are done and radio 0's queues are free
+        frame_ctx_t ctx = {sniffer, &sniffer->shards[i], sniffer->num_workers > 0 ? i : 0};
+        shard_t *shard = ctx.shard;
+
+        data_agg_flush(&shard->data_agg, now_ms, emit_aggregate, &ctx);
+        station_table_flush(&shard->stations, emit_aggregate, &ctx);
+        if (sniffer->sketch_interval_us) {
+            probe_sketch_maybe_ship(&shard->sketch, &shard->sketch_outbox, now_ms * 1000, sniffer->sketch_interval_us,
+                                    true);
+        }
     }
-
-    http_post_data(sniffer->api_url, hdr->addr2, 1, frame_len);
 }
 
-void packet_handler(u_char *args, const struct pcap_pkthdr *header, const u_char *packet) {
-    sniffer_t *sniffer = (sniffer_t *)args;
-    static uint32_t packet_count = 0;
-
-    packet_count++;
-    if (packet_count % 100 == 0) {
-        printf("Processed %u packets...\n", packet_count);
-        fflush(stdout);
+void packet_handler_process(sniffer_t *sniffer, shard_t *shard, int producer, const frame_rec_t *f,
+                            const uint8_t *frame) {
+    frame_ctx_t ctx = {sniffer, shard, producer};
+    const ieee80211_hdr_t *wifi = (const ieee80211_hdr_t *)frame;
+    uint64_t now_ms = f->ts_us / 1000;
+
+    sniffer_lock_tables(sniffer);
+    data_agg_maybe_flush(&shard->data_agg, now_ms, emit_aggregate, &ctx);
+    station_table_maybe_flush(&shard->stations, now_ms, emit_aggregate, &ctx);
+    if (sniffer->sketch_interval_us) {
+        probe_sketch_maybe_ship(&shard->sketch, &shard->sketch_outbox, f->ts_us, sniffer->sketch_interval_us, false);
     }
-
-    if (header->len < sizeof(radiotap_hdr_t)) return;
-
-    const radiotap_hdr_t *rtap = (const radiotap_hdr_t *)packet;
-    uint16_t rtap_len = rtap->len;
-
-    if (header->len < rtap_len + sizeof(ieee80211_hdr_t)) return;
-
-    int8_t rssi = extract_rssi(packet, rtap_len);
-
-    const ieee80211_hdr_t *wifi = (const ieee80211_hdr_t *)(packet + rtap_len);
+    sniffer_unlock_tables(sniffer);
 
     uint8_t type = (wifi->fc[0] >> 2) & 0x03;
     uint8_t subtype = (wifi->fc[0] >> 4) & 0x0F;
 
-    const uint8_t *body = packet + rtap_len + sizeof(ieee80211_hdr_t);
-    uint32_t body_len = header->len - rtap_len - sizeof(ieee80211_hdr_t);
+    // IEs are only parsed out of bytes that were actually captured
+    const uint8_t *body = frame + sizeof(ieee80211_hdr_t);
+    uint32_t body_len = f->captured - sizeof(ieee80211_hdr_t);
 
     if (type == IEEE80211_FTYPE_MGMT) {
         switch (subtype) {
             case IEEE80211_STYPE_BEACON:
-                handle_beacon(sniffer, wifi, body, body_len, rssi);
+                handle_beacon(&ctx, wifi, body, body_len, f);
                 break;
             case IEEE80211_STYPE_PROBE_REQ:
-                handle_probe_req(sniffer, wifi, body, body_len, rssi);
+                handle_probe_req(&ctx, wifi, body, body_len, f);
                 break;
             case IEEE80211_STYPE_ASSOC_REQ:
-                handle_assoc_req(sniffer, wifi, rssi);
+                handle_assoc_req(&ctx, wifi, f->rssi, f->ts_us);
                 break;
             case IEEE80211_STYPE_REASSOC_REQ:
-                handle_reassoc_req(sniffer, wifi, rssi);
+                handle_reassoc_req(&ctx, wifi, f->rssi, f->ts_us);
                 break;
             case IEEE80211_STYPE_DISASSOC:
-                handle_disassoc(sniffer, wifi);
+                handle_disassoc(&ctx, wifi, f);
                 break;
             case IEEE80211_STYPE_DEAUTH:
-                handle_deauth(sniffer, wifi);
+                handle_deauth(&ctx, wifi, f);
                 break;
         }
     } else if (type == IEEE80211_FTYPE_DATA) {
-        handle_data_frame(sniffer, wifi, header->len);
+        handle_data_frame(&ctx, wifi, f);
     }
 }
+
+// The MAC whose tables and events a frame feeds, which picks its worker;
+// NULL for frames no handler uses
+static const uint8_t *shard_mac(const ieee80211_hdr_t *hdr, uint8_t type, uint8_t subtype) {
+    if (type == IEEE80211_FTYPE_DATA) return hdr->addr2;
+    if (type != IEEE80211_FTYPE_MGMT) return NULL;
+
+    switch (subtype) {
+        case IEEE80211_STYPE_BEACON:
+            return hdr->addr3;
+        case IEEE80211_STYPE_PROBE_REQ:
+        case IEEE80211_STYPE_ASSOC_REQ:
+        case IEEE80211_STYPE_REASSOC_REQ:
+            return hdr->addr2;
+        case IEEE80211_STYPE_DISASSOC:
+        case IEEE80211_STYPE_DEAUTH:
+            return disconnect_station(hdr);
+    }
+    return NULL;
+}
+
+// Fibonacci hash of the whole MAC, reduced to [0, n) without a division
+static inline int mac_worker(const uint8_t *mac, int n) {
+    uint64_t key = 0;
+    memcpy(&key, mac, 6);
+    uint32_t h = (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32);
+    return (int)(((uint64_t)h * (uint32_t)n) >> 32);
+}
+
+// Copy the frame into its worker's ring for this radio. Data frames only
+// need their header; the rest are copied up to FRAME_RING_MAX_FRAME.
+static void hand_off(radio_t *radio, const frame_rec_t *f, const uint8_t *frame, const ieee80211_hdr_t *wifi,
+                     uint8_t type, uint8_t subtype) {
+    sniffer_t *sniffer = radio->sniffer;
+    const uint8_t *mac = shard_mac(wifi, type, subtype);
+    if (!mac) return;
+
+    worker_t *worker = &sniffer->workers[mac_worker(mac, sniffer->num_workers)];
+    frame_ring_t *ring = &worker->rings[radio->id];
+
+    size_t copy = type == IEEE80211_FTYPE_DATA ? sizeof(ieee80211_hdr_t) : f->captured;
+    if (copy > FRAME_RING_MAX_FRAME) copy = FRAME_RING_MAX_FRAME;
+
+    // Live capture never waits: a full ring drops the frame and counts it
+    frame_rec_t *slot = frame_ring_reserve(ring, copy, !sniffer->backpressure);
+    while (!slot && sniffer->backpressure && atomic_load_explicit(&worker->running, memory_order_relaxed)) {
+        sched_yield();
+        slot = frame_ring_reserve(ring, copy, false);
+    }
+    if (!slot) return;
+
+    *slot = *f;
+    slot->captured = (uint16_t)copy;
+    memcpy(slot + 1, frame, copy);
+    frame_ring_commit(ring);
+}
+
+static void handle_frame(radio_t *radio, const struct pcap_pkthdr *header, const u_char *packet) {
+    sniffer_t *sniffer = radio->sniffer;
+    radio_telemetry_t *t = &radio->telemetry;
+
+    radiotap_info_t rt;
+    if (radiotap_parse(packet, header->caplen, &rt) != 0) {
+        telemetry_add(&t->malformed, 1);
+        return;
+    }
+
+    // Corrupt frames carry garbage addresses, so drop them before any table sees them
+    if (radiotap_bad_fcs(&rt)) {
+        telemetry_add(&t->bad_fcs, 1);
+        return;
+    }
+
+    if (header->caplen < rt.len + sizeof(ieee80211_hdr_t)) {
+        telemetry_add(&t->malformed, 1);
+        return;
+    }
+
+    // Strip a trailing FCS from the frame, if the capture kept it
+    uint32_t fcs_len = radiotap_fcs_len(&rt);
+    uint32_t frame_len = header->len - rt.len;
+    uint32_t captured = header->caplen - rt.len;
+    if (frame_len < sizeof(ieee80211_hdr_t) + fcs_len) {
+        telemetry_add(&t->malformed, 1);
+        return;
+    }
+    frame_len -= fcs_len;
+    if (captured > frame_len) captured = frame_len;
+    if (captured >= FRAME_RING_WRAP) captured = FRAME_RING_WRAP - 1;
+
+    frame_rec_t f = {
+        .ts_us = (uint64_t)header->ts.tv_sec * 1000000 + header->ts.tv_usec,
+        .frame_len = frame_len,
+        .captured = (uint16_t)captured,
+        .rx_channel = (int16_t)((rt.has & RADIOTAP_HAS_FREQ) ? radiotap_freq_to_channel(rt.freq_mhz) : 0),
+        .rssi = (rt.has & RADIOTAP_HAS_SIGNAL) ? rt.signal_dbm : -100,
+        .weight = 1,
+    };
+
+    const uint8_t *frame = packet + rt.len;
+    const ieee80211_hdr_t *wifi = (const ieee80211_hdr_t *)frame;
+
+    hop_sched_record(&radio->hop_sched, f.rx_channel, wifi->addr2);
+
+    uint8_t type = (wifi->fc[0] >> 2) & 0x03;
+    uint8_t subtype = (wifi->fc[0] >> 4) & 0x0F;
+    telemetry_add(&t->frames[type][subtype], 1);
+
+    // Capture policies shed load here, before any element is parsed or
+    // table touched; a kept frame carries the count it stands for
+    int cls = frame_filter_index(type, subtype);
+    if (cls >= 0 && radio->policer.active) {
+        f.weight = frame_policer_admit(&radio->policer, cls, shard_mac(wifi, type, subtype), f.ts_us);
+        if (f.weight == 0) {
+            telemetry_add(&t->shed[cls], 1);
+            return;
+        }
+    }
+
+    if (sniffer->num_workers > 0) {
+        hand_off(radio, &f, frame, wifi, type, subtype);
+    } else {
+        packet_handler_process(sniffer, &sniffer->shards[0], radio->id, &f, frame);
+    }
+}
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void packet_handler(u_char *args, const struct pcap_pkthdr *header, const u_char *packet) {
+    radio_t *radio = (radio_t *)args;
+
+    radio->packets++;
+    telemetry_add(&radio->telemetry.bytes, header->len);
+
+    // Timing every frame would cost two clock reads per frame
+    if (radio->packets % TELEMETRY_FRAME_SAMPLE != 0) {
+        handle_frame(radio, header, packet);
+        return;
+    }
+
+    uint64_t started = monotonic_ns();
+    handle_frame(radio, header, packet);
+    telemetry_hist_record(&radio->telemetry.frame_ns, monotonic_ns() - started);
+}
@@ -4,6 +4,14 @@
 #include <pcap.h>
 #include "sniffer.h"
 
+// pcap callback; args is the radio_t. Classifies the frame, then handles
+// it in place or hands it to the worker that owns its MAC.
 void packet_handler(u_char *args, const struct pcap_pkthdr *header, const u_char *packet);
+// Runs the frame handlers against one shard, emitting as producer
+void packet_handler_process(sniffer_t *sniffer, shard_t *shard, int producer, const frame_rec_t *f,
+                            const uint8_t *frame);
+// Emit everything still held in the shards' aggregation tables; call once
+// the capture and worker threads have stopped
+void packet_handler_flush(sniffer_t *sniffer, uint64_t now_ms);
 
 #endif
@@ -0,0 +1,208 @@
+#include "radiotap.h"
+#include <string.h>
+
+#define RADIOTAP_MAX_PRESENT_WORDS 16
+
+// Alignment and size of each default-namespace field, indexed by bit.
+// A zero size means the field is not defined here and parsing must stop.
+static const struct {
+    uint8_t align;
+    uint8_t size;
+} field_layout[] = {
+    [RADIOTAP_TSFT] = {8, 8},
+    [RADIOTAP_FLAGS] = {1, 1},
+    [RADIOTAP_RATE] = {1, 1},
+    [RADIOTAP_CHANNEL] = {2, 4},
+    [RADIOTAP_FHSS] = {1, 2},
+    [RADIOTAP_DBM_ANTSIGNAL] = {1, 1},
+    [RADIOTAP_DBM_ANTNOISE] = {1, 1},
+    [7] = {2, 2},                       // Lock quality
+    [8] = {2, 2},                       // TX attenuation
+    [9] = {2, 2},                       // dB TX attenuation
+    [10] = {1, 1},                      // dBm TX power
+    [RADIOTAP_ANTENNA] = {1, 1},
+    [12] = {1, 1},                      // dB antenna signal
+    [13] = {1, 1},                      // dB antenna noise
+    [14] = {2, 2},                      // RX flags
+    [15] = {2, 2},                      // TX flags
+    [16] = {1, 1},                      // RTS retries
+    [17] = {1, 1},                      // Data retries
+    [RADIOTAP_XCHANNEL] = {4, 8},
+    [RADIOTAP_MCS] = {1, 3},
+    [20] = {4, 8},                      // A-MPDU status
+    [21] = {2, 12},                     // VHT
+    [22] = {8, 12},                     // Timestamp
+    [23] = {2, 12},                     // HE
+    [24] = {2, 12},                     // HE-MU
+    [25] = {2, 6},                      // HE-MU other user
+    [26] = {1, 1},                      // 0-length PSDU
+    [27] = {2, 4},                      // L-SIG
+};
+
+#define FIELD_COUNT (sizeof(field_layout) / sizeof(field_layout[0]))
+
+static inline uint16_t get_le16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t get_le64(const uint8_t *p) {
+    return (uint64_t)get_le32(p) | ((uint64_t)get_le32(p + 4) << 32);
+}
+
+// Signal and antenna fields seen in the current present word
+typedef struct {
+    bool has_signal;
+    bool has_antenna;
+    int8_t signal;
+    uint8_t antenna;
+} word_state_t;
+
+static void store_field(radiotap_info_t *info, int field, const uint8_t *p, word_state_t *word) {
+    switch (field) {
+        case RADIOTAP_TSFT:
+            info->tsft = get_le64(p);
+            info->has |= RADIOTAP_HAS_TSFT;
+            break;
+        case RADIOTAP_FLAGS:
+            info->flags = p[0];
+            info->has |= RADIOTAP_HAS_FLAGS;
+            break;
+        case RADIOTAP_RATE:
+            info->rate = p[0];
+            info->has |= RADIOTAP_HAS_RATE;
+            break;
+        case RADIOTAP_CHANNEL:
+            info->freq_mhz = get_le16(p);
+            info->chan_flags = get_le16(p + 2);
+            info->has |= RADIOTAP_HAS_FREQ;
+            break;
+        case RADIOTAP_XCHANNEL:
+            // Only used when the plain channel field is absent
+            if (!(info->has & RADIOTAP_HAS_FREQ)) {
+                info->freq_mhz = get_le16(p + 4);
+                info->has |= RADIOTAP_HAS_FREQ;
+            }
+            break;
+        case RADIOTAP_DBM_ANTSIGNAL:
+            word->signal = (int8_t)p[0];
+            word->has_signal = true;
+            break;
+        case RADIOTAP_DBM_ANTNOISE:
+            info->noise_dbm = (int8_t)p[0];
+            info->has |= RADIOTAP_HAS_NOISE;
+            break;
+        case RADIOTAP_ANTENNA:
+            word->antenna = p[0];
+            word->has_antenna = true;
+            break;
+        case RADIOTAP_MCS:
+            if (p[0] & 0x02) {   // MCS index known
+                info->mcs = p[2];
+                info->has |= RADIOTAP_HAS_MCS;
+            }
+            break;
+    }
+}
+
+// Per-chain reports without a combined value: use the strongest chain
+static int parse_done(radiotap_info_t *info) {
+    if (info->num_antennas > 0 && !(info->has & RADIOTAP_HAS_SIGNAL)) {
+        info->signal_dbm = info->antenna_signal[0];
+        for (int i = 1; i < info->num_antennas; i++) {
+            if (info->antenna_signal[i] > info->signal_dbm) info->signal_dbm = info->antenna_signal[i];
+        }
+        info->has |= RADIOTAP_HAS_SIGNAL;
+    }
+    return 0;
+}
+
+int radiotap_parse(const uint8_t *buf, uint32_t caplen, radiotap_info_t *info) {
+    memset(info, 0, sizeof(*info));
+
+    if (caplen < 8 || buf[0] != 0) return -1;
+
+    uint16_t len = get_le16(buf + 2);
+    if (len < 8 || len > caplen) return -1;
+    info->len = len;
+
+    // Present bitmaps chain while bit 31 is set
+    uint32_t present[RADIOTAP_MAX_PRESENT_WORDS];
+    int num_words = 0;
+    uint32_t off = 4;
+    do {
+        if (off + 4 > len || num_words == RADIOTAP_MAX_PRESENT_WORDS) return -1;
+        present[num_words++] = get_le32(buf + off);
+        off += 4;
+    } while (present[num_words - 1] & (1u << RADIOTAP_EXT));
+
+    bool vendor_ns = false;
+    uint32_t vendor_skip = 0;
+    int bit_base = 0;   // Default-namespace index of bit 0 in this word
+
+    for (int w = 0; w < num_words; w++) {
+        uint32_t bits = present[w];
+        word_state_t word = {0};
+
+        if (vendor_ns) {
+            // Vendor fields are opaque; skip_length covers all of them, in
+            // however many present words the namespace spans
+            if (off + vendor_skip > len) return parse_done(info);
+            off += vendor_skip;
+            vendor_skip = 0;
+        } else {
+            uint32_t fields = bits & ((1u << RADIOTAP_RADIOTAP_NAMESPACE) - 1);
+            while (fields) {
+                int bit = __builtin_ctz(fields);
+                int field = bit_base + bit;
+                fields &= fields - 1;
+
+                if (field == RADIOTAP_TLV || (size_t)field >= FIELD_COUNT || field_layout[field].size == 0) {
+                    // Unknown size: nothing after this point can be located
+                    return parse_done(info);
+                }
+
+                uint32_t align = field_layout[field].align;
+                off = (off + align - 1) & ~(align - 1);
+                if (off + field_layout[field].size > len) return parse_done(info);
+
+                store_field(info, field, buf + off, &word);
+                off += field_layout[field].size;
+            }
+        }
+
+        // A signal paired with an antenna index is one chain; a bare one
+        // is the combined signal
+        if (word.has_signal && word.has_antenna) {
+            if (info->num_antennas < RADIOTAP_MAX_ANTENNAS) {
+                info->antenna[info->num_antennas] = word.antenna;
+                info->antenna_signal[info->num_antennas] = word.signal;
+                info->num_antennas++;
+            }
+        } else if (word.has_signal && !(info->has & RADIOTAP_HAS_SIGNAL)) {
+            info->signal_dbm = word.signal;
+            info->has |= RADIOTAP_HAS_SIGNAL;
+        }
+
+        // The namespace bits pick how the next word is interpreted
+        if (bits & (1u << RADIOTAP_VENDOR_NAMESPACE)) {
+            // OUI[3], sub-namespace, skip_length (le16), 2-byte aligned
+            off = (off + 1) & ~1u;
+            if (off + 6 > len) return parse_done(info);
+            vendor_skip = get_le16(buf + off + 4);
+            off += 6;
+            vendor_ns = true;
+            bit_base = 0;
+        } else if (bits & (1u << RADIOTAP_RADIOTAP_NAMESPACE)) {
+            vendor_ns = false;
+            bit_base = 0;
+        } else {
+            bit_base += 32;
+        }
+    }
+
+    return parse_done(info);
+}
@@ -0,0 +1,80 @@
+#ifndef RADIOTAP_H
+#define RADIOTAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Radiotap field indexes in the default namespace
+enum {
+    RADIOTAP_TSFT = 0,
+    RADIOTAP_FLAGS = 1,
+    RADIOTAP_RATE = 2,
+    RADIOTAP_CHANNEL = 3,
+    RADIOTAP_FHSS = 4,
+    RADIOTAP_DBM_ANTSIGNAL = 5,
+    RADIOTAP_DBM_ANTNOISE = 6,
+    RADIOTAP_ANTENNA = 11,
+    RADIOTAP_XCHANNEL = 18,
+    RADIOTAP_MCS = 19,
+    RADIOTAP_TLV = 28,
+    RADIOTAP_RADIOTAP_NAMESPACE = 29,
+    RADIOTAP_VENDOR_NAMESPACE = 30,
+    RADIOTAP_EXT = 31,
+};
+
+// Bits of the Flags field
+#define RADIOTAP_F_DATAPAD  0x20   // 802.11 header is padded to 32 bits
+#define RADIOTAP_F_FCS      0x10   // Frame ends with a 4-byte FCS
+#define RADIOTAP_F_BADFCS   0x40   // FCS check failed
+
+// Which radiotap_info_t members were filled in
+#define RADIOTAP_HAS_TSFT     (1u << 0)
+#define RADIOTAP_HAS_FLAGS    (1u << 1)
+#define RADIOTAP_HAS_RATE     (1u << 2)
+#define RADIOTAP_HAS_FREQ     (1u << 3)
+#define RADIOTAP_HAS_SIGNAL   (1u << 4)
+#define RADIOTAP_HAS_NOISE    (1u << 5)
+#define RADIOTAP_HAS_MCS      (1u << 6)
+
+#define RADIOTAP_MAX_ANTENNAS 4
+
+typedef struct {
+    uint16_t len;              // Header length; the 802.11 frame starts here
+    uint32_t has;              // RADIOTAP_HAS_* bits
+    uint64_t tsft;
+    uint8_t flags;
+    uint8_t rate;              // Legacy rate in 500 kbps units
+    uint16_t freq_mhz;
+    uint16_t chan_flags;
+    int8_t signal_dbm;         // Combined signal, or the strongest chain
+    int8_t noise_dbm;
+    uint8_t mcs;
+    uint8_t num_antennas;
+    uint8_t antenna[RADIOTAP_MAX_ANTENNAS];        // Antenna index per chain
+    int8_t antenna_signal[RADIOTAP_MAX_ANTENNAS];  // dBm per chain
+} radiotap_info_t;
+
+// Walk the radiotap header in buf in one pass. Returns 0 on success and -1
+// if the header is truncated or malformed. Fields after one the parser
+// does not know the size of are left unset, as the spec requires.
+int radiotap_parse(const uint8_t *buf, uint32_t caplen, radiotap_info_t *info);
+
+static inline bool radiotap_bad_fcs(const radiotap_info_t *info) {
+    return (info->has & RADIOTAP_HAS_FLAGS) && (info->flags & RADIOTAP_F_BADFCS);
+}
+
+// Bytes of trailing FCS included in the captured frame
+static inline uint32_t radiotap_fcs_len(const radiotap_info_t *info) {
+    return ((info->has & RADIOTAP_HAS_FLAGS) && (info->flags & RADIOTAP_F_FCS)) ? 4 : 0;
+}
+
+// 802.11 channel number for a centre frequency, 0 if unknown
+static inline int radiotap_freq_to_channel(uint16_t freq_mhz) {
+    if (freq_mhz == 2484) return 14;
+    if (freq_mhz >= 2412 && freq_mhz <= 2472) return (freq_mhz - 2407) / 5;
+    if (freq_mhz >= 5955 && freq_mhz <= 7115) return (freq_mhz - 5950) / 5;
+    if (freq_mhz >= 5000 && freq_mhz <= 5925) return (freq_mhz - 5000) / 5;
+    return 0;
+}
+
+#endif
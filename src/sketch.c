@@ -0,0 +1,160 @@
+#include "sketch.h"
+#include <string.h>
+
+uint64_t sketch_hash(const void *data, size_t len) {
+    const uint8_t *p = data;
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 0x100000001B3ULL;
+    }
+
+    // FNV alone leaves the top bits, which pick the HLL register, poorly mixed
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+void probe_sketch_reset(probe_sketch_t *s, uint64_t start_us) {
+    memset(s, 0, sizeof(*s));
+    s->start_us = start_us;
+}
+
+static void hll_add(uint8_t *registers, uint64_t h) {
+    uint32_t idx = (uint32_t)(h >> (64 - SKETCH_HLL_P));
+    uint64_t w = h << SKETCH_HLL_P;
+    uint8_t rank = w ? (uint8_t)(__builtin_clzll(w) + 1) : (uint8_t)(64 - SKETCH_HLL_P + 1);
+    if (rank > registers[idx]) registers[idx] = rank;
+}
+
+// Counter indexes come from two halves of one hash (Kirsch-Mitzenmacher)
+static uint32_t cms_add(probe_sketch_t *s, uint64_t h, uint32_t n) {
+    uint32_t h1 = (uint32_t)h;
+    uint32_t h2 = (uint32_t)(h >> 32) | 1;
+    uint32_t est = UINT32_MAX;
+
+    for (uint32_t row = 0; row < SKETCH_CMS_DEPTH; row++) {
+        uint32_t *c = &s->cms[row][(h1 + row * h2) & (SKETCH_CMS_WIDTH - 1)];
+        *c = *c > UINT32_MAX - n ? UINT32_MAX : *c + n;
+        if (*c < est) est = *c;
+    }
+    return est;
+}
+
+// Keep the K SSIDs with the highest estimates; a newcomer only displaces
+// the current minimum
+static void topk_offer(probe_sketch_t *s, const char *ssid, uint32_t est) {
+    int min = -1;
+    for (int i = 0; i < s->num_topk; i++) {
+        if (strcmp(s->topk[i].ssid, ssid) == 0) {
+            s->topk[i].count = est;
+            return;
+        }
+        if (min < 0 || s->topk[i].count < s->topk[min].count) min = i;
+    }
+
+    int slot;
+    if (s->num_topk < SKETCH_TOPK) {
+        slot = s->num_topk++;
+    } else if (est > s->topk[min].count) {
+        slot = min;
+    } else {
+        return;
+    }
+    strncpy(s->topk[slot].ssid, ssid, sizeof(s->topk[slot].ssid) - 1);
+    s->topk[slot].ssid[sizeof(s->topk[slot].ssid) - 1] = '\0';
+    s->topk[slot].count = est;
+}
+
+void probe_sketch_add(probe_sketch_t *s, const uint8_t *mac, const char *ssid, uint32_t weight) {
+    s->probes += weight;
+
+    uint64_t h = sketch_hash(mac, 6);
+    hll_add(s->hll_all, h);
+    // Randomized MACs set the locally administered bit and change per scan
+    if (!(mac[0] & 0x02)) {
+        hll_add(s->hll_global, h);
+    }
+
+    // Broadcast probes carry no SSID
+    if (ssid && ssid[0]) {
+        size_t len = strnlen(ssid, 32);
+        topk_offer(s, ssid, cms_add(s, sketch_hash(ssid, len), weight));
+    }
+}
+
+bool probe_sketch_maybe_ship(probe_sketch_t *s, sketch_outbox_t *box, uint64_t now_us, uint64_t interval_us,
+                             bool force) {
+    if (s->start_us == 0) {
+        s->start_us = now_us;
+        return false;
+    }
+    if (!force && (now_us < s->start_us || now_us - s->start_us < interval_us)) return false;
+
+    if (s->probes == 0) {
+        s->start_us = now_us;
+        return false;
+    }
+    if (atomic_load_explicit(&box->full, memory_order_acquire)) return false;
+
+    box->sketch = *s;
+    box->sketch.end_us = now_us;
+    atomic_store_explicit(&box->full, true, memory_order_release);
+    probe_sketch_reset(s, now_us);
+    return true;
+}
+
+static inline void put_u16le(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_u32le(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline void put_u64le(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+size_t probe_sketch_encode(const probe_sketch_t *s, uint8_t *out, size_t cap) {
+    if (cap < SKETCH_WIRE_MAX_LEN) return 0;
+
+    memcpy(out, SKETCH_WIRE_MAGIC, 3);
+    out[3] = SKETCH_WIRE_VERSION;
+    out[4] = SKETCH_HLL_P;
+    out[5] = SKETCH_CMS_DEPTH;
+    put_u16le(out + 6, SKETCH_CMS_WIDTH);
+    put_u64le(out + 8, s->start_us);
+    put_u64le(out + 16, s->end_us);
+    put_u32le(out + 24, s->probes);
+    put_u16le(out + 28, (uint16_t)s->num_topk);
+    put_u16le(out + 30, 0);
+
+    uint8_t *p = out + SKETCH_WIRE_HEADER_LEN;
+    memcpy(p, s->hll_all, SKETCH_HLL_REGISTERS);
+    p += SKETCH_HLL_REGISTERS;
+    memcpy(p, s->hll_global, SKETCH_HLL_REGISTERS);
+    p += SKETCH_HLL_REGISTERS;
+
+    for (int row = 0; row < SKETCH_CMS_DEPTH; row++) {
+        for (int col = 0; col < SKETCH_CMS_WIDTH; col++) {
+            put_u32le(p, s->cms[row][col]);
+            p += 4;
+        }
+    }
+
+    for (int i = 0; i < s->num_topk; i++) {
+        size_t len = strnlen(s->topk[i].ssid, 32);
+        *p++ = (uint8_t)len;
+        memcpy(p, s->topk[i].ssid, len);
+        p += len;
+        put_u32le(p, s->topk[i].count);
+        p += 4;
+    }
+
+    return (size_t)(p - out);
+}
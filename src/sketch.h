@@ -0,0 +1,76 @@
+#ifndef SKETCH_H
+#define SKETCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define SKETCH_HLL_P 12                          // 4096 registers, ~1.6% standard error
+#define SKETCH_HLL_REGISTERS (1u << SKETCH_HLL_P)
+#define SKETCH_CMS_DEPTH 4
+#define SKETCH_CMS_WIDTH 1024                    // Power of two
+#define SKETCH_TOPK 32
+#define SKETCH_DEFAULT_INTERVAL_S 60
+
+// Binary /ingest/sketch body (Content-Type: application/octet-stream).
+// Little-endian; the API decoder lives in api/sketch.go.
+//   header (32 bytes):
+//     0  "FLS"   3  u8 version   4  u8 hll_p   5  u8 cms_depth
+//     6  u16 cms_width           8  u64 start_us   16 u64 end_us
+//     24 u32 probes              28 u16 num_topk   30 reserved
+//   hll_all[registers], hll_global[registers]
+//   cms: depth * width u32, row-major
+//   num_topk x { u8 ssid_len, ssid bytes, u32 count }
+#define SKETCH_WIRE_MAGIC "FLS"
+#define SKETCH_WIRE_VERSION 1
+#define SKETCH_WIRE_HEADER_LEN 32
+#define SKETCH_WIRE_MAX_LEN (SKETCH_WIRE_HEADER_LEN + 2 * SKETCH_HLL_REGISTERS + \
+                             SKETCH_CMS_DEPTH * SKETCH_CMS_WIDTH * 4 + SKETCH_TOPK * (1 + 32 + 4))
+
+typedef struct {
+    char ssid[33];
+    uint32_t count;            // Count-Min estimate
+} sketch_ssid_t;
+
+// One interval of probe requests: HyperLogLogs of the probing MACs, one
+// over all of them and one over globally administered (non-randomized)
+// addresses only, plus a Count-Min sketch and top-K of probed SSIDs.
+// Every part merges by register max / counter sum, so the API can combine
+// intervals and sniffers into any tier without seeing individual events.
+typedef struct {
+    uint64_t start_us;
+    uint64_t end_us;
+    uint32_t probes;
+    uint8_t hll_all[SKETCH_HLL_REGISTERS];
+    uint8_t hll_global[SKETCH_HLL_REGISTERS];
+    uint32_t cms[SKETCH_CMS_DEPTH][SKETCH_CMS_WIDTH];
+    sketch_ssid_t topk[SKETCH_TOPK];
+    int num_topk;
+} probe_sketch_t;
+
+// Single-slot hand-off from the capture side to the uploader that posts
+// sketches: the capture side only fills it while full is false, the
+// uploader clears full once it has encoded the sketch.
+typedef struct {
+    probe_sketch_t sketch;
+    atomic_bool full;
+} sketch_outbox_t;
+
+// 64-bit FNV-1a with a murmur3 finalizer; api/sketch.go must match it
+uint64_t sketch_hash(const void *data, size_t len);
+
+void probe_sketch_reset(probe_sketch_t *s, uint64_t start_us);
+// Counts a probe request standing for weight probes (see frame_policy.h)
+void probe_sketch_add(probe_sketch_t *s, const uint8_t *mac, const char *ssid, uint32_t weight);
+
+// Moves the sketch to the outbox once interval_us has passed (or at once
+// if force) and starts a new interval. If the outbox is still taken the
+// interval is simply extended. Returns true if a sketch was handed off.
+bool probe_sketch_maybe_ship(probe_sketch_t *s, sketch_outbox_t *box, uint64_t now_us, uint64_t interval_us,
+                             bool force);
+
+// Returns the encoded length, or 0 if out is too small
+size_t probe_sketch_encode(const probe_sketch_t *s, uint8_t *out, size_t cap);
+
+#endif
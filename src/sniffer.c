@@ -1,225 +1,1102 @@
+#define _GNU_SOURCE
 #include "sniffer.h"
 #include "packet_handler.h"
+#include "frame_filter.h"
+#include "nl80211.h"
+#include "alloc_stats.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <sched.h>
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <time.h>
-#include <curl/curl.h>
 
-static void set_channel(const char *interface, int channel) {
+static void set_channel_iw(const char *interface, int channel) {
     char cmd[256];
     snprintf(cmd, sizeof(cmd), "iw dev %s set channel %d 2>/dev/null", interface, channel);
     system(cmd);
 }
 
-// Buffer to store API response
-struct curl_response {
-    char *data;
-    size_t size;
-};
+static uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
 
-static size_t config_write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
-    size_t realsize = size * nmemb;
-    struct curl_response *mem = (struct curl_response *)userp;
+static inline uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
 
-    char *ptr = realloc(mem->data, mem->size + realsize + 1);
-    if (!ptr) {
-        fprintf(stderr, "Not enough memory for config response\n");
-        return 0;
+// Sleep until an absolute CLOCK_MONOTONIC time; a signal only cuts it
+// short once the sniffer is stopping
+static void sleep_until_ns(sniffer_t *sniffer, uint64_t due_ns) {
+    struct timespec ts = {(time_t)(due_ns / 1000000000ull), (long)(due_ns % 1000000000ull)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR && sniffer->running) {
     }
+}
+
+static void set_channel(radio_t *radio, int channel) {
+    radio_telemetry_t *t = &radio->telemetry;
+    uint64_t started = monotonic_us();
 
-    mem->data = ptr;
-    memcpy(&(mem->data[mem->size]), contents, realsize);
-    mem->size += realsize;
-    mem->data[mem->size] = 0;
+    radio->current_channel = channel;
+    telemetry_set(&t->channel, (uint64_t)channel);
+    telemetry_add(&t->channel_switches, 1);
 
-    return realsize;
+    if (radio->nl.fd >= 0) {
+        int ret = nl80211_set_channel(&radio->nl, channel);
+        if (ret == 0) {
+            telemetry_hist_record(&t->channel_switch_us, monotonic_us() - started);
+            return;
+        }
+
+        telemetry_add(&t->channel_switch_failures, 1);
+        // Busy or unsupported channels fail per call; log the first few only
+        if (radio->nl_errors++ < 5) {
+            fprintf(stderr, "%s: nl80211 set channel %d failed: %s, using iw\n",
+                    radio->interface, channel, strerror(-ret));
+        }
+    }
+    set_channel_iw(radio->interface, channel);
+    telemetry_hist_record(&t->channel_switch_us, monotonic_us() - started);
 }
 
-// Read channel hopping config from API
-static void read_config(sniffer_t *sniffer) {
-    CURL *curl = curl_easy_init();
-    if (!curl) {
-        fprintf(stderr, "Failed to init curl for config fetch\n");
-        sniffer->hopping_enabled = true;
-        sniffer->hopping_timeout_ms = 300;
-        return;
+// Copy the shared config if it moved on since the last look; a
+// command-line channel plan overrides its list. Returns true if the
+// channel list changed.
+static bool sync_config(radio_t *radio) {
+    config_watcher_t *config = &radio->sniffer->config;
+    if (config_watcher_generation(config) == radio->config_generation) {
+        return false;
+    }
+
+    hop_config_t cfg;
+    radio->config_generation = config_watcher_get(config, &cfg);
+    radio->hopping_enabled = cfg.enabled;
+    radio->hopping_timeout_ms = cfg.timeout_ms;
+    radio->hopping_mode = cfg.mode;
+
+    const int *channels = cfg.channels;
+    int num_channels = cfg.num_channels;
+    if (radio->num_plan_channels > 0) {
+        channels = radio->plan_channels;
+        num_channels = radio->num_plan_channels;
+    }
+
+    bool changed = num_channels != radio->num_channels ||
+                   memcmp(channels, radio->channels, sizeof(int) * num_channels) != 0;
+    memcpy(radio->channels, channels, sizeof(int) * num_channels);
+    radio->num_channels = num_channels;
+    return changed;
+}
+
+// Sleep out a dwell that started at *deadline_ns and move the deadline
+// to its end. Deadlines are absolute, so the time spent switching
+// channels and waking up comes out of the dwell instead of adding to it
+// and every cycle takes the configured time. A hopper that fell behind
+// by a whole dwell (a stall, a slow iw) starts over from now rather than
+// hopping back to back to catch up.
+static void sleep_dwell(radio_t *radio, uint64_t *deadline_ns, int dwell_ms) {
+    uint64_t due = *deadline_ns + (uint64_t)dwell_ms * 1000000;
+    uint64_t now = monotonic_ns();
+    if (due < now) {
+        due = now + (uint64_t)dwell_ms * 1000000;
+    }
+
+    sleep_until_ns(radio->sniffer, due);
+    now = monotonic_ns();
+    telemetry_hist_record(&radio->telemetry.hop_late_us, now > due ? (now - due) / 1000 : 0);
+    *deadline_ns = due;
+}
+
+// Scheduling for the hoppers and, with pin_io, their CPUs
+static void place_hopper(radio_t *radio) {
+    sniffer_t *sniffer = radio->sniffer;
+    if (sniffer->pin_io && cpu_pin_thread(pthread_self(), &sniffer->io_cpus) != 0) {
+        fprintf(stderr, "Could not pin channel hopper for %s\n", radio->interface);
+    }
+    if (sniffer->rt_priority > 0) {
+        int ret = cpu_set_fifo(pthread_self(), sniffer->rt_priority);
+        if (ret != 0) {
+            fprintf(stderr, "%s: channel hopper keeps normal scheduling: %s\n", radio->interface, strerror(ret));
+        }
+    }
+}
+
+static void* channel_hopper(void *arg) {
+    radio_t *radio = (radio_t *)arg;
+    sniffer_t *sniffer = radio->sniffer;
+    int idx = 0;
+
+    char name[32];
+    snprintf(name, sizeof(name), "hop-%s", radio->interface);
+    alloc_stats_register(name);
+    place_hopper(radio);
+    printf("Channel hopping thread started for %s\n", radio->interface);
+
+    uint64_t deadline = monotonic_ns();
+
+    while (sniffer->running) {
+        // The config thread does the fetching; this is only a counter check.
+        // Reset index and learned activity if the channel list changed.
+        if (sync_config(radio)) {
+            idx = 0;
+            hop_sched_reset(&radio->hop_sched);
+        }
+
+        int dwell_ms = radio->hopping_timeout_ms;
+
+        // Only hop if enabled and we have channels
+        if (radio->hopping_enabled && radio->num_channels > 0) {
+            int channel = radio->channels[idx];
+            if (radio->hopping_mode == HOP_MODE_ADAPTIVE) {
+                dwell_ms = hop_sched_dwell_ms(&radio->hop_sched, idx, radio->num_channels,
+                                              radio->hopping_timeout_ms);
+            }
+
+            // A single-channel plan parks the radio; only retune if it moved
+            if (radio->num_channels > 1 || radio->current_channel != channel) {
+                set_channel(radio, channel);
+            }
+
+            // Activity is scored in round-robin mode too, so switching to
+            // adaptive starts from warm weights
+            hop_sched_begin(&radio->hop_sched, channel);
+            sleep_dwell(radio, &deadline, dwell_ms);
+            hop_sched_end(&radio->hop_sched, idx, channel, dwell_ms);
+
+            idx = (idx + 1) % radio->num_channels;
+            continue;
+        }
+
+        // Check the config again after the configured timeout
+        sleep_dwell(radio, &deadline, dwell_ms);
+    }
+
+    return NULL;
+}
+
+void sniffer_opts_init(sniffer_opts_t *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->radios[0].interface = "wlan0";
+    opts->num_radios = 1;
+    opts->api_url = "http://127.0.0.1:8080";
+    opts->num_uploaders = SNIFFER_DEFAULT_UPLOADERS;
+    opts->queue_capacity = EVENT_QUEUE_DEFAULT_CAPACITY;
+    opts->batch_size = HTTP_BATCH_DEFAULT_MAX_EVENTS;
+    opts->batch_flush_ms = HTTP_BATCH_DEFAULT_FLUSH_MS;
+    opts->ap_rssi_hysteresis = AP_CACHE_DEFAULT_HYSTERESIS_DB;
+    opts->ap_heartbeat_s = AP_CACHE_DEFAULT_HEARTBEAT_S;
+    opts->data_interval_s = DATA_AGG_DEFAULT_INTERVAL_S;
+    opts->capture_backend = CAPTURE_LIVE;
+    opts->buffer_mb = SNIFFER_DEFAULT_BUFFER_MB;
+    opts->wire_format = HTTP_WIRE_JSON;
+    opts->compression = HTTP_COMPRESS_DEFLATE;
+    opts->spool_mb = SPOOL_DEFAULT_MB;
+    opts->sketch_interval_s = SKETCH_DEFAULT_INTERVAL_S;
+    opts->worker_ring_bytes = FRAME_RING_DEFAULT_BYTES;
+    opts->replay_rate = 1.0;
+}
+
+static int init_shard(shard_t *shard, const sniffer_opts_t *opts) {
+    if (ap_cache_init(&shard->ap_cache, opts->ap_rssi_hysteresis, opts->ap_heartbeat_s) != 0) {
+        fprintf(stderr, "Failed to allocate AP cache\n");
+        return -1;
+    }
+    if (data_agg_init(&shard->data_agg, opts->data_interval_s) != 0) {
+        fprintf(stderr, "Failed to allocate data frame aggregation table\n");
+        ap_cache_destroy(&shard->ap_cache);
+        return -1;
+    }
+    if (station_table_init(&shard->stations) != 0) {
+        fprintf(stderr, "Failed to allocate station table\n");
+        data_agg_destroy(&shard->data_agg);
+        ap_cache_destroy(&shard->ap_cache);
+        return -1;
+    }
+    probe_sketch_reset(&shard->sketch, 0);
+    atomic_init(&shard->sketch_outbox.full, false);
+    return 0;
+}
+
+static void destroy_shard(shard_t *shard) {
+    ap_cache_destroy(&shard->ap_cache);
+    data_agg_destroy(&shard->data_agg);
+    station_table_destroy(&shard->stations);
+}
+
+static void destroy_tables(sniffer_t *sniffer) {
+    for (int i = 0; i < sniffer->num_shards; i++) {
+        destroy_shard(&sniffer->shards[i]);
+    }
+    sniffer->num_shards = 0;
+    pthread_mutex_destroy(&sniffer->tables_lock);
+}
+
+// One shard inline, or one per worker
+static int init_tables(sniffer_t *sniffer, const sniffer_opts_t *opts) {
+    pthread_mutex_init(&sniffer->tables_lock, NULL);
+    int num_shards = sniffer->num_workers > 0 ? sniffer->num_workers : 1;
+    for (int i = 0; i < num_shards; i++) {
+        if (init_shard(&sniffer->shards[i], opts) != 0) {
+            destroy_tables(sniffer);
+            return -1;
+        }
+        sniffer->num_shards++;
+    }
+    sniffer->sketch_interval_us = opts->sketch_interval_s > 0 ? (uint64_t)opts->sketch_interval_s * 1000000 : 0;
+    return 0;
+}
+
+static void stop_uploaders(sniffer_t *sniffer) {
+    for (int i = 0; i < sniffer->num_uploaders; i++) {
+        uploader_stop(&sniffer->uploaders[i]);
+    }
+    sniffer->num_uploaders = 0;
+}
+
+static pcap_t *open_capture(const char *interface, const sniffer_opts_t *opts, char *errbuf) {
+    if (opts->capture_backend == CAPTURE_LIVE) {
+        return pcap_open_live(interface, BUFSIZ, 1, 1000, errbuf);
+    }
+
+    pcap_t *handle = pcap_create(interface, errbuf);
+    if (handle == NULL) {
+        return NULL;
+    }
+
+    int buffer_mb = opts->buffer_mb > 0 ? opts->buffer_mb : SNIFFER_DEFAULT_BUFFER_MB;
+
+    pcap_set_snaplen(handle, SNIFFER_MMAP_SNAPLEN);
+    pcap_set_promisc(handle, 1);
+    pcap_set_timeout(handle, SNIFFER_MMAP_TIMEOUT_MS);
+    // Immediate mode would wake the capture thread for every frame; with it
+    // off the kernel hands over whole ring blocks and pcap_dispatch walks
+    // them in place without copying
+    pcap_set_immediate_mode(handle, 0);
+    pcap_set_buffer_size(handle, buffer_mb * 1024 * 1024);
+
+    int status = pcap_activate(handle);
+    if (status < 0) {
+        snprintf(errbuf, PCAP_ERRBUF_SIZE, "%s (%s)", pcap_statustostr(status), pcap_geterr(handle));
+        pcap_close(handle);
+        return NULL;
+    }
+    if (status > 0) {
+        fprintf(stderr, "Warning opening %s: %s (%s)\n", interface,
+                pcap_statustostr(status), pcap_geterr(handle));
     }
 
-    char url[512];
-    snprintf(url, sizeof(url), "%s/config/channel-hopping", sniffer->api_url);
+    printf("Capture backend on %s: mmap ring, %d MB\n", interface, buffer_mb);
+    return handle;
+}
 
-    struct curl_response response = {0};
+// Print kernel and ring drop counters accumulated since the last report
+static void report_capture_stats(radio_t *radio, time_t now) {
+    struct pcap_stat stats;
+    if (sniffer_capture_stats(radio, &stats) != 0) {
+        return;
+    }
 
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, config_write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&response);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 5L);
+    // The counters are 32-bit and wrap; unsigned differences stay correct
+    printf("Capture %s: %u received, %u dropped (buffer full), %u dropped by interface in %lds\n",
+           radio->interface,
+           stats.ps_recv - radio->last_stats.ps_recv,
+           stats.ps_drop - radio->last_stats.ps_drop,
+           stats.ps_ifdrop - radio->last_stats.ps_ifdrop,
+           (long)(now - radio->last_stats_time));
+    // Once the tables have grown to the working set this should stay at 0
+    if (alloc_stats_enabled()) {
+        uint64_t allocs = alloc_stats_self();
+        printf("Capture %s: %llu heap allocations since the last report\n", radio->interface,
+               (unsigned long long)(allocs - radio->last_stats_allocs));
+        radio->last_stats_allocs = allocs;
+    }
+    radio->last_stats = stats;
+    radio->last_stats_time = now;
+}
 
-    CURLcode res = curl_easy_perform(curl);
+static void report_alloc_stats(void) {
+    if (!alloc_stats_enabled()) return;
+    for (int i = 0; i < alloc_stats_count(); i++) {
+        const alloc_thread_stats_t *t = alloc_stats_get(i);
+        printf("Heap allocations on %s: %llu (%.1f KB)\n", t->name,
+               (unsigned long long)atomic_load(&t->allocs), atomic_load(&t->bytes) / 1024.0);
+    }
+}
 
-    if (res != CURLE_OK) {
-        // Use defaults on error
-        sniffer->hopping_enabled = true;
-        sniffer->hopping_timeout_ms = 300;
-        curl_easy_cleanup(curl);
-        if (response.data) free(response.data);
+// pcap_stats counters are 32-bit; the telemetry totals are widened by
+// adding the unsigned difference to the previous reading
+static void update_kernel_telemetry(radio_t *radio) {
+    struct pcap_stat stats;
+    if (sniffer_capture_stats(radio, &stats) != 0) {
         return;
     }
 
-    // Simple JSON parsing - look for "enabled", "timeout_ms", and "channels" fields
-    if (response.data) {
-        char *enabled_ptr = strstr(response.data, "\"enabled\":");
-        if (enabled_ptr) {
-            enabled_ptr += 10; // Skip past "enabled":
-            while (*enabled_ptr == ' ') enabled_ptr++;
-            sniffer->hopping_enabled = (strncmp(enabled_ptr, "true", 4) == 0);
-        }
-
-        char *timeout_ptr = strstr(response.data, "\"timeout_ms\":");
-        if (timeout_ptr) {
-            timeout_ptr += 13; // Skip past "timeout_ms":
-            sniffer->hopping_timeout_ms = atoi(timeout_ptr);
-            if (sniffer->hopping_timeout_ms < 50) sniffer->hopping_timeout_ms = 50;
-            if (sniffer->hopping_timeout_ms > 10000) sniffer->hopping_timeout_ms = 10000;
-        }
-
-        // Parse channels array
-        char *channels_ptr = strstr(response.data, "\"channels\":");
-        if (channels_ptr) {
-            channels_ptr += 11; // Skip past "channels":
-            while (*channels_ptr == ' ') channels_ptr++;
-            if (*channels_ptr == '[') {
-                channels_ptr++; // Skip '['
-                sniffer->num_channels = 0;
-
-                while (*channels_ptr && *channels_ptr != ']' && sniffer->num_channels < 64) {
-                    while (*channels_ptr == ' ' || *channels_ptr == ',') channels_ptr++;
-                    if (*channels_ptr >= '0' && *channels_ptr <= '9') {
-                        int ch = atoi(channels_ptr);
-                        if (ch >= 1 && ch <= 165) {
-                            sniffer->channels[sniffer->num_channels++] = ch;
-                        }
-                        while (*channels_ptr >= '0' && *channels_ptr <= '9') channels_ptr++;
-                    } else {
-                        break;
-                    }
-                }
+    radio_telemetry_t *t = &radio->telemetry;
+    telemetry_add(&t->kernel_received, stats.ps_recv - radio->telemetry_stats.ps_recv);
+    telemetry_add(&t->kernel_dropped, stats.ps_drop - radio->telemetry_stats.ps_drop);
+    telemetry_add(&t->kernel_ifdropped, stats.ps_ifdrop - radio->telemetry_stats.ps_ifdrop);
+    radio->telemetry_stats = stats;
+}
+
+// Workers go on the cores after the capture threads', wrapping around
+static void pin_worker_thread(worker_t *worker) {
+    sniffer_t *sniffer = worker->sniffer;
+    if (!sniffer->pin_workers) return;
+
+    cpu_mask_t cpu = {0};
+    cpu_mask_set(&cpu, cpu_mask_nth(&sniffer->worker_cpus, worker->id));
+    if (cpu_pin_thread(pthread_self(), &cpu) != 0) {
+        fprintf(stderr, "Could not pin parse worker %d\n", worker->id);
+    }
+}
+
+static void *worker_thread(void *arg) {
+    worker_t *worker = (worker_t *)arg;
+    sniffer_t *sniffer = worker->sniffer;
+
+    char name[32];
+    snprintf(name, sizeof(name), "worker-%d", worker->id);
+    alloc_stats_register(name);
+    pin_worker_thread(worker);
+
+    for (;;) {
+        // Check before draining, so frames committed before a stop are still handled
+        bool running = atomic_load_explicit(&worker->running, memory_order_acquire);
+        int handled = 0;
+
+        for (int i = 0; i < worker->num_rings; i++) {
+            frame_ring_t *ring = &worker->rings[i];
+            const frame_rec_t *f;
+            for (int n = 0; n < SNIFFER_WORKER_BURST && (f = frame_ring_peek(ring)); n++) {
+                packet_handler_process(sniffer, worker->shard, worker->id, f, frame_rec_data(f));
+                frame_ring_release(ring);
+                handled++;
             }
         }
 
-        // If no channels parsed, use defaults
-        if (sniffer->num_channels == 0) {
-            int default_channels[] = {1, 6, 11, 2, 7, 3, 8, 4, 9, 5, 10};
-            sniffer->num_channels = 11;
-            memcpy(sniffer->channels, default_channels, sizeof(default_channels));
+        if (handled) {
+            telemetry_add(&worker->frames, handled);
+        } else if (!running) {
+            break;
+        } else {
+            usleep(SNIFFER_WORKER_IDLE_US);
         }
+    }
+    return NULL;
+}
 
-        free(response.data);
+static void stop_workers(sniffer_t *sniffer) {
+    for (int i = 0; i < sniffer->num_workers; i++) {
+        worker_t *worker = &sniffer->workers[i];
+        atomic_store_explicit(&worker->running, false, memory_order_release);
+        if (worker->started) {
+            pthread_join(worker->thread, NULL);
+            worker->started = false;
+        }
+        for (int j = 0; j < worker->num_rings; j++) {
+            frame_ring_destroy(&worker->rings[j]);
+        }
+        worker->num_rings = 0;
     }
+}
+
+// One ring per radio per worker keeps every ring single-producer
+static int start_workers(sniffer_t *sniffer, const sniffer_opts_t *opts) {
+    size_t ring_bytes = opts->worker_ring_bytes ? opts->worker_ring_bytes : FRAME_RING_DEFAULT_BYTES;
+
+    for (int i = 0; i < sniffer->num_workers; i++) {
+        worker_t *worker = &sniffer->workers[i];
+        worker->sniffer = sniffer;
+        worker->id = i;
+        worker->shard = &sniffer->shards[i];
+        atomic_init(&worker->running, true);
 
-    curl_easy_cleanup(curl);
+        for (int j = 0; j < sniffer->num_radios; j++) {
+            if (frame_ring_init(&worker->rings[j], ring_bytes) != 0) {
+                fprintf(stderr, "Failed to allocate frame ring for parse worker %d\n", i);
+                stop_workers(sniffer);
+                return -1;
+            }
+            worker->num_rings++;
+        }
+
+        if (pthread_create(&worker->thread, NULL, worker_thread, worker) != 0) {
+            fprintf(stderr, "Failed to create parse worker %d\n", i);
+            stop_workers(sniffer);
+            return -1;
+        }
+        worker->started = true;
+    }
+    return 0;
 }
 
-static void* channel_hopper(void *arg) {
-    sniffer_t *sniffer = (sniffer_t *)arg;
-    int idx = 0;
-    time_t last_config_check = 0;
+void sniffer_wait_workers(sniffer_t *sniffer) {
+    for (int i = 0; i < sniffer->num_workers; i++) {
+        worker_t *worker = &sniffer->workers[i];
+        for (int j = 0; j < worker->num_rings; j++) {
+            while (!frame_ring_empty(&worker->rings[j])) {
+                usleep(SNIFFER_WORKER_IDLE_US);
+            }
+        }
+    }
+}
 
-    printf("Channel hopping thread started\n");
+// A --capture-cpus or --uploader-cpus list, restricted to the allowed CPUs
+static int parse_cpus(const char *option, const char *list, const cpu_mask_t *allowed, cpu_mask_t *out) {
+    if (cpu_mask_parse(list, out) != 0) {
+        fprintf(stderr, "Invalid CPU list for %s: %s\n", option, list);
+        return -1;
+    }
+    for (int cpu = 0; cpu < CPU_MASK_MAX; cpu++) {
+        if (!cpu_mask_test(allowed, cpu)) cpu_mask_clear(out, cpu);
+    }
+    if (cpu_mask_count(out) == 0) {
+        char buf[128];
+        cpu_mask_format(allowed, buf, sizeof(buf));
+        fprintf(stderr, "%s %s names none of the CPUs this process may use (%s)\n", option, list, buf);
+        return -1;
+    }
+    return 0;
+}
 
-    while (sniffer->running) {
-        // Check config every 5 seconds
-        time_t now = time(NULL);
-        if (now - last_config_check >= 5) {
-            int old_num_channels = sniffer->num_channels;
-            read_config(sniffer);
-            // Reset index if channel list changed
-            if (sniffer->num_channels != old_num_channels || idx >= sniffer->num_channels) {
-                idx = 0;
+// The CPU nearest a radio's NIC interrupts, preferring one no earlier
+// radio took; -1 if the NIC's placement is unknown
+static int irq_capture_cpu(sniffer_t *sniffer, radio_t *radio, const cpu_mask_t *allowed) {
+    cpu_mask_t near;
+    char source[32];
+    if (cpu_mask_for_interface(radio->interface, &near, source, sizeof(source)) != 0) {
+        return -1;
+    }
+    for (int cpu = 0; cpu < CPU_MASK_MAX; cpu++) {
+        if (!cpu_mask_test(allowed, cpu)) cpu_mask_clear(&near, cpu);
+    }
+
+    int choice = cpu_mask_nth(&near, 0);
+    for (int cpu = 0; choice >= 0 && cpu < CPU_MASK_MAX; cpu++) {
+        if (!cpu_mask_test(&near, cpu)) continue;
+        bool taken = false;
+        for (int i = 0; i < radio->id; i++) {
+            taken |= sniffer->radios[i].capture_cpu == cpu;
+        }
+        if (!taken) {
+            choice = cpu;
+            break;
+        }
+    }
+    if (choice >= 0) {
+        printf("%s: capture thread on CPU %d, next to its %s\n", radio->interface, choice, source);
+    }
+    return choice;
+}
+
+// Decide where every thread runs before any is started:
+//   capture    --capture-cpus: auto gives each radio the next allowed CPU,
+//              irq the CPU its NIC's interrupts are handled on (or its
+//              NUMA node), a list one CPU of the list per radio
+//   uploaders  --uploader-cpus, by default every allowed CPU without a
+//   hoppers    capture thread; they mostly wait on the network or a timer
+//   workers    one CPU each of what is left, else of the non-capture CPUs
+// With a single allowed CPU nothing is pinned.
+static int plan_cpus(sniffer_t *sniffer, const sniffer_opts_t *opts) {
+    const char *capture = opts->capture_cpus ? opts->capture_cpus : "auto";
+    bool capture_auto = strcmp(capture, "auto") == 0, capture_irq = strcmp(capture, "irq") == 0;
+    bool capture_none = strcmp(capture, "none") == 0;
+    bool io_none = opts->uploader_cpus && strcmp(opts->uploader_cpus, "none") == 0;
+
+    sniffer->rt_priority = opts->rt_priority;
+    for (int i = 0; i < sniffer->num_radios; i++) {
+        sniffer->radios[i].capture_cpu = -1;
+    }
+
+    cpu_mask_t allowed, capture_list, io_list;
+    if (cpu_mask_allowed(&allowed) != 0) {
+        memset(&allowed, 0, sizeof(allowed));
+    }
+    if (!capture_auto && !capture_irq && !capture_none &&
+        parse_cpus("--capture-cpus", capture, &allowed, &capture_list) != 0) {
+        return -1;
+    }
+    if (opts->uploader_cpus && !io_none && parse_cpus("--uploader-cpus", opts->uploader_cpus, &allowed, &io_list) != 0) {
+        return -1;
+    }
+    if (cpu_mask_count(&allowed) <= 1) {
+        return 0;
+    }
+
+    cpu_mask_t rest = allowed;
+    for (int i = 0; i < sniffer->num_radios; i++) {
+        radio_t *radio = &sniffer->radios[i];
+        if (capture_none) break;
+
+        int cpu = -1;
+        if (capture_irq && !sniffer->replaying) {
+            cpu = irq_capture_cpu(sniffer, radio, &allowed);
+            if (cpu < 0) {
+                fprintf(stderr, "%s: IRQ placement unknown, pinning capture in order\n", radio->interface);
             }
-            last_config_check = now;
+        } else if (!capture_auto && !capture_irq) {
+            cpu = cpu_mask_nth(&capture_list, i);
         }
+        radio->capture_cpu = cpu >= 0 ? cpu : cpu_mask_nth(&allowed, i);
+        cpu_mask_clear(&rest, radio->capture_cpu);
+    }
 
-        // Only hop if enabled and we have channels
-        if (sniffer->hopping_enabled && sniffer->num_channels > 0) {
-            set_channel(sniffer->interface, sniffer->channels[idx]);
-            idx = (idx + 1) % sniffer->num_channels;
+    if (opts->uploader_cpus && !io_none) {
+        sniffer->io_cpus = io_list;
+        sniffer->pin_io = true;
+    } else if (!io_none && cpu_mask_count(&rest) > 0) {
+        sniffer->io_cpus = rest;
+        sniffer->pin_io = true;
+    }
+
+    sniffer->worker_cpus = rest;
+    for (int cpu = 0; sniffer->pin_io && cpu < CPU_MASK_MAX; cpu++) {
+        if (cpu_mask_test(&sniffer->io_cpus, cpu)) cpu_mask_clear(&sniffer->worker_cpus, cpu);
+    }
+    if (cpu_mask_count(&sniffer->worker_cpus) == 0) {
+        sniffer->worker_cpus = cpu_mask_count(&rest) > 0 ? rest : allowed;
+    }
+    sniffer->pin_workers = true;
+
+    if (sniffer->pin_io) {
+        char buf[128];
+        cpu_mask_format(&sniffer->io_cpus, buf, sizeof(buf));
+        printf("Uploader and hopper threads on CPU%s %s\n", cpu_mask_count(&sniffer->io_cpus) == 1 ? "" : "s", buf);
+    }
+    return 0;
+}
+
+// Tables, uploader and worker threads: everything downstream of the capture handles
+static int start_pipeline(sniffer_t *sniffer, const sniffer_opts_t *opts) {
+    if (plan_cpus(sniffer, opts) != 0) {
+        return -1;
+    }
+    if (init_tables(sniffer, opts) != 0) {
+        return -1;
+    }
+
+    sniffer->running = true;
+    sniffer->shared_tables = sniffer->num_radios > 1 && sniffer->num_workers == 0;
+
+    int num_uploaders = opts->num_uploaders;
+    if (num_uploaders < 1) num_uploaders = 1;
+    if (num_uploaders > UPLOADER_MAX) num_uploaders = UPLOADER_MAX;
+
+    uploader_config_t upload = {
+        .api_url = sniffer->api_url,
+        .sniffer_id = sniffer->sniffer_id,
+        .queue_capacity = opts->queue_capacity,
+        .num_producers = sniffer->num_workers > 0 ? sniffer->num_workers : sniffer->num_radios,
+        .batch_size = opts->batch_size,
+        .batch_flush_ms = opts->batch_flush_ms > 0 ? opts->batch_flush_ms : HTTP_BATCH_DEFAULT_FLUSH_MS,
+        .wire_format = opts->wire_format,
+        .compression = opts->compression,
+    };
+
+    // Each uploader spools to its own subdirectory, so segment files never
+    // have two writers
+    char spool_dir[256];
+    if (opts->spool_dir) {
+        if (mkdir(opts->spool_dir, 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "Cannot create spool directory %s: %s\n", opts->spool_dir, strerror(errno));
         }
+        int spool_mb = opts->spool_mb > 0 ? opts->spool_mb : SPOOL_DEFAULT_MB;
+        upload.spool_dir = spool_dir;
+        upload.spool_bytes = (size_t)spool_mb * 1024 * 1024 / num_uploaders;
+    }
 
-        // Use configured timeout (convert ms to microseconds)
-        usleep(sniffer->hopping_timeout_ms * 1000);
+    for (int i = 0; i < sniffer->num_shards; i++) {
+        upload.sketches[i] = &sniffer->shards[i].sketch_outbox;
     }
 
-    return NULL;
+    for (int i = 0; i < num_uploaders; i++) {
+        // Read only while uploader_start opens the spool
+        snprintf(spool_dir, sizeof(spool_dir), "%s/uploader-%d", opts->spool_dir ? opts->spool_dir : "", i);
+        upload.num_sketches = i == 0 && sniffer->sketch_interval_us ? sniffer->num_shards : 0;
+        if (uploader_start(&sniffer->uploaders[i], i, &upload) != 0) {
+            stop_uploaders(sniffer);
+            destroy_tables(sniffer);
+            return -1;
+        }
+        sniffer->num_uploaders++;
+        // Off the capture cores: curl and deflate would evict their cache
+        if (sniffer->pin_io && cpu_pin_thread(sniffer->uploaders[i].thread, &sniffer->io_cpus) != 0) {
+            fprintf(stderr, "Could not pin uploader thread %d\n", i);
+        }
+    }
+
+    if (start_workers(sniffer, opts) != 0) {
+        stop_uploaders(sniffer);
+        destroy_tables(sniffer);
+        return -1;
+    }
+
+    return 0;
 }
 
-int sniffer_init(sniffer_t *sniffer, const char *interface, const char *api_url) {
+static void reset_sniffer(sniffer_t *sniffer, const sniffer_opts_t *opts) {
+    memset(sniffer, 0, sizeof(sniffer_t));
+    strncpy(sniffer->api_url, opts->api_url, sizeof(sniffer->api_url) - 1);
+    if (opts->sniffer_id && opts->sniffer_id[0]) {
+        strncpy(sniffer->sniffer_id, opts->sniffer_id, sizeof(sniffer->sniffer_id) - 1);
+    } else if (gethostname(sniffer->sniffer_id, sizeof(sniffer->sniffer_id) - 1) != 0) {
+        strcpy(sniffer->sniffer_id, "flux");
+    }
+    config_watcher_init(&sniffer->config);
+
+    int num_radios = opts->num_radios;
+    if (num_radios < 1) num_radios = 1;
+    if (num_radios > SNIFFER_MAX_RADIOS) num_radios = SNIFFER_MAX_RADIOS;
+    sniffer->num_radios = num_radios;
+
+    int num_workers = opts->num_workers;
+    if (num_workers < 0) num_workers = 0;
+    if (num_workers > SNIFFER_MAX_WORKERS) num_workers = SNIFFER_MAX_WORKERS;
+    sniffer->num_workers = num_workers;
+    sniffer->backpressure = opts->backpressure;
+    sniffer->pinned_policies = opts->frame_policies;
+    sniffer->pinned_policy_mask = opts->pinned_policies;
+
+    for (int i = 0; i < num_radios; i++) {
+        radio_t *radio = &sniffer->radios[i];
+        const radio_opts_t *ro = &opts->radios[i];
+
+        radio->sniffer = sniffer;
+        radio->id = i;
+        strncpy(radio->interface, ro->interface ? ro->interface : "wlan0", sizeof(radio->interface) - 1);
+        radio->num_plan_channels = ro->num_channels < SNIFFER_MAX_CHANNELS ? ro->num_channels : SNIFFER_MAX_CHANNELS;
+        memcpy(radio->plan_channels, ro->channels, sizeof(int) * radio->num_plan_channels);
+        radio->nl.fd = -1;
+        hop_sched_reset(&radio->hop_sched);
+        frame_policer_init(&radio->policer);
+    }
+}
+
+static void close_radios(sniffer_t *sniffer) {
+    for (int i = 0; i < sniffer->num_radios; i++) {
+        radio_t *radio = &sniffer->radios[i];
+        nl80211_close(&radio->nl);
+        frame_policer_destroy(&radio->policer);
+        if (radio->handle) {
+            pcap_close(radio->handle);
+            radio->handle = NULL;
+        }
+    }
+}
+
+static int open_radio(radio_t *radio, const sniffer_opts_t *opts) {
     char errbuf[PCAP_ERRBUF_SIZE];
 
-    memset(sniffer, 0, sizeof(sniffer_t));
-    strncpy(sniffer->interface, interface, sizeof(sniffer->interface) - 1);
-    strncpy(sniffer->api_url, api_url, sizeof(sniffer->api_url) - 1);
+    sync_config(radio);
+    printf("%s: channel hopping %s (%s), timeout: %dms, channels: [", radio->interface,
+           radio->hopping_enabled ? "enabled" : "disabled",
+           radio->hopping_mode == HOP_MODE_ADAPTIVE ? "adaptive" : "round robin",
+           radio->hopping_timeout_ms);
+    for (int i = 0; i < radio->num_channels; i++) {
+        printf("%d%s", radio->channels[i], i < radio->num_channels - 1 ? ", " : "");
+    }
+    printf("]%s\n", radio->num_plan_channels > 0 ? " (fixed plan)" : "");
 
-    // Load initial channel hopping configuration
-    read_config(sniffer);
-    printf("Channel hopping: %s, timeout: %dms, channels: [",
-           sniffer->hopping_enabled ? "enabled" : "disabled",
-           sniffer->hopping_timeout_ms);
-    for (int i = 0; i < sniffer->num_channels; i++) {
-        printf("%d%s", sniffer->channels[i], i < sniffer->num_channels - 1 ? ", " : "");
+    radio->handle = open_capture(radio->interface, opts, errbuf);
+    if (radio->handle == NULL) {
+        fprintf(stderr, "Error opening interface %s: %s\n", radio->interface, errbuf);
+        return -1;
     }
-    printf("]\n");
 
-    sniffer->handle = pcap_open_live(interface, BUFSIZ, 1, 1000, errbuf);
-    if (sniffer->handle == NULL) {
-        fprintf(stderr, "Error opening interface %s: %s\n", interface, errbuf);
+    if (pcap_datalink(radio->handle) != DLT_IEEE802_11_RADIO) {
+        fprintf(stderr, "Interface %s is not in monitor mode\n", radio->interface);
         return -1;
     }
 
-    if (pcap_datalink(sniffer->handle) != DLT_IEEE802_11_RADIO) {
-        fprintf(stderr, "Interface %s is not in monitor mode\n", interface);
-        pcap_close(sniffer->handle);
+    // Drop frames the handlers ignore before they are copied to user space.
+    // A failure only costs performance, so capture continues unfiltered.
+    radio->applied_frame_types = atomic_load(&radio->sniffer->config.frame_types);
+    frame_filter_apply(radio->handle, radio->applied_frame_types);
+
+    // One netlink socket for every hop; iw stays as the fallback
+    int nl_ret = nl80211_open(&radio->nl, radio->interface);
+    if (nl_ret != 0) {
+        fprintf(stderr, "nl80211 unavailable on %s (%s), switching channels with iw\n",
+                radio->interface, strerror(-nl_ret));
+    }
+    return 0;
+}
+
+static void stop_hoppers(sniffer_t *sniffer) {
+    for (int i = 0; i < sniffer->num_radios; i++) {
+        radio_t *radio = &sniffer->radios[i];
+        if (radio->hopper_started) {
+            pthread_join(radio->hopper_thread, NULL);
+            radio->hopper_started = false;
+        }
+    }
+}
+
+// One radio reading a capture file instead of an interface. There is no
+// config fetch, channel hopping or capture filter, and nothing downstream
+// drops: capture waits on full worker rings and uploader queues.
+static int init_replay(sniffer_t *sniffer, const sniffer_opts_t *opts) {
+    sniffer_opts_t replay = *opts;
+    replay.num_radios = 1;
+    replay.radios[0].interface = "replay";
+    replay.radios[0].num_channels = 0;
+    replay.backpressure = true;
+    reset_sniffer(sniffer, &replay);
+    sniffer->replaying = true;
+    sniffer->replay_rate = opts->replay_rate > 0 ? opts->replay_rate : 0;
+
+    char errbuf[PCAP_ERRBUF_SIZE];
+    radio_t *radio = &sniffer->radios[0];
+    radio->handle = pcap_open_offline(opts->replay_path, errbuf);
+    if (radio->handle == NULL) {
+        fprintf(stderr, "Error opening %s: %s\n", opts->replay_path, errbuf);
+        return -1;
+    }
+    if (pcap_datalink(radio->handle) != DLT_IEEE802_11_RADIO) {
+        fprintf(stderr, "%s is not a radiotap capture\n", opts->replay_path);
+        close_radios(sniffer);
         return -1;
     }
 
-    sniffer->running = true;
+    if (start_pipeline(sniffer, &replay) != 0) {
+        close_radios(sniffer);
+        return -1;
+    }
+
+    if (sniffer->replay_rate > 0) {
+        printf("Replaying %s at %gx recorded speed\n", opts->replay_path, sniffer->replay_rate);
+    } else {
+        printf("Replaying %s as fast as possible\n", opts->replay_path);
+    }
+
+    if (opts->metrics_listen && metrics_server_start(&sniffer->metrics, sniffer, opts->metrics_listen) != 0) {
+        fprintf(stderr, "Metrics endpoint disabled\n");
+    }
+    return 0;
+}
 
-    if (pthread_create(&sniffer->hopper_thread, NULL, channel_hopper, sniffer) != 0) {
-        fprintf(stderr, "Failed to create channel hopper thread\n");
-        pcap_close(sniffer->handle);
+int sniffer_init(sniffer_t *sniffer, const sniffer_opts_t *opts) {
+    if (opts->replay_path) {
+        return init_replay(sniffer, opts);
+    }
+
+    reset_sniffer(sniffer, opts);
+
+    // Load initial channel hopping configuration, then keep watching it
+    if (config_watcher_start(&sniffer->config, sniffer->api_url) != 0) {
         return -1;
     }
 
+    for (int i = 0; i < sniffer->num_radios; i++) {
+        if (open_radio(&sniffer->radios[i], opts) != 0) {
+            config_watcher_stop(&sniffer->config);
+            close_radios(sniffer);
+            return -1;
+        }
+    }
+
+    if (start_pipeline(sniffer, opts) != 0) {
+        config_watcher_stop(&sniffer->config);
+        close_radios(sniffer);
+        return -1;
+    }
+
+    for (int i = 0; i < sniffer->num_radios; i++) {
+        radio_t *radio = &sniffer->radios[i];
+        if (pthread_create(&radio->hopper_thread, NULL, channel_hopper, radio) != 0) {
+            fprintf(stderr, "Failed to create channel hopper thread for %s\n", radio->interface);
+            sniffer->running = false;
+            stop_hoppers(sniffer);
+            config_watcher_stop(&sniffer->config);
+            stop_uploaders(sniffer);
+            destroy_tables(sniffer);
+            close_radios(sniffer);
+            return -1;
+        }
+        radio->hopper_started = true;
+    }
+
+    // Telemetry is optional; the sniffer runs on without it
+    if (opts->metrics_listen && metrics_server_start(&sniffer->metrics, sniffer, opts->metrics_listen) != 0) {
+        fprintf(stderr, "Metrics endpoint disabled\n");
+    }
+
     return 0;
 }
 
+int sniffer_init_offline(sniffer_t *sniffer, const sniffer_opts_t *opts) {
+    sniffer_opts_t offline = *opts;
+    offline.num_radios = 1;
+    offline.radios[0].interface = "offline";
+    offline.radios[0].num_channels = 0;
+    reset_sniffer(sniffer, &offline);
+    return start_pipeline(sniffer, &offline);
+}
+
+// Keep each capture thread on its own core so its tables and ring stay
+// hot, under SCHED_FIFO if asked so a burst of uploads or a busy hopper
+// never delays pcap_dispatch. Replays keep normal scheduling: they run
+// flat out and would starve everything else on the core.
+static void place_capture_thread(radio_t *radio) {
+    sniffer_t *sniffer = radio->sniffer;
+    if (radio->capture_cpu >= 0) {
+        cpu_mask_t cpu = {0};
+        cpu_mask_set(&cpu, radio->capture_cpu);
+        if (cpu_pin_thread(pthread_self(), &cpu) != 0) {
+            fprintf(stderr, "Could not pin capture thread for %s\n", radio->interface);
+        }
+    }
+    if (sniffer->rt_priority > 0 && !sniffer->replaying) {
+        int ret = cpu_set_fifo(pthread_self(), sniffer->rt_priority);
+        if (ret != 0) {
+            fprintf(stderr, "%s: capture thread keeps normal scheduling: %s\n", radio->interface, strerror(ret));
+        }
+    }
+}
+
+// Sleep until a replayed frame is due, in slices so a stop request is
+// noticed during long gaps in the capture
+static void replay_wait(sniffer_t *sniffer, uint64_t due_ns) {
+    for (;;) {
+        uint64_t now = monotonic_ns();
+        if (now >= due_ns || !sniffer->running) return;
+
+        uint64_t until = due_ns - now > SNIFFER_REPLAY_WAIT_NS ? now + SNIFFER_REPLAY_WAIT_NS : due_ns;
+        sleep_until_ns(sniffer, until);
+    }
+}
+
+// pcap callback for replay files: holds each frame back until its offset
+// from the first frame, scaled by the replay rate, has passed. The frame
+// keeps its recorded capture time, so aggregation windows and the events
+// sent to the API follow the capture's clock.
+static void replay_packet(u_char *user, const struct pcap_pkthdr *header, const u_char *packet) {
+    radio_t *radio = (radio_t *)user;
+    sniffer_t *sniffer = radio->sniffer;
+    uint64_t ts_us = (uint64_t)header->ts.tv_sec * 1000000 + header->ts.tv_usec;
+
+    if (radio->replay_frames++ == 0) {
+        radio->replay_first_us = ts_us;
+        radio->replay_start_ns = monotonic_ns();
+    } else if (sniffer->replay_rate > 0 && ts_us > radio->replay_first_us) {
+        double offset_ns = (double)(ts_us - radio->replay_first_us) * 1000.0 / sniffer->replay_rate;
+        replay_wait(sniffer, radio->replay_start_ns + (uint64_t)offset_ns);
+    }
+
+    packet_handler(user, header, packet);
+}
+
+static void report_replay(radio_t *radio) {
+    double elapsed = radio->replay_frames ? (double)(monotonic_ns() - radio->replay_start_ns) / 1e9 : 0;
+    printf("Replayed %llu frames in %.1fs (%.0f frames/s)\n", (unsigned long long)radio->replay_frames,
+           elapsed, elapsed > 0 ? radio->replay_frames / elapsed : 0);
+}
+
+// The API's capture policies, except for types pinned on the command line.
+// Called between dispatches, so the policer only ever has one writer.
+static void refresh_policies(radio_t *radio) {
+    sniffer_t *sniffer = radio->sniffer;
+    if (config_watcher_generation(&sniffer->config) == radio->policy_generation) return;
+
+    hop_config_t cfg;
+    radio->policy_generation = config_watcher_get(&sniffer->config, &cfg);
+    frame_policy_set_t set = cfg.policies;
+    for (int i = 0; i < FRAME_CLASS_COUNT; i++) {
+        if (sniffer->pinned_policy_mask & (1u << i)) set.classes[i] = sniffer->pinned_policies.classes[i];
+    }
+
+    bool changed = false;
+    for (int i = 0; i < FRAME_CLASS_COUNT; i++) {
+        changed |= !frame_policy_equal(&set.classes[i], &radio->policer.set.classes[i]);
+    }
+    if (!changed) return;
+
+    if (frame_policer_set(&radio->policer, &set) != 0) {
+        fprintf(stderr, "%s: no memory for rate buckets, rate policies keep every frame\n", radio->interface);
+    }
+
+    char line[FRAME_CLASS_COUNT * (FRAME_POLICY_STR_MAX + 16)];
+    size_t n = 0;
+    line[0] = '\0';
+    for (int i = 0; i < FRAME_CLASS_COUNT; i++) {
+        if (set.classes[i].kind == FRAME_POLICY_KEEP) continue;
+        char policy[FRAME_POLICY_STR_MAX];
+        frame_policy_format(&set.classes[i], policy, sizeof(policy));
+        n += snprintf(line + n, sizeof(line) - n, " %s=%s", frame_filter_name(i), policy);
+    }
+    printf("%s: capture policies%s\n", radio->interface, n ? line : " off, keeping every frame");
+}
+
+static void *capture_thread(void *arg) {
+    radio_t *radio = (radio_t *)arg;
+    sniffer_t *sniffer = radio->sniffer;
+
+    char name[32];
+    snprintf(name, sizeof(name), "capture-%s", radio->interface);
+    alloc_stats_register(name);
+    place_capture_thread(radio);
+    radio->last_stats_time = time(NULL);
+    refresh_policies(radio);
+
+    while (sniffer->running) {
+        int n = sniffer->replaying
+                    ? pcap_dispatch(radio->handle, SNIFFER_REPLAY_BURST, replay_packet, (u_char *)radio)
+                    : pcap_dispatch(radio->handle, -1, packet_handler, (u_char *)radio);
+        if (n == -1) {
+            fprintf(stderr, "Error in pcap_dispatch on %s: %s\n", radio->interface, pcap_geterr(radio->handle));
+            radio->capture_result = -1;
+            break;
+        }
+        if (n == -2) {
+            break; // pcap_breakloop from sniffer_request_stop
+        }
+        refresh_policies(radio);
+        if (sniffer->replaying) {
+            if (n == 0) {
+                // End of file: shut down through the same path as a signal
+                sniffer_request_stop(sniffer);
+                break;
+            }
+            continue;
+        }
+
+        // The config thread only publishes changes; the filter is
+        // swapped here, between dispatches, on the thread that owns the handle
+        uint32_t frame_types = atomic_load(&sniffer->config.frame_types);
+        if (frame_types != radio->applied_frame_types) {
+            radio->applied_frame_types = frame_types;
+            frame_filter_apply(radio->handle, frame_types);
+        }
+
+        time_t now = time(NULL);
+        if (now != radio->telemetry_time) {
+            radio->telemetry_time = now;
+            update_kernel_telemetry(radio);
+        }
+        if (now - radio->last_stats_time >= SNIFFER_STATS_INTERVAL_S) {
+            report_capture_stats(radio, now);
+        }
+    }
+
+    if (sniffer->replaying) {
+        report_replay(radio);
+    } else {
+        report_capture_stats(radio, time(NULL));
+    }
+    return NULL;
+}
+
 int sniffer_start(sniffer_t *sniffer) {
-    printf("Starting packet capture loop...\n");
+    printf("Starting packet capture on %d interface%s...\n", sniffer->num_radios,
+           sniffer->num_radios == 1 ? "" : "s");
     fflush(stdout);
 
-    if (pcap_loop(sniffer->handle, -1, packet_handler, (u_char *)sniffer) == -1) {
-        fprintf(stderr, "Error in pcap_loop: %s\n", pcap_geterr(sniffer->handle));
-        return -1;
+    int ret = 0;
+    for (int i = 0; i < sniffer->num_radios; i++) {
+        radio_t *radio = &sniffer->radios[i];
+        if (pthread_create(&radio->capture_thread, NULL, capture_thread, radio) != 0) {
+            fprintf(stderr, "Failed to create capture thread for %s\n", radio->interface);
+            sniffer_request_stop(sniffer);
+            ret = -1;
+            break;
+        }
+        radio->capture_started = true;
     }
-    return 0;
+
+    for (int i = 0; i < sniffer->num_radios; i++) {
+        radio_t *radio = &sniffer->radios[i];
+        if (radio->capture_started) {
+            pthread_join(radio->capture_thread, NULL);
+            radio->capture_started = false;
+            if (radio->capture_result != 0) ret = -1;
+        }
+    }
+
+    return ret;
 }
 
-void sniffer_stop(sniffer_t *sniffer) {
+void sniffer_request_stop(sniffer_t *sniffer) {
     sniffer->running = false;
-    if (sniffer->handle) {
-        pcap_breakloop(sniffer->handle);
+    for (int i = 0; i < sniffer->num_radios; i++) {
+        if (sniffer->radios[i].handle) {
+            pcap_breakloop(sniffer->radios[i].handle);
+        }
     }
-    pthread_join(sniffer->hopper_thread, NULL);
 }
 
-void sniffer_cleanup(sniffer_t *sniffer) {
-    if (sniffer->handle) {
-        pcap_close(sniffer->handle);
-        sniffer->handle = NULL;
+void sniffer_stop(sniffer_t *sniffer) {
+    sniffer_request_stop(sniffer);
+    metrics_server_stop(&sniffer->metrics);
+    stop_hoppers(sniffer);
+    config_watcher_stop(&sniffer->config);
+
+    // The capture threads have returned and the workers have drained their
+    // rings, so the aggregation tables can be flushed from here before the
+    // uploaders drain them
+    stop_workers(sniffer);
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    packet_handler_flush(sniffer, (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000);
+    stop_uploaders(sniffer);
+    report_alloc_stats();
+}
+
+bool sniffer_emit(sniffer_t *sniffer, int producer, const flux_event_t *ev) {
+    // Shard by the low MAC bytes so every event for a MAC goes through the
+    // same uploader and keeps its order
+    const uint8_t *mac = ev->mac;
+    int idx = (mac[3] ^ mac[4] ^ mac[5]) % sniffer->num_uploaders;
+    event_queue_t *q = &sniffer->uploaders[idx].queues[producer];
+
+    // The uploader drains its queues until it is stopped, which only
+    // happens after the final flush, so this wait always ends
+    while (sniffer->replaying && event_queue_depth(q) > q->mask) {
+        sched_yield();
     }
+
+    flux_event_t stamped = *ev;
+    stamped.seq = atomic_fetch_add_explicit(&sniffer->next_seq, 1, memory_order_relaxed);
+#ifdef FLUX_EVENT_TRACE
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    stamped.enqueue_ns = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+    return event_queue_push(q, &stamped);
+}
+
+void sniffer_queue_stats(sniffer_t *sniffer, uint64_t *enqueued, uint64_t *dropped) {
+    *enqueued = 0;
+    *dropped = 0;
+    for (int i = 0; i < sniffer->num_uploaders; i++) {
+        uploader_t *up = &sniffer->uploaders[i];
+        for (int j = 0; j < up->num_queues; j++) {
+            *enqueued += atomic_load_explicit(&up->queues[j].enqueued, memory_order_relaxed);
+            *dropped += atomic_load_explicit(&up->queues[j].dropped, memory_order_relaxed);
+        }
+    }
+}
+
+int sniffer_capture_stats(radio_t *radio, struct pcap_stat *stats) {
+    if (!radio->handle || pcap_stats(radio->handle, stats) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+void sniffer_cleanup(sniffer_t *sniffer) {
+    metrics_server_stop(&sniffer->metrics);
+    stop_workers(sniffer);
+    stop_uploaders(sniffer);
+    config_watcher_stop(&sniffer->config);
+    config_watcher_destroy(&sniffer->config);
+    destroy_tables(sniffer);
+    close_radios(sniffer);
 }
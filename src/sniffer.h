@@ -5,22 +5,216 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "event_queue.h"
+#include "uploader.h"
+#include "ap_cache.h"
+#include "data_agg.h"
+#include "station_table.h"
+#include "sketch.h"
+#include "frame_ring.h"
+#include "nl80211.h"
+#include "hop_sched.h"
+#include "config_watcher.h"
+#include "telemetry.h"
+#include "metrics_server.h"
+#include "cpu_affinity.h"
 
+#define SNIFFER_DEFAULT_UPLOADERS 1
+#define SNIFFER_DEFAULT_BUFFER_MB 32
+#define SNIFFER_MMAP_SNAPLEN 4096      // Frames are packed by captured length, so this only caps
+#define SNIFFER_MMAP_TIMEOUT_MS 100    // Max time a partly filled ring block waits for user space
+#define SNIFFER_STATS_INTERVAL_S 10
+
+typedef enum {
+    CAPTURE_LIVE,   // pcap_open_live with the default socket buffer
+    CAPTURE_MMAP,   // pcap_create with a sized TPACKET_V3 ring read in blocks
+} capture_backend_t;
+
+#define SNIFFER_MAX_RADIOS 4
+#define SNIFFER_MAX_WORKERS UPLOADER_MAX_PRODUCERS
+#define SNIFFER_WORKER_IDLE_US 100
+#define SNIFFER_WORKER_BURST 64     // Frames taken from one ring before looking at the next
+#define SNIFFER_MAX_CHANNELS CONFIG_MAX_CHANNELS
+#define SNIFFER_REPLAY_BURST 256     // Frames read from a replay file between loop checks
+#define SNIFFER_REPLAY_WAIT_NS 100000000ull   // Longest single sleep while pacing a replay
+
+// One capture interface and, optionally, a fixed channel plan for it
+typedef struct {
+    const char *interface;
+    int channels[SNIFFER_MAX_CHANNELS];   // Overrides the API channel list when non-empty
+    int num_channels;
+} radio_opts_t;
+
+// Startup options, filled with defaults by sniffer_opts_init and
+// overridden from the command line in main.c
+typedef struct {
+    radio_opts_t radios[SNIFFER_MAX_RADIOS];
+    int num_radios;
+    const char *api_url;
+    const char *sniffer_id;   // Sent as X-Sniffer-ID; NULL uses the hostname
+    int num_uploaders;
+    size_t queue_capacity;
+    int batch_size;
+    int batch_flush_ms;
+    int ap_rssi_hysteresis;   // dB change that forces an AP report
+    int ap_heartbeat_s;       // Max seconds between reports of an unchanged AP
+    int data_interval_s;      // Data frame aggregation window
+    capture_backend_t capture_backend;
+    int buffer_mb;            // Ring size for CAPTURE_MMAP
+    http_wire_format_t wire_format;   // Encoding of /ingest/batch bodies
+    http_compression_t compression;   // and their Content-Encoding
+    const char *spool_dir;    // Disk spool for API outages; NULL disables it
+    int spool_mb;             // Disk budget shared by all uploaders' spools
+    int sketch_interval_s;    // Probe sketch interval; 0 disables sketching
+    const char *metrics_listen;   // [addr:]port for the Prometheus endpoint; NULL disables it
+    int num_workers;          // Parse worker threads; 0 parses on the capture threads
+    size_t worker_ring_bytes; // Frame ring per radio per worker
+    bool backpressure;        // Capture waits on a full worker ring instead of dropping (offline only)
+    const char *replay_path;  // Feed this radiotap capture file instead of the interfaces
+    double replay_rate;       // Replay speed: 1 = recorded timing, N = N times faster, 0 = as fast as possible
+    frame_policy_set_t frame_policies;   // Capture policies that override the API's
+    uint32_t pinned_policies;            // FRAME_* bits of the types set in frame_policies
+    const char *capture_cpus;   // "auto" (NULL), "irq", "none" or a CPU list; see plan_cpus
+    const char *uploader_cpus;  // CPUs for uploaders and hoppers: NULL = those without capture, "none" or a list
+    int rt_priority;            // SCHED_FIFO priority for capture and hopper threads; 0 keeps normal scheduling
+} sniffer_opts_t;
+
+struct sniffer;
+
+// The tables events are derived from. Inline, one shard serves every radio
+// (under tables_lock when there are several). With workers, each worker
+// owns the shard for its slice of MACs and never locks it.
+typedef struct {
+    ap_cache_t ap_cache;            // Beacon de-duplication
+    data_agg_t data_agg;            // Per-station data frame totals
+    station_table_t stations;       // Association state, for edge-triggered (dis)connections
+    probe_sketch_t sketch;          // Probe requests of the current interval
+    sketch_outbox_t sketch_outbox;  // Finished interval, posted by uploader 0
+} shard_t;
+
+// Parse worker: takes the frames of its MAC slice from one SPSC ring per
+// radio, runs the handlers against its own shard and feeds the uploaders
+// as producer `id`. Every event for a MAC comes out of one worker, so
+// per-MAC order survives the hand-off.
 typedef struct {
+    struct sniffer *sniffer;
+    int id;                 // Also the producer index into every uploader
+    pthread_t thread;
+    bool started;
+    atomic_bool running;
+    frame_ring_t rings[SNIFFER_MAX_RADIOS];
+    int num_rings;
+    shard_t *shard;
+    telemetry_counter_t frames;
+} worker_t;
+
+// Per-interface state: capture handle and thread, hopping plan and stats.
+// Everything here is owned by the radio's capture or hopper thread; the
+// hopping fields are the hopper's copy of the shared config.
+typedef struct {
+    struct sniffer *sniffer;
+    int id;                // Also the producer index into every uploader
     char interface[16];
-    char api_url[256];
     pcap_t *handle;
-    bool running;
+    pthread_t capture_thread;
+    int capture_cpu;       // CPU the capture thread is pinned to, -1 for none
+    bool capture_started;
+    int capture_result;
     pthread_t hopper_thread;
+    bool hopper_started;
+    unsigned config_generation;   // Config copied into the fields below
     bool hopping_enabled;
     int hopping_timeout_ms;
-    int channels[64];      // Array of channels to hop
-    int num_channels;      // Number of channels in array
+    hop_mode_t hopping_mode;
+    int channels[SNIFFER_MAX_CHANNELS];        // Array of channels to hop
+    int num_channels;                          // Number of channels in array
+    int plan_channels[SNIFFER_MAX_CHANNELS];   // Fixed plan from the command line
+    int num_plan_channels;
+    int current_channel;
+    nl80211_t nl;          // Channel switching socket, fd -1 when iw is used
+    int nl_errors;
+    hop_sched_t hop_sched; // Per-channel activity for adaptive hopping
+    uint32_t applied_frame_types;   // Mask the installed filter was built from
+    frame_policer_t policer;        // Capture policies, applied in packet_handler
+    unsigned policy_generation;     // Config generation the policer was set from
+    uint32_t packets;
+    struct pcap_stat last_stats;    // Counters at the previous stats report
+    time_t last_stats_time;
+    uint64_t last_stats_allocs;     // Capture thread heap allocations at that report
+    struct pcap_stat telemetry_stats;   // pcap_stats at the last telemetry update
+    time_t telemetry_time;
+    radio_telemetry_t telemetry;
+    uint64_t replay_frames;         // Frames read from the replay file so far
+    uint64_t replay_first_us;       // Capture time of its first frame
+    uint64_t replay_start_ns;       // CLOCK_MONOTONIC when that frame was read
+} radio_t;
+
+typedef struct sniffer {
+    char api_url[256];
+    char sniffer_id[64];
+    bool running;
+    radio_t radios[SNIFFER_MAX_RADIOS];
+    int num_radios;
+    config_watcher_t config;        // Shared channel hopping config and FRAME_* mask
+    _Atomic uint32_t next_seq;      // Sequence number of the next emitted event
+    uploader_t uploaders[UPLOADER_MAX];
+    int num_uploaders;
+    // Inline with more than one radio, shard 0 is shared and taken under tables_lock
+    bool shared_tables;
+    pthread_mutex_t tables_lock;
+    shard_t shards[SNIFFER_MAX_WORKERS];
+    int num_shards;
+    worker_t workers[SNIFFER_MAX_WORKERS];
+    int num_workers;                 // 0 = frames are handled on the capture threads
+    bool backpressure;
+    bool replaying;                  // Fed from opts.replay_path; events wait for queue room
+    double replay_rate;
+    uint64_t sketch_interval_us;     // 0 = sketching off
+    frame_policy_set_t pinned_policies;   // Command-line capture policies, see sniffer_opts_t
+    uint32_t pinned_policy_mask;
+    cpu_mask_t io_cpus;              // Uploaders and hoppers, if pin_io
+    cpu_mask_t worker_cpus;          // One CPU of these per parse worker, if pin_workers
+    bool pin_io;
+    bool pin_workers;
+    int rt_priority;
+    metrics_server_t metrics;
 } sniffer_t;
 
-int sniffer_init(sniffer_t *sniffer, const char *interface, const char *api_url);
+void sniffer_opts_init(sniffer_opts_t *opts);
+// Opens the interfaces, or the replay file when opts->replay_path is set
+int sniffer_init(sniffer_t *sniffer, const sniffer_opts_t *opts);
+// Tables, uploaders and one radio without a capture handle, for feeding
+// packet_handler from elsewhere (no config fetch or channel hopping)
+int sniffer_init_offline(sniffer_t *sniffer, const sniffer_opts_t *opts);
+// Runs one pinned capture thread per radio and returns once all have stopped
 int sniffer_start(sniffer_t *sniffer);
+// Async-signal-safe: only asks the capture loop to return
+void sniffer_request_stop(sniffer_t *sniffer);
+// Joins the worker threads and flushes pending events; call after sniffer_start returns
 void sniffer_stop(sniffer_t *sniffer);
 void sniffer_cleanup(sniffer_t *sniffer);
 
+// Stamp the next sequence number on an event and hand it to the uploader
+// that owns its MAC, on the queue reserved for the producing radio. A
+// dropped event still uses its number, so gaps at the API mean loss.
+// Never blocks, except during a replay, which waits for queue room
+// rather than lose backfilled events.
+bool sniffer_emit(sniffer_t *sniffer, int producer, const flux_event_t *ev);
+void sniffer_queue_stats(sniffer_t *sniffer, uint64_t *enqueued, uint64_t *dropped);
+// Returns once the workers have handled every frame given to them so far
+void sniffer_wait_workers(sniffer_t *sniffer);
+// Kernel/ring counters from pcap_stats; returns -1 if the backend has none
+int sniffer_capture_stats(radio_t *radio, struct pcap_stat *stats);
+
+// Guard shard 0 when several capture threads share it
+static inline void sniffer_lock_tables(sniffer_t *sniffer) {
+    if (sniffer->shared_tables) pthread_mutex_lock(&sniffer->tables_lock);
+}
+
+static inline void sniffer_unlock_tables(sniffer_t *sniffer) {
+    if (sniffer->shared_tables) pthread_mutex_unlock(&sniffer->tables_lock);
+}
+
 #endif
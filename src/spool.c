@@ -0,0 +1,326 @@
+#include "spool.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define RECORD_SIZE sizeof(spool_record_t)
+#define FIRST_RECORD sizeof(spool_header_t)
+
+// CRC-32 (IEEE 802.3, reflected), the same checksum as zlib's crc32
+static uint32_t crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void crc_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        crc_table[i] = c;
+    }
+}
+
+static uint32_t crc32(const void *data, size_t len) {
+    const uint8_t *p = data;
+    uint32_t c = 0xFFFFFFFFu;
+    while (len--) {
+        c = crc_table[(c ^ *p++) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+static void segment_path(const spool_t *spool, uint32_t index, char *out, size_t len) {
+    snprintf(out, len, "%s/seg-%010u.spool", spool->dir, index);
+}
+
+static spool_header_t *header_of(const spool_segment_t *seg) {
+    return (spool_header_t *)seg->base;
+}
+
+static spool_record_t *record_at(const spool_segment_t *seg, size_t off) {
+    return (spool_record_t *)(seg->base + off);
+}
+
+// Map segment index, creating and preallocating it if create is set.
+// Preallocation keeps a full disk from turning a store into SIGBUS.
+static int map_segment(spool_t *spool, uint32_t index, bool create, spool_segment_t *seg) {
+    char path[320];
+    segment_path(spool, index, path, sizeof(path));
+
+    int fd = open(path, O_RDWR | (create ? O_CREAT | O_EXCL : 0), 0644);
+    if (fd < 0) return -errno;
+
+    if (create) {
+        int err = posix_fallocate(fd, 0, SPOOL_SEGMENT_BYTES);
+        if (err != 0) {
+            close(fd);
+            unlink(path);
+            return -err;
+        }
+    } else {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size != SPOOL_SEGMENT_BYTES) {
+            close(fd);
+            return -EINVAL;
+        }
+    }
+
+    void *base = mmap(NULL, SPOOL_SEGMENT_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        int err = errno;
+        close(fd);
+        return -err;
+    }
+
+    seg->index = index;
+    seg->fd = fd;
+    seg->base = base;
+
+    spool_header_t *hdr = header_of(seg);
+    if (create) {
+        memcpy(hdr->magic, SPOOL_MAGIC, sizeof(hdr->magic));
+        hdr->version = SPOOL_VERSION;
+        hdr->record_size = RECORD_SIZE;
+        hdr->read_off = FIRST_RECORD;
+    } else if (memcmp(hdr->magic, SPOOL_MAGIC, sizeof(hdr->magic)) != 0 ||
+               hdr->version != SPOOL_VERSION || hdr->record_size != RECORD_SIZE) {
+        // Written by an incompatible build; its records cannot be decoded
+        munmap(base, SPOOL_SEGMENT_BYTES);
+        close(fd);
+        seg->base = NULL;
+        return -EINVAL;
+    }
+    return 0;
+}
+
+static void unmap_segment(spool_segment_t *seg) {
+    if (!seg->base) return;
+    msync(seg->base, SPOOL_SEGMENT_BYTES, MS_ASYNC);
+    munmap(seg->base, SPOOL_SEGMENT_BYTES);
+    close(seg->fd);
+    seg->base = NULL;
+    seg->fd = -1;
+}
+
+// Offset just past the last written record
+static size_t scan_end(const spool_segment_t *seg) {
+    size_t off = FIRST_RECORD;
+    while (off + RECORD_SIZE <= SPOOL_SEGMENT_BYTES && record_at(seg, off)->magic == SPOOL_RECORD_MAGIC) {
+        off += RECORD_SIZE;
+    }
+    return off;
+}
+
+// Delete the read segment and map the next one still on disk
+static void advance_read(spool_t *spool) {
+    char path[320];
+    unmap_segment(&spool->read);
+    segment_path(spool, spool->first, path, sizeof(path));
+    unlink(path);
+
+    while (spool->first < spool->last) {
+        spool->first++;
+        if (map_segment(spool, spool->first, false, &spool->read) == 0) return;
+
+        // Missing or unreadable: count it as gone and try the next one
+        segment_path(spool, spool->first, path, sizeof(path));
+        unlink(path);
+    }
+}
+
+static void drop_oldest(spool_t *spool) {
+    if (spool->read.base) {
+        size_t read_off = header_of(&spool->read)->read_off;
+        size_t end = scan_end(&spool->read);
+        if (end > read_off) {
+            spool->dropped += (end - read_off) / RECORD_SIZE;
+        }
+    }
+    advance_read(spool);
+}
+
+// Start a new write segment, making room under the disk budget first
+static int rotate(spool_t *spool) {
+    unmap_segment(&spool->write);
+    if (spool->last - spool->first + 1 >= spool->max_segments) {
+        drop_oldest(spool);
+    }
+
+    int ret = map_segment(spool, spool->last + 1, true, &spool->write);
+    if (ret != 0) {
+        if (spool->dropped == 0) {
+            fprintf(stderr, "Spool %s: cannot create segment: %s\n", spool->dir, strerror(-ret));
+        }
+        return ret;
+    }
+
+    spool->last++;
+    spool->write_off = FIRST_RECORD;
+    // The read segment may have been created in this same call
+    if (!spool->read.base && map_segment(spool, spool->first, false, &spool->read) != 0) {
+        spool->first = spool->last;
+        map_segment(spool, spool->first, false, &spool->read);
+    }
+    return 0;
+}
+
+int spool_open(spool_t *spool, const char *dir, size_t max_bytes) {
+    pthread_once(&crc_once, crc_init);
+
+    memset(spool, 0, sizeof(*spool));
+    spool->read.fd = -1;
+    spool->write.fd = -1;
+    snprintf(spool->dir, sizeof(spool->dir), "%s", dir);
+    spool->max_segments = (uint32_t)(max_bytes / SPOOL_SEGMENT_BYTES);
+    if (spool->max_segments < SPOOL_MIN_SEGMENTS) spool->max_segments = SPOOL_MIN_SEGMENTS;
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Spool %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+
+    DIR *d = opendir(dir);
+    if (!d) {
+        fprintf(stderr, "Spool %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+
+    bool found = false;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        unsigned index;
+        char tail;
+        if (sscanf(entry->d_name, "seg-%u.spool%c", &index, &tail) != 1) continue;
+        if (!found || index < spool->first) spool->first = index;
+        if (!found || index > spool->last) spool->last = index;
+        found = true;
+    }
+    closedir(d);
+
+    int ret;
+    if (!found) {
+        ret = map_segment(spool, 0, true, &spool->write);
+        spool->write_off = FIRST_RECORD;
+    } else {
+        ret = map_segment(spool, spool->last, false, &spool->write);
+        if (ret == 0) spool->write_off = scan_end(&spool->write);
+    }
+    if (ret != 0) {
+        fprintf(stderr, "Spool %s: cannot open segment %u: %s\n", dir, spool->last, strerror(-ret));
+        return -1;
+    }
+
+    if (map_segment(spool, spool->first, false, &spool->read) != 0) {
+        // Skip an unreadable oldest segment rather than refuse to start
+        advance_read(spool);
+    }
+    if (!spool->read.base) {
+        unmap_segment(&spool->write);
+        fprintf(stderr, "Spool %s: cannot open read segment\n", dir);
+        return -1;
+    }
+
+    if (!spool_empty(spool)) {
+        printf("Spool %s: %u segment%s waiting to be replayed\n", dir, spool->last - spool->first + 1,
+               spool->last == spool->first ? "" : "s");
+    }
+    return 0;
+}
+
+void spool_close(spool_t *spool) {
+    unmap_segment(&spool->read);
+    unmap_segment(&spool->write);
+}
+
+bool spool_append(spool_t *spool, const flux_event_t *ev) {
+    if (!spool->write.base || spool->write_off + RECORD_SIZE > SPOOL_SEGMENT_BYTES) {
+        if (rotate(spool) != 0) {
+            spool->dropped++;
+            return false;
+        }
+    }
+
+    // The magic goes in last, so a record cut short by a crash is either
+    // invisible or fails its CRC
+    spool_record_t *rec = record_at(&spool->write, spool->write_off);
+    rec->ev = *ev;
+    rec->crc = crc32(&rec->ev, sizeof(rec->ev));
+    rec->magic = SPOOL_RECORD_MAGIC;
+
+    spool->write_off += RECORD_SIZE;
+    spool->appended++;
+    return true;
+}
+
+bool spool_empty(const spool_t *spool) {
+    if (spool->first != spool->last) return false;
+    return !spool->read.base || header_of(&spool->read)->read_off >= spool->write_off;
+}
+
+size_t spool_peek(spool_t *spool, flux_event_t *out, size_t max) {
+    while (spool->read.base) {
+        spool_header_t *hdr = header_of(&spool->read);
+        size_t limit = spool->read.index == spool->last ? spool->write_off : SPOOL_SEGMENT_BYTES;
+        size_t off = hdr->read_off;
+        size_t n = 0;
+        uint32_t corrupt = 0;
+
+        while (n < max && off + RECORD_SIZE <= limit) {
+            const spool_record_t *rec = record_at(&spool->read, off);
+            if (rec->magic != SPOOL_RECORD_MAGIC) {
+                limit = off;   // End of a segment that was rotated early
+                break;
+            }
+            if (rec->crc == crc32(&rec->ev, sizeof(rec->ev))) {
+                out[n++] = rec->ev;
+            } else {
+                corrupt++;
+            }
+            off += RECORD_SIZE;
+        }
+
+        if (n > 0) {
+            spool->peek_off = off;
+            spool->peek_corrupt = corrupt;
+            return n;
+        }
+
+        // Only corrupt records in this stretch: skip them now
+        if (corrupt > 0) {
+            hdr->read_off = off;
+            spool->corrupt += corrupt;
+            continue;
+        }
+
+        if (spool->read.index == spool->last) break;
+        advance_read(spool);
+    }
+
+    spool->peek_off = 0;
+    return 0;
+}
+
+void spool_consume(spool_t *spool) {
+    if (!spool->read.base || spool->peek_off == 0) return;
+
+    spool_header_t *hdr = header_of(&spool->read);
+    spool->replayed += (spool->peek_off - hdr->read_off) / RECORD_SIZE - spool->peek_corrupt;
+    spool->corrupt += spool->peek_corrupt;
+    hdr->read_off = spool->peek_off;
+    spool->peek_off = 0;
+    spool->peek_corrupt = 0;
+
+    // A replayed-out write segment is reused from the start instead of
+    // growing the log while the API is healthy
+    if (spool->read.index == spool->last && hdr->read_off >= spool->write_off) {
+        hdr->read_off = FIRST_RECORD;
+        memset(spool->write.base + FIRST_RECORD, 0, spool->write_off - FIRST_RECORD);
+        spool->write_off = FIRST_RECORD;
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef SPOOL_H
+#define SPOOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "event_queue.h"
+
+#define SPOOL_SEGMENT_BYTES (4u << 20)   // Preallocated size of one segment file
+#define SPOOL_DEFAULT_MB 256
+#define SPOOL_MIN_SEGMENTS 2
+#define SPOOL_MAGIC "FLXSPOOL"
+#define SPOOL_VERSION 1
+#define SPOOL_RECORD_MAGIC 0x46524543u   // "FREC"
+
+// First bytes of every segment. read_off is the replay position and is
+// updated in place, so a restart resumes where the last replay stopped.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;        // sizeof(spool_record_t) of the writer
+    uint64_t read_off;
+    uint8_t reserved[40];
+} spool_header_t;
+
+// One event on disk. magic marks a written slot and crc covers the event,
+// so a torn or rotted record is detected instead of replayed.
+typedef struct {
+    uint32_t magic;
+    uint32_t crc;
+    flux_event_t ev;
+} spool_record_t;
+
+typedef struct {
+    uint32_t index;              // seg-<index>.spool
+    int fd;
+    uint8_t *base;               // MAP_SHARED mapping of the whole segment
+} spool_segment_t;
+
+// Append-only event log of fixed-size, mmap'd segment files in one
+// directory. Appends go to the newest segment, replay reads from the
+// oldest; fully replayed segments are deleted, and when the disk budget is
+// used up the oldest segment is dropped to make room. Owned by one
+// uploader thread; not thread-safe.
+typedef struct {
+    char dir[256];
+    uint32_t max_segments;
+    uint32_t first;              // Oldest segment on disk (the read segment)
+    uint32_t last;               // Newest segment on disk (the write segment)
+    spool_segment_t read;
+    spool_segment_t write;
+    size_t write_off;
+    size_t peek_off;             // End of the records returned by the last peek
+    uint32_t peek_corrupt;
+
+    uint64_t appended;
+    uint64_t replayed;
+    uint64_t dropped;            // Records lost to the disk budget or I/O errors
+    uint64_t corrupt;            // Records skipped on a CRC mismatch
+} spool_t;
+
+// Opens (creating if needed) the spool in dir and recovers its read and
+// write positions. max_bytes bounds the disk used by segment files.
+int spool_open(spool_t *spool, const char *dir, size_t max_bytes);
+void spool_close(spool_t *spool);
+
+bool spool_append(spool_t *spool, const flux_event_t *ev);
+bool spool_empty(const spool_t *spool);
+
+// Copies up to max of the oldest unreplayed events into out without
+// consuming them; spool_consume commits them once they are delivered.
+size_t spool_peek(spool_t *spool, flux_event_t *out, size_t max);
+void spool_consume(spool_t *spool);
+
+#endif
@@ -0,0 +1,221 @@
+#include "station_table.h"
+#include "mac.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define STATION_USED (1ULL << 63)
+
+static inline size_t slot_for(uint64_t key, size_t mask) {
+    return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+// Capture times from several radios are not strictly ordered
+static inline uint64_t elapsed(uint64_t now, uint64_t then) {
+    return now > then ? now - then : 0;
+}
+
+static int alloc_entries(station_table_t *table, size_t capacity) {
+    table->entries = calloc(capacity, sizeof(station_entry_t));
+    if (!table->entries) return -1;
+    table->mask = capacity - 1;
+    table->count = 0;
+    table->pending = 0;
+    return 0;
+}
+
+int station_table_init(station_table_t *table) {
+    memset(table, 0, sizeof(*table));
+    return alloc_entries(table, STATION_TABLE_INITIAL_CAPACITY);
+}
+
+void station_table_destroy(station_table_t *table) {
+    free(table->entries);
+    table->entries = NULL;
+}
+
+static bool is_live(const station_entry_t *e, uint64_t now_ms) {
+    return e->key && (e->burst_frames > 0 || elapsed(now_ms, e->last_seen_ms) < STATION_IDLE_MS);
+}
+
+// Rebuild the table once it passes 75% load: idle stations are forgotten
+// (their state would be ignored as stale anyway) and the table doubles if
+// it is still crowded. Pending bursts are always kept.
+static void rehash(station_table_t *table, uint64_t now_ms) {
+    station_entry_t *old = table->entries;
+    size_t old_cap = table->mask + 1;
+    size_t old_count = table->count;
+    size_t old_pending = table->pending;
+    size_t live = 0;
+
+    for (size_t i = 0; i < old_cap; i++) {
+        if (is_live(&old[i], now_ms)) live++;
+    }
+
+    size_t new_cap = old_cap;
+    while (live * 2 > new_cap && new_cap < STATION_TABLE_MAX_CAPACITY) new_cap <<= 1;
+
+    if (alloc_entries(table, new_cap) != 0) {
+        table->entries = old;
+        table->mask = old_cap - 1;
+        table->count = old_count;
+        table->pending = old_pending;
+        return;
+    }
+
+    // Pending bursts go first: at STATION_TABLE_MAX_CAPACITY the recent
+    // idle stations that do not fit in half the table are shed instead
+    for (int pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < old_cap; i++) {
+            if (!is_live(&old[i], now_ms) || (old[i].burst_frames > 0) != (pass == 0)) continue;
+            if (pass == 1 && table->count * 2 >= table->mask + 1) break;
+
+            size_t slot = slot_for(old[i].key, table->mask);
+            while (table->entries[slot].key) slot = (slot + 1) & table->mask;
+            table->entries[slot] = old[i];
+            table->count++;
+            if (pass == 0) table->pending++;
+        }
+    }
+
+    free(old);
+}
+
+static bool crowded(const station_table_t *table) {
+    return table->count * 4 >= (table->mask + 1) * 3;
+}
+
+// The entry of mac, claiming a free slot for a new station. NULL if the
+// table is full: probes end at a free slot, so the last one stays free.
+static station_entry_t *lookup(station_table_t *table, const uint8_t *mac, uint64_t now_ms) {
+    uint64_t key = mac_to_u64(mac) | STATION_USED;
+
+    // A flood of pending bursts at STATION_TABLE_MAX_CAPACITY (or a failed
+    // allocation) keeps the load up; rebuilding on every frame then costs
+    // a full scan and calloc each time for nothing
+    if (crowded(table) && now_ms >= table->rehash_after_ms) {
+        rehash(table, now_ms);
+        table->rehash_after_ms = crowded(table) ? now_ms + STATION_REHASH_RETRY_MS : 0;
+    }
+
+    size_t slot = slot_for(key, table->mask);
+    for (;;) {
+        station_entry_t *e = &table->entries[slot];
+        if (e->key == key) return e;
+        if (e->key == 0) {
+            if (table->count >= table->mask) return NULL;
+            e->key = key;
+            table->count++;
+            return e;
+        }
+        slot = (slot + 1) & table->mask;
+    }
+}
+
+static void emit_burst(station_table_t *table, station_entry_t *e, station_emit_fn emit, void *ctx) {
+    flux_event_t ev = {0};
+    ev.ts_us = e->burst_ts_us;
+    ev.type = EVENT_DISCONNECTION;
+    ev.frame_count = (int32_t)e->burst_frames;
+    u64_to_mac(e->key & ~STATION_USED, ev.mac);
+    emit(ctx, &ev);
+
+    e->burst_frames = 0;
+    table->pending--;
+    table->disconnections++;
+}
+
+bool station_table_associate(station_table_t *table, const uint8_t *mac, const uint8_t *bssid,
+                             uint64_t now_ms, station_emit_fn emit, void *ctx) {
+    station_entry_t *e = lookup(table, mac, now_ms);
+    uint64_t bss = mac_to_u64(bssid);
+
+    if (!e) {
+        table->untracked++;
+        table->connections++;
+        return true;
+    }
+
+    // Keep the disconnection ahead of the connection that ended it
+    if (e->burst_frames > 0) {
+        emit_burst(table, e, emit, ctx);
+    }
+
+    bool stale = elapsed(now_ms, e->last_seen_ms) >= STATION_IDLE_MS;
+    e->last_seen_ms = now_ms;
+
+    // Association request retries and periodic reassociations to the same AP
+    if (e->state == STATION_ASSOCIATED && e->bssid == bss && !stale) {
+        table->suppressed++;
+        return false;
+    }
+
+    e->state = STATION_ASSOCIATED;
+    e->bssid = bss;
+    table->connections++;
+    return true;
+}
+
+void station_table_disconnect(station_table_t *table, const uint8_t *mac, uint64_t ts_us, uint32_t weight,
+                              station_emit_fn emit, void *ctx) {
+    uint64_t now_ms = ts_us / 1000;
+    station_entry_t *e = lookup(table, mac, now_ms);
+
+    if (!e) {
+        flux_event_t ev = {0};
+        ev.ts_us = ts_us;
+        ev.type = EVENT_DISCONNECTION;
+        ev.frame_count = (int32_t)weight;
+        memcpy(ev.mac, mac, 6);
+        emit(ctx, &ev);
+        table->untracked++;
+        table->disconnections++;
+        return;
+    }
+
+    bool stale = elapsed(now_ms, e->last_seen_ms) >= STATION_IDLE_MS;
+    e->last_seen_ms = now_ms;
+
+    if (e->burst_frames > 0) {
+        e->burst_frames += weight;
+        e->burst_last_ms = now_ms;
+        table->suppressed++;
+        return;
+    }
+
+    // Already gone: the tail of a flood that was reported
+    if (e->state == STATION_DISCONNECTED && !stale) {
+        table->suppressed++;
+        return;
+    }
+
+    e->state = STATION_DISCONNECTED;
+    e->bssid = 0;
+    e->burst_frames = weight;
+    e->burst_ts_us = ts_us;
+    e->burst_last_ms = now_ms;
+    table->pending++;
+}
+
+void station_table_maybe_flush(station_table_t *table, uint64_t now_ms, station_emit_fn emit, void *ctx) {
+    if (table->pending == 0 || elapsed(now_ms, table->last_sweep_ms) < STATION_SWEEP_MS) return;
+    table->last_sweep_ms = now_ms;
+
+    for (size_t i = 0; i <= table->mask && table->pending > 0; i++) {
+        station_entry_t *e = &table->entries[i];
+        if (!e->key || e->burst_frames == 0) continue;
+
+        if (elapsed(now_ms, e->burst_last_ms) >= STATION_BURST_QUIET_MS ||
+            elapsed(now_ms, e->burst_ts_us / 1000) >= STATION_BURST_MAX_MS) {
+            emit_burst(table, e, emit, ctx);
+        }
+    }
+}
+
+void station_table_flush(station_table_t *table, station_emit_fn emit, void *ctx) {
+    for (size_t i = 0; i <= table->mask && table->pending > 0; i++) {
+        station_entry_t *e = &table->entries[i];
+        if (e->key && e->burst_frames > 0) {
+            emit_burst(table, e, emit, ctx);
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef STATION_TABLE_H
+#define STATION_TABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "event_queue.h"
+
+#define STATION_TABLE_INITIAL_CAPACITY 1024
+#define STATION_TABLE_MAX_CAPACITY 65536
+#define STATION_IDLE_MS 300000      // A station unseen this long may re-associate silently
+#define STATION_BURST_QUIET_MS 2000 // Gap that ends a deauth/disassoc burst
+#define STATION_BURST_MAX_MS 30000  // A longer burst is reported while still running
+#define STATION_SWEEP_MS 500
+#define STATION_REHASH_RETRY_MS 1000 // Pause before rebuilding a table a rebuild left crowded
+
+typedef enum {
+    STATION_UNKNOWN = 0,
+    STATION_ASSOCIATED,
+    STATION_DISCONNECTED,
+} station_state_t;
+
+typedef struct {
+    uint64_t key;              // Packed MAC | STATION_USED, 0 = empty slot
+    uint64_t bssid;            // Packed BSSID while associated
+    uint64_t last_seen_ms;
+    uint64_t burst_ts_us;      // Capture time of the first frame of a pending burst
+    uint64_t burst_last_ms;
+    uint32_t burst_frames;     // 0 = no burst pending
+    uint8_t state;
+} station_entry_t;
+
+// Open-addressing table of each station's association state, so that
+// connection and disconnection events are only sent on real transitions
+// and a flood of deauth/disassoc frames becomes one disconnection carrying
+// the frame count. Owned by the capture thread; not thread-safe.
+typedef struct {
+    station_entry_t *entries;
+    size_t mask;
+    size_t count;
+    size_t pending;            // Entries with a burst not yet reported
+    uint64_t last_sweep_ms;
+    uint64_t rehash_after_ms;  // Set when a rehash left the table crowded
+    uint64_t untracked;        // Frames reported directly because the table was full
+    uint64_t connections;
+    uint64_t disconnections;
+    uint64_t suppressed;
+} station_table_t;
+
+typedef void (*station_emit_fn)(void *ctx, const flux_event_t *ev);
+
+int station_table_init(station_table_t *table);
+void station_table_destroy(station_table_t *table);
+
+// Records an (re)association of mac to bssid. Any pending disconnection
+// of the station is emitted first; returns true if this is a new
+// association that should be reported.
+bool station_table_associate(station_table_t *table, const uint8_t *mac, const uint8_t *bssid,
+                             uint64_t now_ms, station_emit_fn emit, void *ctx);
+
+// Records a deauth/disassoc frame for mac, standing for weight frames. The
+// disconnection is emitted once the burst ends, by station_table_maybe_flush,
+// or right away if the table is too full to track the station.
+void station_table_disconnect(station_table_t *table, const uint8_t *mac, uint64_t ts_us, uint32_t weight,
+                              station_emit_fn emit, void *ctx);
+
+// Emit bursts that went quiet or ran too long; cheap when none are pending
+void station_table_maybe_flush(station_table_t *table, uint64_t now_ms, station_emit_fn emit, void *ctx);
+// Emit every pending burst regardless of age (shutdown)
+void station_table_flush(station_table_t *table, station_emit_fn emit, void *ctx);
+
+#endif
@@ -0,0 +1,61 @@
+#include "telemetry.h"
+#include <stdio.h>
+#include <stdarg.h>
+
+#define SUB_BUCKETS (1u << TELEMETRY_HIST_SUB_BITS)
+
+static int bucket_index(uint64_t v) {
+    if (v < SUB_BUCKETS) return (int)v;
+
+    int e = 63 - __builtin_clzll(v);   // >= TELEMETRY_HIST_SUB_BITS
+    int shift = e - TELEMETRY_HIST_SUB_BITS;
+    int idx = (int)SUB_BUCKETS * (shift + 1) + (int)((v >> shift) & (SUB_BUCKETS - 1));
+    return idx < TELEMETRY_HIST_BUCKETS ? idx : TELEMETRY_HIST_BUCKETS - 1;
+}
+
+uint64_t telemetry_hist_bucket_max(int i) {
+    if (i < (int)SUB_BUCKETS) return (uint64_t)i;
+
+    int shift = i / SUB_BUCKETS - 1;
+    uint64_t lower = (uint64_t)(SUB_BUCKETS + i % SUB_BUCKETS) << shift;
+    return lower + (1ull << shift) - 1;
+}
+
+void telemetry_hist_record(telemetry_hist_t *h, uint64_t value) {
+    telemetry_add(&h->buckets[bucket_index(value)], 1);
+    telemetry_add(&h->count, 1);
+    telemetry_add(&h->sum, value);
+}
+
+void telemetry_printf(telemetry_writer_t *w, const char *fmt, ...) {
+    if (w->overflow) return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(w->buf + w->len, w->cap - w->len, fmt, ap);
+    va_end(ap);
+
+    if (n < 0 || (size_t)n >= w->cap - w->len) {
+        w->overflow = true;
+        return;
+    }
+    w->len += (size_t)n;
+}
+
+void telemetry_write_hist(telemetry_writer_t *w, const char *name, const char *labels, const telemetry_hist_t *h,
+                          double scale) {
+    const char *sep = labels[0] ? "," : "";
+
+    // Buckets are read one by one while the owner keeps recording, so a
+    // scrape may be off by the few samples taken meanwhile
+    uint64_t cumulative = 0;
+    for (int i = 0; i < TELEMETRY_HIST_BUCKETS - 1; i++) {
+        cumulative += telemetry_get(&h->buckets[i]);
+        telemetry_printf(w, "%s_bucket{%s%sle=\"%.9g\"} %llu\n", name, labels, sep,
+                         telemetry_hist_bucket_max(i) * scale, (unsigned long long)cumulative);
+    }
+    cumulative += telemetry_get(&h->buckets[TELEMETRY_HIST_BUCKETS - 1]);
+    telemetry_printf(w, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels, sep, (unsigned long long)cumulative);
+    telemetry_printf(w, "%s_sum{%s} %.9g\n", name, labels, telemetry_get(&h->sum) * scale);
+    telemetry_printf(w, "%s_count{%s} %llu\n", name, labels, (unsigned long long)cumulative);
+}
@@ -0,0 +1,93 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "frame_policy.h"
+
+// Log-linear buckets in the style of HdrHistogram: values below 4 get a
+// bucket each, and every power of two above that is split into 4, so a
+// bucket is never wider than 25% of its value. 100 buckets reach 2^26
+// (67 s in microseconds); larger values land in the last one.
+#define TELEMETRY_HIST_SUB_BITS 2
+#define TELEMETRY_HIST_BUCKETS 100
+#define TELEMETRY_FRAME_SAMPLE 64   // Every Nth frame is timed
+
+// Counters and histograms have a single writer (the thread that owns them)
+// and are read by the metrics server. Writers use relaxed load/store pairs
+// instead of read-modify-write, so recording costs plain adds.
+typedef _Atomic uint64_t telemetry_counter_t;
+
+static inline void telemetry_add(telemetry_counter_t *c, uint64_t n) {
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+static inline void telemetry_set(telemetry_counter_t *c, uint64_t v) {
+    atomic_store_explicit(c, v, memory_order_relaxed);
+}
+
+static inline uint64_t telemetry_get(const telemetry_counter_t *c) {
+    return atomic_load_explicit((telemetry_counter_t *)c, memory_order_relaxed);
+}
+
+typedef struct {
+    telemetry_counter_t buckets[TELEMETRY_HIST_BUCKETS];
+    telemetry_counter_t count;
+    telemetry_counter_t sum;
+} telemetry_hist_t;
+
+void telemetry_hist_record(telemetry_hist_t *h, uint64_t value);
+// Largest value counted in bucket i
+uint64_t telemetry_hist_bucket_max(int i);
+
+// Frames by 802.11 type (mgmt, ctrl, data, ext) and subtype
+typedef struct {
+    telemetry_counter_t frames[4][16];
+    telemetry_counter_t bytes;
+    telemetry_counter_t malformed;       // Bad radiotap header or truncated 802.11 header
+    telemetry_counter_t bad_fcs;
+    telemetry_counter_t kernel_received; // pcap_stats, widened past the 32-bit wrap
+    telemetry_counter_t kernel_dropped;
+    telemetry_counter_t kernel_ifdropped;
+    telemetry_counter_t channel;         // Current channel, 0 before the first hop
+    telemetry_counter_t channel_switches;
+    telemetry_counter_t channel_switch_failures;   // nl80211 failed and iw was used
+    telemetry_counter_t shed[FRAME_CLASS_COUNT];   // Frames a capture policy left unhandled, by FRAME_* type
+    telemetry_hist_t frame_ns;           // packet_handler time, sampled
+    telemetry_hist_t channel_switch_us;
+    telemetry_hist_t hop_late_us;        // Hopper wake-up past its dwell deadline
+} radio_telemetry_t;
+
+typedef struct {
+    telemetry_counter_t posts;
+    telemetry_counter_t post_failures;
+    telemetry_counter_t retries;         // Replay POSTs of spooled events
+    telemetry_counter_t events_posted;
+    telemetry_counter_t events_spooled;
+    telemetry_counter_t events_replayed;
+    telemetry_counter_t events_dropped;  // Refused by the API with no spool to fall back on
+    telemetry_counter_t spool_dropped;   // Lost to the spool's disk budget
+    telemetry_counter_t batch_bytes;     // Batch bodies before compression
+    telemetry_counter_t batch_wire_bytes;   // and as sent
+    telemetry_hist_t post_us;
+    telemetry_hist_t delivery_us;        // Capture timestamp to accepted POST
+} uploader_telemetry_t;
+
+// Bounded text buffer for the Prometheus exposition; overflow is sticky
+// and truncates instead of allocating
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+    bool overflow;
+} telemetry_writer_t;
+
+void telemetry_printf(telemetry_writer_t *w, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+// name{labels} sample lines for one histogram, with bucket bounds scaled
+// to seconds (scale 1e-6 for microseconds, 1e-9 for nanoseconds)
+void telemetry_write_hist(telemetry_writer_t *w, const char *name, const char *labels, const telemetry_hist_t *h,
+                          double scale);
+
+#endif
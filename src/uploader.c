@@ -0,0 +1,362 @@
+#include "uploader.h"
+#include "http_client.h"
+#include "alloc_stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Counts one POST started at started_us and passes its result through
+static int record_post(uploader_t *up, uint64_t started_us, int ret) {
+    telemetry_add(&up->telemetry.posts, 1);
+    if (ret != 0) telemetry_add(&up->telemetry.post_failures, 1);
+    telemetry_hist_record(&up->telemetry.post_us, now_us() - started_us);
+    return ret;
+}
+
+// Events are stamped with the pcap (wall clock) capture time
+static void delivered(uploader_t *up, const flux_event_t *events, int count) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t now = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+    telemetry_add(&up->telemetry.events_posted, (uint64_t)count);
+    for (int i = 0; i < count; i++) {
+        telemetry_hist_record(&up->telemetry.delivery_us, now > events[i].ts_us ? now - events[i].ts_us : 0);
+    }
+}
+
+// The binary format only exists as a batch body, so it always batches
+static bool batching(const uploader_t *up) {
+    return up->config.batch_size > 1 || up->config.wire_format == HTTP_WIRE_BINARY;
+}
+
+static void mark_unhealthy(uploader_t *up) {
+    if (up->healthy) {
+        fprintf(stderr, "Uploader %d: API unreachable, spooling events to %s\n", up->id, up->spool.dir);
+    }
+    up->healthy = false;
+    up->next_probe_ms = now_ms() + UPLOADER_PROBE_MS;
+}
+
+// Hand events that could not be posted to the spool, or drop them without one
+static void undelivered(uploader_t *up, const flux_event_t *events, int count) {
+    if (!up->spool_ready) {
+        if (count > 1 && up->client.error_count < 5) {
+            fprintf(stderr, "Dropped batch of %d events\n", count);
+        }
+        telemetry_add(&up->telemetry.events_dropped, (uint64_t)count);
+        return;
+    }
+
+    telemetry_add(&up->telemetry.events_spooled, (uint64_t)count);
+    for (int i = 0; i < count; i++) {
+        spool_append(&up->spool, &events[i]);
+    }
+    mark_unhealthy(up);
+}
+
+static void flush_batch(uploader_t *up) {
+    int count = up->batch.count;
+    if (count == 0) return;
+
+    uint64_t started = now_us();
+    if (record_post(up, started, http_batch_flush(&up->batch, &up->client)) != 0) {
+        undelivered(up, up->pending, count);
+    } else {
+        delivered(up, up->pending, count);
+    }
+}
+
+static void batch_event(uploader_t *up, const flux_event_t *ev) {
+    if (up->batch.count == 0) {
+        up->batch_started_ms = now_ms();
+    }
+    int before = up->batch.count;
+    if (!http_batch_add(&up->batch, ev)) {
+        flush_batch(up);
+        up->batch_started_ms = now_ms();
+        before = up->batch.count;
+        http_batch_add(&up->batch, ev);
+    }
+    // Records the encoder drops (unknown type, oversized JSON) are not appended
+    if (up->batch.count == before) return;
+    up->pending[before] = *ev;
+    if (up->batch.count >= up->config.batch_size) {
+        flush_batch(up);
+    }
+}
+
+static void deliver(uploader_t *up, const flux_event_t *ev) {
+    if (up->spool_ready && (!up->healthy || up->spilling)) {
+        telemetry_add(&up->telemetry.events_spooled, 1);
+        spool_append(&up->spool, ev);
+    } else if (batching(up)) {
+        batch_event(up, ev);
+    } else {
+        uint64_t started = now_us();
+        if (record_post(up, started, http_post_event(&up->client, ev)) != 0) {
+            undelivered(up, ev, 1);
+        } else {
+            delivered(up, ev, 1);
+        }
+    }
+}
+
+// Post the oldest spooled events; they are only consumed once the API has
+// accepted them, so a failed replay is retried from the same place
+static void replay_spool(uploader_t *up) {
+    size_t n = spool_peek(&up->spool, up->replay, UPLOADER_REPLAY_EVENTS);
+    if (n == 0) {
+        up->healthy = true;
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        http_batch_add(&up->replay_batch, &up->replay[i]);
+    }
+    telemetry_add(&up->telemetry.retries, 1);
+    uint64_t started = now_us();
+    if (record_post(up, started, http_batch_flush(&up->replay_batch, &up->client)) != 0) {
+        mark_unhealthy(up);
+        return;
+    }
+    telemetry_add(&up->telemetry.events_replayed, n);
+
+    spool_consume(&up->spool);
+    if (!up->healthy) {
+        printf("Uploader %d: API reachable again, replaying spool\n", up->id);
+        up->healthy = true;
+    }
+}
+
+// Sketches are one POST per interval and are not spooled: a lost interval
+// only leaves a gap in the probe tiers
+static void post_sketch(uploader_t *up, sketch_outbox_t *box) {
+    size_t len = probe_sketch_encode(&box->sketch, up->sketch_buf, SKETCH_WIRE_MAX_LEN);
+    atomic_store_explicit(&box->full, false, memory_order_release);
+
+    if (len == 0) return;
+
+    uint64_t started = now_us();
+    if (record_post(up, started, http_post_sketch(&up->client, up->sketch_buf, len)) != 0 &&
+        up->client.error_count < 5) {
+        fprintf(stderr, "Dropped probe sketch\n");
+    }
+}
+
+static void post_sketches(uploader_t *up) {
+    for (int i = 0; i < up->config.num_sketches; i++) {
+        sketch_outbox_t *box = up->config.sketches[i];
+        if (atomic_load_explicit(&box->full, memory_order_acquire)) {
+            post_sketch(up, box);
+        }
+    }
+}
+
+// Take the next event from any producer queue, rotating the starting queue
+static bool pop_event(uploader_t *up, flux_event_t *ev) {
+    for (int i = 0; i < up->num_queues; i++) {
+        int q = (up->next_queue + i) % up->num_queues;
+        if (event_queue_pop(&up->queues[q], ev)) {
+            up->next_queue = (q + 1) % up->num_queues;
+
+            // Spill to disk between the 3/4 and 1/4 watermarks rather than
+            // let a slow API fill the ring and drop at the producer
+            if (up->spool_ready) {
+                size_t depth = event_queue_depth(&up->queues[q]);
+                if (depth >= up->config.queue_capacity / 4 * 3) up->spilling = true;
+                else if (depth <= up->config.queue_capacity / 4) up->spilling = false;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+static void destroy_queues(uploader_t *up) {
+    for (int i = 0; i < up->num_queues; i++) {
+        event_queue_destroy(&up->queues[i]);
+    }
+    up->num_queues = 0;
+}
+
+static void* uploader_thread(void *arg) {
+    uploader_t *up = (uploader_t *)arg;
+    flux_event_t ev;
+
+    char name[24];
+    snprintf(name, sizeof(name), "uploader-%d", up->id);
+    alloc_stats_register(name);
+
+    printf("Uploader thread %d started (%s%s, batch size %d, flush %dms%s)\n", up->id,
+           up->config.wire_format == HTTP_WIRE_BINARY ? "binary" : "JSON",
+           up->config.compression == HTTP_COMPRESS_DEFLATE ? "+deflate" : "",
+           batching(up) ? up->batch.max_events : 1, up->config.batch_flush_ms,
+           up->spool_ready ? ", spooling" : "");
+
+    for (;;) {
+        if (up->spool_ready) {
+            telemetry_set(&up->telemetry.spool_dropped, up->spool.dropped);
+        }
+        telemetry_set(&up->telemetry.batch_bytes, up->client.batch_bytes);
+        telemetry_set(&up->telemetry.batch_wire_bytes, up->client.batch_wire_bytes);
+
+        bool got = pop_event(up, &ev);
+        if (got) {
+            deliver(up, &ev);
+        }
+
+        // Time-based flush so a trickle of events is not held back
+        if (up->batch.count > 0 && now_ms() - up->batch_started_ms >= (uint64_t)up->config.batch_flush_ms) {
+            flush_batch(up);
+        }
+
+        post_sketches(up);
+
+        // Replay when idle while healthy, and probe on a timer while not
+        if (up->spool_ready && atomic_load_explicit(&up->running, memory_order_relaxed)) {
+            bool due = up->healthy ? !got && !up->spilling && !spool_empty(&up->spool)
+                                   : now_ms() >= up->next_probe_ms;
+            if (due) {
+                replay_spool(up);
+                continue;
+            }
+        }
+
+        if (got) continue;
+
+        // Only exit once every queue has been drained
+        if (!atomic_load_explicit(&up->running, memory_order_acquire)) break;
+        usleep(UPLOADER_IDLE_US);
+    }
+
+    // Anything that fails here is spooled and replayed by the next run
+    flush_batch(up);
+    post_sketches(up);
+    return NULL;
+}
+
+static void free_buffers(uploader_t *up) {
+    http_batch_free(&up->batch);
+    http_batch_free(&up->replay_batch);
+    free(up->pending);
+    free(up->replay);
+    free(up->sketch_buf);
+    up->pending = NULL;
+    up->replay = NULL;
+    up->sketch_buf = NULL;
+}
+
+static int open_spool(uploader_t *up) {
+    if (http_batch_init(&up->replay_batch, UPLOADER_REPLAY_EVENTS, up->config.wire_format) != 0) return -1;
+    up->replay = malloc(UPLOADER_REPLAY_EVENTS * sizeof(*up->replay));
+    if (!up->replay) return -1;
+
+    if (spool_open(&up->spool, up->config.spool_dir, up->config.spool_bytes) != 0) {
+        // Not fatal: upload as before, dropping what the API refuses
+        fprintf(stderr, "Uploader %d continuing without a spool\n", up->id);
+        return 0;
+    }
+    up->spool_ready = true;
+    return 0;
+}
+
+int uploader_start(uploader_t *up, int id, const uploader_config_t *config) {
+    memset(up, 0, sizeof(*up));
+    up->id = id;
+    up->config = *config;
+    up->healthy = true;
+
+    int producers = config->num_producers;
+    if (producers < 1) producers = 1;
+    if (producers > UPLOADER_MAX_PRODUCERS) producers = UPLOADER_MAX_PRODUCERS;
+
+    for (int i = 0; i < producers; i++) {
+        if (event_queue_init(&up->queues[i], config->queue_capacity) != 0) {
+            fprintf(stderr, "Failed to allocate event queue for uploader %d\n", id);
+            destroy_queues(up);
+            return -1;
+        }
+        up->num_queues++;
+    }
+
+    if (batching(up)) {
+        if (http_batch_init(&up->batch, config->batch_size, config->wire_format) != 0 ||
+            !(up->pending = malloc((size_t)up->batch.max_events * sizeof(*up->pending)))) {
+            fprintf(stderr, "Failed to allocate batch buffer for uploader %d\n", id);
+            free_buffers(up);
+            destroy_queues(up);
+            return -1;
+        }
+    }
+
+    if (config->num_sketches > 0 && !(up->sketch_buf = malloc(SKETCH_WIRE_MAX_LEN))) {
+        fprintf(stderr, "Failed to allocate sketch buffer for uploader %d\n", id);
+        free_buffers(up);
+        destroy_queues(up);
+        return -1;
+    }
+
+    if (config->spool_dir && open_spool(up) != 0) {
+        fprintf(stderr, "Failed to allocate replay buffer for uploader %d\n", id);
+        free_buffers(up);
+        destroy_queues(up);
+        return -1;
+    }
+
+    if (http_client_init(&up->client, config->api_url, config->sniffer_id, config->compression) != 0) {
+        fprintf(stderr, "Failed to create HTTP client for uploader %d\n", id);
+        if (up->spool_ready) spool_close(&up->spool);
+        free_buffers(up);
+        destroy_queues(up);
+        return -1;
+    }
+
+    atomic_store(&up->running, true);
+    if (pthread_create(&up->thread, NULL, uploader_thread, up) != 0) {
+        fprintf(stderr, "Failed to create uploader thread %d\n", id);
+        http_client_cleanup(&up->client);
+        if (up->spool_ready) spool_close(&up->spool);
+        free_buffers(up);
+        destroy_queues(up);
+        return -1;
+    }
+
+    return 0;
+}
+
+void uploader_stop(uploader_t *up) {
+    if (up->num_queues == 0) return;
+
+    atomic_store_explicit(&up->running, false, memory_order_release);
+    pthread_join(up->thread, NULL);
+    http_client_cleanup(&up->client);
+
+    if (up->spool_ready) {
+        spool_t *s = &up->spool;
+        if (s->appended > 0 || s->replayed > 0) {
+            printf("Uploader %d spool: %llu spooled, %llu replayed, %llu dropped, %llu corrupt\n", up->id,
+                   (unsigned long long)s->appended, (unsigned long long)s->replayed,
+                   (unsigned long long)s->dropped, (unsigned long long)s->corrupt);
+        }
+        spool_close(s);
+        up->spool_ready = false;
+    }
+
+    free_buffers(up);
+    destroy_queues(up);
+}
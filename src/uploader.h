@@ -0,0 +1,67 @@
+#ifndef UPLOADER_H
+#define UPLOADER_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "event_queue.h"
+#include "http_client.h"
+#include "spool.h"
+#include "sketch.h"
+#include "telemetry.h"
+
+#define UPLOADER_MAX 8
+#define UPLOADER_IDLE_US 1000
+#define UPLOADER_MAX_PRODUCERS 8   // Capture or worker threads feeding each uploader
+#define UPLOADER_REPLAY_EVENTS 256 // Spooled events per replay POST
+#define UPLOADER_PROBE_MS 2000     // Replay retry interval while the API is down
+
+typedef struct {
+    const char *api_url;
+    const char *sniffer_id;
+    size_t queue_capacity;
+    int num_producers;     // One SPSC queue per capture (or worker) thread
+    int batch_size;        // Events per POST; <= 1 posts each event on its own
+    int batch_flush_ms;    // Upper bound on how long an event waits in a batch
+    http_wire_format_t wire_format;
+    http_compression_t compression;   // Of batch bodies
+    const char *spool_dir;  // Per-uploader spool directory; NULL disables spooling
+    size_t spool_bytes;     // Disk budget for this uploader's spool
+    sketch_outbox_t *sketches[UPLOADER_MAX_PRODUCERS];   // Probe sketch outboxes to post from
+    int num_sketches;
+} uploader_config_t;
+
+// One uploader thread drains its SPSC queues (one per producer thread) and
+// performs the blocking HTTP work, so capture never waits on the network.
+typedef struct {
+    int id;
+    uploader_config_t config;
+    pthread_t thread;
+    atomic_bool running;
+    event_queue_t queues[UPLOADER_MAX_PRODUCERS];
+    int num_queues;
+    int next_queue;         // Round-robin start so no producer starves the others
+    http_client_t client;   // Persistent keep-alive connection to the API
+    http_batch_t batch;
+    flux_event_t *pending;  // Copies of the events in batch, spooled if its POST fails
+    uint64_t batch_started_ms;
+
+    // While the API is unreachable or the queues back up, events go to the
+    // spool instead, and are replayed from it once posts succeed again
+    spool_t spool;
+    bool spool_ready;
+    bool healthy;
+    bool spilling;          // Queue depth crossed the high watermark
+    uint64_t next_probe_ms;
+    http_batch_t replay_batch;
+    flux_event_t *replay;
+
+    uint8_t *sketch_buf;    // Encoded probe sketch
+    uploader_telemetry_t telemetry;
+} uploader_t;
+
+int uploader_start(uploader_t *up, int id, const uploader_config_t *config);
+// Stops accepting work, drains whatever is still queued, and joins the thread
+void uploader_stop(uploader_t *up);
+
+#endif